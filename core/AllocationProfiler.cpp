@@ -0,0 +1,546 @@
+#include "core/AllocationProfiler.h"
+#include "core/Atomic.h"
+#include "core/MemManager.h"
+#include "core/RdeAssert.h"
+#include "core/System.h"
+#include "core/Thread.h"
+#include <cstring>
+
+// Binary report layout (native endianness):
+//	uint32 magic ('RDAP'), uint32 version, uint32 numTags, uint32 numCallsites
+//	numTags x:
+//		uint16 nameLength, char name[nameLength]
+//		uint64 numAllocs, uint64 allocatedBytes
+//		uint32 numAllocsPerFrame, uint64 allocatedBytesPerFrame
+//		int64 liveBytes, int64 peakLiveBytes
+//	numCallsites x:
+//		uint32 tagIndex, uint32 numSamples, int64 liveBytes, int64 peakLiveBytes
+//		uint8 numFrames, uint64 frames[numFrames]
+
+namespace
+{
+typedef rde::AllocationProfiler Profiler;
+
+const rde::uint32	kReportMagic		= 0x50414452;	// 'RDAP'
+const rde::uint32	kReportVersion		= 1;
+const int			kTagHashSize		= Profiler::kMaxTags * 2;
+const int			kCallsiteHashSize	= Profiler::kMaxCallsites * 2;
+// Table of live sampled allocations.
+const int			kMaxSamples			= 1 << 16;
+const int			kMaxSampleProbes	= 16;
+const rde::int64	kSampleEmpty		= 0;
+const rde::int64	kSampleDeleted		= 1;
+// RecordSample + alloc handler + MemManager::Alloc.
+const int			kFramesToSkip		= 3;
+
+// Only written by owner thread, read (without synchronization) by EndFrame.
+struct TagCounters
+{
+	rde::uint64	numAllocs;
+	rde::uint64	allocatedBytes;
+	// Sum of weights of sampled allocations made - freed by this thread.
+	rde::int64	sampledLiveBytes;
+};
+struct ThreadData
+{
+	TagCounters	tags[Profiler::kMaxTags];
+	rde::int64	bytesUntilSample;
+	rde::uint32	randomState;
+};
+
+struct Sample
+{
+	rde::Atomic64	address;
+	rde::int64		weight;
+	int				tagIndex;
+	int				callsiteIndex;
+};
+
+struct Callsite
+{
+	void*		frames[Profiler::kMaxCallstackDepth];
+	int			numFrames;
+	int			tagIndex;
+	rde::uint32	hash;
+	rde::uint32	numSamples;
+	rde::int64	liveBytes;
+	rde::int64	peakLiveBytes;
+};
+
+// Everything's zero-initialized, profiler can be started before
+// static initialization is done.
+ThreadData		s_threadData[Profiler::kMaxThreads];
+rde::Atomic32	s_numThreads;
+RDE_THREADLOCAL ThreadData*	s_currentThreadData;
+// Set while inside profiler, capturing callstack might allocate.
+RDE_THREADLOCAL bool		s_inProfiler;
+RDE_THREADLOCAL const char*	s_currentTag;
+// Most allocations in a row come with the same tag.
+RDE_THREADLOCAL const char*	s_lastTag;
+RDE_THREADLOCAL int			s_lastTagIndex;
+
+// Tags are never removed. Index 0 = untagged.
+const char*		s_tagNames[Profiler::kMaxTags];
+rde::Atomic32	s_numTags;
+// Index + 1, 0 = empty.
+rde::Atomic32	s_tagHash[kTagHashSize];
+rde::Atomic32	s_tagLock;
+
+Sample			s_samples[kMaxSamples];
+rde::Atomic32	s_numDroppedSamples;
+
+// Only touched when sampling, guarded by lock.
+Callsite		s_callsites[Profiler::kMaxCallsites];
+int				s_numCallsites;
+int				s_callsiteHash[kCallsiteHashSize];
+rde::Atomic32	s_callsiteLock;
+
+bool			s_running;
+rde::int64		s_samplingInterval;
+
+// Results of last EndFrame.
+Profiler::TagStats	s_tagStats[Profiler::kMaxTags];
+int					s_numTagStats;
+
+void Lock(rde::Atomic32& lock)
+{
+	while (rde::Interlocked::CompareAndSwap(&lock, 0, 1) != 0)
+		rde::Thread::YieldCurrentThread();
+}
+void Unlock(rde::Atomic32& lock)
+{
+	rde::Interlocked::FetchAndStore(&lock, 0);
+}
+
+RDE_FORCEINLINE rde::uint32 HashPointer(const void* ptr)
+{
+	rde::uint64 h = rde::uint64(size_t(ptr));
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	return rde::uint32(h);
+}
+rde::uint32 XorShift(rde::uint32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+// Randomized (uniform in [1, 2*interval]), so that periodic allocation
+// patterns don't always sample same allocations.
+rde::int64 NextSampleDistance(ThreadData* threadData)
+{
+	return 1 + rde::int64(XorShift(threadData->randomState)) % (2 * s_samplingInterval);
+}
+
+ThreadData* GetThreadData()
+{
+	ThreadData* threadData = s_currentThreadData;
+	if (threadData == 0)
+	{
+		// Threads beyond the limit share the last buffer (counters become approximate).
+		int index = int(rde::Interlocked::Increment(&s_numThreads)) - 1;
+		if (index >= Profiler::kMaxThreads)
+		{
+			index = Profiler::kMaxThreads - 1;
+			s_numThreads = Profiler::kMaxThreads;
+		}
+		threadData = &s_threadData[index];
+		threadData->randomState = 2463534242U + index * 7919;
+		threadData->bytesUntilSample = NextSampleDistance(threadData);
+		s_currentThreadData = threadData;
+	}
+	return threadData;
+}
+
+int FindOrAddTag(const char* tag)
+{
+	const rde::uint32 mask = kTagHashSize - 1;
+	const rde::uint32 hash = HashPointer(tag);
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (rde::uint32 i = 0; i < rde::uint32(kTagHashSize); ++i)
+		{
+			const rde::uint32 slot = (hash + i) & mask;
+			const int index = int(rde::Load_Acquire(s_tagHash[slot])) - 1;
+			if (index < 0)
+			{
+				if (pass == 0)
+					break;
+				// Still under lock.
+				const int newIndex = int(s_numTags);
+				if (newIndex >= Profiler::kMaxTags)
+				{
+					Unlock(s_tagLock);
+					return 0;
+				}
+				s_tagNames[newIndex] = tag;
+				s_numTags = newIndex + 1;
+				rde::MemoryBarrier();
+				s_tagHash[slot] = newIndex + 1;
+				Unlock(s_tagLock);
+				return newIndex;
+			}
+			if (s_tagNames[index] == tag)
+			{
+				if (pass == 1)
+					Unlock(s_tagLock);
+				return index;
+			}
+		}
+		// Not found, try again under lock (someone might be adding it right now).
+		if (pass == 0)
+			Lock(s_tagLock);
+	}
+	Unlock(s_tagLock);
+	return 0;
+}
+RDE_FORCEINLINE int GetTagIndex(const char* tag)
+{
+	if (tag == 0)
+		return 0;
+	if (tag != s_lastTag)
+	{
+		s_lastTagIndex = FindOrAddTag(tag);
+		s_lastTag = tag;
+	}
+	return s_lastTagIndex;
+}
+
+// @pre Callsite lock taken.
+int FindOrAddCallsite(void** frames, int numFrames, int tagIndex)
+{
+	rde::uint32 hash = rde::uint32(tagIndex) * 2654435761U;
+	for (int i = 0; i < numFrames; ++i)
+		hash = (hash ^ HashPointer(frames[i])) * 16777619U;
+
+	const rde::uint32 mask = kCallsiteHashSize - 1;
+	for (rde::uint32 i = 0; i < rde::uint32(kCallsiteHashSize); ++i)
+	{
+		const rde::uint32 slot = (hash + i) & mask;
+		const int index = s_callsiteHash[slot] - 1;
+		if (index < 0)
+		{
+			if (s_numCallsites >= Profiler::kMaxCallsites)
+				return -1;
+			Callsite& callsite = s_callsites[s_numCallsites];
+			memcpy(callsite.frames, frames, numFrames * sizeof(void*));
+			callsite.numFrames = numFrames;
+			callsite.tagIndex = tagIndex;
+			callsite.hash = hash;
+			s_callsiteHash[slot] = ++s_numCallsites;
+			return s_numCallsites - 1;
+		}
+		const Callsite& callsite = s_callsites[index];
+		if (callsite.hash == hash && callsite.tagIndex == tagIndex && callsite.numFrames == numFrames &&
+			memcmp(callsite.frames, frames, numFrames * sizeof(void*)) == 0)
+		{
+			return index;
+		}
+	}
+	return -1;
+}
+
+bool InsertSample(const void* ptr, rde::int64 weight, int tagIndex, int callsiteIndex)
+{
+	const rde::int64 address = rde::int64(size_t(ptr));
+	const rde::uint32 hash = HashPointer(ptr);
+	for (int i = 0; i < kMaxSampleProbes; ++i)
+	{
+		Sample& sample = s_samples[(hash + i) & (kMaxSamples - 1)];
+		const rde::int64 current = sample.address;
+		if ((current == kSampleEmpty || current == kSampleDeleted) &&
+			rde::Interlocked::CompareAndSwap(&sample.address, current, address) == current)
+		{
+			// Nobody can look for this address until allocation returns.
+			sample.weight = weight;
+			sample.tagIndex = tagIndex;
+			sample.callsiteIndex = callsiteIndex;
+			return true;
+		}
+	}
+	return false;
+}
+// False if address wasn't sampled.
+bool RemoveSample(const void* ptr, Sample& outSample)
+{
+	const rde::int64 address = rde::int64(size_t(ptr));
+	const rde::uint32 hash = HashPointer(ptr);
+	for (int i = 0; i < kMaxSampleProbes; ++i)
+	{
+		Sample& sample = s_samples[(hash + i) & (kMaxSamples - 1)];
+		const rde::int64 current = sample.address;
+		if (current == kSampleEmpty)
+			return false;
+		if (current == address)
+		{
+			outSample.weight = sample.weight;
+			outSample.tagIndex = sample.tagIndex;
+			outSample.callsiteIndex = sample.callsiteIndex;
+			rde::Interlocked::FetchAndStore(&sample.address, kSampleDeleted);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Slow path, on average once per sampling interval bytes.
+void RecordSample(ThreadData* threadData, const void* ptr, rde::int64 weight, int tagIndex)
+{
+	s_inProfiler = true;
+	void* frames[Profiler::kMaxCallstackDepth];
+	const int numFrames = rde::Sys::CaptureCallstack(frames, Profiler::kMaxCallstackDepth, kFramesToSkip);
+
+	Lock(s_callsiteLock);
+	const int callsiteIndex = FindOrAddCallsite(frames, numFrames, tagIndex);
+	if (InsertSample(ptr, weight, tagIndex, callsiteIndex))
+	{
+		threadData->tags[tagIndex].sampledLiveBytes += weight;
+		if (callsiteIndex >= 0)
+		{
+			Callsite& callsite = s_callsites[callsiteIndex];
+			++callsite.numSamples;
+			callsite.liveBytes += weight;
+			if (callsite.liveBytes > callsite.peakLiveBytes)
+				callsite.peakLiveBytes = callsite.liveBytes;
+		}
+	}
+	else
+	{
+		rde::Interlocked::Increment(&s_numDroppedSamples);
+	}
+	Unlock(s_callsiteLock);
+	s_inProfiler = false;
+}
+
+void OnAlloc(const void* ptr, size_t bytes, const char* tag)
+{
+	if (ptr == 0 || s_inProfiler)
+		return;
+
+	ThreadData* threadData = GetThreadData();
+	const int tagIndex = GetTagIndex(tag != 0 ? tag : s_currentTag);
+	TagCounters& counters = threadData->tags[tagIndex];
+	++counters.numAllocs;
+	counters.allocatedBytes += bytes;
+
+	// Big allocations are always sampled, they represent only themselves.
+	// Small ones represent all bytes allocated since last sample.
+	if (rde::int64(bytes) >= s_samplingInterval)
+	{
+		RecordSample(threadData, ptr, rde::int64(bytes), tagIndex);
+	}
+	else
+	{
+		threadData->bytesUntilSample -= rde::int64(bytes);
+		if (threadData->bytesUntilSample <= 0)
+		{
+			threadData->bytesUntilSample = NextSampleDistance(threadData);
+			RecordSample(threadData, ptr, s_samplingInterval, tagIndex);
+		}
+	}
+}
+
+void OnFree(const void* ptr)
+{
+	if (s_inProfiler)
+		return;
+	Sample sample;
+	if (!RemoveSample(ptr, sample))
+		return;
+
+	GetThreadData()->tags[sample.tagIndex].sampledLiveBytes -= sample.weight;
+	if (sample.callsiteIndex >= 0)
+	{
+		Lock(s_callsiteLock);
+		s_callsites[sample.callsiteIndex].liveBytes -= sample.weight;
+		Unlock(s_callsiteLock);
+	}
+}
+
+void OnEndFrame()
+{
+	Profiler::EndFrame();
+}
+
+void WriteString(Profiler::WriteFunc writeFunc, void* userData, const char* str)
+{
+	writeFunc(str, strlen(str), userData);
+}
+template<typename T>
+void WriteValue(Profiler::WriteFunc writeFunc, void* userData, T value)
+{
+	writeFunc(&value, sizeof(value), userData);
+}
+} // namespace
+
+namespace rde
+{
+AllocationProfiler::TagScope::TagScope(const char* tag)
+:	m_prevTag(s_currentTag)
+{
+	s_currentTag = tag;
+}
+AllocationProfiler::TagScope::~TagScope()
+{
+	s_currentTag = m_prevTag;
+}
+
+void AllocationProfiler::Start(size_t samplingInterval)
+{
+	RDE_ASSERT(samplingInterval > 0);
+	s_samplingInterval = int64(samplingInterval);
+	if (s_numTags == 0)
+	{
+		s_tagNames[0] = "untagged";
+		s_numTags = 1;
+	}
+	s_running = true;
+	MemManager::SetOnAllocHandler(OnAlloc);
+	MemManager::SetOnFreeHandler(OnFree);
+	MemManager::SetOnEndFrameHandler(OnEndFrame);
+}
+void AllocationProfiler::Stop()
+{
+	MemManager::SetOnAllocHandler(0);
+	MemManager::SetOnFreeHandler(0);
+	MemManager::SetOnEndFrameHandler(0);
+	s_running = false;
+}
+bool AllocationProfiler::IsRunning()
+{
+	return s_running;
+}
+
+void AllocationProfiler::EndFrame()
+{
+	const int numThreads = int(Load_Acquire(s_numThreads));
+	const int numTags = int(Load_Acquire(s_numTags));
+	for (int tagIndex = 0; tagIndex < numTags; ++tagIndex)
+	{
+		uint64 numAllocs(0);
+		uint64 allocatedBytes(0);
+		int64 liveBytes(0);
+		for (int i = 0; i < numThreads; ++i)
+		{
+			const TagCounters& counters = s_threadData[i].tags[tagIndex];
+			numAllocs += counters.numAllocs;
+			allocatedBytes += counters.allocatedBytes;
+			liveBytes += counters.sampledLiveBytes;
+		}
+		TagStats& stats = s_tagStats[tagIndex];
+		stats.name = s_tagNames[tagIndex];
+		stats.numAllocsPerFrame = uint32(numAllocs - stats.numAllocs);
+		stats.allocatedBytesPerFrame = allocatedBytes - stats.allocatedBytes;
+		stats.numAllocs = numAllocs;
+		stats.allocatedBytes = allocatedBytes;
+		// Can be temporarily negative if sample is freed on another thread.
+		stats.liveBytes = (liveBytes < 0 ? 0 : liveBytes);
+		if (stats.liveBytes > stats.peakLiveBytes)
+			stats.peakLiveBytes = stats.liveBytes;
+	}
+	s_numTagStats = numTags;
+}
+
+int AllocationProfiler::GetNumTags()
+{
+	return s_numTagStats;
+}
+const AllocationProfiler::TagStats& AllocationProfiler::GetTagStats(int tagIndex)
+{
+	RDE_ASSERT(tagIndex >= 0 && tagIndex < s_numTagStats);
+	return s_tagStats[tagIndex];
+}
+int AllocationProfiler::GetNumCallsites()
+{
+	Lock(s_callsiteLock);
+	const int numCallsites = s_numCallsites;
+	Unlock(s_callsiteLock);
+	return numCallsites;
+}
+void AllocationProfiler::GetCallsiteStats(int callsiteIndex, CallsiteStats& outStats)
+{
+	Lock(s_callsiteLock);
+	RDE_ASSERT(callsiteIndex >= 0 && callsiteIndex < s_numCallsites);
+	const Callsite& callsite = s_callsites[callsiteIndex];
+	memcpy(outStats.frames, callsite.frames, callsite.numFrames * sizeof(void*));
+	outStats.numFrames = callsite.numFrames;
+	outStats.tagIndex = callsite.tagIndex;
+	outStats.numSamples = callsite.numSamples;
+	outStats.liveBytes = callsite.liveBytes;
+	outStats.peakLiveBytes = callsite.peakLiveBytes;
+	Unlock(s_callsiteLock);
+}
+uint32 AllocationProfiler::GetNumDroppedSamples()
+{
+	return uint32(Load_Acquire(s_numDroppedSamples));
+}
+
+void AllocationProfiler::WriteReportCSV(WriteFunc writeFunc, void* userData)
+{
+	char line[512];
+	WriteString(writeFunc, userData, "tag,allocs,bytes,allocs_per_frame,bytes_per_frame,live_bytes,peak_live_bytes\n");
+	for (int i = 0; i < s_numTagStats; ++i)
+	{
+		const TagStats& stats = s_tagStats[i];
+		Sys::StringFormat(line, sizeof(line), "%s,%llu,%llu,%u,%llu,%lld,%lld\n", stats.name,
+			(unsigned long long)stats.numAllocs, (unsigned long long)stats.allocatedBytes,
+			(unsigned int)stats.numAllocsPerFrame, (unsigned long long)stats.allocatedBytesPerFrame,
+			(long long)stats.liveBytes, (long long)stats.peakLiveBytes);
+		WriteString(writeFunc, userData, line);
+	}
+
+	WriteString(writeFunc, userData, "\ncallsite,tag,samples,live_bytes,peak_live_bytes,frames\n");
+	const int numCallsites = GetNumCallsites();
+	CallsiteStats stats;
+	for (int i = 0; i < numCallsites; ++i)
+	{
+		GetCallsiteStats(i, stats);
+		Sys::StringFormat(line, sizeof(line), "%d,%s,%u,%lld,%lld,", i, s_tagNames[stats.tagIndex],
+			(unsigned int)stats.numSamples, (long long)stats.liveBytes, (long long)stats.peakLiveBytes);
+		WriteString(writeFunc, userData, line);
+		for (int f = 0; f < stats.numFrames; ++f)
+		{
+			Sys::StringFormat(line, sizeof(line), f == 0 ? "%p" : " %p", stats.frames[f]);
+			WriteString(writeFunc, userData, line);
+		}
+		WriteString(writeFunc, userData, "\n");
+	}
+}
+
+void AllocationProfiler::WriteReportBinary(WriteFunc writeFunc, void* userData)
+{
+	const int numCallsites = GetNumCallsites();
+	WriteValue(writeFunc, userData, kReportMagic);
+	WriteValue(writeFunc, userData, kReportVersion);
+	WriteValue(writeFunc, userData, uint32(s_numTagStats));
+	WriteValue(writeFunc, userData, uint32(numCallsites));
+	for (int i = 0; i < s_numTagStats; ++i)
+	{
+		const TagStats& stats = s_tagStats[i];
+		const uint16 nameLength = uint16(strlen(stats.name));
+		WriteValue(writeFunc, userData, nameLength);
+		writeFunc(stats.name, nameLength, userData);
+		WriteValue(writeFunc, userData, stats.numAllocs);
+		WriteValue(writeFunc, userData, stats.allocatedBytes);
+		WriteValue(writeFunc, userData, stats.numAllocsPerFrame);
+		WriteValue(writeFunc, userData, stats.allocatedBytesPerFrame);
+		WriteValue(writeFunc, userData, stats.liveBytes);
+		WriteValue(writeFunc, userData, stats.peakLiveBytes);
+	}
+	CallsiteStats stats;
+	for (int i = 0; i < numCallsites; ++i)
+	{
+		GetCallsiteStats(i, stats);
+		WriteValue(writeFunc, userData, uint32(stats.tagIndex));
+		WriteValue(writeFunc, userData, stats.numSamples);
+		WriteValue(writeFunc, userData, stats.liveBytes);
+		WriteValue(writeFunc, userData, stats.peakLiveBytes);
+		WriteValue(writeFunc, userData, uint8(stats.numFrames));
+		for (int f = 0; f < stats.numFrames; ++f)
+			WriteValue(writeFunc, userData, uint64(size_t(stats.frames[f])));
+	}
+}
+
+} // rde
@@ -0,0 +1,89 @@
+#ifndef CORE_ALLOCATION_PROFILER_H
+#define CORE_ALLOCATION_PROFILER_H
+
+#include "core/Config.h"
+
+namespace rde
+{
+// Memory profiler plugged into MemManager handlers.
+// Every allocation updates counters of its tag (in buffer of the calling
+// thread, no locks/atomics). Additionally, allocations are sampled (on average
+// one per samplingInterval bytes), sampled ones remember callstack, so that
+// live bytes can be estimated per tag and per callsite.
+// Per-thread counters are aggregated at MemManager::EndFrame.
+// Allocations without explicit tag are attributed to innermost TagScope
+// of the allocating thread (or "untagged"). Tags are identified by address,
+// not contents (use string literals).
+struct AllocationProfiler
+{
+	static const int	kMaxTags			= 256;
+	static const int	kMaxCallsites		= 4096;
+	static const int	kMaxCallstackDepth	= 16;
+	static const int	kMaxThreads			= 64;
+
+	struct TagStats
+	{
+		const char*	name;
+		uint64		numAllocs;
+		uint64		allocatedBytes;
+		// Last frame only.
+		uint32		numAllocsPerFrame;
+		uint64		allocatedBytesPerFrame;
+		// Estimated from samples.
+		int64		liveBytes;
+		int64		peakLiveBytes;
+	};
+	struct CallsiteStats
+	{
+		void*		frames[kMaxCallstackDepth];
+		int			numFrames;
+		int			tagIndex;
+		uint32		numSamples;
+		int64		liveBytes;
+		int64		peakLiveBytes;
+	};
+
+	// Attributes untagged allocations made by the calling thread to 'tag'
+	// for the lifetime of the scope. Tag string has to stay valid.
+	class TagScope
+	{
+	public:
+		explicit TagScope(const char* tag);
+		~TagScope();
+	private:
+		RDE_FORBID_COPY(TagScope);
+		const char*	m_prevTag;
+	};
+
+	// Installs MemManager handlers.
+	// samplingInterval - average number of bytes between samples. Bigger interval
+	// means less overhead, but less precise live bytes estimates.
+	static void Start(size_t samplingInterval = 512 * 1024);
+	static void Stop();
+	static bool IsRunning();
+
+	// Aggregates per-thread counters. Called automatically from MemManager::EndFrame,
+	// should only be called from one thread at a time.
+	static void EndFrame();
+
+	// Results of last EndFrame.
+	static int GetNumTags();
+	static const TagStats& GetTagStats(int tagIndex);
+	static int GetNumCallsites();
+	static void GetCallsiteStats(int callsiteIndex, CallsiteStats& outStats);
+	// Samples that didn't fit in sample table (estimates are too low if > 0).
+	static uint32 GetNumDroppedSamples();
+
+	// Report writers. Output goes through callback, so that profiler doesn't
+	// depend on any particular stream implementation.
+	typedef void (*WriteFunc)(const void* data, size_t bytes, void* userData);
+	// Human readable, tags first, then callsites (frames as hex addresses).
+	static void WriteReportCSV(WriteFunc writeFunc, void* userData);
+	// Compact format, see AllocationProfiler.cpp for layout.
+	static void WriteReportBinary(WriteFunc writeFunc, void* userData);
+};
+
+} // rde
+
+//-----------------------------------------------------------------------------
+#endif // #ifndef CORE_ALLOCATION_PROFILER_H
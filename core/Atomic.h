@@ -0,0 +1,15 @@
+#ifndef CORE_ATOMIC_H
+#define CORE_ATOMIC_H
+
+#include "core/Config.h"
+#include "core/RdeAssert.h"		// RDE_COMPILE_CHECK
+
+#if RDE_PLATFORM_WIN32
+#	include "core/win32/Win32Interlocked.h"
+#elif RDE_PLATFORM_POSIX
+#	include "core/posix/PosixInterlocked.h"
+#else
+#	error "Platform not supported"
+#endif
+
+#endif // #ifndef CORE_ATOMIC_H
@@ -3,6 +3,8 @@
 
 #if defined (_MSC_VER)
 #	include "msvc/MsvcConfig.h"
+#elif defined (__GNUC__)
+#	include "gcc/GccConfig.h"
 #else
 #	error "Compiler not supported"
 #endif
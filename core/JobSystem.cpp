@@ -0,0 +1,415 @@
+#include "core/JobSystem.h"
+#include "core/BitMath.h"
+#include "core/RdeAssert.h"
+#include "core/Semaphore.h"
+#include "core/Thread.h"
+#include "core/WorkStealingQueue.h"
+
+namespace
+{
+// Jobs are allocated from per-thread ring buffer.
+const rde::uint32	kMaxJobsPerThread	= 4096;
+const long			kQueueCapacity		= 4096;
+// Number of unsuccessful attempts to find a job before worker goes to sleep.
+const int			kIdleSpinCount		= 64;
+const unsigned int	kWorkerStackSize	= 64 * 1024;
+
+// Worker of the current thread (NULL if not a worker/owner thread).
+RDE_THREADLOCAL void*	s_currentWorker(0);
+
+RDE_FORCEINLINE rde::uint32 XorShift(rde::uint32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+}
+
+namespace rde
+{
+struct JobSystem::Job
+{
+	JobFunc		m_func;
+	RangeFunc	m_rangeFunc;
+	void*		m_userData;
+	int			m_begin;
+	int			m_end;
+	int			m_granularity;
+	Counter*	m_counter;
+	Job*		m_nextDependent;
+	Atomic32	m_inUse;
+};
+
+JobSystem::Counter::Counter()
+:	m_value(0),
+	m_lock(0),
+	m_dependents(0)
+{
+	/**/
+}
+JobSystem::Counter::~Counter()
+{
+	RDE_ASSERT(IsDone() && "Destroying counter with jobs in flight");
+	RDE_ASSERT(m_dependents == 0);
+}
+
+struct JobSystem::Impl
+{
+	struct Worker
+	{
+		Worker()
+		:	m_nextJob(0),
+			m_randomState(0),
+			m_index(0),
+			m_system(0)
+		{
+			for (uint32 i = 0; i < kMaxJobsPerThread; ++i)
+				m_jobs[i].m_inUse = 0;
+		}
+		void Run()
+		{
+			s_currentWorker = this;
+			m_system->WorkerLoop(this);
+			s_currentWorker = 0;
+		}
+
+		WorkStealingQueue<Job*, kQueueCapacity>	m_queue;
+		Job				m_jobs[kMaxJobsPerThread];
+		uint32			m_nextJob;
+		uint32			m_randomState;
+		int				m_index;
+		Impl*			m_system;
+		Thread			m_thread;
+	};
+
+	explicit Impl(int numWorkerThreads)
+	:	m_workers(new Worker[numWorkerThreads + 1]),
+		m_numWorkers(numWorkerThreads + 1),
+		m_numSleeping(0),
+		m_numJobsInFlight(0),
+		m_quit(0)
+	{
+		for (int i = 0; i < m_numWorkers; ++i)
+		{
+			m_workers[i].m_index = i;
+			m_workers[i].m_randomState = 2463534242U + i * 7919;
+			m_workers[i].m_system = this;
+		}
+		// Worker 0 belongs to thread that created the system.
+		RDE_ASSERT(s_currentWorker == 0 && "Only one job system per thread");
+		s_currentWorker = &m_workers[0];
+		for (int i = 1; i < m_numWorkers; ++i)
+		{
+			m_workers[i].m_thread.Start(Thread::Delegate::from_method<Worker, &Worker::Run>(&m_workers[i]),
+				kWorkerStackSize);
+		}
+	}
+	~Impl()
+	{
+		Interlocked::FetchAndStore(&m_quit, 1);
+		m_wakeUp.Signal(m_numWorkers);
+		for (int i = 1; i < m_numWorkers; ++i)
+			m_workers[i].m_thread.Stop();
+		if (s_currentWorker == &m_workers[0])
+			s_currentWorker = 0;
+		delete[] m_workers;
+	}
+
+	Worker* GetCurrentWorker() const
+	{
+		Worker* worker = static_cast<Worker*>(s_currentWorker);
+		RDE_ASSERT(worker != 0 && worker->m_system == this && "Not a job system thread");
+		return worker;
+	}
+
+	Job* AllocateJob(Worker* worker)
+	{
+		while (true)
+		{
+			// Normally first slot is free, unless there's a lot of jobs in flight.
+			for (uint32 i = 0; i < kMaxJobsPerThread; ++i)
+			{
+				Job* job = &worker->m_jobs[worker->m_nextJob++ & (kMaxJobsPerThread - 1)];
+				if (Load_Acquire(job->m_inUse) == 0)
+				{
+					job->m_inUse = 1;
+					Interlocked::Increment(&m_numJobsInFlight);
+					return job;
+				}
+			}
+			// All slots taken, help with finishing some of them.
+			if (!ExecuteNext(worker))
+				Thread::YieldCurrentThread();
+		}
+	}
+
+	void Push(Worker* worker, Job* job)
+	{
+		// Queue full, no choice but to do it immediately.
+		if (!worker->m_queue.Push(job))
+		{
+			Execute(worker, job);
+			return;
+		}
+		// Pairs with barrier in Sleep(), either we see sleeping worker or
+		// it sees our job.
+		MemoryBarrier();
+		if (Load_Acquire(m_numSleeping) > 0)
+			m_wakeUp.Signal(1);
+	}
+
+	void Submit(Worker* worker, Job* job, Counter* dependency)
+	{
+		if (job->m_counter)
+			Interlocked::Increment(&job->m_counter->m_value);
+		if (dependency == 0 || !AddDependent(*dependency, job))
+			Push(worker, job);
+	}
+
+	// False if counter is already done (job can be started immediately).
+	bool AddDependent(Counter& counter, Job* job)
+	{
+		LockCounter(counter);
+		// Not IsDone(), we hold the lock.
+		const bool added = Load_Acquire(counter.m_value) != 0;
+		if (added)
+		{
+			job->m_nextDependent = counter.m_dependents;
+			counter.m_dependents = job;
+		}
+		UnlockCounter(counter);
+		return added;
+	}
+
+	void Finish(Worker* worker, Job* job)
+	{
+		Counter* counter = job->m_counter;
+		// Slot can be reused right after this point.
+		Interlocked::FetchAndStore(&job->m_inUse, 0);
+		Job* dependent(0);
+		if (counter != 0)
+			dependent = ReleaseCounter(*counter);
+		// Counter may be gone already (IsDone() is true after unlock).
+		while (dependent != 0)
+		{
+			Job* next = dependent->m_nextDependent;
+			Push(worker, dependent);
+			dependent = next;
+		}
+		// Last, jobs spawned by this one (and dependents) are counted already.
+		Interlocked::Decrement(&m_numJobsInFlight);
+	}
+	// @return dependents to start if counter dropped to 0.
+	Job* ReleaseCounter(Counter& counter)
+	{
+		// Fast path, not the last one, nobody can observe 0 yet.
+		long value = Load_Acquire(counter.m_value);
+		while (value > 1)
+		{
+			const long prev = Interlocked::CompareAndSwap(&counter.m_value, value, value - 1);
+			if (prev == value)
+				return 0;
+			value = prev;
+		}
+		// Dependents are taken before lock is released, waiter can't
+		// destroy counter before that (see Counter::IsDone).
+		LockCounter(counter);
+		Job* dependent(0);
+		if (Interlocked::Decrement(&counter.m_value) == 0)
+		{
+			dependent = counter.m_dependents;
+			counter.m_dependents = 0;
+		}
+		UnlockCounter(counter);
+		return dependent;
+	}
+
+	void Execute(Worker* worker, Job* job)
+	{
+		if (job->m_rangeFunc != 0)
+		{
+			// Keep splitting range in half, other threads steal the right halves.
+			int end = job->m_end;
+			while (end - job->m_begin > job->m_granularity)
+			{
+				const int mid = job->m_begin + (end - job->m_begin) / 2;
+				Job* half = AllocateJob(worker);
+				half->m_func = 0;
+				half->m_rangeFunc = job->m_rangeFunc;
+				half->m_userData = job->m_userData;
+				half->m_begin = mid;
+				half->m_end = end;
+				half->m_granularity = job->m_granularity;
+				half->m_counter = job->m_counter;
+				Submit(worker, half, 0);
+				end = mid;
+			}
+			job->m_rangeFunc(job->m_begin, end, job->m_userData);
+		}
+		else
+		{
+			job->m_func(job->m_userData);
+		}
+		Finish(worker, job);
+	}
+
+	Job* FindJob(Worker* worker)
+	{
+		Job* job(0);
+		if (worker->m_queue.Pop(job))
+			return job;
+
+		// Start from random victim, so that thieves don't all fight for the same queue.
+		const int start = int(XorShift(worker->m_randomState) % m_numWorkers);
+		for (int i = 0; i < m_numWorkers; ++i)
+		{
+			Worker& victim = m_workers[(start + i) % m_numWorkers];
+			if (&victim != worker && victim.m_queue.Steal(job))
+				return job;
+		}
+		return 0;
+	}
+	bool ExecuteNext(Worker* worker)
+	{
+		Job* job = FindJob(worker);
+		if (job != 0)
+			Execute(worker, job);
+		return job != 0;
+	}
+
+	void Wait(Worker* worker, const Counter& counter)
+	{
+		while (!counter.IsDone())
+		{
+			if (!ExecuteNext(worker))
+				Thread::YieldCurrentThread();
+		}
+	}
+
+	bool HasQueuedJobs() const
+	{
+		for (int i = 0; i < m_numWorkers; ++i)
+		{
+			if (!m_workers[i].m_queue.IsEmpty())
+				return true;
+		}
+		return false;
+	}
+	void Sleep()
+	{
+		Interlocked::Increment(&m_numSleeping);
+		// Increment is a full barrier, so we either see new job or pusher sees us.
+		if (!HasQueuedJobs() && !Load_Acquire(m_quit))
+			m_wakeUp.WaitInfinite();
+		Interlocked::Decrement(&m_numSleeping);
+	}
+	void WorkerLoop(Worker* worker)
+	{
+		int idleCount(0);
+		while (!Load_Acquire(m_quit))
+		{
+			if (ExecuteNext(worker))
+			{
+				idleCount = 0;
+			}
+			else if (++idleCount < kIdleSpinCount)
+			{
+				Thread::YieldCurrentThread();
+			}
+			else
+			{
+				Sleep();
+				idleCount = 0;
+			}
+		}
+	}
+
+	static void LockCounter(Counter& counter)
+	{
+		while (Interlocked::CompareAndSwap(&counter.m_lock, 0, 1) != 0)
+			Thread::YieldCurrentThread();
+	}
+	static void UnlockCounter(Counter& counter)
+	{
+		Interlocked::FetchAndStore(&counter.m_lock, 0);
+	}
+
+	Worker*		m_workers;
+	int			m_numWorkers;
+	Semaphore	m_wakeUp;
+	Atomic32	m_numSleeping;
+	// Allocated, but not finished yet (queued, running, waiting for dependency).
+	Atomic32	m_numJobsInFlight;
+	Atomic32	m_quit;
+};
+
+JobSystem::JobSystem(int numWorkerThreads)
+{
+	if (numWorkerThreads < 0)
+		numWorkerThreads = int(NumBits(Thread::GetProcessAffinityMask())) - 1;
+	if (numWorkerThreads < 0)
+		numWorkerThreads = 0;
+	if (numWorkerThreads > kMaxWorkerThreads)
+		numWorkerThreads = kMaxWorkerThreads;
+	m_impl.Reset(new Impl(numWorkerThreads));
+}
+JobSystem::~JobSystem()
+{
+	// Empty queue of this thread is not enough, jobs might be still running
+	// on workers (and spawn new ones) or wait for dependencies.
+	Impl::Worker* worker = m_impl->GetCurrentWorker();
+	while (Load_Acquire(m_impl->m_numJobsInFlight) != 0)
+	{
+		if (!m_impl->ExecuteNext(worker))
+			Thread::YieldCurrentThread();
+	}
+}
+
+void JobSystem::Run(JobFunc func, void* userData, Counter* counter, Counter* dependency)
+{
+	RDE_ASSERT(func != 0);
+	Impl::Worker* worker = m_impl->GetCurrentWorker();
+	Job* job = m_impl->AllocateJob(worker);
+	job->m_func = func;
+	job->m_rangeFunc = 0;
+	job->m_userData = userData;
+	job->m_counter = counter;
+	m_impl->Submit(worker, job, dependency);
+}
+
+void JobSystem::Wait(Counter& counter)
+{
+	m_impl->Wait(m_impl->GetCurrentWorker(), counter);
+}
+
+void JobSystem::ParallelFor(int begin, int end, int granularity, RangeFunc func, void* userData)
+{
+	RDE_ASSERT(func != 0);
+	if (begin >= end)
+		return;
+	if (granularity < 1)
+		granularity = 1;
+
+	Impl::Worker* worker = m_impl->GetCurrentWorker();
+	Counter counter;
+	Job* job = m_impl->AllocateJob(worker);
+	job->m_func = 0;
+	job->m_rangeFunc = func;
+	job->m_userData = userData;
+	job->m_begin = begin;
+	job->m_end = end;
+	job->m_granularity = granularity;
+	job->m_counter = &counter;
+	Interlocked::Increment(&counter.m_value);
+	// Process first part on this thread straight away.
+	m_impl->Execute(worker, job);
+	m_impl->Wait(worker, counter);
+}
+
+int JobSystem::GetNumWorkerThreads() const
+{
+	return m_impl->m_numWorkers - 1;
+}
+
+} // rde
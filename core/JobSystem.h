@@ -0,0 +1,102 @@
+#ifndef CORE_JOB_SYSTEM_H
+#define CORE_JOB_SYSTEM_H
+
+#include "core/Atomic.h"
+#include "core/ScopedPtr.h"
+
+namespace rde
+{
+// Work-stealing job scheduler.
+// Every worker thread (+ thread that created the system) has its own job
+// deque. New jobs go to deque of the thread that spawned them, idle threads
+// steal from others.
+// Jobs can be spawned from the owner thread and from inside of other jobs.
+class JobSystem
+{
+	struct Job;
+
+public:
+	typedef void (*JobFunc)(void* userData);
+	// Processes [begin, end) range.
+	typedef void (*RangeFunc)(int begin, int end, void* userData);
+
+	// Tracks number of unfinished jobs. Can be waited on and can be used
+	// as dependency for other jobs (they're started when counter drops to 0).
+	class Counter
+	{
+	public:
+		Counter();
+		~Counter();
+
+		// Lock is checked too (after value!), last job still uses counter
+		// (takes dependents) until it's released.
+		bool IsDone() const
+		{
+			return Load_Acquire(m_value) == 0 && Load_Acquire(m_lock) == 0;
+		}
+
+	private:
+		RDE_FORBID_COPY(Counter);
+		friend class JobSystem;
+
+		Atomic32	m_value;
+		Atomic32	m_lock;
+		// Jobs waiting for this counter to reach 0.
+		Job*		m_dependents;
+	};
+
+	static const int	kMaxWorkerThreads	= 31;
+
+	// numWorkerThreads < 0 -> one per CPU (minus 1 for owner thread).
+	explicit JobSystem(int numWorkerThreads = -1);
+	// Waits for all jobs (including ones spawned by other jobs).
+	~JobSystem();
+
+	// counter (optional) - incremented now, decremented when job is finished.
+	// dependency (optional) - job won't start until it reaches 0.
+	void Run(JobFunc func, void* userData, Counter* counter = 0, Counter* dependency = 0);
+
+	// Blocks until counter reaches 0. Calling thread executes other jobs
+	// in the meantime.
+	void Wait(Counter& counter);
+
+	// Calls func for sub-ranges of [begin, end) (not longer than granularity)
+	// in parallel, returns when all of them are processed.
+	// Range is split recursively, halves are stolen by idle threads.
+	void ParallelFor(int begin, int end, int granularity, RangeFunc func, void* userData);
+
+	int GetNumWorkerThreads() const;
+
+private:
+	RDE_FORBID_COPY(JobSystem);
+
+	struct Impl;
+	ScopedPtr<Impl>	m_impl;
+};
+
+// Executor for RDESTL parallel algorithms (see rdestl/parallel_sort.h).
+class JobSystemExecutor
+{
+public:
+	explicit JobSystemExecutor(JobSystem& jobSystem)
+	:	m_jobSystem(jobSystem)
+	{
+		/**/
+	}
+
+	int get_num_threads() const
+	{
+		return m_jobSystem.GetNumWorkerThreads() + 1;
+	}
+	void parallel_for(int begin, int end, int granularity, JobSystem::RangeFunc func, void* userData)
+	{
+		m_jobSystem.ParallelFor(begin, end, granularity, func, userData);
+	}
+
+private:
+	JobSystem&	m_jobSystem;
+};
+
+} // rde
+
+#endif // CORE_JOB_SYSTEM_H
@@ -0,0 +1,97 @@
+#include "core/LinearArena.h"
+#include "core/MemManager.h"
+#include "core/RdeAssert.h"
+
+namespace rde
+{
+struct LinearArena::Chunk
+{
+	Chunk*	next;
+	size_t	size;	// Including header.
+};
+
+LinearArena::LinearArena(size_t chunkSize, const char* tag)
+:	m_chunks(0),
+	m_top(0),
+	m_end(0),
+	m_chunkSize(chunkSize),
+	m_allocatedBytes(0),
+	m_reservedBytes(0),
+	m_tag(tag)
+{
+	RDE_ASSERT(chunkSize > sizeof(Chunk));
+}
+LinearArena::~LinearArena()
+{
+	Release();
+}
+
+void* LinearArena::Allocate(size_t bytes, size_t alignment)
+{
+	RDE_ASSERT((alignment & (alignment - 1)) == 0);
+	char* result = reinterpret_cast<char*>((size_t(m_top) + alignment - 1) & ~(alignment - 1));
+	if (m_top == 0 || result + bytes > m_end)
+		return AllocateFromNewChunk(bytes, alignment);
+	m_top = result + bytes;
+	m_allocatedBytes += bytes;
+	return result;
+}
+
+void* LinearArena::AllocateFromNewChunk(size_t bytes, size_t alignment)
+{
+	// Chunk memory itself doesn't have to be aligned to given alignment
+	// (malloc on Win32 only guarantees 8 bytes), so leave room for padding
+	// and align absolute address, just like Allocate does.
+	const size_t maxHeaderSize = sizeof(Chunk) + alignment - 1;
+	const bool isBigBlock = (maxHeaderSize + bytes > m_chunkSize);
+	const size_t chunkSize = (isBigBlock ? maxHeaderSize + bytes : m_chunkSize);
+	Chunk* chunk = static_cast<Chunk*>(MemManager::Alloc(chunkSize, m_tag));
+	chunk->size = chunkSize;
+	m_reservedBytes += chunkSize;
+	m_allocatedBytes += bytes;
+
+	char* result = reinterpret_cast<char*>(
+		(size_t(chunk) + sizeof(Chunk) + alignment - 1) & ~(alignment - 1));
+	// Big blocks don't replace current chunk, there might be plenty of
+	// space left in it. They go to the back of the list.
+	if (isBigBlock && m_chunks != 0)
+	{
+		chunk->next = m_chunks->next;
+		m_chunks->next = chunk;
+	}
+	else
+	{
+		chunk->next = m_chunks;
+		m_chunks = chunk;
+		m_top = result + bytes;
+		m_end = reinterpret_cast<char*>(chunk) + chunkSize;
+	}
+	return result;
+}
+
+void LinearArena::Release()
+{
+	Chunk* chunk = m_chunks;
+	while (chunk != 0)
+	{
+		Chunk* next = chunk->next;
+		MemManager::Free(chunk);
+		chunk = next;
+	}
+	m_chunks = 0;
+	m_top = m_end = 0;
+	m_allocatedBytes = m_reservedBytes = 0;
+}
+
+bool LinearArena::Owns(const void* ptr) const
+{
+	for (const Chunk* chunk = m_chunks; chunk != 0; chunk = chunk->next)
+	{
+		const char* chunkMem = reinterpret_cast<const char*>(chunk);
+		if (ptr >= chunkMem && ptr < chunkMem + chunk->size)
+			return true;
+	}
+	return false;
+}
+
+} // rde
@@ -0,0 +1,100 @@
+#ifndef CORE_LINEAR_ARENA_H
+#define CORE_LINEAR_ARENA_H
+
+#include "core/Config.h"
+#include <new>
+
+namespace rde
+{
+// Bump-pointer allocator. Memory is carved from big chunks and can only
+// be given back all at once (Release/destructor). Destructors of objects
+// constructed in the arena are NOT called, so they shouldn't own anything
+// outside of it.
+// Consecutive allocations are contiguous in memory (unless chunk boundary
+// is crossed).
+class LinearArena
+{
+public:
+	static const size_t	kDefaultAlignment	= 16;
+
+	explicit LinearArena(size_t chunkSize = 64 * 1024, const char* tag = "LinearArena");
+	~LinearArena();
+
+	// Blocks bigger than chunk size get their own chunk.
+	void* Allocate(size_t bytes, size_t alignment = kDefaultAlignment);
+	// Default constructed.
+	template<typename T>
+	T* AllocateArray(int n)
+	{
+		T* result = static_cast<T*>(Allocate(sizeof(T) * n));
+		for (int i = 0; i < n; ++i)
+			new (result + i) T();
+		return result;
+	}
+
+	// Frees all chunks. All pointers returned so far are invalid afterwards.
+	void Release();
+
+	bool Owns(const void* ptr) const;
+	// Bytes handed out by Allocate (excluding alignment padding).
+	size_t GetAllocatedBytes() const	{ return m_allocatedBytes; }
+	// Bytes taken from MemManager.
+	size_t GetReservedBytes() const		{ return m_reservedBytes; }
+
+private:
+	RDE_FORBID_COPY(LinearArena);
+
+	struct Chunk;
+	void* AllocateFromNewChunk(size_t bytes, size_t alignment);
+
+	Chunk*		m_chunks;
+	char*		m_top;
+	char*		m_end;
+	size_t		m_chunkSize;
+	size_t		m_allocatedBytes;
+	size_t		m_reservedBytes;
+	const char*	m_tag;
+};
+
+// Allocator (RDESTL concept) for containers living in the arena.
+// Deallocate is a no-op for arena memory, so containers shouldn't grow
+// much (reserve up front). Without arena it forwards to operator new/delete.
+class LinearArenaAllocator
+{
+public:
+	explicit LinearArenaAllocator(LinearArena* arena = 0)
+	:	m_arena(arena)
+	{
+		/**/
+	}
+
+	void* allocate(size_t bytes, int /*flags*/ = 0)
+	{
+		return m_arena ? m_arena->Allocate(bytes) : operator new(bytes);
+	}
+	void deallocate(void* ptr, size_t /*bytes*/)
+	{
+		if (m_arena == 0 && ptr != 0)
+			operator delete(ptr);
+	}
+
+	const char* get_name() const	{ return "LinearArena"; }
+	LinearArena* get_arena() const	{ return m_arena; }
+
+private:
+	LinearArena*	m_arena;
+};
+
+inline bool operator==(const LinearArenaAllocator& lhs, const LinearArenaAllocator& rhs)
+{
+	return lhs.get_arena() == rhs.get_arena();
+}
+inline bool operator!=(const LinearArenaAllocator& lhs, const LinearArenaAllocator& rhs)
+{
+	return !(lhs == rhs);
+}
+
+} // rde
+
+//-----------------------------------------------------------------------------
+#endif // #ifndef CORE_LINEAR_ARENA_H
@@ -0,0 +1,139 @@
+#ifndef CORE_MPMC_QUEUE_H
+#define CORE_MPMC_QUEUE_H
+
+#include "core/Atomic.h"
+#include "core/BitMath.h"
+
+namespace rde
+{
+// Bounded multi-producer/multi-consumer FIFO queue (D. Vyukov's design).
+// Every cell has a sequence number that tells if it's ready to be written
+// (== position) or read (== position + 1). Producers/consumers only contend
+// on their own index (one CAS per operation), never on each other's.
+// Lock-free, no allocations. T should be a pointer or other small POD
+// (eg. buffer handed from I/O thread to workers).
+template<typename T, long TCapacity>
+class MPMCQueue
+{
+public:
+	MPMCQueue()
+	:	m_enqueuePos(0),
+		m_dequeuePos(0)
+	{
+		RDE_COMPILE_CHECK(RDE_IS_POWER_OF_TWO(TCapacity));
+		RDE_COMPILE_CHECK(TCapacity >= 2 && TCapacity <= (1 << 30));
+		for (long i = 0; i < TCapacity; ++i)
+			m_cells[i].sequence = i;
+	}
+
+	// Any thread. False if queue is full.
+	bool Push(const T& item)
+	{
+		Cell* cell;
+		long pos = Load_Relaxed(m_enqueuePos);
+		for (;;)
+		{
+			cell = &m_cells[pos & kMask];
+			const long diff = Distance(pos, Load_Acquire(cell->sequence));
+			if (diff == 0)
+			{
+				// Cell free, claim it.
+				const long prevPos = Interlocked::CompareAndSwap(&m_enqueuePos, pos, Next(pos));
+				if (prevPos == pos)
+					break;
+				pos = prevPos;
+			}
+			else if (diff < 0)
+			{
+				// Not consumed yet after previous lap.
+				return false;
+			}
+			else
+			{
+				// Other producer got there first.
+				pos = Load_Relaxed(m_enqueuePos);
+			}
+		}
+		cell->data = item;
+		// Publishes data to consumers.
+		Store_Release(cell->sequence, Next(pos));
+		return true;
+	}
+
+	// Any thread. False if queue is empty.
+	bool Pop(T& item)
+	{
+		Cell* cell;
+		long pos = Load_Relaxed(m_dequeuePos);
+		for (;;)
+		{
+			cell = &m_cells[pos & kMask];
+			const long diff = Distance(Next(pos), Load_Acquire(cell->sequence));
+			if (diff == 0)
+			{
+				const long prevPos = Interlocked::CompareAndSwap(&m_dequeuePos, pos, Next(pos));
+				if (prevPos == pos)
+					break;
+				pos = prevPos;
+			}
+			else if (diff < 0)
+			{
+				// Not written yet.
+				return false;
+			}
+			else
+			{
+				pos = Load_Relaxed(m_dequeuePos);
+			}
+		}
+		item = cell->data;
+		// Cell can be reused by producers in next lap.
+		Store_Release(cell->sequence, long((unsigned long)pos + TCapacity));
+		return true;
+	}
+
+	// Approximation, may be stale by the time it returns.
+	long GetSize() const
+	{
+		const long size = Distance(Load_Relaxed(m_dequeuePos), Load_Relaxed(m_enqueuePos));
+		return size < 0 ? 0 : (size > TCapacity ? TCapacity : size);
+	}
+	bool IsEmpty() const	{ return GetSize() == 0; }
+
+private:
+	RDE_FORBID_COPY(MPMCQueue);
+
+	static const long kMask	= TCapacity - 1;
+
+	// Positions wrap around, so arithmetic is done on unsigned values.
+	static long Next(long pos)
+	{
+		return long((unsigned long)pos + 1);
+	}
+	static long Distance(long from, long to)
+	{
+		return long((unsigned long)to - (unsigned long)from);
+	}
+
+	// Sequence is only stored with release/loaded with acquire, doesn't
+	// need to be CAS-able.
+	struct Cell
+	{
+		long	sequence;
+		T		data;
+	};
+
+	// Cells are shared by everyone, indices are only contended by producers
+	// (enqueue) or consumers (dequeue). Keep them on separate cache lines.
+	char		m_pad0[64];
+	Cell		m_cells[TCapacity];
+	char		m_pad1[64];
+	Atomic32	m_enqueuePos;
+	char		m_pad2[64 - sizeof(Atomic32)];
+	Atomic32	m_dequeuePos;
+	char		m_pad3[64 - sizeof(Atomic32)];
+};
+
+} // rde
+
+#endif // CORE_MPMC_QUEUE_H
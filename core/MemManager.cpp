@@ -1,11 +1,12 @@
 #include "core/MemManager.h"
+#include <cstdlib>
 #include <new>
 
 namespace
 {
 	struct MemManagerInitializer
 	{
-		static void __cdecl ExitMem()
+		static void RDE_CDECL ExitMem()
 		{
 			rde::MemManager::Exit();
 		}
@@ -17,44 +18,48 @@ namespace
 
 	rde::MemManager::OnAlloc	onAllocHandler(0);
 	rde::MemManager::OnFree		onFreeHandler(0);
+	rde::MemManager::OnEndFrame	onEndFrameHandler(0);
 }
 
 #if 1
 //-----------------------------------------------------------------------------
-void* __cdecl operator new(size_t bytes) 
+void* RDE_CDECL operator new(size_t bytes) 
 {
 	return rde::MemManager::Alloc(bytes);
 }
-void* __cdecl operator new[](size_t bytes) 
+void* RDE_CDECL operator new[](size_t bytes) 
 {
 	return rde::MemManager::Alloc(bytes);
 }
-void* __cdecl operator new(size_t bytes, const std::nothrow_t&) throw() 
+void* RDE_CDECL operator new(size_t bytes, const std::nothrow_t&) throw() 
 {
 	return rde::MemManager::Alloc(bytes);
 } 
-void* __cdecl operator new[](size_t bytes, const std::nothrow_t&) throw() 
+void* RDE_CDECL operator new[](size_t bytes, const std::nothrow_t&) throw() 
 {
 	return rde::MemManager::Alloc(bytes);
 } 
 
 //-----------------------------------------------------------------------------
-void __cdecl operator delete(void* ptr) throw()
+void RDE_CDECL operator delete(void* ptr) throw()
 {
 	rde::MemManager::Free(ptr);
 }
-void __cdecl operator delete[](void* ptr) throw()
+void RDE_CDECL operator delete[](void* ptr) throw()
 {
 	rde::MemManager::Free(ptr);
 }
 #endif
 
-namespace rde
-{
+// Custom implementation of MemManager functions. Included at global scope,
+// so it can pull its own dependencies (see SizeClassMemManager.h).
 #ifdef RDE_CORE_MEMMGR_HEADER
 #	include RDE_CORE_MEMMGR_HEADER
 #else
 
+namespace rde
+{
+
 static long s_numAllocations(0);
 
 //-----------------------------------------------------------------------------
@@ -71,9 +76,10 @@ void MemManager::Free(void* ptr) throw()
 {
 	if (ptr != 0)
 	{
-		::free(ptr);
+		// Before actual free, address could be reused by another thread otherwise.
 		if (onFreeHandler)
 			onFreeHandler(ptr);
+		::free(ptr);
 	}
 }
 
@@ -85,6 +91,8 @@ void MemManager::BeginFrame()
 //-----------------------------------------------------------------------------
 void MemManager::EndFrame()
 {
+	if (onEndFrameHandler)
+		onEndFrameHandler();
 }
 
 //-----------------------------------------------------------------------------
@@ -99,6 +107,12 @@ void MemManager::SetOnFreeHandler(OnFree handler)
 	onFreeHandler = handler;
 }
 
+//-----------------------------------------------------------------------------
+void MemManager::SetOnEndFrameHandler(OnEndFrame handler)
+{
+	onEndFrameHandler = handler;
+}
+
 //-----------------------------------------------------------------------------
 void MemManager::Exit()
 {
@@ -106,9 +120,9 @@ void MemManager::Exit()
 	sizeof(tits);
 }
 
-#endif // #RDE_CORE_MEMMGR_HEADER 
-
 } // rde
+
+#endif // #RDE_CORE_MEMMGR_HEADER 
 //-----------------------------------------------------------------------------
 
 
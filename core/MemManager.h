@@ -1,6 +1,8 @@
 #ifndef CORE_MEMMANAGER_H
 #define CORE_MEMMANAGER_H
 
+#include "core/Config.h"
+
 namespace rde
 {
 // Memory manager.
@@ -9,6 +11,7 @@ struct MemManager
 	// Handler functions called on every allocation/every free.
 	typedef void (*OnAlloc)(const void* address, size_t bytes, const char* tag);
 	typedef void (*OnFree)(const void* address);
+	typedef void (*OnEndFrame)();
 
 	static void* Alloc(size_t bytes, const char* tag = 0);
     static void Free(void* ptr) throw();
@@ -19,6 +22,7 @@ struct MemManager
 
 	static void SetOnAllocHandler(OnAlloc handler);
 	static void SetOnFreeHandler(OnFree handler);
+	static void SetOnEndFrameHandler(OnEndFrame handler);
     
     // Deinitializes memory manager. It's forbidden to call Alloc/Fre
     // after this function has been executed.
@@ -0,0 +1,35 @@
+#ifndef CORE_MUTEX_H
+#define CORE_MUTEX_H
+
+#include "core/Config.h"
+
+namespace rde
+{
+// Recursive mutex (critical section on Win32).
+// Implemented in win32/Win32Mutex.cpp & posix/PosixMutex.cpp.
+class Mutex
+{
+public:
+	// spinCount - number of spins before thread goes to sleep (if lock is taken).
+	explicit Mutex(long spinCount = 0);
+	~Mutex();
+
+	void Acquire() const;
+	bool TryAcquire() const;
+	void Release() const;
+	bool IsLocked() const;
+
+	// CRITICAL_SECTION* / pthread_mutex_t*.
+	void* GetSystemRepresentation() const;
+
+private:
+	RDE_FORBID_COPY(Mutex);
+
+	struct Impl;
+	Impl*	m_impl;
+	void*	m_implMem[8];
+};
+
+} // rde
+
+#endif // #ifndef CORE_MUTEX_H
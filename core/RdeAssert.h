@@ -16,7 +16,7 @@ namespace Assertion
 	bool Failure(const char* expr, const char* file, int line);
 } // Assertion
 
-#define RDE_HALT()	do { __debugbreak(); } while (0) 
+#define RDE_HALT()	do { RDE_DEBUGBREAK(); } while (0) 
 
 // Base assert macro. Will work even in release builds.
 // @see RDE_ASSERT
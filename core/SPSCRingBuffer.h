@@ -0,0 +1,84 @@
+#ifndef CORE_SPSC_RING_BUFFER_H
+#define CORE_SPSC_RING_BUFFER_H
+
+#include "core/Atomic.h"
+#include "core/BitMath.h"
+
+namespace rde
+{
+// Bounded single-producer/single-consumer FIFO queue. Wait-free, no atomic
+// read-modify-write operations, every index is written by one thread only.
+// Each side keeps a cached copy of the other side's index and only reads the
+// shared one (cache miss) when its copy says queue is full/empty.
+// T should be a pointer or other small POD.
+template<typename T, long TCapacity>
+class SPSCRingBuffer
+{
+public:
+	SPSCRingBuffer()
+	:	m_writePos(0),
+		m_cachedReadPos(0),
+		m_readPos(0),
+		m_cachedWritePos(0)
+	{
+		RDE_COMPILE_CHECK(RDE_IS_POWER_OF_TWO(TCapacity));
+	}
+
+	// Producer thread only. False if buffer is full.
+	bool Push(const T& item)
+	{
+		const unsigned long w = Load_Relaxed(m_writePos);
+		if (w - m_cachedReadPos == TCapacity)
+		{
+			m_cachedReadPos = Load_Acquire(m_readPos);
+			if (w - m_cachedReadPos == TCapacity)
+				return false;
+		}
+		m_items[w & kMask] = item;
+		// Item has to be visible before consumer sees new position.
+		Store_Release(m_writePos, w + 1);
+		return true;
+	}
+
+	// Consumer thread only. False if buffer is empty.
+	bool Pop(T& item)
+	{
+		const unsigned long r = Load_Relaxed(m_readPos);
+		if (r == m_cachedWritePos)
+		{
+			m_cachedWritePos = Load_Acquire(m_writePos);
+			if (r == m_cachedWritePos)
+				return false;
+		}
+		item = m_items[r & kMask];
+		// Slot can be overwritten once producer sees new position.
+		Store_Release(m_readPos, r + 1);
+		return true;
+	}
+
+	// Approximation if called from thread other than producer/consumer.
+	long GetSize() const
+	{
+		return long(Load_Relaxed(m_writePos) - Load_Relaxed(m_readPos));
+	}
+	bool IsEmpty() const	{ return GetSize() == 0; }
+
+private:
+	RDE_FORBID_COPY(SPSCRingBuffer);
+
+	static const unsigned long kMask = TCapacity - 1;
+
+	// Producer cache line.
+	unsigned long	m_writePos;
+	unsigned long	m_cachedReadPos;
+	char			m_pad0[64 - 2 * sizeof(unsigned long)];
+	// Consumer cache line.
+	unsigned long	m_readPos;
+	unsigned long	m_cachedWritePos;
+	char			m_pad1[64 - 2 * sizeof(unsigned long)];
+	T				m_items[TCapacity];
+};
+
+} // rde
+
+#endif // CORE_SPSC_RING_BUFFER_H
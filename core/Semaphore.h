@@ -0,0 +1,31 @@
+#ifndef CORE_SEMAPHORE_H
+#define CORE_SEMAPHORE_H
+
+#include "core/Config.h"
+
+namespace rde
+{
+// Implemented in win32/Win32Semaphore.cpp & posix/PosixSemaphore.cpp.
+class Semaphore
+{
+public:
+	explicit Semaphore(int initialValue = 0);
+	~Semaphore();
+
+	void WaitInfinite();
+	// @return false if timed out.
+	bool WaitTimeout(long milliseconds);
+	// Increases count by num (wakes up to num waiting threads).
+	void Signal(int num = 1);
+
+private:
+	RDE_FORBID_COPY(Semaphore);
+
+	struct Impl;
+	// Impl is constructed in place, no pointer (HANDLE/sem_t* only).
+	void*	m_implMem[1];
+};
+
+} // rde
+
+#endif // #ifndef CORE_SEMAPHORE_H
@@ -0,0 +1,337 @@
+#include "core/SizeClassAllocator.h"
+#include "core/Atomic.h"
+#include "core/RdeAssert.h"
+#include "core/System.h"
+#include "core/Thread.h"
+#include <cstdlib>
+
+namespace
+{
+const size_t	kAlignment			= 16;
+const size_t	kSlabSize			= 64 * 1024;
+// Slab header lives in first bytes of every slab (keeps blocks 16-byte aligned).
+const size_t	kSlabHeaderSize		= 64;
+#if RDE_64
+const size_t	kRegionSize			= size_t(16) * 1024 * 1024 * 1024;
+#else
+const size_t	kRegionSize			= 512 * 1024 * 1024;
+#endif
+
+// 16-byte steps up to 256, then 4 classes per power of 2.
+const int		kNumSizeClasses		= 28;
+const rde::uint16 s_classSizes[kNumSizeClasses] =
+{
+	16, 32, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192, 208, 224, 240, 256,
+	320, 384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048
+};
+RDE_COMPILE_CHECK(rde::SizeClassAllocator::kMaxSmallSize == 2048);
+
+// Size class for (bytes + 15) / 16. Constant, so that it can be used
+// before (and while) region is being initialized by another thread.
+const rde::uint8 s_sizeToClass[rde::SizeClassAllocator::kMaxSmallSize / 16 + 1] =
+{
+	0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+	15, 16, 16, 16, 16, 17, 17, 17, 17, 18, 18, 18, 18, 19, 19, 19,
+	19, 20, 20, 20, 20, 20, 20, 20, 20, 21, 21, 21, 21, 21, 21, 21,
+	21, 22, 22, 22, 22, 22, 22, 22, 22, 23, 23, 23, 23, 23, 23, 23,
+	23, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24,
+	24, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25,
+	25, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26,
+	26, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27,
+	27
+};
+
+struct SlabHeader
+{
+	int		sizeClass;
+};
+
+// Free blocks are linked through their first word. First block of the batch
+// additionally links to the next batch in its second word.
+struct FreeBlock
+{
+	FreeBlock*	next;
+	FreeBlock*	nextBatch;
+};
+
+// Shared between threads, one per size class.
+struct CentralList
+{
+	rde::Atomic32	lock;
+	// Batches of exactly GetBatchSize() blocks.
+	FreeBlock*		batches;
+	// Leftovers from flushed thread caches.
+	FreeBlock*		loose;
+	char			pad[64 - sizeof(rde::Atomic32) - 2 * sizeof(FreeBlock*)];
+};
+
+// All zero-initialized, nothing to construct.
+CentralList		s_centralLists[kNumSizeClasses];
+rde::Atomic32	s_regionLock;
+char*			s_regionBase;
+// Stays 0 until region is reserved, so range check in Free fails for all pointers.
+size_t			s_regionSize;
+size_t			s_regionUsed;
+
+RDE_THREADLOCAL FreeBlock*	s_cacheHeads[kNumSizeClasses];
+RDE_THREADLOCAL int			s_cacheCounts[kNumSizeClasses];
+
+void Lock(rde::Atomic32& lock)
+{
+	int numSpins(0);
+	while (rde::Interlocked::CompareAndSwap(&lock, 0, 1) != 0)
+	{
+		if (++numSpins > 64)
+			rde::Thread::YieldCurrentThread();
+	}
+}
+void Unlock(rde::Atomic32& lock)
+{
+	rde::Interlocked::FetchAndStore(&lock, 0);
+}
+
+// malloc only guarantees 8-byte alignment on some platforms (32-bit Win32),
+// so big blocks are over-allocated and aligned manually. Distance to the
+// malloc'ed pointer is stored in the byte right before the block.
+void* AllocLarge(size_t bytes)
+{
+	if (bytes > size_t(-1) - kAlignment)
+		return 0;
+	char* mem = static_cast<char*>(::malloc(bytes + kAlignment));
+	if (mem == 0)
+		return 0;
+	char* block = reinterpret_cast<char*>((size_t(mem) + kAlignment) & ~(kAlignment - 1));
+	block[-1] = char(block - mem);
+	return block;
+}
+void FreeLarge(void* ptr)
+{
+	if (ptr != 0)
+	{
+		char* block = static_cast<char*>(ptr);
+		::free(block - rde::uint8(block[-1]));
+	}
+}
+
+// Number of blocks moved between thread cache and central list at once.
+RDE_FORCEINLINE int GetBatchSize(int sizeClass)
+{
+	const int batchSize = 8192 / s_classSizes[sizeClass];
+	return batchSize > 64 ? 64 : (batchSize < 4 ? 4 : batchSize);
+}
+
+RDE_FORCEINLINE bool IsFromRegion(const void* ptr)
+{
+	return size_t(static_cast<const char*>(ptr) - s_regionBase) < s_regionSize;
+}
+RDE_FORCEINLINE const SlabHeader* GetSlabHeader(const void* ptr)
+{
+	return reinterpret_cast<const SlabHeader*>(size_t(ptr) & ~(kSlabSize - 1));
+}
+
+bool InitRegion()
+{
+	if (s_regionSize != 0)
+		return true;
+
+#if RDE_DEBUG
+	for (size_t i = 0; i < RDE_ARRAY_COUNT(s_sizeToClass); ++i)
+	{
+		const int sizeClass = s_sizeToClass[i];
+		RDE_ASSERT(size_t(s_classSizes[sizeClass]) >= i * 16);
+		RDE_ASSERT(sizeClass == 0 || size_t(s_classSizes[sizeClass - 1]) < i * 16);
+	}
+#endif
+
+	// Extra slab, so that we can align base.
+	char* region = static_cast<char*>(rde::Sys::ReserveMemory(kRegionSize + kSlabSize));
+	if (region == 0)
+		return false;
+	s_regionBase = reinterpret_cast<char*>((size_t(region) + kSlabSize - 1) & ~(kSlabSize - 1));
+	s_regionUsed = 0;
+	rde::MemoryBarrier();
+	s_regionSize = kRegionSize;
+	return true;
+}
+
+// Returns one batch, carves rest of the slab into batches for central list.
+// @pre Central list locked.
+FreeBlock* CarveSlab(int sizeClass)
+{
+	Lock(s_regionLock);
+	char* slab(0);
+	if (InitRegion() && s_regionUsed + kSlabSize <= s_regionSize)
+	{
+		slab = s_regionBase + s_regionUsed;
+		if (rde::Sys::CommitMemory(slab, kSlabSize))
+			s_regionUsed += kSlabSize;
+		else
+			slab = 0;
+	}
+	Unlock(s_regionLock);
+	if (slab == 0)
+		return 0;
+
+	reinterpret_cast<SlabHeader*>(slab)->sizeClass = sizeClass;
+	const size_t blockSize = s_classSizes[sizeClass];
+	const int numBlocks = int((kSlabSize - kSlabHeaderSize) / blockSize);
+	const int batchSize = GetBatchSize(sizeClass);
+
+	// Last, incomplete batch goes to loose list.
+	CentralList& central = s_centralLists[sizeClass];
+	char* block = slab + kSlabHeaderSize;
+	for (int i = 0; i < numBlocks; i += batchSize)
+	{
+		const int blocksInBatch = (numBlocks - i < batchSize ? numBlocks - i : batchSize);
+		FreeBlock* first = reinterpret_cast<FreeBlock*>(block);
+		for (int j = 0; j < blocksInBatch - 1; ++j, block += blockSize)
+			reinterpret_cast<FreeBlock*>(block)->next = reinterpret_cast<FreeBlock*>(block + blockSize);
+		FreeBlock* last = reinterpret_cast<FreeBlock*>(block);
+		block += blockSize;
+		if (blocksInBatch == batchSize)
+		{
+			last->next = 0;
+			first->nextBatch = central.batches;
+			central.batches = first;
+		}
+		else
+		{
+			last->next = central.loose;
+			central.loose = first;
+		}
+	}
+	FreeBlock* batch = central.batches;
+	central.batches = batch->nextBatch;
+	return batch;
+}
+
+// Gets blocks from central list into (empty) thread cache.
+// False if out of memory.
+bool RefillCache(int sizeClass)
+{
+	RDE_ASSERT(s_cacheHeads[sizeClass] == 0);
+	CentralList& central = s_centralLists[sizeClass];
+	const int batchSize = GetBatchSize(sizeClass);
+	Lock(central.lock);
+	FreeBlock* batch = central.batches;
+	int numBlocks = batchSize;
+	if (batch != 0)
+	{
+		central.batches = batch->nextBatch;
+	}
+	else if (central.loose != 0)
+	{
+		batch = central.loose;
+		FreeBlock* last = batch;
+		for (numBlocks = 1; numBlocks < batchSize && last->next != 0; ++numBlocks)
+			last = last->next;
+		central.loose = last->next;
+		last->next = 0;
+	}
+	else
+	{
+		batch = CarveSlab(sizeClass);
+	}
+	Unlock(central.lock);
+
+	s_cacheHeads[sizeClass] = batch;
+	s_cacheCounts[sizeClass] = (batch != 0 ? numBlocks : 0);
+	return batch != 0;
+}
+
+// Gives back one batch from the (overfilled) thread cache.
+void ReleaseBatch(int sizeClass)
+{
+	const int batchSize = GetBatchSize(sizeClass);
+	FreeBlock* batch = s_cacheHeads[sizeClass];
+	FreeBlock* last = batch;
+	for (int i = 1; i < batchSize; ++i)
+		last = last->next;
+	s_cacheHeads[sizeClass] = last->next;
+	s_cacheCounts[sizeClass] -= batchSize;
+	last->next = 0;
+
+	CentralList& central = s_centralLists[sizeClass];
+	Lock(central.lock);
+	batch->nextBatch = central.batches;
+	central.batches = batch;
+	Unlock(central.lock);
+}
+} // namespace
+
+namespace rde
+{
+void* SizeClassAllocator::Alloc(size_t bytes)
+{
+	if (bytes > kMaxSmallSize)
+		return AllocLarge(bytes);
+
+	const int sizeClass = s_sizeToClass[(bytes + 15) >> 4];
+	if (s_cacheHeads[sizeClass] == 0)
+	{
+		if (s_regionSize == 0)
+		{
+			Lock(s_regionLock);
+			const bool initialized = InitRegion();
+			Unlock(s_regionLock);
+			if (!initialized)
+				return AllocLarge(bytes);
+			return Alloc(bytes);
+		}
+		// Out of address space.
+		if (!RefillCache(sizeClass))
+			return AllocLarge(bytes);
+	}
+	FreeBlock* block = s_cacheHeads[sizeClass];
+	s_cacheHeads[sizeClass] = block->next;
+	--s_cacheCounts[sizeClass];
+	return block;
+}
+
+void SizeClassAllocator::Free(void* ptr)
+{
+	if (!IsFromRegion(ptr))
+	{
+		FreeLarge(ptr);
+		return;
+	}
+	const int sizeClass = GetSlabHeader(ptr)->sizeClass;
+	FreeBlock* block = static_cast<FreeBlock*>(ptr);
+	block->next = s_cacheHeads[sizeClass];
+	s_cacheHeads[sizeClass] = block;
+	// Keep one batch for allocations, so that we don't ping-pong
+	// with central list.
+	if (++s_cacheCounts[sizeClass] >= 2 * GetBatchSize(sizeClass))
+		ReleaseBatch(sizeClass);
+}
+
+size_t SizeClassAllocator::GetBlockSize(const void* ptr)
+{
+	return IsFromRegion(ptr) ? s_classSizes[GetSlabHeader(ptr)->sizeClass] : 0;
+}
+
+void SizeClassAllocator::FlushThreadCache()
+{
+	for (int sizeClass = 0; sizeClass < kNumSizeClasses; ++sizeClass)
+	{
+		while (s_cacheCounts[sizeClass] >= GetBatchSize(sizeClass))
+			ReleaseBatch(sizeClass);
+
+		FreeBlock* first = s_cacheHeads[sizeClass];
+		if (first == 0)
+			continue;
+		FreeBlock* last = first;
+		while (last->next != 0)
+			last = last->next;
+
+		CentralList& central = s_centralLists[sizeClass];
+		Lock(central.lock);
+		last->next = central.loose;
+		central.loose = first;
+		Unlock(central.lock);
+		s_cacheHeads[sizeClass] = 0;
+		s_cacheCounts[sizeClass] = 0;
+	}
+}
+
+} // rde
@@ -0,0 +1,41 @@
+#ifndef CORE_SIZE_CLASS_ALLOCATOR_H
+#define CORE_SIZE_CLASS_ALLOCATOR_H
+
+#include "core/Config.h"
+
+namespace rde
+{
+// General purpose allocator, optimized for lots of small blocks.
+// Allocations up to kMaxSmallSize bytes are rounded up to one of the size
+// classes and carved from 64KB slabs. Every thread caches freed blocks
+// in its own free lists and exchanges them with central (per class) lists
+// in batches, so most Alloc/Free calls don't touch shared data at all.
+// Bigger blocks go to malloc/free (with few bytes of padding, so they are
+// 16-byte aligned as well).
+// Slabs come from one reserved address range, so Free can tell small block
+// from malloc'ed one with single comparison. Slab memory is never returned
+// to the OS.
+// Doesn't need constructing, can be used before static initialization
+// (ie. from global operator new, see SizeClassMemManager.h).
+struct SizeClassAllocator
+{
+	static const size_t	kMaxSmallSize	= 2048;
+
+	// Blocks are 16-byte aligned.
+	static void* Alloc(size_t bytes);
+	static void Free(void* ptr);
+
+	// Usable size of the block (>= requested), 0 if not allocated from slabs.
+	static size_t GetBlockSize(const void* ptr);
+
+	// Gives all blocks cached by the calling thread back to central lists.
+	// Should be called before thread exits, otherwise they're lost.
+	// rde::Thread does it automatically (so JobSystem/AsyncIo workers are
+	// covered), other threads have to call it themselves.
+	static void FlushThreadCache();
+};
+
+} // rde
+
+//-----------------------------------------------------------------------------
+#endif // #ifndef CORE_SIZE_CLASS_ALLOCATOR_H
@@ -0,0 +1,74 @@
+#ifndef CORE_SIZE_CLASS_MEMMANAGER_H
+#define CORE_SIZE_CLASS_MEMMANAGER_H
+
+// MemManager implementation on top of SizeClassAllocator.
+// To use it, compile MemManager.cpp with
+// RDE_CORE_MEMMGR_HEADER="core/SizeClassMemManager.h".
+// Only to be included from MemManager.cpp (uses its handlers).
+#include "core/SizeClassAllocator.h"
+
+namespace rde
+{
+//-----------------------------------------------------------------------------
+void* MemManager::Alloc(size_t bytes, const char* tag)
+{
+	void* ptr = SizeClassAllocator::Alloc(bytes);
+	if (onAllocHandler)
+		onAllocHandler(ptr, bytes, tag);
+	return ptr;
+}
+
+//-----------------------------------------------------------------------------
+void MemManager::Free(void* ptr) throw()
+{
+	if (ptr != 0)
+	{
+		// Before actual free, address could be reused by another thread otherwise.
+		if (onFreeHandler)
+			onFreeHandler(ptr);
+		SizeClassAllocator::Free(ptr);
+	}
+}
+
+//-----------------------------------------------------------------------------
+void MemManager::BeginFrame()
+{
+}
+
+//-----------------------------------------------------------------------------
+void MemManager::EndFrame()
+{
+	if (onEndFrameHandler)
+		onEndFrameHandler();
+}
+
+//-----------------------------------------------------------------------------
+void MemManager::SetOnAllocHandler(OnAlloc handler)
+{
+	onAllocHandler = handler;
+}
+
+//-----------------------------------------------------------------------------
+void MemManager::SetOnFreeHandler(OnFree handler)
+{
+	onFreeHandler = handler;
+}
+
+//-----------------------------------------------------------------------------
+void MemManager::SetOnEndFrameHandler(OnEndFrame handler)
+{
+	onEndFrameHandler = handler;
+}
+
+//-----------------------------------------------------------------------------
+void MemManager::Exit()
+{
+	// Slabs stay reserved till the process ends, blocks might still be
+	// freed by other static destructors.
+	SizeClassAllocator::FlushThreadCache();
+}
+
+} // rde
+
+//-----------------------------------------------------------------------------
+#endif // #ifndef CORE_SIZE_CLASS_MEMMANAGER_H
@@ -25,11 +25,23 @@ namespace Sys
 
 	void DebugPrint(const char* msg);
 	void OnFatalError(const char* msg);
+
+	// Virtual memory. Reserved range is only address space, it has to be
+	// committed (page granularity) before use. Returns NULL/false on failure.
+	void* ReserveMemory(size_t bytes);
+	bool CommitMemory(void* ptr, size_t bytes);
+	void ReleaseMemory(void* ptr, size_t bytes);
+
+	// Fills frames with return addresses of the calling thread (innermost first),
+	// returns number of frames captured.
+	int CaptureCallstack(void** frames, int maxFrames, int framesToSkip);
 }
 }
 
 #if RDE_PLATFORM_WIN32
 #	include "win32/Win32System.h"
+#elif RDE_PLATFORM_POSIX
+#	include "posix/PosixSystem.h"
 #else
 #	error "Platform not supported"
 #endif
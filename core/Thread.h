@@ -0,0 +1,63 @@
+#ifndef CORE_THREAD_H
+#define CORE_THREAD_H
+
+#include "core/Config.h"
+#include <external/srutil/delegate.hpp>
+
+namespace rde
+{
+// Implemented in win32/Win32Thread.cpp & posix/PosixThread.cpp.
+class Thread
+{
+public:
+	typedef srutil::delegate0<void>	Delegate;
+	enum Priority
+	{
+		PRIORITY_LOW,
+		PRIORITY_NORMAL,
+		PRIORITY_HIGH
+	};
+
+	Thread();
+	// Waits for thread to finish, if it's still running.
+	~Thread();
+
+	// Doesn't return before thread actually started.
+	bool Start(const Delegate& delegate, unsigned int stackSize = 4096,
+		Priority priority = PRIORITY_NORMAL);
+	// Waits for thread function to return.
+	void Stop();
+	void Wait();
+	bool IsRunning() const;
+	void SetAffinityMask(uint32 affinityMask);
+
+	// Calling thread.
+	static void SetName(const char* name);
+	static const char* GetCurrentThreadName();
+	static int GetCurrentThreadId();
+	static void Sleep(long millis);
+	static void YieldCurrentThread();
+
+	static uint32 GetProcessAffinityMask();
+
+	struct Impl;
+
+private:
+	RDE_FORBID_COPY(Thread);
+
+	// Platform thread + start event (POSIX event is mutex + condvar).
+	enum
+	{
+#if RDE_PLATFORM_POSIX
+		IMPL_SIZE	= 192
+#else
+		IMPL_SIZE	= 64
+#endif
+	};
+	Impl*	m_impl;
+	void*	m_implMem[IMPL_SIZE / sizeof(void*)];
+};
+
+} // rde
+
+#endif // #ifndef CORE_THREAD_H
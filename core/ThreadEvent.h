@@ -0,0 +1,14 @@
+#ifndef CORE_THREAD_EVENT_H
+#define CORE_THREAD_EVENT_H
+
+#include "core/Config.h"
+
+#if RDE_PLATFORM_WIN32
+#	include "core/win32/Win32ThreadEvent.h"
+#elif RDE_PLATFORM_POSIX
+#	include "core/posix/PosixThreadEvent.h"
+#else
+#	error "Platform not supported"
+#endif
+
+#endif // #ifndef CORE_THREAD_EVENT_H
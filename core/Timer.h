@@ -5,6 +5,8 @@
 
 #if RDE_PLATFORM_WIN32
 #	include "win32/Win32Timer.h"
+#elif RDE_PLATFORM_POSIX
+#	include "posix/PosixTimer.h"
 #endif
 
 #endif // CORE_TIMER_H
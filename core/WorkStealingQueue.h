@@ -0,0 +1,100 @@
+#ifndef CORE_WORK_STEALING_QUEUE_H
+#define CORE_WORK_STEALING_QUEUE_H
+
+#include "core/Atomic.h"
+#include "core/BitMath.h"
+
+namespace rde
+{
+// Fixed capacity Chase-Lev deque ("Dynamic Circular Work-Stealing Deque",
+// Chase & Lev, 2005), see also "Correct and Efficient Work-Stealing for Weak
+// Memory Models", Le et al.
+// Push/Pop - owner thread only (LIFO end), Steal - any thread (FIFO end).
+// T should be a pointer or other small POD.
+template<typename T, long TCapacity>
+class WorkStealingQueue
+{
+public:
+	WorkStealingQueue()
+	:	m_top(0),
+		m_bottom(0)
+	{
+		RDE_COMPILE_CHECK(RDE_IS_POWER_OF_TWO(TCapacity));
+	}
+
+	// Owner thread only. False if queue is full.
+	bool Push(const T& item)
+	{
+		const long b = Load_Relaxed(m_bottom);
+		const long t = Load_Acquire(m_top);
+		if (b - t >= TCapacity)
+			return false;
+		m_items[b & kMask] = item;
+		// Item has to be visible before thieves see new bottom.
+		Store_Release(m_bottom, b + 1);
+		return true;
+	}
+
+	// Owner thread only. False if queue is empty (or last item got stolen).
+	bool Pop(T& item)
+	{
+		const long b = Load_Relaxed(m_bottom) - 1;
+		Store_Relaxed(m_bottom, b);
+		// Store to bottom has to be visible before we read top (store-load ordering,
+		// needs full barrier, even on x86).
+		MemoryBarrier();
+		long t = Load_Relaxed(m_top);
+		if (t > b)
+		{
+			// Empty.
+			Store_Relaxed(m_bottom, t);
+			return false;
+		}
+		item = m_items[b & kMask];
+		if (t != b)
+			return true;
+
+		// Last item, race against thieves.
+		const bool won = (Interlocked::CompareAndSwap(&m_top, t, t + 1) == t);
+		Store_Relaxed(m_bottom, t + 1);
+		return won;
+	}
+
+	// Any thread. False if queue is empty or we lost race with other thread.
+	bool Steal(T& item)
+	{
+		const long t = Load_Acquire(m_top);
+		// Top has to be read before bottom.
+		MemoryBarrier();
+		const long b = Load_Acquire(m_bottom);
+		if (t >= b)
+			return false;
+
+		item = m_items[t & kMask];
+		return Interlocked::CompareAndSwap(&m_top, t, t + 1) == t;
+	}
+
+	// Approximation, may be stale by the time it returns.
+	long GetSize() const
+	{
+		const long size = Load_Relaxed(m_bottom) - Load_Relaxed(m_top);
+		return size < 0 ? 0 : size;
+	}
+	bool IsEmpty() const	{ return GetSize() == 0; }
+
+private:
+	RDE_FORBID_COPY(WorkStealingQueue);
+
+	static const long kMask	= TCapacity - 1;
+
+	// Thieves modify top, owner - bottom. Keep them on separate cache lines.
+	// Bottom is only written by owner, so it doesn't need to be CAS-able.
+	Atomic32	m_top;
+	char		m_pad[64 - sizeof(Atomic32)];
+	long		m_bottom;
+	T			m_items[TCapacity];
+};
+
+} // rde
+
+#endif // CORE_WORK_STEALING_QUEUE_H
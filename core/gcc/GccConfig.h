@@ -0,0 +1,67 @@
+#if !defined (__GNUC__)
+#	error "GCC compatible C++ compiler required!"
+#endif
+#if !defined (CORE_CONFIG_H)
+#	error "Do not include directly, only via core/Config.h"
+#endif
+
+#if !defined(NDEBUG)
+#	undef RDE_DEBUG
+#	define RDE_DEBUG	1
+#endif
+
+#define RDE_PLATFORM_POSIX	1
+#define RDE_COMPILER_GCC	1
+#if defined(__x86_64__) || defined(__aarch64__) || defined(__LP64__)
+#	define RDE_64			1
+#else
+#	define RDE_64			0
+#endif
+
+// --- Wrappers over compiled specific declarations/keywords
+#define RDE_FORCEINLINE		inline __attribute__((always_inline))
+#define RDE_THREADLOCAL		__thread
+#define RDE_DLLIMPORT
+#define RDE_DLLEXPORT		__attribute__((visibility("default")))
+#define RDE_ALIGN(x)		__attribute__((aligned(x)))
+#define RDE_DEBUGBREAK()	__builtin_trap()
+// Default (and only) calling convention on POSIX platforms.
+#define RDE_CDECL
+
+// --- Test compiler options.
+#ifndef RDE_DONT_CHECK_COMPILER_OPTIONS
+#	if defined (__GXX_RTTI)
+#		error "Please disable RTTI (-fno-rtti)"
+#	endif
+#	if defined (__EXCEPTIONS)
+#		error "Please disable exceptions (-fno-exceptions)"
+#	endif
+#endif
+
+#include <cstddef>	// size_t
+
+// --- Types
+namespace rde
+{
+	typedef signed char			int8;
+	typedef unsigned char		uint8;
+	typedef unsigned short		uint16;
+	typedef signed short		int16;
+	// Not long, it's 64-bit on LP64 platforms.
+	typedef unsigned int		uint32;
+	typedef signed int			int32;
+	typedef unsigned long long	uint64;
+	typedef signed long long	int64;
+#if RDE_64
+	typedef unsigned long long	PointerSizedUInt;
+	typedef long long			PointerSizedInt;
+#else
+	typedef unsigned int		PointerSizedUInt;
+	typedef int					PointerSizedInt;
+#endif
+
+	struct RDE_ALIGN(16) MachineTypeWithStrictestAlignment
+	{
+		int member[4];
+	};
+} // rde
@@ -24,6 +24,8 @@
 #define RDE_DLLIMPORT		__declspec(dllimport)
 #define RDE_DLLEXPORT		__declspec(dllexport)
 #define RDE_ALIGN(x)		__declspec(align(x))
+#define RDE_DEBUGBREAK()	__debugbreak()
+#define RDE_CDECL			__cdecl
 
 // --- Test compiler options.
 // Trick from ICE by Pierre Terdiman.
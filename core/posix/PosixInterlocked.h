@@ -0,0 +1,137 @@
+#ifndef CORE_ATOMIC_H
+#	error "Do not include this file directly, use core/Atomic.h"
+#endif
+
+// GCC __sync builtins, they all imply full memory barrier.
+
+namespace rde
+{
+// Same underlying type as on Win32 (long), so code using 'volatile long'
+// directly stays portable. Note: it's 64-bit wide on LP64 platforms.
+typedef volatile long	Atomic32;
+typedef volatile int64	Atomic64;
+
+// Read/writes will be completed at this point (compiler barrier only!).
+inline void CompilerReadWriteBarrier()
+{
+	__asm__ __volatile__("" ::: "memory");
+}
+// Full memory barrier
+inline void MemoryBarrier()
+{
+	__sync_synchronize();
+}
+inline void CompilerReadBarrier()
+{
+	CompilerReadWriteBarrier();
+}
+inline void CompilerWriteBarrier()
+{
+	CompilerReadWriteBarrier();
+}
+
+template<typename T>
+inline T Load_Relaxed(const T& v)
+{
+	RDE_COMPILE_CHECK(sizeof(T) <= 8);
+	T ret = v;
+	return ret;
+}
+template<typename T> 
+inline void Store_Relaxed(T& dst, T v)
+{
+	RDE_COMPILE_CHECK(sizeof(T) <= 8);
+	dst = v;
+}
+
+// Compiler barriers are enough on x86/x64 (loads are not reordered with
+// other loads, stores not with other stores). Other architectures need
+// real fences.
+#if defined(__i386__) || defined(__x86_64__)
+#	define RDE_POSIX_ACQ_REL_FENCE()	CompilerReadWriteBarrier()
+#else
+#	define RDE_POSIX_ACQ_REL_FENCE()	MemoryBarrier()
+#endif
+
+template<typename T> 
+inline T Load_Acquire(const T& v)
+{
+	RDE_COMPILE_CHECK(sizeof(T) <= 8);
+	T ret = v;
+	RDE_POSIX_ACQ_REL_FENCE();
+	return ret;
+}
+template<typename T> 
+inline void Store_Release(T& dst, T v)
+{
+	RDE_COMPILE_CHECK(sizeof(T) <= 8);
+	RDE_POSIX_ACQ_REL_FENCE();
+	dst = v;
+}
+
+template<typename T> 
+inline T Load_SeqCst(const T& v)
+{
+	RDE_COMPILE_CHECK(sizeof(T) <= 8);
+	MemoryBarrier();
+	T ret = v;
+	MemoryBarrier();
+	return ret;
+}
+template<typename T> 
+inline void Store_SeqCst(T& dst, T v)
+{
+	RDE_COMPILE_CHECK(sizeof(T) <= 8);
+	MemoryBarrier();
+	dst = v;
+	MemoryBarrier();
+}
+
+#undef RDE_POSIX_ACQ_REL_FENCE
+
+namespace Interlocked
+{
+// if (*ptr == comparand)
+//	*ptr = exchange
+// Return initial value of *ptr.
+inline long CompareAndSwap(Atomic32* ptr, long comparand, long exchange)
+{
+	return __sync_val_compare_and_swap(ptr, comparand, exchange);
+}
+inline int64 CompareAndSwap(Atomic64* ptr, int64 comparand, int64 exchange)
+{
+	return __sync_val_compare_and_swap(ptr, comparand, exchange);
+}
+
+// Returns initial value of *ptr (same as Win32 version).
+inline long FetchAndAdd(Atomic32* ptr, long addend)
+{
+	return __sync_fetch_and_add(ptr, addend);
+}
+
+// *ptr = value, returns previous *ptr.
+// __sync_lock_test_and_set is only an acquire barrier, hence explicit fence.
+inline long FetchAndStore(Atomic32* ptr, long value)
+{
+	MemoryBarrier();
+	return __sync_lock_test_and_set(ptr, value);
+}
+inline int64 FetchAndStore(Atomic64* ptr, int64 value)
+{
+	MemoryBarrier();
+	return __sync_lock_test_and_set(ptr, value);
+}
+
+// Returns new value of *ptr.
+inline long Increment(Atomic32* ptr)
+{
+	return __sync_add_and_fetch(ptr, 1L);
+}
+
+// Returns new value of *ptr.
+inline long Decrement(Atomic32* ptr)
+{
+	return __sync_sub_and_fetch(ptr, 1L);
+}
+} // Interlocked
+} // rde
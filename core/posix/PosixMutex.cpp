@@ -0,0 +1,86 @@
+#include "core/Mutex.h"
+#include "core/RdeAssert.h"
+#include <pthread.h>
+#include <new>
+
+namespace
+{
+// Number of pause instructions between lock attempts when spinning.
+const long kSpinsPerTry	= 32;
+
+inline void CpuRelax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#else
+	__asm__ __volatile__("" ::: "memory");
+#endif
+}
+}
+
+namespace rde
+{
+struct Mutex::Impl
+{
+	Impl(long spinCount)
+	:	m_spinCount(spinCount)
+	{
+		pthread_mutexattr_t attr;
+		::pthread_mutexattr_init(&attr);
+		// Critical sections are recursive, keep the same semantics.
+		::pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+		const int res = ::pthread_mutex_init(&m_mutex, &attr);
+		RDE_ASSERT(res == 0);
+		(void)res;
+		::pthread_mutexattr_destroy(&attr);
+	}
+	~Impl()
+	{
+		::pthread_mutex_destroy(&m_mutex);
+	}
+
+	mutable pthread_mutex_t	m_mutex;
+	long					m_spinCount;
+};
+
+Mutex::Mutex(long spinCount)
+{
+	RDE_COMPILE_CHECK(sizeof(Impl) <= sizeof(m_implMem));
+	m_impl = new(m_implMem) Impl(spinCount);
+}
+Mutex::~Mutex()
+{
+	m_impl->~Impl();
+	m_impl = 0;
+}
+
+void Mutex::Acquire() const
+{
+	// pthreads have no spin count, emulate InitializeCriticalSectionAndSpinCount.
+	for (long i = 0; i < m_impl->m_spinCount; i += kSpinsPerTry)
+	{
+		if (::pthread_mutex_trylock(&m_impl->m_mutex) == 0)
+			return;
+		for (long j = 0; j < kSpinsPerTry; ++j)
+			CpuRelax();
+	}
+	::pthread_mutex_lock(&m_impl->m_mutex);
+}
+bool Mutex::TryAcquire() const
+{
+	return ::pthread_mutex_trylock(&m_impl->m_mutex) == 0;
+}
+void Mutex::Release() const
+{
+	::pthread_mutex_unlock(&m_impl->m_mutex);
+}
+bool Mutex::IsLocked() const
+{
+	return false;
+}
+void* Mutex::GetSystemRepresentation() const
+{
+	return &m_impl->m_mutex;
+}
+
+} // rde
@@ -0,0 +1,84 @@
+#include "core/Semaphore.h"
+#include "core/RdeAssert.h"
+#include "core/System.h"
+#include <cerrno>
+#include <new>
+#include <semaphore.h>
+#include <time.h>
+
+// We dont have explicit impl pointer, instead we cast before use.
+// sem_t is much bigger than Win32 handle, so Impl only keeps pointer to it
+// (same footprint as on Win32).
+#define SEM_AS_IMPL(mem)	((Impl*)(mem))
+
+namespace rde
+{
+struct Semaphore::Impl
+{
+	Impl(int initialValue)
+	{
+		semaphore = new sem_t;
+		const int res = ::sem_init(semaphore, 0, initialValue);
+		RDE_ASSERT(res == 0);
+		if (res != 0)
+			Sys::DebugPrint("Couldn't create semaphore\n");
+	}
+	~Impl()
+	{
+		const int res = ::sem_destroy(semaphore);
+		RDE_ASSERT(res == 0);
+		(void)res;
+		delete semaphore;
+		semaphore = 0;
+	}
+	sem_t*	semaphore;
+};
+
+Semaphore::Semaphore(int initialValue /* = 0 */)
+{
+	RDE_COMPILE_CHECK(sizeof(Impl) <= sizeof(m_implMem));
+	new (m_implMem) Impl(initialValue);
+}
+Semaphore::~Semaphore()
+{
+	SEM_AS_IMPL(m_implMem)->~Impl();
+}
+void Semaphore::WaitInfinite()
+{
+	int res;
+	// Restart if interrupted by signal handler.
+	while ((res = ::sem_wait(SEM_AS_IMPL(m_implMem)->semaphore)) != 0 && errno == EINTR)
+	{
+		/**/
+	}
+	RDE_ASSERT(res == 0);
+}
+bool Semaphore::WaitTimeout(long milliseconds)
+{
+	timespec deadline;
+	::clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += milliseconds / 1000;
+	deadline.tv_nsec += (milliseconds % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		++deadline.tv_sec;
+		deadline.tv_nsec -= 1000000000;
+	}
+	int res;
+	while ((res = ::sem_timedwait(SEM_AS_IMPL(m_implMem)->semaphore, &deadline)) != 0 && errno == EINTR)
+	{
+		/**/
+	}
+	return res == 0;
+}
+void Semaphore::Signal(int num)
+{
+	for (int i = 0; i < num; ++i)
+	{
+		const int res = ::sem_post(SEM_AS_IMPL(m_implMem)->semaphore);
+		RDE_ASSERT(res == 0);
+		(void)res;
+	}
+}
+
+} // rde
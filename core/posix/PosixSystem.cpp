@@ -0,0 +1,76 @@
+#include "core/RdeAssert.h"
+#include "core/System.h"
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <execinfo.h>
+#include <sys/mman.h>
+
+namespace rde
+{
+void Sys::StringFormat(char* outBuf, size_t outBufSize, const char* fmt, ...)
+{
+	va_list argList;
+	va_start(argList, fmt);
+	vsnprintf(outBuf, outBufSize, fmt, argList);
+	va_end(argList);
+}
+
+void Sys::DebugPrint(const char* msg)
+{
+	fputs(msg, stderr);
+}
+
+void Sys::OnFatalError(const char* msg)
+{
+	const Sys::ErrorHandlerDelegate& handler = Sys::GetErrorHandler();
+	// If special handler exists and it didn't handle our error OR
+	// there's no special handler -- go for it.
+	if ((handler && !handler(true, msg)) || !handler)
+	{
+		fprintf(stderr, "Fatal Error: %s\n", msg);
+		abort();
+	}
+}
+
+void Sys::GetErrorString(char* outString, int maxOutStringLen, uint32 errorOverride)
+{
+	const int error = (errorOverride == 0 ? errno : int(errorOverride));
+	const char* errorString = strerror(error);
+	if (errorString == 0)
+		snprintf(outString, maxOutStringLen, "Unknown error [0x%X]", error);
+	else
+		snprintf(outString, maxOutStringLen, "%s", errorString);
+}
+
+void* Sys::ReserveMemory(size_t bytes)
+{
+	void* ptr = mmap(0, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	return ptr == MAP_FAILED ? 0 : ptr;
+}
+bool Sys::CommitMemory(void* ptr, size_t bytes)
+{
+	return mprotect(ptr, bytes, PROT_READ | PROT_WRITE) == 0;
+}
+void Sys::ReleaseMemory(void* ptr, size_t bytes)
+{
+	if (ptr != 0)
+		munmap(ptr, bytes);
+}
+
+int Sys::CaptureCallstack(void** frames, int maxFrames, int framesToSkip)
+{
+	// backtrace() can only fill from the top, skip frames manually.
+	// +1 for this function.
+	void* allFrames[64];
+	const int numToSkip = framesToSkip + 1;
+	int numFrames = backtrace(allFrames, maxFrames + numToSkip < 64 ? maxFrames + numToSkip : 64);
+	numFrames -= numToSkip;
+	if (numFrames <= 0)
+		return 0;
+	Sys::MemCpy(frames, allFrames + numToSkip, numFrames * sizeof(void*));
+	return numFrames;
+}
+
+} // rde
@@ -0,0 +1,23 @@
+#include <cstring>
+
+namespace rde
+{
+RDE_FORCEINLINE void Sys::MemCpy(void* to, const void* from, size_t bytes)
+{
+	memcpy(to, from, bytes);
+}
+RDE_FORCEINLINE void Sys::MemMove(void* to, const void* from, size_t bytes)
+{
+	memmove(to, from, bytes);
+}
+RDE_FORCEINLINE void Sys::MemSet(void* buf, uint8 value, size_t bytes)
+{
+	memset(buf, value, bytes);
+}
+
+namespace Sys
+{
+	void GetErrorString(char* outString, int maxOutStringLen, uint32 errorOverride = 0);
+}
+
+}
@@ -0,0 +1,197 @@
+#include "core/Thread.h"
+#include "core/RdeAssert.h"
+#include "core/SizeClassAllocator.h"
+#include "core/System.h"
+#include "core/ThreadEvent.h"
+#include <new>
+#include <climits>		// PTHREAD_STACK_MIN
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__linux__)
+#	include <sys/syscall.h>
+#endif
+
+namespace rde
+{
+struct Thread::Impl
+{
+	Impl(): running(false), joined(false) {}
+	void Run()
+	{
+		evtThreadStarted.Signal();
+		mdelegate();
+	}
+	void Join()
+	{
+		if (!joined)
+		{
+			const int res = ::pthread_join(thread, 0);
+			RDE_ASSERT(res == 0);
+			(void)res;
+			joined = true;
+		}
+	}
+	pthread_t			thread;
+	bool				running;
+	bool				joined;
+	Thread::Delegate	mdelegate;
+	rde::ThreadEvent	evtThreadStarted;
+};
+} // rde
+
+namespace
+{
+RDE_THREADLOCAL const char*		s_currentThreadName(0);
+
+void* Thread_Run(void* arg)
+{
+	rde::Thread::Impl* impl = static_cast<rde::Thread::Impl*>(arg);
+	impl->Run();
+	// Blocks cached by this thread would be lost otherwise.
+	rde::SizeClassAllocator::FlushThreadCache();
+	s_currentThreadName = 0;
+	return 0;
+}
+} // namespace
+
+namespace rde
+{
+Thread::Thread()
+{
+	RDE_COMPILE_CHECK(sizeof(Impl) <= sizeof(m_implMem));
+	m_impl = new(m_implMem) Impl();
+}
+Thread::~Thread()
+{
+	if (m_impl->running)
+		Stop();
+	m_impl->~Impl();
+}
+
+// @note	Priority is ignored, POSIX threads with default (SCHED_OTHER)
+//			policy don't support per-thread priorities.
+bool Thread::Start(const Delegate& delegate, unsigned int stackSize /*= 4096*/,
+		Priority /*priority = PRIORITY_NORMAL*/)
+{
+	RDE_ASSERT(!IsRunning());
+	m_impl->mdelegate = delegate;
+
+	pthread_attr_t attr;
+	::pthread_attr_init(&attr);
+	// Win32 rounds stack size up as well.
+	if (stackSize < PTHREAD_STACK_MIN)
+		stackSize = PTHREAD_STACK_MIN;
+	::pthread_attr_setstacksize(&attr, stackSize);
+	const int res = ::pthread_create(&m_impl->thread, &attr, &Thread_Run, m_impl);
+	::pthread_attr_destroy(&attr);
+
+	RDE_ASSERT(res == 0);
+	if (res != 0)
+		Sys::DebugPrint("Couldn't start thread\n");
+	else
+	{
+		m_impl->running = true;
+		m_impl->joined = false;
+		m_impl->evtThreadStarted.WaitInfinite();
+	}
+	return res == 0;
+}
+
+void Thread::Stop()
+{
+	RDE_ASSERT(IsRunning());
+	m_impl->Join();
+	m_impl->running = false;
+}
+
+void Thread::Wait()
+{
+	m_impl->Join();
+}
+
+bool Thread::IsRunning() const
+{
+	return m_impl->running;
+}
+
+void Thread::SetAffinityMask(uint32 affinityMask)
+{
+#if defined(__linux__)
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	for (int i = 0; i < 32; ++i)
+	{
+		if (affinityMask & (1U << i))
+			CPU_SET(i, &cpuSet);
+	}
+	::pthread_setaffinity_np(m_impl->thread, sizeof(cpuSet), &cpuSet);
+#else
+	(void)affinityMask;
+#endif
+}
+
+void Thread::SetName(const char* name)
+{
+	s_currentThreadName = name;
+#if defined(__linux__)
+	// Max 16 characters (including terminator), longer names are rejected.
+	char shortName[16];
+	strncpy(shortName, name, sizeof(shortName) - 1);
+	shortName[sizeof(shortName) - 1] = '\0';
+	::pthread_setname_np(::pthread_self(), shortName);
+#endif
+}
+const char* Thread::GetCurrentThreadName()
+{
+	return s_currentThreadName;
+}
+int Thread::GetCurrentThreadId()
+{
+#if defined(__linux__)
+	return int(::syscall(SYS_gettid));
+#else
+	return int(size_t(::pthread_self()));
+#endif
+}
+void Thread::Sleep(long millis)
+{
+	timespec ts;
+	ts.tv_sec = millis / 1000;
+	ts.tv_nsec = (millis % 1000) * 1000000;
+	while (::nanosleep(&ts, &ts) != 0)
+	{
+		/**/
+	}
+}
+void Thread::YieldCurrentThread()
+{
+	::sched_yield();
+}
+
+uint32 Thread::GetProcessAffinityMask()
+{
+	uint32 processAffinityMask(0);
+#if defined(__linux__)
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	if (::sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0)
+	{
+		for (int i = 0; i < 32; ++i)
+		{
+			if (CPU_ISSET(i, &cpuSet))
+				processAffinityMask |= (1U << i);
+		}
+	}
+#endif
+	if (processAffinityMask == 0)
+	{
+		const long numCpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+		processAffinityMask = (numCpus >= 32 ? 0xFFFFFFFFU : (1U << (numCpus > 0 ? numCpus : 1)) - 1);
+	}
+	return processAffinityMask;
+}
+
+} // rde
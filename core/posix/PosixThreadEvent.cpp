@@ -0,0 +1,73 @@
+#include "core/ThreadEvent.h"
+#include "core/RdeAssert.h"
+#include <cerrno>
+#include <time.h>
+
+namespace rde
+{
+ThreadEvent::ThreadEvent(ResetType resetType, bool initialState)
+:	m_signaled(initialState),
+	m_resetType(resetType)
+{
+	::pthread_mutex_init(&m_mutex, 0);
+	::pthread_cond_init(&m_cond, 0);
+}
+ThreadEvent::~ThreadEvent()
+{
+	::pthread_cond_destroy(&m_cond);
+	::pthread_mutex_destroy(&m_mutex);
+}
+void ThreadEvent::Signal()
+{
+	::pthread_mutex_lock(&m_mutex);
+	m_signaled = true;
+	// Auto reset event releases single waiting thread, manual - all of them.
+	if (m_resetType == AUTO_RESET)
+		::pthread_cond_signal(&m_cond);
+	else
+		::pthread_cond_broadcast(&m_cond);
+	::pthread_mutex_unlock(&m_mutex);
+}
+void ThreadEvent::Reset()
+{
+	::pthread_mutex_lock(&m_mutex);
+	m_signaled = false;
+	::pthread_mutex_unlock(&m_mutex);
+}
+void ThreadEvent::WaitInfinite() const
+{
+	::pthread_mutex_lock(&m_mutex);
+	while (!m_signaled)
+		::pthread_cond_wait(&m_cond, &m_mutex);
+	if (m_resetType == AUTO_RESET)
+		m_signaled = false;
+	::pthread_mutex_unlock(&m_mutex);
+}
+bool ThreadEvent::WaitTimeout(long milliseconds) const
+{
+	timespec deadline;
+	::clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += milliseconds / 1000;
+	deadline.tv_nsec += (milliseconds % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		++deadline.tv_sec;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	::pthread_mutex_lock(&m_mutex);
+	int res(0);
+	while (!m_signaled && res != ETIMEDOUT)
+		res = ::pthread_cond_timedwait(&m_cond, &m_mutex, &deadline);
+	const bool signaled = m_signaled;
+	if (signaled && m_resetType == AUTO_RESET)
+		m_signaled = false;
+	::pthread_mutex_unlock(&m_mutex);
+	return signaled;
+}
+void* ThreadEvent::GetSystemRepresentation() const
+{
+	return &m_cond;
+}
+
+} // rde
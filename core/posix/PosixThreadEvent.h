@@ -0,0 +1,34 @@
+#ifndef CORE_THREAD_EVENT_H
+#	error "Do not include directly, only via core/ThreadEvent.h"
+#endif
+
+#include <pthread.h>
+
+namespace rde
+{
+// Win32-like event, built on top of condition variable.
+class ThreadEvent
+{
+public:
+	enum ResetType
+	{
+		AUTO_RESET,
+		MANUAL_RESET
+	};
+
+	explicit ThreadEvent(ResetType resetType = AUTO_RESET, bool initialState = false);
+	~ThreadEvent();
+
+	void Signal();
+	void Reset();
+	void WaitInfinite() const;
+	bool WaitTimeout(long milliseconds) const;
+
+	void* GetSystemRepresentation() const;
+private:
+	mutable pthread_mutex_t	m_mutex;
+	mutable pthread_cond_t	m_cond;
+	mutable bool			m_signaled;
+	ResetType				m_resetType;
+};
+}
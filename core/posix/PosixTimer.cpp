@@ -0,0 +1,59 @@
+#include "core/Timer.h"
+#include <time.h>
+
+namespace
+{
+const rde::int64	kNanosPerSecond	= 1000000000;
+const rde::int64	kNanosPerMilli	= 1000000;
+} // <anonymous>
+
+namespace rde
+{
+Timer::Timer()
+:	m_startTime(0),
+	m_stopTime(0),
+	m_running(false)
+{
+	/**/
+}
+
+void Timer::Start()
+{
+	if (!m_running)
+	{
+		m_startTime = Now();
+		m_running = true;
+	}
+}
+
+void Timer::Stop()
+{
+	if (m_running)
+	{
+		m_stopTime = Now();
+		m_running = false;
+	}
+}
+
+int Timer::GetTimeInMs() const
+{
+	return ToMillis(GetTime());
+}
+
+int64 Timer::GetTime() const
+{
+	const int64 curTime = m_running ? Now() : m_stopTime;
+	return curTime - m_startTime;
+}
+int Timer::ToMillis(int64 ticks) const
+{
+	return int(ticks / kNanosPerMilli);
+}
+
+int64 Timer::Now()
+{
+	timespec ts;
+	::clock_gettime(CLOCK_MONOTONIC, &ts);
+	return int64(ts.tv_sec) * kNanosPerSecond + ts.tv_nsec;
+}
+} // rde
@@ -0,0 +1,31 @@
+#ifndef CORE_TIMER_H
+#	error "Do not include directly, only via core/Timer.h"
+#endif
+
+namespace rde
+{
+
+// POSIX timer (monotonic clock, internal units are nanoseconds).
+class Timer
+{
+public:
+	Timer();
+
+	void Start();
+	void Stop();
+
+	int GetTimeInMs() const;
+	// Time in internal units.
+	int64 GetTime() const;
+	int ToMillis(int64 ticks) const;
+	static int64 Now();
+
+	bool IsRunning() const { return m_running; }
+
+private:
+	int64	m_startTime;
+	int64	m_stopTime;
+	bool	m_running;
+};
+
+} // namespaces
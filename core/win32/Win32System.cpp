@@ -83,4 +83,24 @@ void Sys::GetErrorString(char* outString, int maxOutStringLen, DWORD errorOverri
 		::strcpy_s(outString, maxOutStringLen, (const char*)locString);
 }
 
+void* Sys::ReserveMemory(size_t bytes)
+{
+	return ::VirtualAlloc(NULL, bytes, MEM_RESERVE, PAGE_NOACCESS);
+}
+bool Sys::CommitMemory(void* ptr, size_t bytes)
+{
+	return ::VirtualAlloc(ptr, bytes, MEM_COMMIT, PAGE_READWRITE) != NULL;
+}
+void Sys::ReleaseMemory(void* ptr, size_t /*bytes*/)
+{
+	if (ptr != 0)
+		::VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+int Sys::CaptureCallstack(void** frames, int maxFrames, int framesToSkip)
+{
+	// +1 for this function.
+	return ::CaptureStackBackTrace(framesToSkip + 1, maxFrames, frames, NULL);
+}
+
 } // rde
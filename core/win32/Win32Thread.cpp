@@ -1,6 +1,7 @@
 #include "core/Thread.h"
 #include "core/Console.h"
 #include "core/RdeAssert.h"
+#include "core/SizeClassAllocator.h"
 #include "core/ThreadEvent.h"
 #include "core/ThreadProfiler.h"
 #include "core/win32/Windows.h"
@@ -64,6 +65,8 @@ unsigned __stdcall Thread_Run(LPVOID arg)
 {
 	rde::Thread::Impl* impl = static_cast<rde::Thread::Impl*>(arg);
 	impl->Run();
+	// Blocks cached by this thread would be lost otherwise.
+	rde::SizeClassAllocator::FlushThreadCache();
 	rde::ThreadProfiler::SubmitEvents();
 	s_currentThreadName = 0;
 	return 0;
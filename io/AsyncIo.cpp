@@ -0,0 +1,383 @@
+#include "io/AsyncIo.h"
+#include "core/Atomic.h"
+#include "core/Mutex.h"
+#include "core/Semaphore.h"
+#include "core/Thread.h"
+#include "core/RdeAssert.h"
+
+// Linux: requests go straight to io_uring, no worker threads needed.
+// Elsewhere (and if io_uring is not available) worker threads use
+// positional reads/writes.
+#if defined(__linux__)
+#	define RDE_ASYNC_IO_URING	1
+#	include "io/posix/IoRing.h"
+#	include <cerrno>
+#else
+#	define RDE_ASYNC_IO_URING	0
+#endif
+
+namespace
+{
+// Critical sections guarding request queue are very short.
+const long kQueueMutexSpinCount	= 4000;
+
+#if RDE_ASYNC_IO_URING
+const rde::uint32 kRingEntries				= 256;
+const int kMaxCompletionsPerWait			= 32;
+// Bigger requests are split (kernel may transfer less anyway).
+const long kMaxRingTransfer					= 1 << 30;
+// Request pointers are never null.
+const rde::uint64 kQuitUserData				= 0;
+#endif
+}
+
+namespace rde
+{
+AsyncIoRequest::AsyncIoRequest()
+:	m_file(iosys::INVALID_FILE_HANDLE),
+	m_offset(0),
+	m_data(0),
+	m_bytes(0),
+	m_operation(READ),
+	m_callback(0),
+	m_userData(0),
+	m_status(STATUS_IDLE),
+	m_bytesTransferred(0),
+	m_next(0)
+{
+}
+
+void AsyncIoRequest::SetRead(iosys::FileHandle f, long offset, void* data, long bytes)
+{
+	RDE_ASSERT(!IsPending());
+	m_file = f;
+	m_offset = offset;
+	m_data = data;
+	m_bytes = bytes;
+	m_operation = READ;
+}
+void AsyncIoRequest::SetWrite(iosys::FileHandle f, long offset, const void* data, long bytes)
+{
+	SetRead(f, offset, const_cast<void*>(data), bytes);
+	m_operation = WRITE;
+}
+
+bool AsyncIoRequest::IsDone() const
+{
+	return Load_Acquire(m_status) >= STATUS_DONE;
+}
+bool AsyncIoRequest::Succeeded() const
+{
+	return Load_Acquire(m_status) == STATUS_DONE;
+}
+bool AsyncIoRequest::IsPending() const
+{
+	return Load_Acquire(m_status) == STATUS_PENDING;
+}
+
+struct AsyncIo::Impl
+{
+	explicit Impl(int numWorkerThreads)
+	:	m_mutex(kQueueMutexSpinCount),
+		m_head(0),
+		m_tail(0),
+		m_numPending(0),
+		m_numThreads(0),
+		m_quit(false)
+#if RDE_ASYNC_IO_URING
+		, m_useRing(false),
+		m_numInRing(0)
+#endif
+	{
+		RDE_ASSERT(numWorkerThreads > 0);
+#if RDE_ASYNC_IO_URING
+		// Kernel does all the work, we only need a thread reaping completions.
+		if (m_ring.Init(kRingEntries))
+		{
+			m_useRing = true;
+			m_completionThread.Start(Thread::Delegate::from_method<Impl, &Impl::CompletionThread>(this));
+			return;
+		}
+#endif
+		m_numThreads = (numWorkerThreads < kMaxWorkerThreads ? numWorkerThreads : kMaxWorkerThreads);
+		for (int i = 0; i < m_numThreads; ++i)
+		{
+			m_threads[i].Start(Thread::Delegate::from_method<Impl, &Impl::WorkerThread>(this));
+		}
+	}
+	~Impl()
+	{
+		WaitAll();
+		m_quit = true;
+#if RDE_ASYNC_IO_URING
+		if (m_useRing)
+		{
+			// All requests are done, so there's room for wake-up NOP.
+			m_mutex.Acquire();
+			m_ring.PrepareNop(kQuitUserData);
+			const bool submitted = m_ring.Submit();
+			RDE_ASSERT(submitted);
+			(void)submitted;
+			m_mutex.Release();
+			m_completionThread.Stop();
+		}
+#endif
+		m_workAvailable.Signal(m_numThreads);
+		for (int i = 0; i < m_numThreads; ++i)
+			m_threads[i].Stop();
+	}
+
+	void Push(AsyncIoRequest* requests, int numRequests)
+	{
+		for (int i = 0; i < numRequests; ++i)
+		{
+			RDE_ASSERT(!requests[i].IsPending());
+			RDE_ASSERT(requests[i].m_file != iosys::INVALID_FILE_HANDLE && requests[i].m_bytes > 0);
+			requests[i].m_status = AsyncIoRequest::STATUS_PENDING;
+			requests[i].m_bytesTransferred = 0;
+			requests[i].m_next = (i + 1 < numRequests ? &requests[i + 1] : 0);
+		}
+		Interlocked::FetchAndAdd(&m_numPending, numRequests);
+
+		m_mutex.Acquire();
+		int numQueued(0);
+#if RDE_ASYNC_IO_URING
+		// Whatever doesn't fit in the ring waits in the queue, it's submitted
+		// as soon as some requests complete.
+		if (m_useRing)
+		{
+			while (numQueued < numRequests && CanSubmitToRing())
+				SubmitToRing(&requests[numQueued++]);
+			if (numQueued != 0)
+				SubmitRing();
+		}
+#endif
+		if (numQueued < numRequests)
+		{
+			if (m_tail != 0)
+				m_tail->m_next = requests + numQueued;
+			else
+				m_head = requests + numQueued;
+			m_tail = requests + numRequests - 1;
+		}
+		m_mutex.Release();
+
+		if (m_numThreads != 0)
+			m_workAvailable.Signal(numRequests);
+	}
+	AsyncIoRequest* Pop()
+	{
+		m_mutex.Acquire();
+		AsyncIoRequest* request = PopLocked();
+		m_mutex.Release();
+		return request;
+	}
+	AsyncIoRequest* PopLocked()
+	{
+		AsyncIoRequest* request = m_head;
+		if (request != 0)
+		{
+			m_head = request->m_next;
+			if (m_head == 0)
+				m_tail = 0;
+		}
+		return request;
+	}
+	// Request can be partially done already (short transfer in the ring),
+	// we continue from where it stopped.
+	void Process(AsyncIoRequest* request)
+	{
+		const long done = request->m_bytesTransferred;
+		uint8* data = static_cast<uint8*>(request->m_data) + done;
+		const long transferred = (request->m_operation == AsyncIoRequest::READ ?
+			iosys::ReadAt(request->m_file, request->m_offset + done, data, request->m_bytes - done) :
+			iosys::WriteAt(request->m_file, request->m_offset + done, data, request->m_bytes - done));
+		if (transferred > 0)
+			request->m_bytesTransferred += transferred;
+		Complete(request, request->m_bytesTransferred == request->m_bytes);
+	}
+	void Complete(AsyncIoRequest* request, bool succeeded)
+	{
+		if (request->m_callback)
+			request->m_callback(request, request->m_userData);
+
+		// Publish result. Request can be reused/freed by its owner right after this point.
+		Interlocked::FetchAndStore(&request->m_status, succeeded ?
+			AsyncIoRequest::STATUS_DONE : AsyncIoRequest::STATUS_FAILED);
+		Interlocked::Decrement(&m_numPending);
+	}
+	// Processes one queued request on calling thread, false if queue was empty.
+	bool Help()
+	{
+		AsyncIoRequest* request = Pop();
+		if (request != 0)
+			Process(request);
+		return request != 0;
+	}
+	void Wait(const AsyncIoRequest& request)
+	{
+		while (!request.IsDone())
+		{
+			if (!Help())
+				Thread::YieldCurrentThread();
+		}
+	}
+	void WaitAll()
+	{
+		while (Load_Acquire(m_numPending) > 0)
+		{
+			if (!Help())
+				Thread::YieldCurrentThread();
+		}
+	}
+
+	void WorkerThread()
+	{
+		while (true)
+		{
+			// Semaphore count may be higher than number of queued requests
+			// (waiting threads help processing them), so Pop() can fail.
+			m_workAvailable.WaitInfinite();
+			if (m_quit)
+				break;
+			Help();
+		}
+	}
+
+#if RDE_ASYNC_IO_URING
+	// Requests in the ring never exceed its capacity, so completion queue
+	// (twice as big) cannot overflow.
+	bool CanSubmitToRing() const
+	{
+		return m_numInRing < m_ring.GetCapacity() && m_ring.GetNumFreeEntries() != 0;
+	}
+	// @pre	m_mutex held.
+	void SubmitToRing(AsyncIoRequest* request)
+	{
+		const long done = request->m_bytesTransferred;
+		const long left = request->m_bytes - done;
+		// Rest (if any) is resubmitted when this part completes.
+		const uint32 bytes = uint32(left < kMaxRingTransfer ? left : kMaxRingTransfer);
+		const int fd = iosys::GetFileDescriptor(request->m_file);
+		uint8* data = static_cast<uint8*>(request->m_data) + done;
+		const uint64 offset = uint64(request->m_offset + done);
+		const uint64 userData = uint64(reinterpret_cast<size_t>(request));
+		if (request->m_operation == AsyncIoRequest::READ)
+			m_ring.PrepareRead(fd, offset, data, bytes, userData);
+		else
+			m_ring.PrepareWrite(fd, offset, data, bytes, userData);
+		++m_numInRing;
+	}
+	// @pre	m_mutex held.
+	void SubmitRing()
+	{
+		// Only fails if kernel runs out of memory. Entries stay queued,
+		// next submission (or completion) tries again.
+		const bool submitted = m_ring.Submit();
+		RDE_ASSERT(submitted);
+		(void)submitted;
+	}
+
+	void CompletionThread()
+	{
+		IoRing::Completion completions[kMaxCompletionsPerWait];
+		bool quit(false);
+		while (!quit)
+		{
+			const int numCompletions = m_ring.WaitCompletions(completions, kMaxCompletionsPerWait);
+			AsyncIoRequest* resubmit(0);
+			for (int i = 0; i < numCompletions; ++i)
+			{
+				if (completions[i].userData == kQuitUserData)
+				{
+					quit = true;
+					continue;
+				}
+				AsyncIoRequest* request = reinterpret_cast<AsyncIoRequest*>(size_t(completions[i].userData));
+				const int result = completions[i].result;
+				if (result > 0)
+					request->m_bytesTransferred += result;
+				// Short transfer (or interrupted), continue with the rest. Zero bytes
+				// means end of file.
+				if ((result > 0 && request->m_bytesTransferred < request->m_bytes) ||
+					result == -EINTR || result == -EAGAIN)
+				{
+					request->m_next = resubmit;
+					resubmit = request;
+				}
+				else
+				{
+					Complete(request, request->m_bytesTransferred == request->m_bytes);
+				}
+			}
+
+			m_mutex.Acquire();
+			m_numInRing -= uint32(numCompletions - (quit ? 1 : 0));
+			// Unfinished requests go to the front, queued ones are older than them anyway.
+			while (resubmit != 0)
+			{
+				AsyncIoRequest* next = resubmit->m_next;
+				resubmit->m_next = m_head;
+				m_head = resubmit;
+				if (m_tail == 0)
+					m_tail = resubmit;
+				resubmit = next;
+			}
+			bool anySubmitted(false);
+			while (m_head != 0 && CanSubmitToRing())
+			{
+				SubmitToRing(PopLocked());
+				anySubmitted = true;
+			}
+			if (anySubmitted)
+				SubmitRing();
+			m_mutex.Release();
+		}
+	}
+
+	IoRing				m_ring;
+	Thread				m_completionThread;
+#endif
+
+	Mutex				m_mutex;
+	Semaphore			m_workAvailable;
+	AsyncIoRequest*		m_head;
+	AsyncIoRequest*		m_tail;
+	Atomic32			m_numPending;
+	Thread				m_threads[kMaxWorkerThreads];
+	int					m_numThreads;
+	volatile bool		m_quit;
+#if RDE_ASYNC_IO_URING
+	bool				m_useRing;
+	uint32				m_numInRing;
+#endif
+};
+
+AsyncIo::AsyncIo(int numWorkerThreads)
+:	m_impl(new Impl(numWorkerThreads))
+{
+}
+AsyncIo::~AsyncIo()
+{
+}
+
+void AsyncIo::Submit(AsyncIoRequest* requests, int numRequests)
+{
+	RDE_ASSERT(requests != 0 || numRequests == 0);
+	if (numRequests > 0)
+		m_impl->Push(requests, numRequests);
+}
+void AsyncIo::Wait(AsyncIoRequest& request)
+{
+	m_impl->Wait(request);
+}
+void AsyncIo::WaitAll()
+{
+	m_impl->WaitAll();
+}
+int AsyncIo::GetNumPendingRequests() const
+{
+	return Load_Acquire(m_impl->m_numPending);
+}
+
+} // rde
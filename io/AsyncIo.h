@@ -0,0 +1,92 @@
+#ifndef IO_ASYNC_IO_H
+#define IO_ASYNC_IO_H
+
+#include "io/IoSys.h"
+#include "core/ScopedPtr.h"
+
+namespace rde
+{
+// Single asynchronous read/write request.
+// Data buffer is owned by the caller and has to stay valid (and untouched)
+// until request is completed. Same for request object itself.
+struct AsyncIoRequest
+{
+	// Called from I/O thread, right after request has been processed,
+	// m_bytesTransferred is already valid at this point.
+	typedef void (*Callback)(AsyncIoRequest* request, void* userData);
+
+	enum Operation
+	{
+		READ,
+		WRITE
+	};
+	enum Status
+	{
+		STATUS_IDLE,
+		STATUS_PENDING,
+		STATUS_DONE,
+		STATUS_FAILED
+	};
+
+	AsyncIoRequest();
+
+	void SetRead(iosys::FileHandle f, long offset, void* data, long bytes);
+	void SetWrite(iosys::FileHandle f, long offset, const void* data, long bytes);
+
+	// Can be polled from any thread.
+	bool IsPending() const;
+	bool IsDone() const;
+	bool Succeeded() const;
+
+	iosys::FileHandle	m_file;
+	long				m_offset;
+	void*				m_data;
+	long				m_bytes;
+	Operation			m_operation;
+	Callback			m_callback;		// Optional, may be NULL
+	void*				m_userData;
+
+	// Filled by AsyncIo, do not modify.
+	volatile long		m_status;
+	long				m_bytesTransferred;
+	AsyncIoRequest*		m_next;
+};
+
+// Asynchronous I/O queue.
+// Requests are processed by pool of worker threads, using positional
+// reads/writes, so it's OK to have many requests for the same file in flight.
+// On Linux requests are submitted to io_uring instead (single thread reaps
+// completions and runs callbacks), worker threads are only used if it's not
+// available.
+class AsyncIo
+{
+public:
+	static const int	kMaxWorkerThreads	= 8;
+
+	// numWorkerThreads is ignored if io_uring is used.
+	explicit AsyncIo(int numWorkerThreads = 2);
+	// Waits for all pending requests.
+	~AsyncIo();
+
+	// Submits whole batch at once (one lock, one wake-up).
+	// @pre	None of the requests is pending.
+	void Submit(AsyncIoRequest* requests, int numRequests);
+	void Submit(AsyncIoRequest& request)	{ Submit(&request, 1); }
+
+	// Blocks until request is completed. Calling thread helps with
+	// processing queued requests in the meantime.
+	void Wait(AsyncIoRequest& request);
+	void WaitAll();
+
+	int GetNumPendingRequests() const;
+
+private:
+	RDE_FORBID_COPY(AsyncIo);
+
+	struct Impl;
+	ScopedPtr<Impl>	m_impl;
+};
+
+} // rde
+
+#endif // IO_ASYNC_IO_H
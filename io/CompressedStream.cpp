@@ -0,0 +1,431 @@
+#include "io/CompressedStream.h"
+#include "io/LzCodec.h"
+#include "core/Atomic.h"
+#include "core/RdeAssert.h"
+#include "core/Semaphore.h"
+#include "core/System.h"
+#include "core/Thread.h"
+
+namespace
+{
+// 'RDEZ' (same value multichar constant would have on MSVC).
+const rde::uint32	kMagic				= (rde::uint32('R') << 24) | (rde::uint32('D') << 16) |
+											(rde::uint32('E') << 8) | rde::uint32('Z');
+const long			kMaxBlockSize		= 4 * 1024 * 1024;
+// Max number of blocks read from underlying stream at once (limits scratch memory).
+const int			kMaxBlocksPerBatch	= 64;
+const int			kMaxThreads			= 8;
+
+struct Header
+{
+	rde::uint32	m_magic;
+	rde::uint32	m_blockSize;
+	rde::uint32	m_uncompressedSize;
+	rde::uint32	m_numBlocks;
+	rde::uint32	m_indexOffset;
+};
+}
+
+namespace rde
+{
+struct CompressedStream::DecompressTask
+{
+	const uint8*	m_src;
+	long			m_srcBytes;
+	uint8*			m_dst;
+	long			m_dstBytes;
+
+	bool Run() const
+	{
+		if (m_srcBytes == m_dstBytes)
+		{
+			Sys::MemCpy(m_dst, m_src, m_dstBytes);
+			return true;
+		}
+		return lz::Decompress(m_src, m_srcBytes, m_dst, m_dstBytes) == m_dstBytes;
+	}
+};
+
+// Helper threads, they grab tasks from shared list together with calling thread.
+struct CompressedStream::ThreadPool
+{
+	explicit ThreadPool(int numThreads)
+	:	m_tasks(0),
+		m_numTasks(0),
+		m_nextTask(0),
+		m_numFailed(0),
+		m_numThreads(numThreads < kMaxThreads ? numThreads : kMaxThreads),
+		m_quit(false)
+	{
+		for (int i = 0; i < m_numThreads; ++i)
+			m_threads[i].Start(Thread::Delegate::from_method<ThreadPool, &ThreadPool::WorkerThread>(this));
+	}
+	~ThreadPool()
+	{
+		m_quit = true;
+		m_workAvailable.Signal(m_numThreads);
+		for (int i = 0; i < m_numThreads; ++i)
+			m_threads[i].Stop();
+	}
+
+	// Returns false if any of the tasks failed.
+	bool Run(const DecompressTask* tasks, int numTasks)
+	{
+		m_tasks = tasks;
+		m_numTasks = numTasks;
+		m_nextTask = 0;
+		m_numFailed = 0;
+		m_workAvailable.Signal(m_numThreads);
+		ProcessTasks();
+		// Wait for every thread to check in, so that none of them touches
+		// task list after we return.
+		for (int i = 0; i < m_numThreads; ++i)
+			m_workDone.WaitInfinite();
+		return m_numFailed == 0;
+	}
+
+	void ProcessTasks()
+	{
+		long taskIndex;
+		while ((taskIndex = Interlocked::Increment(&m_nextTask) - 1) < m_numTasks)
+		{
+			if (!m_tasks[taskIndex].Run())
+				Interlocked::Increment(&m_numFailed);
+		}
+	}
+	void WorkerThread()
+	{
+		while (true)
+		{
+			m_workAvailable.WaitInfinite();
+			if (m_quit)
+				break;
+			ProcessTasks();
+			m_workDone.Signal(1);
+		}
+	}
+
+	const DecompressTask*	m_tasks;
+	long					m_numTasks;
+	Atomic32				m_nextTask;
+	Atomic32				m_numFailed;
+	Semaphore				m_workAvailable;
+	Semaphore				m_workDone;
+	Thread					m_threads[kMaxThreads];
+	int						m_numThreads;
+	volatile bool			m_quit;
+};
+
+CompressedStream::CompressedStream()
+:	m_stream(0),
+	m_baseOffset(0),
+	m_blockSize(0),
+	m_size(0),
+	m_position(0),
+	m_compressedSize(0),
+	m_cachedBlock(-1),
+	m_numThreads(0)
+{
+	/**/
+}
+CompressedStream::~CompressedStream()
+{
+	if (IsOpen())
+		Close();
+}
+
+bool CompressedStream::Open(Stream* stream, unsigned long accessModeFlags, long blockSize)
+{
+	RDE_ASSERT(!IsOpen());
+	RDE_ASSERT(stream != 0 && stream->IsOpen());
+	RDE_ASSERT(accessModeFlags == iosys::AccessMode::READ || accessModeFlags == iosys::AccessMode::WRITE);
+	RDE_ASSERT(stream->GetAccessModeFlags() & accessModeFlags);
+
+	m_baseOffset = stream->GetPosition();
+	m_position = 0;
+	m_cachedBlock = -1;
+	m_blocks.clear();
+	if (accessModeFlags == iosys::AccessMode::WRITE)
+	{
+		RDE_ASSERT(blockSize > 0 && blockSize <= kMaxBlockSize);
+		m_blockSize = blockSize;
+		m_size = 0;
+		m_compressedSize = 0;
+		m_block.resize(m_blockSize);
+		m_compressed.resize(lz::GetMaxCompressedSize(m_blockSize));
+
+		// Placeholder, final header written on Close.
+		Header header;
+		Sys::MemSet(&header, 0, sizeof(header));
+		stream->Write(&header, sizeof(header));
+	}
+	else
+	{
+		Header header;
+		if (stream->Read(&header, sizeof(header)) != sizeof(header) || header.m_magic != kMagic ||
+			header.m_blockSize == 0 || header.m_blockSize > kMaxBlockSize ||
+			header.m_uncompressedSize > 0x7FFFFFFF)
+		{
+			return false;
+		}
+		// Corrupted header/index must not make us index past m_blocks or
+		// allocate/read crazy amounts of memory, so everything is validated
+		// against the size of underlying stream before it's used.
+		const uint32 expectedNumBlocks = uint32((uint64(header.m_uncompressedSize) + header.m_blockSize - 1) /
+			header.m_blockSize);
+		const uint64 streamBytes = uint64(stream->GetSize() - m_baseOffset);
+		const uint64 indexBytes = uint64(header.m_numBlocks) * sizeof(BlockInfo);
+		if (header.m_numBlocks != expectedNumBlocks || header.m_indexOffset < sizeof(Header) ||
+			uint64(header.m_indexOffset) + indexBytes > streamBytes)
+		{
+			return false;
+		}
+		m_blockSize = header.m_blockSize;
+		m_size = header.m_uncompressedSize;
+		m_blocks.resize(header.m_numBlocks);
+		stream->Seek(iosys::SeekMode::BEGIN, m_baseOffset + header.m_indexOffset);
+		if (indexBytes > 0 && stream->Read(m_blocks.begin(), long(indexBytes)) != long(indexBytes))
+		{
+			m_blocks.clear();
+			return false;
+		}
+		// Blocks are written one after another, right after the header
+		// (DecompressBlocks relies on that).
+		uint64 blockEnd = sizeof(Header);
+		for (int i = 0; i < int(m_blocks.size()); ++i)
+		{
+			const BlockInfo& info = m_blocks[i];
+			if (info.m_offset != blockEnd || info.m_compressedSize == 0 ||
+				long(info.m_compressedSize) > GetBlockSize(i))
+			{
+				m_blocks.clear();
+				return false;
+			}
+			blockEnd += info.m_compressedSize;
+		}
+		if (blockEnd != header.m_indexOffset)
+		{
+			m_blocks.clear();
+			return false;
+		}
+		m_compressedSize = long(header.m_indexOffset + indexBytes);
+		m_block.resize(m_blockSize);
+	}
+	m_stream = stream;
+	m_accessMode = accessModeFlags;
+	return true;
+}
+
+void CompressedStream::SetNumDecompressionThreads(int numThreads)
+{
+	RDE_ASSERT(numThreads >= 0);
+	if (numThreads != m_numThreads)
+	{
+		m_threadPool.Reset(numThreads > 0 ? new ThreadPool(numThreads) : 0);
+		m_numThreads = numThreads;
+	}
+}
+
+long CompressedStream::Read(void* data, long bytes)
+{
+	RDE_ASSERT(IsOpen());
+	RDE_ASSERT(GetAccessModeFlags() & iosys::AccessMode::READ);
+	if (!IsOpen())
+		return 0;
+
+	const long bytesLeft = m_size - m_position;
+	if (bytes > bytesLeft)
+		bytes = bytesLeft;
+
+	uint8* dst = static_cast<uint8*>(data);
+	long bytesRead(0);
+	while (bytesRead < bytes)
+	{
+		const int blockIndex = int(m_position / m_blockSize);
+		const long blockOffset = m_position % m_blockSize;
+		const long toRead = bytes - bytesRead;
+
+		// Whole blocks go straight to destination.
+		if (blockOffset == 0 && toRead >= GetBlockSize(blockIndex))
+		{
+			int numBlocks(0);
+			long batchBytes(0);
+			while (numBlocks < kMaxBlocksPerBatch && blockIndex + numBlocks < int(m_blocks.size()) &&
+				batchBytes + GetBlockSize(blockIndex + numBlocks) <= toRead)
+			{
+				batchBytes += GetBlockSize(blockIndex + numBlocks);
+				++numBlocks;
+			}
+			if (!DecompressBlocks(blockIndex, numBlocks, dst + bytesRead))
+				break;
+			bytesRead += batchBytes;
+			m_position += batchBytes;
+			continue;
+		}
+
+		if (!LoadBlock(blockIndex))
+			break;
+		const long blockBytesLeft = GetBlockSize(blockIndex) - blockOffset;
+		const long toCopy = (toRead < blockBytesLeft ? toRead : blockBytesLeft);
+		Sys::MemCpy(dst + bytesRead, m_block.begin() + blockOffset, toCopy);
+		bytesRead += toCopy;
+		m_position += toCopy;
+	}
+	return bytesRead;
+}
+
+void CompressedStream::Write(const void* data, long bytes)
+{
+	RDE_ASSERT(IsOpen());
+	RDE_ASSERT(GetAccessModeFlags() & iosys::AccessMode::WRITE);
+	if (!IsOpen())
+		return;
+
+	const uint8* src = static_cast<const uint8*>(data);
+	while (bytes > 0)
+	{
+		const long blockOffset = m_size % m_blockSize;
+		const long blockBytesLeft = m_blockSize - blockOffset;
+		const long toCopy = (bytes < blockBytesLeft ? bytes : blockBytesLeft);
+		Sys::MemCpy(m_block.begin() + blockOffset, src, toCopy);
+		src += toCopy;
+		bytes -= toCopy;
+		m_size += toCopy;
+		if (toCopy == blockBytesLeft)
+			FlushBlock();
+	}
+	m_position = m_size;
+}
+
+void CompressedStream::Flush()
+{
+	// Blocks have fixed size, so partial block can't be flushed before Close.
+	if (IsOpen())
+		m_stream->Flush();
+}
+
+void CompressedStream::Seek(iosys::SeekMode::Enum mode, long offset)
+{
+	RDE_ASSERT(IsOpen());
+	long newPosition(offset);
+	if (mode == iosys::SeekMode::CURRENT)
+		newPosition += m_position;
+	else if (mode == iosys::SeekMode::END)
+		newPosition += m_size;
+	RDE_ASSERT(newPosition >= 0 && newPosition <= m_size);
+	RDE_ASSERT(newPosition == m_position || !(GetAccessModeFlags() & iosys::AccessMode::WRITE));
+	if (GetAccessModeFlags() & iosys::AccessMode::READ)
+		m_position = newPosition < 0 ? 0 : (newPosition > m_size ? m_size : newPosition);
+}
+
+void CompressedStream::Close()
+{
+	RDE_ASSERT(IsOpen());
+	if (GetAccessModeFlags() & iosys::AccessMode::WRITE)
+	{
+		if (m_size % m_blockSize != 0)
+			FlushBlock();
+
+		Header header;
+		header.m_magic = kMagic;
+		header.m_blockSize = m_blockSize;
+		header.m_uncompressedSize = m_size;
+		header.m_numBlocks = m_blocks.size();
+		header.m_indexOffset = m_stream->GetPosition() - m_baseOffset;
+		const long indexBytes = m_blocks.size() * sizeof(BlockInfo);
+		if (indexBytes > 0)
+			m_stream->Write(m_blocks.begin(), indexBytes);
+		m_compressedSize = header.m_indexOffset + indexBytes;
+
+		const long endPosition = m_stream->GetPosition();
+		m_stream->Seek(iosys::SeekMode::BEGIN, m_baseOffset);
+		m_stream->Write(&header, sizeof(header));
+		m_stream->Seek(iosys::SeekMode::BEGIN, endPosition);
+	}
+	m_stream = 0;
+	m_block.clear();
+	m_compressed.clear();
+	m_cachedBlock = -1;
+}
+
+long CompressedStream::GetSize() const
+{
+	return m_size;
+}
+
+long CompressedStream::GetBlockSize(int blockIndex) const
+{
+	const long blockStart = blockIndex * m_blockSize;
+	const long bytesLeft = m_size - blockStart;
+	return bytesLeft < m_blockSize ? bytesLeft : m_blockSize;
+}
+
+void CompressedStream::FlushBlock()
+{
+	const long blockBytes = (m_size % m_blockSize == 0 ? m_blockSize : m_size % m_blockSize);
+	long compressedBytes = lz::Compress(m_block.begin(), blockBytes, m_compressed.begin(), blockBytes - 1);
+
+	BlockInfo info;
+	info.m_offset = m_stream->GetPosition() - m_baseOffset;
+	// Didn't compress well enough, store as-is.
+	if (compressedBytes == 0)
+	{
+		compressedBytes = blockBytes;
+		m_stream->Write(m_block.begin(), blockBytes);
+	}
+	else
+	{
+		m_stream->Write(m_compressed.begin(), compressedBytes);
+	}
+	info.m_compressedSize = compressedBytes;
+	m_blocks.push_back(info);
+}
+
+bool CompressedStream::LoadBlock(int blockIndex)
+{
+	if (blockIndex == m_cachedBlock)
+		return true;
+	m_cachedBlock = -1;
+	if (!DecompressBlocks(blockIndex, 1, m_block.begin()))
+		return false;
+	m_cachedBlock = blockIndex;
+	return true;
+}
+
+bool CompressedStream::DecompressBlocks(int firstBlock, int numBlocks, uint8* dst)
+{
+	RDE_ASSERT(numBlocks > 0 && numBlocks <= kMaxBlocksPerBatch);
+	RDE_ASSERT(firstBlock + numBlocks <= int(m_blocks.size()));
+
+	// Blocks are stored one after another, so they can be read in one go.
+	const BlockInfo& lastBlock = m_blocks[firstBlock + numBlocks - 1];
+	const long compressedStart = m_blocks[firstBlock].m_offset;
+	const long compressedBytes = lastBlock.m_offset + lastBlock.m_compressedSize - compressedStart;
+	if (long(m_compressed.size()) < compressedBytes)
+		m_compressed.resize(compressedBytes);
+	m_stream->Seek(iosys::SeekMode::BEGIN, m_baseOffset + compressedStart);
+	if (m_stream->Read(m_compressed.begin(), compressedBytes) != compressedBytes)
+		return false;
+
+	DecompressTask tasks[kMaxBlocksPerBatch];
+	for (int i = 0; i < numBlocks; ++i)
+	{
+		const BlockInfo& info = m_blocks[firstBlock + i];
+		DecompressTask& task = tasks[i];
+		task.m_src = m_compressed.begin() + (info.m_offset - compressedStart);
+		task.m_srcBytes = info.m_compressedSize;
+		task.m_dst = dst;
+		task.m_dstBytes = GetBlockSize(firstBlock + i);
+		dst += task.m_dstBytes;
+	}
+
+	if (numBlocks > 1 && m_threadPool.Get() != 0)
+		return m_threadPool->Run(tasks, numBlocks);
+
+	bool ok(true);
+	for (int i = 0; i < numBlocks; ++i)
+		ok &= tasks[i].Run();
+	return ok;
+}
+
+} // rde
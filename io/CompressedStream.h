@@ -0,0 +1,89 @@
+#ifndef IO_COMPRESSED_STREAM_H
+#define IO_COMPRESSED_STREAM_H
+
+#include "io/Stream.h"
+#include "rdestl/vector.h"
+#include "core/ScopedPtr.h"
+
+namespace rde
+{
+// Stream decorator, compresses/decompresses data on the fly (see LzCodec.h).
+// Data is split into fixed-size blocks compressed independently, block
+// index is stored at the end of the stream. Thanks to that, reading stream
+// can be seeked freely and big reads decompress many blocks in parallel.
+// Writing is sequential only.
+// Layout:
+//	Header, compressed blocks..., BlockInfo[numBlocks]
+class CompressedStream : public Stream
+{
+public:
+	static const long	kDefaultBlockSize	= 64 * 1024;
+
+	CompressedStream();
+	// Closes stream if still open.
+	virtual ~CompressedStream();
+
+	// Compressed data starts at current position of underlying stream.
+	// Underlying stream is not owned and has to stay open until Close.
+	// When writing, it also has to support seeking (header is patched on Close).
+	// accessModeFlags - READ or WRITE, not both.
+	// blockSize - ignored when reading (taken from header).
+	bool Open(Stream* stream, unsigned long accessModeFlags, long blockSize = kDefaultBlockSize);
+
+	// Number of additional threads used to decompress blocks, when single
+	// read covers more than one block. 0 (default) - calling thread only.
+	void SetNumDecompressionThreads(int numThreads);
+
+	virtual long Read(void* data, long bytes);
+	virtual void Write(const void* data, long bytes);
+	virtual void Flush();
+	// @note	Only seeking to current position is allowed when writing.
+	virtual void Seek(iosys::SeekMode::Enum mode, long offset);
+	// Writing - compresses last block, writes block index & header.
+	// Doesn't close underlying stream.
+	virtual void Close();
+
+	virtual bool IsOpen() const	{ return m_stream != 0; }
+	// Uncompressed size/position.
+	virtual long GetSize() const;
+	virtual long GetPosition() const	{ return m_position; }
+
+	// Size of compressed data (including header & index). Valid after writing
+	// stream has been closed or any time when reading.
+	long GetCompressedSize() const	{ return m_compressedSize; }
+
+private:
+	RDE_FORBID_COPY(CompressedStream);
+
+	struct BlockInfo
+	{
+		uint32	m_offset;			// Relative to start of the compressed stream.
+		uint32	m_compressedSize;	// == uncompressed size -> block stored as-is.
+	};
+	struct ThreadPool;
+	struct DecompressTask;
+
+	long GetBlockSize(int blockIndex) const;
+	void FlushBlock();
+	bool LoadBlock(int blockIndex);
+	// Decompresses whole blocks straight to destination.
+	bool DecompressBlocks(int firstBlock, int numBlocks, uint8* dst);
+
+	Stream*					m_stream;
+	long					m_baseOffset;
+	long					m_blockSize;
+	long					m_size;
+	long					m_position;
+	long					m_compressedSize;
+	vector<BlockInfo>		m_blocks;
+	// Uncompressed data of current block (being written/last read).
+	vector<uint8>			m_block;
+	int						m_cachedBlock;
+	vector<uint8>			m_compressed;
+	int						m_numThreads;
+	ScopedPtr<ThreadPool>	m_threadPool;
+};
+
+} // rde
+
+#endif // IO_COMPRESSED_STREAM_H
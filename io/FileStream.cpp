@@ -41,6 +41,13 @@ void FileStream::Write(const void* data, long bytes)
 	if (IsOpen())
 		iosys::Write(m_handle, data, bytes);
 }
+void FileStream::WriteV(const iosys::WriteSpan* spans, int numSpans)
+{
+	RDE_ASSERT(IsOpen());
+	RDE_ASSERT(GetAccessModeFlags() & iosys::AccessMode::WRITE);
+	if (IsOpen())
+		iosys::WriteV(m_handle, spans, numSpans);
+}
 void FileStream::Flush()
 {
 	if (IsOpen())
@@ -15,6 +15,7 @@ public:
 
 	virtual long Read(void* data, long bytes);
 	virtual void Write(const void* data, long bytes);
+	virtual void WriteV(const iosys::WriteSpan* spans, int numSpans);
 	virtual void Flush();
 	virtual void Seek(iosys::SeekMode::Enum mode, long offset);
 	virtual void Close();
@@ -52,16 +52,43 @@ namespace iosys
 
 	const FileHandle	INVALID_FILE_HANDLE	= 0;
 
+	// Single buffer of vectored write.
+	struct WriteSpan
+	{
+		const void*	m_data;
+		long		m_bytes;
+	};
+
 	FileHandle OpenFile(const char* path, unsigned long accessModeFlags);
 	void CloseFile(FileHandle f);
 	long Read(FileHandle f, void* data, long bytes);
 	void Write(FileHandle f, const void* data, long bytes);
+	// Writes all buffers, one after another. Small buffers are coalesced,
+	// so it's much cheaper than series of Write calls.
+	void WriteV(FileHandle f, const WriteSpan* spans, int numSpans);
 	long GetFileSize(FileHandle f);
 	void SeekFile(FileHandle f, SeekMode::Enum mode, long offset);
 	long GetFilePosition(FileHandle f);
 	void FlushFile(FileHandle f);
 
+	// Positional versions, offset is given explicitly, so they can be issued
+	// from multiple threads at once (same handle) without any locking.
+	// POSIX: pread/pwrite, file pointer is not used nor modified.
+	// Win32: handles are not opened with FILE_FLAG_OVERLAPPED, so calls on
+	// the same handle are serialized by the system and file pointer is left
+	// right after transferred data. Do not mix with Read/Write/SeekFile on
+	// the same handle.
+	// @return number of bytes transferred (less than requested only at the
+	// end of file), -1 on error.
+	long ReadAt(FileHandle f, long offset, void* data, long bytes);
+	long WriteAt(FileHandle f, long offset, const void* data, long bytes);
+
 	bool Exists(const char* path);
+
+#if RDE_PLATFORM_POSIX
+	// Underlying file descriptor (for native APIs, like io_uring).
+	int GetFileDescriptor(FileHandle f);
+#endif
 } // iosys
 }
 
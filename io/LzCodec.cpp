@@ -0,0 +1,184 @@
+#include "io/LzCodec.h"
+#include "core/RdeAssert.h"
+#include "core/System.h"
+
+namespace
+{
+const long	kMinMatch	= 4;
+const long	kMaxOffset	= 0xFFFF;
+const int	kHashLog	= 12;
+const int	kHashSize	= 1 << kHashLog;
+// The longer we go without finding a match, the bigger steps we take
+// (incompressible data is skipped quickly).
+const int	kSkipShift	= 6;
+
+RDE_FORCEINLINE rde::uint32 Read32(const rde::uint8* p)
+{
+	return rde::uint32(p[0]) | (rde::uint32(p[1]) << 8) |
+		(rde::uint32(p[2]) << 16) | (rde::uint32(p[3]) << 24);
+}
+RDE_FORCEINLINE int Hash(rde::uint32 seq)
+{
+	return int((seq * 2654435761U) >> (32 - kHashLog));
+}
+
+void WriteLength(rde::uint8*& op, long len)
+{
+	while (len >= 255)
+	{
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = rde::uint8(len);
+}
+bool ReadLength(const rde::uint8*& ip, const rde::uint8* iend, long& len)
+{
+	rde::uint8 b;
+	do
+	{
+		if (ip == iend)
+			return false;
+		b = *ip++;
+		len += b;
+	}
+	while (b == 255);
+	return true;
+}
+
+// offset == 0 -> last sequence (literals only).
+bool WriteSequence(rde::uint8*& op, const rde::uint8* oend, const rde::uint8* literals,
+				   long numLiterals, long offset, long matchLen)
+{
+	const long maxBytes = 1 + (numLiterals / 255 + 1) + numLiterals + 2 + (matchLen / 255 + 1);
+	if (maxBytes > oend - op)
+		return false;
+
+	const long matchCode = (offset != 0 ? matchLen - kMinMatch : 0);
+	rde::uint8 token = rde::uint8((numLiterals < 15 ? numLiterals : 15) << 4);
+	token |= rde::uint8(matchCode < 15 ? matchCode : 15);
+	*op++ = token;
+	if (numLiterals >= 15)
+		WriteLength(op, numLiterals - 15);
+	if (numLiterals > 0)
+	{
+		rde::Sys::MemCpy(op, literals, numLiterals);
+		op += numLiterals;
+	}
+	if (offset != 0)
+	{
+		*op++ = rde::uint8(offset & 0xFF);
+		*op++ = rde::uint8(offset >> 8);
+		if (matchCode >= 15)
+			WriteLength(op, matchCode - 15);
+	}
+	return true;
+}
+} // namespace
+
+namespace rde
+{
+namespace lz
+{
+long GetMaxCompressedSize(long srcBytes)
+{
+	return srcBytes + srcBytes / 255 + 16;
+}
+
+long Compress(const void* src, long srcBytes, void* dst, long dstCapacity)
+{
+	RDE_ASSERT(srcBytes >= 0);
+	const uint8* const base = static_cast<const uint8*>(src);
+	const uint8* const iend = base + srcBytes;
+	const uint8* ip = base;
+	const uint8* anchor = base;
+	uint8* op = static_cast<uint8*>(dst);
+	const uint8* const oend = op + dstCapacity;
+
+	long table[kHashSize];
+	for (int i = 0; i < kHashSize; ++i)
+		table[i] = -1;
+
+	while (iend - ip >= kMinMatch)
+	{
+		const uint32 seq = Read32(ip);
+		const int h = Hash(seq);
+		const long pos = long(ip - base);
+		const long ref = table[h];
+		table[h] = pos;
+		if (ref < 0 || pos - ref > kMaxOffset || Read32(base + ref) != seq)
+		{
+			ip += 1 + ((ip - anchor) >> kSkipShift);
+			continue;
+		}
+
+		const uint8* match = base + ref;
+		long matchLen = kMinMatch;
+		while (ip + matchLen < iend && ip[matchLen] == match[matchLen])
+			++matchLen;
+
+		if (!WriteSequence(op, oend, anchor, long(ip - anchor), long(ip - match), matchLen))
+			return 0;
+		ip += matchLen;
+		anchor = ip;
+	}
+	if (!WriteSequence(op, oend, anchor, long(iend - anchor), 0, 0))
+		return 0;
+	return long(op - static_cast<uint8*>(dst));
+}
+
+long Decompress(const void* src, long srcBytes, void* dst, long dstCapacity)
+{
+	const uint8* ip = static_cast<const uint8*>(src);
+	const uint8* const iend = ip + srcBytes;
+	uint8* const obase = static_cast<uint8*>(dst);
+	uint8* op = obase;
+	const uint8* const oend = op + dstCapacity;
+
+	while (true)
+	{
+		if (ip == iend)
+			return -1;
+		const uint8 token = *ip++;
+
+		long numLiterals = token >> 4;
+		if (numLiterals == 15 && !ReadLength(ip, iend, numLiterals))
+			return -1;
+		if (numLiterals > iend - ip || numLiterals > oend - op)
+			return -1;
+		Sys::MemCpy(op, ip, numLiterals);
+		ip += numLiterals;
+		op += numLiterals;
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return -1;
+		const long offset = long(ip[0]) | (long(ip[1]) << 8);
+		ip += 2;
+		if (offset == 0 || offset > op - obase)
+			return -1;
+		long matchLen = token & 15;
+		if (matchLen == 15 && !ReadLength(ip, iend, matchLen))
+			return -1;
+		matchLen += kMinMatch;
+		if (matchLen > oend - op)
+			return -1;
+
+		const uint8* match = op - offset;
+		if (offset >= matchLen)
+		{
+			Sys::MemCpy(op, match, matchLen);
+			op += matchLen;
+		}
+		else
+		{
+			// Overlapping match (repeated pattern), has to go byte by byte.
+			for (long i = 0; i < matchLen; ++i)
+				*op++ = *match++;
+		}
+	}
+	return long(op - obase);
+}
+
+} // lz
+} // rde
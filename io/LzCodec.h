@@ -0,0 +1,28 @@
+#ifndef IO_LZ_CODEC_H
+#define IO_LZ_CODEC_H
+
+#include "core/Config.h"
+
+namespace rde
+{
+// Simple, fast LZ77 codec (LZ4-style byte aligned sequences).
+// Compressed data is a series of sequences:
+//	token (4 bits literal length, 4 bits match length - kMinMatch),
+//	[extra literal length bytes], literals,
+//	16-bit match offset (LE), [extra match length bytes].
+// Last sequence consists of literals only.
+namespace lz
+{
+	// Worst case size of compressed data (incompressible input).
+	long GetMaxCompressedSize(long srcBytes);
+
+	// Returns size of compressed data or 0 if it didn't fit in dst.
+	long Compress(const void* src, long srcBytes, void* dst, long dstCapacity);
+
+	// Returns size of decompressed data or -1 if data is corrupted/didn't fit
+	// in dst. Never reads/writes outside of given buffers.
+	long Decompress(const void* src, long srcBytes, void* dst, long dstCapacity);
+} // lz
+} // rde
+
+#endif // IO_LZ_CODEC_H
@@ -0,0 +1,61 @@
+#include "io/MemoryStream.h"
+#include "core/RdeAssert.h"
+#include "core/System.h"
+
+namespace rde
+{
+namespace internal
+{
+long CalcSeekPosition(iosys::SeekMode::Enum mode, long offset, long position, long size)
+{
+	long newPosition(offset);
+	if (mode == iosys::SeekMode::CURRENT)
+		newPosition += position;
+	else if (mode == iosys::SeekMode::END)
+		newPosition += size;
+	RDE_ASSERT(newPosition >= 0 && newPosition <= size);
+	return newPosition < 0 ? 0 : (newPosition > size ? size : newPosition);
+}
+} // internal
+
+//-----------------------------------------------------------------------------
+SpanStream::SpanStream(const void* data, long bytes)
+:	m_data(static_cast<const uint8*>(data)),
+	m_size(bytes),
+	m_position(0)
+{
+	RDE_ASSERT(data != 0 || bytes == 0);
+	m_accessMode = iosys::AccessMode::READ;
+}
+
+long SpanStream::Read(void* data, long bytes)
+{
+	RDE_ASSERT(bytes >= 0);
+	const long bytesLeft = m_size - m_position;
+	const long bytesToRead = (bytes < bytesLeft ? bytes : bytesLeft);
+	if (bytesToRead > 0)
+	{
+		Sys::MemCpy(data, m_data + m_position, bytesToRead);
+		m_position += bytesToRead;
+	}
+	return bytesToRead;
+}
+void SpanStream::Write(const void*, long)
+{
+	RDE_ASSERT(!"SpanStream is read-only");
+}
+void SpanStream::Seek(iosys::SeekMode::Enum mode, long offset)
+{
+	m_position = internal::CalcSeekPosition(mode, offset, m_position, m_size);
+}
+const void* SpanStream::Consume(long bytes)
+{
+	RDE_ASSERT(bytes >= 0);
+	if (bytes > m_size - m_position)
+		return 0;
+	const void* data = m_data + m_position;
+	m_position += bytes;
+	return data;
+}
+
+} // rde
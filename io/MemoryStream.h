@@ -0,0 +1,172 @@
+#ifndef IO_MEMORY_STREAM_H
+#define IO_MEMORY_STREAM_H
+
+#include "io/Stream.h"
+#include "core/RdeAssert.h"
+#include "core/System.h"
+#include "rdestl/allocator.h"
+
+namespace rde
+{
+namespace internal
+{
+// Shared by all memory streams, returns new position clamped to [0, size].
+long CalcSeekPosition(iosys::SeekMode::Enum mode, long offset, long position, long size);
+} // internal
+
+// Growable in-memory stream, always READWRITE.
+// Memory comes from given allocator (ie. can be pooled). Buffer is accessible
+// directly via GetData/GetSize, so serialized data can be sent/consumed
+// without extra copies.
+template<class TAllocator = rde::allocator>
+class BasicMemoryStream : public Stream
+{
+public:
+	typedef TAllocator	allocator_type;
+
+	explicit BasicMemoryStream(long initialCapacity = 0,
+		const allocator_type& allocator = allocator_type())
+	:	m_data(0),
+		m_size(0),
+		m_capacity(0),
+		m_position(0),
+		m_allocator(allocator)
+	{
+		m_accessMode = iosys::AccessMode::READWRITE;
+		if (initialCapacity > 0)
+			Reserve(initialCapacity);
+	}
+	virtual ~BasicMemoryStream()
+	{
+		Reset();
+	}
+
+	virtual long Read(void* data, long bytes)
+	{
+		RDE_ASSERT(bytes >= 0);
+		const long bytesLeft = m_size - m_position;
+		const long bytesToRead = (bytes < bytesLeft ? bytes : bytesLeft);
+		if (bytesToRead > 0)
+		{
+			Sys::MemCpy(data, m_data + m_position, bytesToRead);
+			m_position += bytesToRead;
+		}
+		return bytesToRead;
+	}
+	virtual void Write(const void* data, long bytes)
+	{
+		RDE_ASSERT(bytes >= 0);
+		const long newPosition = m_position + bytes;
+		if (newPosition > m_capacity)
+		{
+			// Grow geometrically, so series of small writes is amortized O(1).
+			const long newCapacity = m_capacity * 2;
+			Reserve(newCapacity > newPosition ? newCapacity : newPosition);
+		}
+		Sys::MemCpy(m_data + m_position, data, bytes);
+		m_position = newPosition;
+		if (m_position > m_size)
+			m_size = m_position;
+	}
+	// Reserves memory for all spans up front.
+	virtual void WriteV(const iosys::WriteSpan* spans, int numSpans)
+	{
+		long totalBytes(0);
+		for (int i = 0; i < numSpans; ++i)
+			totalBytes += spans[i].m_bytes;
+		Reserve(m_position + totalBytes);
+		for (int i = 0; i < numSpans; ++i)
+			BasicMemoryStream::Write(spans[i].m_data, spans[i].m_bytes);
+	}
+	virtual void Seek(iosys::SeekMode::Enum mode, long offset)
+	{
+		m_position = internal::CalcSeekPosition(mode, offset, m_position, m_size);
+	}
+
+	virtual bool IsOpen() const		{ return true; }
+	virtual long GetSize() const	{ return m_size; }
+	virtual long GetPosition() const	{ return m_position; }
+
+	// Valid until next Write/Reserve/Clear call.
+	uint8* GetData()				{ return m_data; }
+	const uint8* GetData() const	{ return m_data; }
+	long GetCapacity() const		{ return m_capacity; }
+	const allocator_type& GetAllocator() const	{ return m_allocator; }
+
+	// Makes sure buffer can hold at least 'capacity' bytes without reallocating.
+	void Reserve(long capacity)
+	{
+		if (capacity <= m_capacity)
+			return;
+		if (capacity < kMinCapacity)
+			capacity = kMinCapacity;
+
+		uint8* newData = static_cast<uint8*>(m_allocator.allocate(capacity));
+		if (m_size > 0)
+			Sys::MemCpy(newData, m_data, m_size);
+		if (m_data != 0)
+			m_allocator.deallocate(m_data, m_capacity);
+		m_data = newData;
+		m_capacity = capacity;
+	}
+	// Empties stream, keeps memory.
+	void Clear()
+	{
+		m_size = 0;
+		m_position = 0;
+	}
+	// Frees memory.
+	void Reset()
+	{
+		if (m_data != 0)
+			m_allocator.deallocate(m_data, m_capacity);
+		m_data = 0;
+		m_capacity = 0;
+		Clear();
+	}
+
+private:
+	RDE_FORBID_COPY(BasicMemoryStream);
+
+	enum { kMinCapacity = 256 };
+
+	uint8*			m_data;
+	long			m_size;
+	long			m_capacity;
+	long			m_position;
+	allocator_type	m_allocator;
+};
+typedef BasicMemoryStream<>	MemoryStream;
+
+// Read-only stream over existing memory. Doesn't own (nor copy) data,
+// memory has to stay valid for the whole lifetime of the stream.
+class SpanStream : public Stream
+{
+public:
+	SpanStream(const void* data, long bytes);
+
+	virtual long Read(void* data, long bytes);
+	// @pre Never called.
+	virtual void Write(const void* data, long bytes);
+	virtual void Seek(iosys::SeekMode::Enum mode, long offset);
+
+	virtual bool IsOpen() const		{ return m_data != 0; }
+	virtual long GetSize() const	{ return m_size; }
+	virtual long GetPosition() const	{ return m_position; }
+
+	const uint8* GetData() const	{ return m_data; }
+	// Zero-copy alternative to Read. Returns pointer to data at current position
+	// and moves position by 'bytes'. NULL if there's less than 'bytes' bytes left.
+	const void* Consume(long bytes);
+
+private:
+	RDE_FORBID_COPY(SpanStream);
+
+	const uint8*	m_data;
+	long			m_size;
+	long			m_position;
+};
+
+} // rde
+
+#endif // IO_MEMORY_STREAM_H
@@ -16,6 +16,16 @@ public:
 	// Returns number of bytes really read.
 	virtual long Read(void* data, long bytes) = 0;
 	virtual void Write(const void* data, long bytes) = 0;
+	// Vectored write, equivalent to Write call for each span.
+	// Streams that can do better (fewer system calls/reallocations) override it.
+	virtual void WriteV(const iosys::WriteSpan* spans, int numSpans)
+	{
+		for (int i = 0; i < numSpans; ++i)
+		{
+			if (spans[i].m_bytes > 0)
+				Write(spans[i].m_data, spans[i].m_bytes);
+		}
+	}
 	virtual void Flush() {}
 	virtual void Seek(iosys::SeekMode::Enum mode, long offset) = 0;
 	virtual void Close() {}
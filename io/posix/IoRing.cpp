@@ -0,0 +1,213 @@
+#include "io/posix/IoRing.h"
+
+// io_uring is Linux only, AsyncIo uses worker threads elsewhere.
+#if defined(__linux__)
+
+#include "core/Atomic.h"
+#include "core/RdeAssert.h"
+#include "core/System.h"
+#include <cerrno>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+int SysSetup(rde::uint32 numEntries, io_uring_params* params)
+{
+	return int(::syscall(__NR_io_uring_setup, numEntries, params));
+}
+int SysEnter(int ringFd, rde::uint32 toSubmit, rde::uint32 minComplete, rde::uint32 flags)
+{
+	return int(::syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, 0, 0));
+}
+
+void* MapRing(int ringFd, size_t bytes, off_t offset)
+{
+	void* p = ::mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, offset);
+	return p == MAP_FAILED ? 0 : p;
+}
+template<typename T>
+T* RingPtr(void* ring, rde::uint32 offset)
+{
+	return reinterpret_cast<T*>(static_cast<rde::uint8*>(ring) + offset);
+}
+}
+
+namespace rde
+{
+IoRing::IoRing()
+:	m_ringFd(-1),
+	m_sqEntries(0),
+	m_sqRing(0),
+	m_sqRingSize(0),
+	m_cqRing(0),
+	m_cqRingSize(0),
+	m_sqes(0),
+	m_sqesSize(0),
+	m_sqHead(0),
+	m_sqTail(0),
+	m_sqMask(0),
+	m_sqArray(0),
+	m_cqHead(0),
+	m_cqTail(0),
+	m_cqMask(0),
+	m_cqes(0),
+	m_sqLocalTail(0)
+{
+}
+IoRing::~IoRing()
+{
+	Close();
+}
+
+bool IoRing::Init(uint32 numEntries)
+{
+	RDE_ASSERT(!IsInitialized());
+	io_uring_params params;
+	Sys::MemSet(&params, 0, sizeof(params));
+	const int ringFd = SysSetup(numEntries, &params);
+	if (ringFd < 0)
+		return false;
+	m_ringFd = ringFd;
+	// IORING_OP_READ/WRITE are 5.6+, fast poll was added right after (5.7),
+	// there's no cheaper way to tell.
+	if ((params.features & IORING_FEAT_FAST_POLL) == 0)
+	{
+		Close();
+		return false;
+	}
+
+	m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32);
+	m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (m_cqRingSize > m_sqRingSize)
+			m_sqRingSize = m_cqRingSize;
+		m_sqRing = MapRing(ringFd, m_sqRingSize, IORING_OFF_SQ_RING);
+		m_cqRing = m_sqRing;
+		m_cqRingSize = 0;
+	}
+	else
+	{
+		m_sqRing = MapRing(ringFd, m_sqRingSize, IORING_OFF_SQ_RING);
+		m_cqRing = MapRing(ringFd, m_cqRingSize, IORING_OFF_CQ_RING);
+	}
+	m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	m_sqes = MapRing(ringFd, m_sqesSize, IORING_OFF_SQES);
+	if (m_sqRing == 0 || m_cqRing == 0 || m_sqes == 0)
+	{
+		Close();
+		return false;
+	}
+
+	m_sqEntries = params.sq_entries;
+	m_sqHead = RingPtr<uint32>(m_sqRing, params.sq_off.head);
+	m_sqTail = RingPtr<uint32>(m_sqRing, params.sq_off.tail);
+	m_sqMask = *RingPtr<uint32>(m_sqRing, params.sq_off.ring_mask);
+	m_sqArray = RingPtr<uint32>(m_sqRing, params.sq_off.array);
+	m_cqHead = RingPtr<uint32>(m_cqRing, params.cq_off.head);
+	m_cqTail = RingPtr<uint32>(m_cqRing, params.cq_off.tail);
+	m_cqMask = *RingPtr<uint32>(m_cqRing, params.cq_off.ring_mask);
+	m_cqes = RingPtr<io_uring_cqe>(m_cqRing, params.cq_off.cqes);
+	m_sqLocalTail = *m_sqTail;
+	// SQE i always goes to slot i, so the indirection array is set up once.
+	for (uint32 i = 0; i < m_sqEntries; ++i)
+		m_sqArray[i] = i;
+	return true;
+}
+
+uint32 IoRing::GetNumFreeEntries() const
+{
+	return m_sqEntries - (m_sqLocalTail - Load_Acquire(*m_sqHead));
+}
+
+void IoRing::PrepareRead(int fd, uint64 offset, void* data, uint32 bytes, uint64 userData)
+{
+	Prepare(IORING_OP_READ, fd, offset, data, bytes, userData);
+}
+void IoRing::PrepareWrite(int fd, uint64 offset, const void* data, uint32 bytes, uint64 userData)
+{
+	Prepare(IORING_OP_WRITE, fd, offset, data, bytes, userData);
+}
+void IoRing::PrepareNop(uint64 userData)
+{
+	Prepare(IORING_OP_NOP, -1, 0, 0, 0, userData);
+}
+void IoRing::Prepare(uint8 opcode, int fd, uint64 offset, const void* data, uint32 bytes, uint64 userData)
+{
+	RDE_ASSERT(IsInitialized());
+	RDE_ASSERT(GetNumFreeEntries() > 0);
+	io_uring_sqe* sqe = static_cast<io_uring_sqe*>(m_sqes) + (m_sqLocalTail & m_sqMask);
+	Sys::MemSet(sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->off = offset;
+	sqe->addr = uint64(reinterpret_cast<size_t>(data));
+	sqe->len = bytes;
+	sqe->user_data = userData;
+	++m_sqLocalTail;
+}
+bool IoRing::Submit()
+{
+	RDE_ASSERT(IsInitialized());
+	// Entries have to be written before kernel sees new tail.
+	Store_Release(*m_sqTail, m_sqLocalTail);
+	uint32 toSubmit = m_sqLocalTail - Load_Acquire(*m_sqHead);
+	while (toSubmit != 0)
+	{
+		const int res = SysEnter(m_ringFd, toSubmit, 0, 0);
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res <= 0)
+			return false;
+		toSubmit = m_sqLocalTail - Load_Acquire(*m_sqHead);
+	}
+	return true;
+}
+
+int IoRing::WaitCompletions(Completion* completions, int maxCompletions)
+{
+	RDE_ASSERT(IsInitialized());
+	RDE_ASSERT(maxCompletions > 0);
+	uint32 head = *m_cqHead;
+	uint32 tail = Load_Acquire(*m_cqTail);
+	while (head == tail)
+	{
+		const int res = SysEnter(m_ringFd, 0, 1, IORING_ENTER_GETEVENTS);
+		RDE_ASSERT(res >= 0 || errno == EINTR);
+		(void)res;
+		tail = Load_Acquire(*m_cqTail);
+	}
+	int numCompletions(0);
+	const io_uring_cqe* cqes = static_cast<const io_uring_cqe*>(m_cqes);
+	for (; head != tail && numCompletions < maxCompletions; ++head, ++numCompletions)
+	{
+		const io_uring_cqe& cqe = cqes[head & m_cqMask];
+		completions[numCompletions].userData = cqe.user_data;
+		completions[numCompletions].result = cqe.res;
+	}
+	// Entries have been read, kernel can reuse them.
+	Store_Release(*m_cqHead, head);
+	return numCompletions;
+}
+
+void IoRing::Close()
+{
+	if (m_sqes != 0)
+		::munmap(m_sqes, m_sqesSize);
+	if (m_cqRing != 0 && m_cqRing != m_sqRing)
+		::munmap(m_cqRing, m_cqRingSize);
+	if (m_sqRing != 0)
+		::munmap(m_sqRing, m_sqRingSize);
+	if (m_ringFd >= 0)
+		::close(m_ringFd);
+	m_ringFd = -1;
+	m_sqRing = m_cqRing = m_sqes = 0;
+	m_sqEntries = 0;
+}
+
+} // rde
+
+#endif // __linux__
@@ -0,0 +1,76 @@
+#ifndef IO_IORING_H
+#define IO_IORING_H
+
+#include "core/Config.h"
+
+namespace rde
+{
+// Minimal io_uring wrapper (raw syscalls, no liburing), Linux only.
+// Submission side (Prepare*/Submit) and completion side (WaitCompletions)
+// can be used from different threads, but every side needs to be
+// externally synchronized (single submitter at a time, single reaper).
+class IoRing
+{
+public:
+	struct Completion
+	{
+		uint64	userData;
+		// Bytes transferred or -errno.
+		int		result;
+	};
+
+	IoRing();
+	~IoRing();
+
+	// @return false if io_uring is not available (old kernel, seccomp),
+	// or doesn't support non-vectored reads/writes.
+	bool Init(uint32 numEntries);
+	bool IsInitialized() const	{ return m_ringFd >= 0; }
+
+	// Max number of requests in flight (completion queue never overflows
+	// as long as it's respected).
+	uint32 GetCapacity() const	{ return m_sqEntries; }
+	uint32 GetNumFreeEntries() const;
+
+	// Entries are queued only, kernel sees them after Submit.
+	// @pre	GetNumFreeEntries() > 0
+	void PrepareRead(int fd, uint64 offset, void* data, uint32 bytes, uint64 userData);
+	void PrepareWrite(int fd, uint64 offset, const void* data, uint32 bytes, uint64 userData);
+	void PrepareNop(uint64 userData);
+	// @return false on failure (entries remain queued).
+	bool Submit();
+
+	// Blocks until at least one completion is available.
+	// @return number of completions stored (<= maxCompletions).
+	int WaitCompletions(Completion* completions, int maxCompletions);
+
+private:
+	RDE_FORBID_COPY(IoRing);
+
+	void Prepare(uint8 opcode, int fd, uint64 offset, const void* data, uint32 bytes, uint64 userData);
+	void Close();
+
+	int				m_ringFd;
+	uint32			m_sqEntries;
+	// Mapped rings (see struct io_sqring_offsets/io_cqring_offsets).
+	void*			m_sqRing;
+	size_t			m_sqRingSize;
+	void*			m_cqRing;
+	size_t			m_cqRingSize;
+	void*			m_sqes;
+	size_t			m_sqesSize;
+	uint32*			m_sqHead;
+	uint32*			m_sqTail;
+	uint32			m_sqMask;
+	uint32*			m_sqArray;
+	uint32*			m_cqHead;
+	uint32*			m_cqTail;
+	uint32			m_cqMask;
+	void*			m_cqes;
+	// Local SQ tail (entries prepared, but not submitted yet).
+	uint32			m_sqLocalTail;
+};
+
+} // rde
+
+#endif // IO_IORING_H
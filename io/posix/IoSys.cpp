@@ -0,0 +1,211 @@
+#include "io/IoSys.h"
+
+#if !RDE_IO_STANDALONE
+#	include "core/RdeAssert.h"
+#	include "core/System.h"
+#endif
+#include <cerrno>
+#include <climits>		// IOV_MAX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#	define IOV_MAX	16
+#endif
+
+namespace
+{
+// INVALID_FILE_HANDLE is 0, which is valid descriptor (stdin), so we store fd + 1.
+inline int ToDescriptor(rde::iosys::FileHandle f)
+{
+	return int(reinterpret_cast<size_t>(f)) - 1;
+}
+inline rde::iosys::FileHandle ToHandle(int fd)
+{
+	return reinterpret_cast<rde::iosys::FileHandle>(size_t(fd + 1));
+}
+}
+
+namespace rde
+{
+iosys::FileHandle iosys::OpenFile(const char* path, unsigned long accessModeFlags)
+{
+	// Same semantics as Win32 version: READ - OPEN_EXISTING, WRITE - CREATE_ALWAYS,
+	// READWRITE - OPEN_ALWAYS.
+	int flags(0);
+	if ((accessModeFlags & AccessMode::READWRITE) == AccessMode::READWRITE)
+		flags = O_RDWR | O_CREAT;
+	else if (accessModeFlags & AccessMode::WRITE)
+		flags = O_WRONLY | O_CREAT | O_TRUNC;
+	else
+		flags = O_RDONLY;
+	int fd;
+	while ((fd = ::open(path, flags | O_CLOEXEC, 0644)) < 0 && errno == EINTR)
+	{
+		/**/
+	}
+	return fd < 0 ? INVALID_FILE_HANDLE : ToHandle(fd);
+}
+void iosys::CloseFile(FileHandle f)
+{
+	RDE_ASSERT(f != INVALID_FILE_HANDLE);
+	::close(ToDescriptor(f));
+}
+long iosys::Read(FileHandle f, void* data, long bytes)
+{
+	RDE_ASSERT(f != INVALID_FILE_HANDLE);
+	RDE_ASSERT(data != 0);
+	RDE_ASSERT(bytes > 0);
+	// ReadFile returns less only at the end of file, read() may stop earlier.
+	long bytesRead(0);
+	while (bytesRead < bytes)
+	{
+		const ssize_t res = ::read(ToDescriptor(f), static_cast<char*>(data) + bytesRead, bytes - bytesRead);
+		if (res < 0 && errno == EINTR)
+			continue;
+		RDE_ASSERT(res >= 0);
+		if (res <= 0)
+			break;
+		bytesRead += long(res);
+	}
+	return bytesRead;
+}
+void iosys::Write(FileHandle f, const void* data, long bytes)
+{
+	RDE_ASSERT(f != INVALID_FILE_HANDLE);
+	RDE_ASSERT(data != 0);
+	RDE_ASSERT(bytes > 0);
+	long bytesWritten(0);
+	while (bytesWritten < bytes)
+	{
+		const ssize_t res = ::write(ToDescriptor(f), static_cast<const char*>(data) + bytesWritten,
+			bytes - bytesWritten);
+		if (res < 0 && errno == EINTR)
+			continue;
+		RDE_ASSERT(res > 0);
+		if (res <= 0)
+			break;
+		bytesWritten += long(res);
+	}
+}
+void iosys::WriteV(FileHandle f, const WriteSpan* spans, int numSpans)
+{
+	// Native gather write, no need to coalesce spans in local buffer.
+	struct iovec iov[IOV_MAX < 64 ? IOV_MAX : 64];
+	const int maxSpans = int(sizeof(iov) / sizeof(iov[0]));
+	int i(0);
+	while (i < numSpans)
+	{
+		int numIov(0);
+		size_t bytes(0);
+		for (; i < numSpans && numIov < maxSpans; ++i)
+		{
+			if (spans[i].m_bytes <= 0)
+				continue;
+			iov[numIov].iov_base = const_cast<void*>(spans[i].m_data);
+			iov[numIov].iov_len = size_t(spans[i].m_bytes);
+			bytes += iov[numIov].iov_len;
+			++numIov;
+		}
+		// Partial write - skip buffers already written and try again.
+		int first(0);
+		while (bytes > 0)
+		{
+			const ssize_t res = ::writev(ToDescriptor(f), iov + first, numIov - first);
+			if (res < 0 && errno == EINTR)
+				continue;
+			RDE_ASSERT(res > 0);
+			if (res <= 0)
+				return;
+			bytes -= size_t(res);
+			size_t written = size_t(res);
+			while (first < numIov && written >= iov[first].iov_len)
+				written -= iov[first++].iov_len;
+			if (written > 0)
+			{
+				iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + written;
+				iov[first].iov_len -= written;
+			}
+		}
+	}
+}
+long iosys::GetFileSize(FileHandle f)
+{
+	RDE_ASSERT(f != INVALID_FILE_HANDLE);
+	struct stat st;
+	if (::fstat(ToDescriptor(f), &st) != 0)
+		return -1;
+	return long(st.st_size);
+}
+void iosys::SeekFile(FileHandle f, SeekMode::Enum mode, long offset)
+{
+	RDE_ASSERT(f != INVALID_FILE_HANDLE);
+	RDE_ASSERT(mode <= SeekMode::END);
+	const int posixSeekModes[] =
+	{
+		SEEK_SET, SEEK_CUR, SEEK_END
+	};
+	::lseek(ToDescriptor(f), offset, posixSeekModes[mode]);
+}
+long iosys::GetFilePosition(FileHandle f)
+{
+	RDE_ASSERT(f != INVALID_FILE_HANDLE);
+	return long(::lseek(ToDescriptor(f), 0, SEEK_CUR));
+}
+long iosys::ReadAt(FileHandle f, long offset, void* data, long bytes)
+{
+	RDE_ASSERT(f != INVALID_FILE_HANDLE);
+	RDE_ASSERT(data != 0);
+	RDE_ASSERT(offset >= 0 && bytes > 0);
+	long bytesRead(0);
+	while (bytesRead < bytes)
+	{
+		const ssize_t res = ::pread(ToDescriptor(f), static_cast<char*>(data) + bytesRead,
+			bytes - bytesRead, offset + bytesRead);
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res < 0)
+			return -1;
+		if (res == 0)
+			break;
+		bytesRead += long(res);
+	}
+	return bytesRead;
+}
+long iosys::WriteAt(FileHandle f, long offset, const void* data, long bytes)
+{
+	RDE_ASSERT(f != INVALID_FILE_HANDLE);
+	RDE_ASSERT(data != 0);
+	RDE_ASSERT(offset >= 0 && bytes > 0);
+	long bytesWritten(0);
+	while (bytesWritten < bytes)
+	{
+		const ssize_t res = ::pwrite(ToDescriptor(f), static_cast<const char*>(data) + bytesWritten,
+			bytes - bytesWritten, offset + bytesWritten);
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res <= 0)
+			return -1;
+		bytesWritten += long(res);
+	}
+	return bytesWritten;
+}
+void iosys::FlushFile(FileHandle f)
+{
+	RDE_ASSERT(f != INVALID_FILE_HANDLE);
+	::fsync(ToDescriptor(f));
+}
+int iosys::GetFileDescriptor(FileHandle f)
+{
+	return ToDescriptor(f);
+}
+
+bool iosys::Exists(const char* path)
+{
+	struct stat st;
+	return ::stat(path, &st) == 0;
+}
+
+} // rde
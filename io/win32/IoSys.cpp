@@ -3,6 +3,7 @@
 #if !RDE_IO_STANDALONE
 //#	include "core/Console.h"
 #	include "core/RdeAssert.h"
+#	include "core/System.h"
 //#	include "core/win32/Windows.h"
 #endif
 #	define WIN32_LEAN_AND_MEAN	1
@@ -69,6 +70,35 @@ void iosys::Write(FileHandle f, const void* data, long bytes)
 	//	Console::Errorf("Error while writing %d bytes to file %p", bytes, f);
 #endif
 }
+void iosys::WriteV(FileHandle f, const WriteSpan* spans, int numSpans)
+{
+	// WriteFileGather requires unbuffered I/O and page sized buffers, so we
+	// gather small spans in local buffer instead. Big ones are written directly.
+	const long kBufferSize = 32 * 1024;
+	char buffer[kBufferSize];
+	long bufferedBytes(0);
+	for (int i = 0; i < numSpans; ++i)
+	{
+		const long bytes = spans[i].m_bytes;
+		if (bytes <= 0)
+			continue;
+		if (bufferedBytes + bytes > kBufferSize)
+		{
+			if (bufferedBytes > 0)
+				Write(f, buffer, bufferedBytes);
+			bufferedBytes = 0;
+			if (bytes >= kBufferSize)
+			{
+				Write(f, spans[i].m_data, bytes);
+				continue;
+			}
+		}
+		Sys::MemCpy(buffer + bufferedBytes, spans[i].m_data, bytes);
+		bufferedBytes += bytes;
+	}
+	if (bufferedBytes > 0)
+		Write(f, buffer, bufferedBytes);
+}
 long iosys::GetFileSize(FileHandle f)
 {
 	RDE_ASSERT(f != INVALID_FILE_HANDLE);
@@ -89,6 +119,28 @@ long iosys::GetFilePosition(FileHandle f)
 	RDE_ASSERT(f != INVALID_FILE_HANDLE);
 	return ::SetFilePointer(f, 0, NULL, FILE_CURRENT);
 }
+long iosys::ReadAt(FileHandle f, long offset, void* data, long bytes)
+{
+	RDE_ASSERT(f != INVALID_FILE_HANDLE);
+	RDE_ASSERT(data != 0);
+	RDE_ASSERT(offset >= 0 && bytes > 0);
+	OVERLAPPED overlapped = { 0 };
+	overlapped.Offset = offset;
+	DWORD bytesRead(0);
+	const BOOL success = ::ReadFile(f, data, bytes, &bytesRead, &overlapped);
+	return success ? (long)bytesRead : -1;
+}
+long iosys::WriteAt(FileHandle f, long offset, const void* data, long bytes)
+{
+	RDE_ASSERT(f != INVALID_FILE_HANDLE);
+	RDE_ASSERT(data != 0);
+	RDE_ASSERT(offset >= 0 && bytes > 0);
+	OVERLAPPED overlapped = { 0 };
+	overlapped.Offset = offset;
+	DWORD bytesWritten(0);
+	const BOOL success = ::WriteFile(f, data, bytes, &bytesWritten, &overlapped);
+	return success ? (long)bytesWritten : -1;
+}
 void iosys::FlushFile(FileHandle f)
 {
 	RDE_ASSERT(f != INVALID_FILE_HANDLE);
@@ -17,7 +17,7 @@ namespace internal
 		char	x;
 		T		y;
 	};
-	__declspec(align(16)) struct aligned16 { uint64 member[2]; };
+	struct RDE_ALIGN(16) aligned16 { uint64 member[2]; };
 #pragma warning(pop)
 	template<size_t N> struct type_with_alignment
 	{
@@ -106,7 +106,7 @@ public:
 	}
 	basic_string& operator+=(const basic_string& rhs)
 	{
-		append(str);
+		append(rhs);
 		return *this;
 	}
 
@@ -153,7 +153,7 @@ public:
 	}
 	bool empty() const	{ return length() == 0; }
 
-	const allocator_type& get_allocator() const	{ return TStorage::get_allocator; }
+	const allocator_type& get_allocator() const	{ return TStorage::get_allocator(); }
 
 	value_type* reserve(size_type capacity_hint)
 	{
@@ -194,20 +194,7 @@ public:
 
 	size_type find_index_of(value_type ch) const
 	{
-		size_type retIndex(-1);
-		const E* ptr = c_str();
-		size_type currentIndex(0);
-		while (*ptr != value_type(0))
-		{
-			if (*ptr == ch)
-			{
-				retIndex = currentIndex;
-				break;
-			}
-			++ptr;
-			++currentIndex;
-		}
-		return retIndex;
+		return (size_type)rde::find_index_of(c_str(), ch);
 	}
 	size_type find_index_of_last(value_type ch) const
 	{
@@ -0,0 +1,29 @@
+#ifndef RDESTL_BIT_UTILS_H
+#define RDESTL_BIT_UTILS_H
+
+#include "rdestl/rdestl.h"
+
+#ifdef _MSC_VER
+#	include <intrin.h>
+#endif
+
+namespace rde
+{
+namespace internal
+{
+	RDE_FORCEINLINE int lowest_bit_index(uint32 mask)
+	{
+		RDE_ASSERT(mask != 0);
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return int(index);
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+} // internal
+} // rde
+
+//-----------------------------------------------------------------------------
+#endif // #ifndef RDESTL_BIT_UTILS_H
@@ -0,0 +1,198 @@
+#ifndef RDESTL_EYTZINGER_MAP_H
+#define RDESTL_EYTZINGER_MAP_H
+
+#include "rdestl/bit_utils.h"
+#include "rdestl/sorted_vector.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#	include <xmmintrin.h>
+#	define RDESTL_PREFETCH(ptr)	_mm_prefetch(reinterpret_cast<const char*>(ptr), _MM_HINT_T0)
+#else
+#	define RDESTL_PREFETCH(ptr)	((void)0)
+#endif
+
+namespace rde
+{
+//=============================================================================
+// Read-only map for lookup tables that are built once and then only searched
+// (enum constants, field name indices etc).
+// Keys are kept separately from values, in Eytzinger (BFS) order: children of
+// node k are 2k and 2k+1 (root is 1). First levels of the tree share few
+// cache lines and are always hot, search loop has no unpredictable branches
+// and prefetches nodes few levels ahead.
+// Order of elements in storage is NOT sorted (key_at/value_at are for
+// enumerating all elements).
+template<typename TKey, typename TValue, class TCompare = rde::less<TKey>,
+	class TAllocator = rde::allocator>
+class eytzinger_map
+{
+public:
+	typedef TKey					key_type;
+	typedef TValue					mapped_type;
+	typedef pair<TKey, TValue>		value_type;
+	typedef int						size_type;
+	typedef TAllocator				allocator_type;
+
+	explicit eytzinger_map(const allocator_type& allocator = allocator_type())
+	:	m_keys(allocator),
+		m_values(allocator)
+	{
+		/**/
+	}
+	template<class TInputIterator>
+	eytzinger_map(TInputIterator first, TInputIterator last,
+		const allocator_type& allocator = allocator_type())
+	:	m_keys(allocator),
+		m_values(allocator)
+	{
+		build(first, last);
+	}
+
+	// Replaces contents with [first, last) range of value_type (any order).
+	// Keys have to be unique. O(n log n).
+	template<class TInputIterator>
+	void build(TInputIterator first, TInputIterator last)
+	{
+		// Temporary, always goes to the heap. Map's allocator can be an arena
+		// that never gives memory back.
+		vector<value_type> sorted;
+		int count(0);
+		rde::distance(first, last, count);
+		sorted.reserve(count);
+		for (/**/; first != last; ++first)
+			sorted.push_back(*first);
+		rde::quick_sort(sorted.begin(), sorted.end(), internal::compare_func<value_type, TCompare>());
+
+		const size_type n = sorted.size();
+		// Index 0 is not used (makes index math simpler).
+		m_keys.resize(n + 1);
+		m_values.resize(n);
+		size_type sortedIndex(0);
+		if (n != 0)
+			fill(sorted.begin(), 1, sortedIndex);
+		RDE_ASSERT(sortedIndex == n);
+		RDE_ASSERT(invariant());
+	}
+	void clear()
+	{
+		m_keys.clear();
+		m_values.clear();
+	}
+
+	size_type size() const	{ return m_values.size(); }
+	bool empty() const		{ return m_values.empty(); }
+
+	// @return 0 if not found.
+	mapped_type* find(const key_type& k)
+	{
+		const size_type index = find_index(k);
+		return index < 0 ? 0 : &m_values[index];
+	}
+	const mapped_type* find(const key_type& k) const
+	{
+		const size_type index = find_index(k);
+		return index < 0 ? 0 : &m_values[index];
+	}
+	// @return index of element with key == k (for key_at/value_at), -1 if not found.
+	size_type find_index(const key_type& k) const
+	{
+		const size_type node = lower_bound_node(k);
+		if (node == 0 || m_compare(k, m_keys[node]))
+			return -1;
+		return node - 1;
+	}
+	// @return index of first element with key >= k, -1 if there's none.
+	size_type lower_bound_index(const key_type& k) const
+	{
+		return lower_bound_node(k) - 1;
+	}
+
+	// Storage order, 0 <= index < size().
+	const key_type& key_at(size_type index) const
+	{
+		RDE_ASSERT(index >= 0 && index < size());
+		return m_keys[index + 1];
+	}
+	const mapped_type& value_at(size_type index) const
+	{
+		RDE_ASSERT(index >= 0 && index < size());
+		return m_values[index];
+	}
+	mapped_type& value_at(size_type index)
+	{
+		RDE_ASSERT(index >= 0 && index < size());
+		return m_values[index];
+	}
+
+	const allocator_type& get_allocator() const	{ return m_keys.get_allocator(); }
+	// Only allowed before building (memory has to be freed by allocator that gave it).
+	void set_allocator(const allocator_type& allocator)
+	{
+		RDE_ASSERT(m_keys.capacity() == 0 && m_values.capacity() == 0);
+		m_keys.set_allocator(allocator);
+		m_values.set_allocator(allocator);
+	}
+
+private:
+	// @note: block copying for the time being.
+	eytzinger_map(const eytzinger_map&);
+	eytzinger_map& operator=(const eytzinger_map&);
+
+	// In-order traversal of implicit tree visits nodes in sorted order.
+	void fill(const value_type* sorted, size_type node, size_type& sortedIndex)
+	{
+		const size_type n = size();
+		if (2 * node <= n)
+			fill(sorted, 2 * node, sortedIndex);
+		m_keys[node] = sorted[sortedIndex].first;
+		m_values[node - 1] = sorted[sortedIndex].second;
+		++sortedIndex;
+		if (2 * node + 1 <= n)
+			fill(sorted, 2 * node + 1, sortedIndex);
+	}
+
+	// @return node with first key >= k, 0 if all keys are < k.
+	RDE_FORCEINLINE size_type lower_bound_node(const key_type& k) const
+	{
+		const size_type n = size();
+		const key_type* keys = m_keys.begin();
+		uint32 node(1);
+		while (node <= uint32(n))
+		{
+			// Descendants 4 levels down (16 nodes) are adjacent, fetch them now
+			// (reading past the end is fine for prefetch).
+			RDESTL_PREFETCH(reinterpret_cast<const char*>(keys) + size_t(node) * 16 * sizeof(key_type));
+			node = 2 * node + (m_compare(keys[node], k) ? 1 : 0);
+		}
+		// Path went right (key < k) after last left turn. Undo right turns
+		// and the left one, what's left is the last node with key >= k.
+		node >>= internal::lowest_bit_index(~node) + 1;
+		return size_type(node);
+	}
+
+	bool invariant() const
+	{
+		const size_type n = size();
+		RDE_ASSERT(n < (1 << 30));
+		RDE_ASSERT(m_keys.size() == n + 1);
+		// Left child < parent < right child (so keys are unique, too).
+		for (size_type node = 2; node <= n; ++node)
+		{
+			const key_type& parentKey = m_keys[node >> 1];
+			if (node & 1)
+				RDE_ASSERT(m_compare(parentKey, m_keys[node]));
+			else
+				RDE_ASSERT(m_compare(m_keys[node], parentKey));
+		}
+		return true;
+	}
+
+	vector<key_type, TAllocator>	m_keys;
+	vector<mapped_type, TAllocator>	m_values;
+	TCompare						m_compare;
+};
+
+} // rde
+
+//-----------------------------------------------------------------------------
+#endif // #ifndef RDESTL_EYTZINGER_MAP_H
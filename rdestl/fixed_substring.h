@@ -82,20 +82,7 @@ public:
 
 	size_type find_index_of(value_type ch) const
 	{
-		size_type retIndex(-1);
-		const E* ptr = data();
-		size_type currentIndex(0);
-		while (*ptr != value_type(0))
-		{
-			if (*ptr == ch)
-			{
-				retIndex = currentIndex;
-				break;
-			}
-			++ptr;
-			++currentIndex;
-		}
-		return retIndex;
+		return (size_type)rde::find_index_of(data(), ch);
 	}
 	size_type find_index_of_last(value_type ch) const
 	{
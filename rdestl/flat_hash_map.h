@@ -0,0 +1,502 @@
+#ifndef RDESTL_FLAT_HASH_MAP_H
+#define RDESTL_FLAT_HASH_MAP_H
+
+#include "rdestl/bit_utils.h"
+#include "rdestl/hash_map.h"
+
+#ifndef RDESTL_FLAT_HASH_MAP_SSE2
+#	if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#		define RDESTL_FLAT_HASH_MAP_SSE2	1
+#	else
+#		define RDESTL_FLAT_HASH_MAP_SSE2	0
+#	endif
+#endif
+
+#if RDESTL_FLAT_HASH_MAP_SSE2
+#	include <emmintrin.h>
+#endif
+
+namespace rde
+{
+namespace internal
+{
+	// Control byte per slot. Full slots store 7 lowest bits of hash (so
+	// high bit clear), special values have high bit set.
+	typedef signed char	ctrl_t;
+	static const ctrl_t	kCtrlEmpty		= -128;	// 0x80
+	static const ctrl_t	kCtrlDeleted	= -2;	// 0xFE
+
+	static const int	kGroupSize		= 16;
+
+	// 16 control bytes, probed at once. Match functions return bit mask,
+	// bit N set if Nth slot in group matches.
+	struct ctrl_group
+	{
+#if RDESTL_FLAT_HASH_MAP_SSE2
+		explicit ctrl_group(const ctrl_t* ctrl)
+		:	m_ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl)))
+		{
+			/**/
+		}
+		uint32 match(ctrl_t h2) const
+		{
+			return uint32(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), m_ctrl)));
+		}
+		uint32 match_empty() const
+		{
+			return match(kCtrlEmpty);
+		}
+		// Both special values have high bit set.
+		uint32 match_empty_or_deleted() const
+		{
+			return uint32(_mm_movemask_epi8(m_ctrl));
+		}
+		uint32 match_full() const
+		{
+			return match_empty_or_deleted() ^ 0xFFFF;
+		}
+
+		__m128i	m_ctrl;
+#else
+		explicit ctrl_group(const ctrl_t* ctrl)
+		:	m_ctrl(ctrl)
+		{
+			/**/
+		}
+		uint32 match(ctrl_t h2) const
+		{
+			uint32 mask(0);
+			for (int i = 0; i < kGroupSize; ++i)
+				mask |= uint32(m_ctrl[i] == h2) << i;
+			return mask;
+		}
+		uint32 match_empty() const
+		{
+			return match(kCtrlEmpty);
+		}
+		uint32 match_empty_or_deleted() const
+		{
+			uint32 mask(0);
+			for (int i = 0; i < kGroupSize; ++i)
+				mask |= uint32(m_ctrl[i] < 0) << i;
+			return mask;
+		}
+		uint32 match_full() const
+		{
+			return match_empty_or_deleted() ^ 0xFFFF;
+		}
+
+		const ctrl_t*	m_ctrl;
+#endif
+	};
+} // internal
+
+// Open addressing hash map with separate array of control bytes
+// ("Swiss table" layout). Slots are grouped in 16s, lookup compares
+// 7 bits of hash against whole group at once (SSE2), so keys are only
+// compared on (likely) hits.
+// Differences from hash_map:
+//	- max load factor is fixed at 7/8,
+//	- erase usually doesn't leave tombstone (only if group is full),
+//	- iteration skips whole empty groups,
+//	- insert/erase invalidate iterators & pointers to elements.
+template<typename TKey, typename TValue,
+		class THashFunc = rde::hash<TKey>,
+		class TKeyEqualFunc = rde::equal_to<TKey>,
+		class TAllocator = rde::allocator>
+class flat_hash_map
+{
+public:
+	typedef rde::pair<TKey, TValue>         value_type;
+
+private:
+	typedef internal::ctrl_t		ctrl_t;
+	typedef internal::ctrl_group	ctrl_group;
+
+	template<typename TPtr, typename TRef>
+	class slot_iterator
+	{
+		friend class flat_hash_map;
+	public:
+		typedef forward_iterator_tag    iterator_category;
+
+		slot_iterator(int index, const flat_hash_map* map)
+		:	m_index(index),
+			m_map(map)
+		{/**/}
+		template<typename UPtr, typename URef>
+		slot_iterator(const slot_iterator<UPtr, URef>& rhs)
+		:	m_index(rhs.index()),
+			m_map(rhs.get_map())
+		{/**/}
+
+		TRef operator*() const
+		{
+			RDE_ASSERT(m_index < m_map->m_capacity);
+			return m_map->m_slots[m_index];
+		}
+		TPtr operator->() const
+		{
+			return &m_map->m_slots[m_index];
+		}
+
+		slot_iterator& operator++()
+		{
+			RDE_ASSERT(m_index < m_map->m_capacity);
+			m_index = m_map->next_full_slot(m_index + 1);
+			return *this;
+		}
+		slot_iterator operator++(int)
+		{
+			slot_iterator copy(*this);
+			++(*this);
+			return copy;
+		}
+
+		bool operator==(const slot_iterator& rhs) const
+		{
+			return rhs.m_index == m_index && m_map == rhs.get_map();
+		}
+		bool operator!=(const slot_iterator& rhs) const
+		{
+			return !(rhs == *this);
+		}
+
+		int index() const						{ return m_index; }
+		const flat_hash_map* get_map() const	{ return m_map; }
+	private:
+		int						m_index;
+		const flat_hash_map*	m_map;
+	};
+
+public:
+	typedef TKey										key_type;
+	typedef TValue										mapped_type;
+	typedef TAllocator									allocator_type;
+	typedef slot_iterator<value_type*, value_type&>		iterator;
+	typedef slot_iterator<const value_type*, const value_type&>	const_iterator;
+	typedef int											size_type;
+	static const size_type								kInitialCapacity = 64;
+
+	flat_hash_map()
+	:	m_ctrl(0),
+		m_slots(0),
+		m_size(0),
+		m_capacity(0),
+		m_growthLeft(0)
+	{
+		/**/
+	}
+	explicit flat_hash_map(const allocator_type& allocator)
+	:	m_ctrl(0),
+		m_slots(0),
+		m_size(0),
+		m_capacity(0),
+		m_growthLeft(0),
+		m_allocator(allocator)
+	{
+		/**/
+	}
+	explicit flat_hash_map(size_type initial_bucket_count,
+		const allocator_type& allocator = allocator_type())
+	:	m_ctrl(0),
+		m_slots(0),
+		m_size(0),
+		m_capacity(0),
+		m_growthLeft(0),
+		m_allocator(allocator)
+	{
+		reserve(initial_bucket_count);
+	}
+	flat_hash_map(size_type initial_bucket_count,
+		const THashFunc& hashFunc,
+		const allocator_type& allocator = allocator_type())
+	:	m_ctrl(0),
+		m_slots(0),
+		m_size(0),
+		m_capacity(0),
+		m_growthLeft(0),
+		m_hashFunc(hashFunc),
+		m_allocator(allocator)
+	{
+		reserve(initial_bucket_count);
+	}
+	flat_hash_map(const flat_hash_map& rhs, const allocator_type& allocator = allocator_type())
+	:	m_ctrl(0),
+		m_slots(0),
+		m_size(0),
+		m_capacity(0),
+		m_growthLeft(0),
+		m_allocator(allocator)
+	{
+		*this = rhs;
+	}
+	~flat_hash_map()
+	{
+		delete_slots();
+	}
+
+	iterator begin()				{ return iterator(next_full_slot(0), this); }
+	const_iterator begin() const	{ return const_iterator(next_full_slot(0), this); }
+	iterator end()					{ return iterator(m_capacity, this); }
+	const_iterator end() const		{ return const_iterator(m_capacity, this); }
+
+	mapped_type& operator[](const key_type& key)
+	{
+		const hash_value_t hash = m_hashFunc(key);
+		int index = lookup(key, hash);
+		if (index < 0)
+			index = insert_new(value_type(key, TValue()), hash);
+		return m_slots[index].second;
+	}
+	// @note:	Doesnt copy allocator.
+	flat_hash_map& operator=(const flat_hash_map& rhs)
+	{
+		if (&rhs != this)
+		{
+			clear();
+			reserve(rhs.size());
+			for (const_iterator it = rhs.begin(); it != rhs.end(); ++it)
+				insert_new(*it, m_hashFunc(it->first));
+		}
+		return *this;
+	}
+	void swap(flat_hash_map& rhs)
+	{
+		if (&rhs != this)
+		{
+			RDE_ASSERT(m_allocator == rhs.m_allocator);
+			rde::swap(m_ctrl, rhs.m_ctrl);
+			rde::swap(m_slots, rhs.m_slots);
+			rde::swap(m_size, rhs.m_size);
+			rde::swap(m_capacity, rhs.m_capacity);
+			rde::swap(m_growthLeft, rhs.m_growthLeft);
+			rde::swap(m_hashFunc, rhs.m_hashFunc);
+			rde::swap(m_keyEqualFunc, rhs.m_keyEqualFunc);
+		}
+	}
+
+	rde::pair<iterator, bool> insert(const value_type& v)
+	{
+		typedef rde::pair<iterator, bool> ret_type_t;
+		const hash_value_t hash = m_hashFunc(v.first);
+		const int index = lookup(v.first, hash);
+		if (index >= 0)
+			return ret_type_t(iterator(index, this), false);
+		return ret_type_t(iterator(insert_new(v, hash), this), true);
+	}
+
+	size_type erase(const key_type& key)
+	{
+		const int index = lookup(key, m_hashFunc(key));
+		if (index < 0)
+			return 0;
+		erase_slot(index);
+		return 1;
+	}
+	void erase(iterator it)
+	{
+		RDE_ASSERT(it.get_map() == this);
+		if (it != end())
+			erase_slot(it.index());
+	}
+
+	iterator find(const key_type& key)
+	{
+		const int index = lookup(key, m_hashFunc(key));
+		return iterator(index < 0 ? m_capacity : index, this);
+	}
+	const_iterator find(const key_type& key) const
+	{
+		const int index = lookup(key, m_hashFunc(key));
+		return const_iterator(index < 0 ? m_capacity : index, this);
+	}
+
+	void clear()
+	{
+		if (m_size != 0)
+		{
+			for (int i = next_full_slot(0); i < m_capacity; i = next_full_slot(i + 1))
+				rde::destruct(m_slots + i);
+		}
+		if (m_capacity != 0)
+			Sys::MemSet(m_ctrl, (unsigned char)internal::kCtrlEmpty, m_capacity);
+		m_size = 0;
+		m_growthLeft = max_load(m_capacity);
+	}
+
+	// Makes sure at least min_size elements fit without rehashing.
+	void reserve(size_type min_size)
+	{
+		size_type newCapacity = (m_capacity == 0 ? kInitialCapacity : m_capacity);
+		while (max_load(newCapacity) < min_size)
+			newCapacity *= 2;
+		if (newCapacity > m_capacity)
+			rehash(newCapacity);
+	}
+
+	size_type bucket_count() const			{ return m_capacity; }
+	size_type size() const					{ return m_size; }
+	bool empty() const						{ return size() == 0; }
+	size_t used_memory() const
+	{
+		return m_capacity * (sizeof(ctrl_t) + sizeof(value_type));
+	}
+
+	const allocator_type& get_allocator() const	{ return m_allocator; }
+	void set_allocator(const allocator_type& allocator)
+	{
+		m_allocator = allocator;
+	}
+
+private:
+	static RDE_FORCEINLINE ctrl_t h2(hash_value_t hash)	{ return ctrl_t(hash & 0x7F); }
+	static RDE_FORCEINLINE uint32 h1(hash_value_t hash)	{ return uint32(hash >> 7); }
+	static size_type max_load(size_type capacity)		{ return capacity - capacity / 8; }
+
+	// Probes groups (not slots), triangular sequence visits all of them
+	// (group count is power of 2).
+	// -1 if not found.
+	int lookup(const key_type& key, hash_value_t hash) const
+	{
+		if (m_size == 0)
+			return -1;
+		const uint32 groupMask = uint32(m_capacity / internal::kGroupSize) - 1;
+		uint32 group = h1(hash) & groupMask;
+		const ctrl_t tag = h2(hash);
+		for (uint32 numProbes = 1; /**/; ++numProbes)
+		{
+			const ctrl_group g(m_ctrl + group * internal::kGroupSize);
+			uint32 mask = g.match(tag);
+			while (mask != 0)
+			{
+				const int index = int(group * internal::kGroupSize) + internal::lowest_bit_index(mask);
+				if (m_keyEqualFunc(key, m_slots[index].first))
+					return index;
+				mask &= mask - 1;
+			}
+			// Element would've been put in this group, if there was space.
+			if (g.match_empty() != 0)
+				return -1;
+			RDE_ASSERT(numProbes <= groupMask);
+			group = (group + numProbes) & groupMask;
+		}
+	}
+	// First empty (or deleted) slot in probe sequence.
+	int find_free_slot(hash_value_t hash) const
+	{
+		const uint32 groupMask = uint32(m_capacity / internal::kGroupSize) - 1;
+		uint32 group = h1(hash) & groupMask;
+		for (uint32 numProbes = 1; /**/; ++numProbes)
+		{
+			const uint32 mask = ctrl_group(m_ctrl + group * internal::kGroupSize).match_empty_or_deleted();
+			if (mask != 0)
+				return int(group * internal::kGroupSize) + internal::lowest_bit_index(mask);
+			RDE_ASSERT(numProbes <= groupMask);
+			group = (group + numProbes) & groupMask;
+		}
+	}
+	// @pre Key not in the map.
+	int insert_new(const value_type& v, hash_value_t hash)
+	{
+		int index = (m_capacity == 0 ? -1 : find_free_slot(hash));
+		// Reusing tombstone doesn't change load.
+		if (index < 0 || (m_growthLeft == 0 && m_ctrl[index] == internal::kCtrlEmpty))
+		{
+			// If it's mostly tombstones, rehash in place (well, at the same capacity).
+			const size_type newCapacity = (m_capacity == 0 ? kInitialCapacity :
+				(m_size + 1 > max_load(m_capacity) / 2 ? m_capacity * 2 : m_capacity));
+			rehash(newCapacity);
+			index = find_free_slot(hash);
+		}
+		if (m_ctrl[index] == internal::kCtrlEmpty)
+			--m_growthLeft;
+		m_ctrl[index] = h2(hash);
+		rde::copy_construct(m_slots + index, v);
+		++m_size;
+		return index;
+	}
+	void erase_slot(int index)
+	{
+		RDE_ASSERT(index >= 0 && index < m_capacity && m_ctrl[index] >= 0);
+		rde::destruct(m_slots + index);
+		--m_size;
+		// Lookups stop at the first group with an empty slot. If this group
+		// has one, nobody probed past it, so slot can become empty again.
+		const int groupStart = index & ~(internal::kGroupSize - 1);
+		if (ctrl_group(m_ctrl + groupStart).match_empty() != 0)
+		{
+			m_ctrl[index] = internal::kCtrlEmpty;
+			++m_growthLeft;
+		}
+		else
+		{
+			m_ctrl[index] = internal::kCtrlDeleted;
+		}
+	}
+
+	// Index of first full slot >= index (or capacity).
+	int next_full_slot(int index) const
+	{
+		while (index < m_capacity)
+		{
+			const int groupStart = index & ~(internal::kGroupSize - 1);
+			const uint32 mask = ctrl_group(m_ctrl + groupStart).match_full() >> (index - groupStart);
+			if (mask != 0)
+				return index + internal::lowest_bit_index(mask);
+			index = groupStart + internal::kGroupSize;
+		}
+		return m_capacity;
+	}
+
+	void rehash(size_type new_capacity)
+	{
+		RDE_ASSERT((new_capacity & (new_capacity - 1)) == 0);
+		RDE_ASSERT(new_capacity >= internal::kGroupSize && max_load(new_capacity) >= m_size);
+		ctrl_t* oldCtrl = m_ctrl;
+		value_type* oldSlots = m_slots;
+		const size_type oldCapacity = m_capacity;
+
+		// Single block, control bytes first. Capacity is a multiple of 16,
+		// so slots are as aligned as the block itself.
+		m_ctrl = static_cast<ctrl_t*>(m_allocator.allocate(new_capacity * (sizeof(ctrl_t) + sizeof(value_type))));
+		m_slots = reinterpret_cast<value_type*>(m_ctrl + new_capacity);
+		m_capacity = new_capacity;
+		Sys::MemSet(m_ctrl, (unsigned char)internal::kCtrlEmpty, new_capacity);
+		m_growthLeft = max_load(new_capacity) - m_size;
+
+		for (int i = 0; i < oldCapacity; ++i)
+		{
+			if (oldCtrl[i] >= 0)
+			{
+				const hash_value_t hash = m_hashFunc(oldSlots[i].first);
+				const int index = find_free_slot(hash);
+				m_ctrl[index] = h2(hash);
+				rde::copy_construct(m_slots + index, oldSlots[i]);
+				rde::destruct(oldSlots + i);
+			}
+		}
+		if (oldCtrl != 0)
+			m_allocator.deallocate(oldCtrl, oldCapacity * (sizeof(ctrl_t) + sizeof(value_type)));
+	}
+	void delete_slots()
+	{
+		clear();
+		if (m_ctrl != 0)
+			m_allocator.deallocate(m_ctrl, m_capacity * (sizeof(ctrl_t) + sizeof(value_type)));
+	}
+
+	ctrl_t*			m_ctrl;
+	value_type*		m_slots;
+	int				m_size;
+	int				m_capacity;
+	// Number of empty slots we can still fill before hitting max load.
+	int				m_growthLeft;
+	THashFunc		m_hashFunc;
+	TKeyEqualFunc	m_keyEqualFunc;
+	TAllocator		m_allocator;
+};
+
+} // rde
+
+#endif // #ifndef RDESTL_FLAT_HASH_MAP_H
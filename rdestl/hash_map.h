@@ -36,6 +36,16 @@ struct hash
         return a;
 	}
 };
+// Pointers, 64-bit ones are folded first (high bits would be lost otherwise).
+template<typename T>
+struct hash<T*>
+{
+	hash_value_t operator()(const T* ptr) const
+	{
+		const size_t v = (size_t)ptr;
+		return hash<uint32>()(uint32(v) ^ uint32((v >> 16) >> 16));
+	}
+};
 
 template<typename TKey, typename TValue, 
 		class THashFunc = rde::hash<TKey>,
@@ -90,7 +90,7 @@ class map
 public:
 	typedef Tk															key_type;
 	typedef map_pair<Tk, Tv>											value_type;
-	typedef rb_tree<value_type>											tree_type;
+	typedef rb_tree<value_type, TAllocator>								tree_type;
 	typedef node_iterator<typename tree_type::node*, value_type*, value_type&>	iterator;
 	typedef node_iterator<typename tree_type::node*, const value_type*, const value_type&>	const_iterator;
 	typedef TAllocator													allocator_type;
@@ -113,7 +113,7 @@ public:
 	}
 
 private:
-	rb_tree<value_type>	m_tree;
+	tree_type	m_tree;
 };
 
 }
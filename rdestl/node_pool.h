@@ -0,0 +1,229 @@
+#ifndef RDESTL_NODE_POOL_H
+#define RDESTL_NODE_POOL_H
+
+#include "rdestl/allocator.h"
+#include "rdestl/rdestl.h"
+
+namespace rde
+{
+//=============================================================================
+// Pool of fixed size blocks. Memory is taken from TAllocator in chunks of
+// nodes_per_chunk nodes, freed nodes go to intrusive free list and are reused
+// before chunk space. Chunks are only given back in release()/destructor.
+// Node size can be given in constructor or is set by first allocation.
+// Not thread-safe (neither are containers that use it).
+template<class TAllocator = rde::allocator>
+class node_pool
+{
+public:
+	typedef TAllocator	allocator_type;
+
+	explicit node_pool(size_t node_size = 0, int nodes_per_chunk = 256,
+		const allocator_type& allocator = allocator_type())
+	:	m_freeList(0),
+		m_chunks(0),
+		m_chunkTop(0),
+		m_chunkEnd(0),
+		m_nodeSize(0),
+		m_nodesPerChunk(nodes_per_chunk),
+		m_numNodes(0),
+		m_reservedBytes(0),
+		m_allocator(allocator)
+	{
+		RDE_ASSERT(nodes_per_chunk > 0);
+		if (node_size != 0)
+			set_node_size(node_size);
+	}
+	~node_pool()
+	{
+		release();
+	}
+
+	void* allocate()
+	{
+		RDE_ASSERT(m_nodeSize != 0);
+		++m_numNodes;
+		if (m_freeList != 0)
+		{
+			free_node* n = m_freeList;
+			m_freeList = n->next;
+			return n;
+		}
+		if (m_chunkTop == m_chunkEnd)
+			allocate_chunk();
+		void* ret = m_chunkTop;
+		m_chunkTop += m_nodeSize;
+		return ret;
+	}
+	void* allocate(size_t bytes)
+	{
+		if (m_nodeSize == 0)
+			set_node_size(bytes);
+		RDE_ASSERT(bytes <= m_nodeSize);
+		return allocate();
+	}
+	void deallocate(void* ptr)
+	{
+		if (ptr == 0)
+			return;
+		RDE_ASSERT(m_numNodes > 0);
+		--m_numNodes;
+		free_node* n = static_cast<free_node*>(ptr);
+		n->next = m_freeList;
+		m_freeList = n;
+	}
+
+	// Frees all chunks. Nodes still in use become invalid.
+	void release()
+	{
+		chunk_header* chunk = m_chunks;
+		while (chunk != 0)
+		{
+			chunk_header* next = chunk->next;
+			m_allocator.deallocate(chunk, chunk->bytes);
+			chunk = next;
+		}
+		m_freeList = 0;
+		m_chunks = 0;
+		m_chunkTop = m_chunkEnd = 0;
+		m_numNodes = 0;
+		m_reservedBytes = 0;
+	}
+
+	size_t get_node_size() const		{ return m_nodeSize; }
+	size_t get_num_nodes() const		{ return m_numNodes; }
+	// Memory taken from allocator, including chunk headers.
+	size_t get_reserved_bytes() const	{ return m_reservedBytes; }
+
+	const allocator_type& get_allocator() const	{ return m_allocator; }
+	allocator_type& get_allocator()				{ return m_allocator; }
+
+private:
+	struct chunk_header
+	{
+		chunk_header*	next;
+		size_t			bytes;
+	};
+	// Nodes start at this offset, so they're 16-byte aligned if chunk is.
+	static const size_t	kChunkHeaderSize = 16;
+	struct free_node
+	{
+		free_node*	next;
+	};
+
+	node_pool(const node_pool&);
+	node_pool& operator=(const node_pool&);
+
+	void set_node_size(size_t node_size)
+	{
+		RDE_ASSERT(m_nodeSize == 0);
+		// Size is multiple of node alignment, so rounding up to pointer size
+		// keeps nodes aligned.
+		if (node_size < sizeof(free_node))
+			node_size = sizeof(free_node);
+		m_nodeSize = (node_size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+	}
+	void allocate_chunk()
+	{
+		RDE_COMPILE_CHECK(sizeof(chunk_header) <= kChunkHeaderSize);
+		const size_t bytes = kChunkHeaderSize + m_nodeSize * m_nodesPerChunk;
+		chunk_header* chunk = static_cast<chunk_header*>(m_allocator.allocate(bytes));
+		chunk->next = m_chunks;
+		chunk->bytes = bytes;
+		m_chunks = chunk;
+		m_chunkTop = reinterpret_cast<char*>(chunk) + kChunkHeaderSize;
+		m_chunkEnd = m_chunkTop + m_nodeSize * m_nodesPerChunk;
+		m_reservedBytes += bytes;
+	}
+
+	free_node*		m_freeList;
+	chunk_header*	m_chunks;
+	char*			m_chunkTop;
+	char*			m_chunkEnd;
+	size_t			m_nodeSize;
+	int				m_nodesPerChunk;
+	size_t			m_numNodes;
+	size_t			m_reservedBytes;
+	TAllocator		m_allocator;
+};
+
+//=============================================================================
+// Allocator for node based containers (list, slist, rb_tree, map, set),
+// ie. ones that only allocate nodes of one size. Every copy has its own pool
+// (copies start empty), so each container gets private pool when allocator
+// is passed to it.
+// Allocations of other sizes go straight to TAllocator.
+template<class TAllocator = rde::allocator>
+class node_allocator
+{
+public:
+	explicit node_allocator(const char* name = "NODE", int nodes_per_chunk = 256,
+		const TAllocator& allocator = TAllocator())
+	:	m_pool(0, nodes_per_chunk, allocator),
+		m_name(name),
+		m_nodeBytes(0),
+		m_nodesPerChunk(nodes_per_chunk)
+	{
+		/**/
+	}
+	node_allocator(const node_allocator& rhs)
+	:	m_pool(0, rhs.m_nodesPerChunk, rhs.m_pool.get_allocator()),
+		m_name(rhs.m_name),
+		m_nodeBytes(0),
+		m_nodesPerChunk(rhs.m_nodesPerChunk)
+	{
+		/**/
+	}
+	// Only allowed if there are no nodes allocated from this one
+	// (there'd be no way to free them).
+	node_allocator& operator=(const node_allocator& rhs)
+	{
+		RDE_ASSERT(m_pool.get_num_nodes() == 0);
+		m_name = rhs.m_name;
+		return *this;
+	}
+
+	void* allocate(size_t bytes, int flags = 0)
+	{
+		// First allocation decides node size.
+		if (m_nodeBytes == 0)
+			m_nodeBytes = bytes;
+		if (bytes == m_nodeBytes)
+			return m_pool.allocate(bytes);
+		return m_pool.get_allocator().allocate(bytes, flags);
+	}
+	void deallocate(void* ptr, size_t bytes)
+	{
+		if (bytes == m_nodeBytes)
+			m_pool.deallocate(ptr);
+		else
+			m_pool.get_allocator().deallocate(ptr, bytes);
+	}
+
+	const char* get_name() const	{ return m_name; }
+	const node_pool<TAllocator>& get_pool() const	{ return m_pool; }
+
+private:
+	node_pool<TAllocator>	m_pool;
+	const char*				m_name;
+	// As requested by container (pool rounds it up).
+	size_t					m_nodeBytes;
+	int						m_nodesPerChunk;
+};
+
+// Memory from one node_allocator can't be freed by another.
+template<class TAllocator>
+inline bool operator==(const node_allocator<TAllocator>& lhs, const node_allocator<TAllocator>& rhs)
+{
+	return &lhs == &rhs;
+}
+template<class TAllocator>
+inline bool operator!=(const node_allocator<TAllocator>& lhs, const node_allocator<TAllocator>& rhs)
+{
+	return !(lhs == rhs);
+}
+
+} // rde
+
+//-----------------------------------------------------------------------------
+#endif // #ifndef RDESTL_NODE_POOL_H
@@ -0,0 +1,337 @@
+#ifndef RDESTL_PARALLEL_SORT_H
+#define RDESTL_PARALLEL_SORT_H
+
+#include "rdestl/algorithm.h"
+#include "rdestl/sort.h"
+#include "rdestl/vector.h"
+
+namespace rde
+{
+// Executor concept, used by parallel algorithms:
+//	int get_num_threads() const;
+//	// Calls func for sub-ranges of [begin, end), not longer than granularity,
+//	// (possibly) in parallel. Returns when all are processed.
+//	void parallel_for(int begin, int end, int granularity,
+//		void (*func)(int begin, int end, void* user_data), void* user_data);
+// RDESTL doesn't know about threads, see core/JobSystem.h for an executor
+// running on a thread pool.
+struct serial_executor
+{
+	int get_num_threads() const	{ return 1; }
+	void parallel_for(int begin, int end, int /*granularity*/,
+		void (*func)(int, int, void*), void* user_data)
+	{
+		if (begin < end)
+			func(begin, end, user_data);
+	}
+};
+
+namespace internal
+{
+	// Below that it's not worth to fire up threads.
+	static const int	kMinParallelSortSize	= 16 * 1024;
+	static const int	kMaxSortBuckets			= 64;
+	static const int	kSortOversampling		= 32;
+
+	template<typename T, class TPredicate>
+	struct sample_sort_context
+	{
+		T*				data;
+		T*				buffer;
+		int				num;
+		int				block_size;
+		int				num_buckets;
+		TPredicate		pred;
+		T				splitters[kMaxSortBuckets - 1];
+		// [block * num_buckets + bucket], counts, then write offsets.
+		uint32*			offsets;
+		// num_buckets + 1 entries, start of every bucket in final order.
+		uint32*			bucket_starts;
+		// Bucket of every element, so that it's searched for only once.
+		uint8*			bucket_ids;
+
+		RDE_FORCEINLINE int find_bucket(const T& x) const
+		{
+			// Upper bound, ie. first splitter greater than x.
+			int low(0), high(num_buckets - 1);
+			while (low < high)
+			{
+				const int mid = (low + high) >> 1;
+				if (pred(x, splitters[mid]))
+					high = mid;
+				else
+					low = mid + 1;
+			}
+			return low;
+		}
+	};
+
+	template<typename T, class TPredicate>
+	void sample_sort_count(int first_block, int last_block, void* user_data)
+	{
+		sample_sort_context<T, TPredicate>* ctx = static_cast<sample_sort_context<T, TPredicate>*>(user_data);
+		for (int block = first_block; block < last_block; ++block)
+		{
+			uint32* counts = ctx->offsets + block * ctx->num_buckets;
+			const int first = block * ctx->block_size;
+			const int last = (first + ctx->block_size < ctx->num ? first + ctx->block_size : ctx->num);
+			for (int i = first; i < last; ++i)
+			{
+				const int bucket = ctx->find_bucket(ctx->data[i]);
+				ctx->bucket_ids[i] = uint8(bucket);
+				++counts[bucket];
+			}
+		}
+	}
+	template<typename T, class TPredicate>
+	void sample_sort_scatter(int first_block, int last_block, void* user_data)
+	{
+		sample_sort_context<T, TPredicate>* ctx = static_cast<sample_sort_context<T, TPredicate>*>(user_data);
+		for (int block = first_block; block < last_block; ++block)
+		{
+			uint32* offsets = ctx->offsets + block * ctx->num_buckets;
+			const int first = block * ctx->block_size;
+			const int last = (first + ctx->block_size < ctx->num ? first + ctx->block_size : ctx->num);
+			for (int i = first; i < last; ++i)
+				ctx->buffer[offsets[ctx->bucket_ids[i]]++] = ctx->data[i];
+		}
+	}
+	template<typename T, class TPredicate>
+	void sample_sort_buckets(int first_bucket, int last_bucket, void* user_data)
+	{
+		sample_sort_context<T, TPredicate>* ctx = static_cast<sample_sort_context<T, TPredicate>*>(user_data);
+		for (int bucket = first_bucket; bucket < last_bucket; ++bucket)
+		{
+			const uint32 start = ctx->bucket_starts[bucket];
+			const uint32 end = ctx->bucket_starts[bucket + 1];
+			if (start == end)
+				continue;
+			rde::copy(ctx->buffer + start, ctx->buffer + end, ctx->data + start);
+			quick_sort(ctx->data + start, ctx->data + end, ctx->pred);
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	template<typename TKey, typename TValue, bool THasValues>
+	struct radix_sort_context
+	{
+		const TKey*		src_keys;
+		TKey*			dst_keys;
+		const TValue*	src_values;
+		TValue*			dst_values;
+		int				num;
+		int				block_size;
+		int				shift;
+		// [block * 256 + digit], counts, then write offsets.
+		uint32*			offsets;
+	};
+
+	template<typename TKey, typename TValue, bool THasValues>
+	void radix_sort_count(int first_block, int last_block, void* user_data)
+	{
+		radix_sort_context<TKey, TValue, THasValues>* ctx =
+			static_cast<radix_sort_context<TKey, TValue, THasValues>*>(user_data);
+		for (int block = first_block; block < last_block; ++block)
+		{
+			uint32* counts = ctx->offsets + block * 256;
+			const int first = block * ctx->block_size;
+			const int last = (first + ctx->block_size < ctx->num ? first + ctx->block_size : ctx->num);
+			const int shift = ctx->shift;
+			for (int i = first; i < last; ++i)
+				++counts[(ctx->src_keys[i] >> shift) & 0xFF];
+		}
+	}
+	template<typename TKey, typename TValue, bool THasValues>
+	void radix_sort_scatter(int first_block, int last_block, void* user_data)
+	{
+		radix_sort_context<TKey, TValue, THasValues>* ctx =
+			static_cast<radix_sort_context<TKey, TValue, THasValues>*>(user_data);
+		for (int block = first_block; block < last_block; ++block)
+		{
+			uint32* offsets = ctx->offsets + block * 256;
+			const int first = block * ctx->block_size;
+			const int last = (first + ctx->block_size < ctx->num ? first + ctx->block_size : ctx->num);
+			const int shift = ctx->shift;
+			for (int i = first; i < last; ++i)
+			{
+				const TKey key = ctx->src_keys[i];
+				const uint32 pos = offsets[(key >> shift) & 0xFF]++;
+				ctx->dst_keys[pos] = key;
+				if (THasValues)
+					ctx->dst_values[pos] = ctx->src_values[i];
+			}
+		}
+	}
+	template<typename TKey, typename TValue, bool THasValues>
+	void radix_sort_copy(int first, int last, void* user_data)
+	{
+		radix_sort_context<TKey, TValue, THasValues>* ctx =
+			static_cast<radix_sort_context<TKey, TValue, THasValues>*>(user_data);
+		rde::copy(ctx->src_keys + first, ctx->src_keys + last, ctx->dst_keys + first);
+		if (THasValues)
+			rde::copy(ctx->src_values + first, ctx->src_values + last, ctx->dst_values + first);
+	}
+
+	template<typename TKey, typename TValue, bool THasValues, class TExecutor>
+	void parallel_radix_sort(TKey* keys, TValue* values, TKey* key_buffer, TValue* value_buffer,
+		int num, TExecutor& executor)
+	{
+		if (num < 2)
+			return;
+		const int num_threads = executor.get_num_threads();
+		int num_blocks = (num_threads > 1 ? num_threads * 4 : 1);
+		if (num_blocks > num / 4096)
+			num_blocks = (num / 4096 > 0 ? num / 4096 : 1);
+		vector<uint32> offsets(num_blocks * 256);
+
+		radix_sort_context<TKey, TValue, THasValues> ctx;
+		ctx.src_keys = keys;
+		ctx.dst_keys = key_buffer;
+		ctx.src_values = values;
+		ctx.dst_values = value_buffer;
+		ctx.num = num;
+		ctx.block_size = (num + num_blocks - 1) / num_blocks;
+		ctx.offsets = offsets.begin();
+		for (ctx.shift = 0; ctx.shift < int(sizeof(TKey) * 8); ctx.shift += 8)
+		{
+			Sys::MemSet(ctx.offsets, 0, offsets.size() * sizeof(uint32));
+			executor.parallel_for(0, num_blocks, 1, radix_sort_count<TKey, TValue, THasValues>, &ctx);
+
+			// Digit-major, block-minor, so that sort is stable.
+			uint32 total(0);
+			bool single_digit(false);
+			for (int digit = 0; digit < 256 && !single_digit; ++digit)
+			{
+				const uint32 digit_start = total;
+				for (int block = 0; block < num_blocks; ++block)
+				{
+					uint32& count = ctx.offsets[block * 256 + digit];
+					const uint32 offset = total;
+					total += count;
+					count = offset;
+				}
+				// All keys have the same digit (typical for high bytes), nothing to do.
+				single_digit = (total - digit_start == uint32(num));
+			}
+			if (single_digit)
+				continue;
+
+			executor.parallel_for(0, num_blocks, 1, radix_sort_scatter<TKey, TValue, THasValues>, &ctx);
+			TKey* keys_tmp = const_cast<TKey*>(ctx.src_keys);
+			ctx.src_keys = ctx.dst_keys;
+			ctx.dst_keys = keys_tmp;
+			TValue* values_tmp = const_cast<TValue*>(ctx.src_values);
+			ctx.src_values = ctx.dst_values;
+			ctx.dst_values = values_tmp;
+		}
+		// Odd number of passes, results are in buffer.
+		if (ctx.src_keys != keys)
+		{
+			ctx.dst_keys = keys;
+			ctx.dst_values = values;
+			executor.parallel_for(0, num, ctx.block_size, radix_sort_copy<TKey, TValue, THasValues>, &ctx);
+		}
+	}
+} // internal
+
+// Sample sort. Input is split into blocks, elements of every block are
+// distributed to buckets (by splitters chosen from random sample), then
+// buckets are sorted independently (with quick_sort). Not stable.
+// help_buffer has to be at least (end - begin) elements big.
+template<typename T, class TPredicate, class TExecutor>
+void parallel_sort(T* begin, T* end, TPredicate pred, TExecutor& executor, T* help_buffer)
+{
+	const int num = int(end - begin);
+	const int num_threads = executor.get_num_threads();
+	if (num < internal::kMinParallelSortSize || num_threads < 2)
+	{
+		quick_sort(begin, end, pred);
+		return;
+	}
+
+	internal::sample_sort_context<T, TPredicate> ctx;
+	ctx.data = begin;
+	ctx.buffer = help_buffer;
+	ctx.num = num;
+	ctx.pred = pred;
+	ctx.num_buckets = (num_threads * 4 < internal::kMaxSortBuckets ? num_threads * 4 : internal::kMaxSortBuckets);
+	ctx.block_size = (num + ctx.num_buckets - 1) / ctx.num_buckets;
+
+	// Random sample, sorted, every kSortOversampling-th becomes a splitter.
+	const int num_samples = ctx.num_buckets * internal::kSortOversampling;
+	vector<T> samples(num_samples);
+	uint32 seed = uint32(num);
+	for (int i = 0; i < num_samples; ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+		samples[i] = begin[(seed >> 8) % uint32(num)];
+	}
+	quick_sort(samples.begin(), samples.end(), pred);
+	for (int i = 0; i < ctx.num_buckets - 1; ++i)
+		ctx.splitters[i] = samples[(i + 1) * internal::kSortOversampling];
+
+	vector<uint32> offsets(ctx.num_buckets * ctx.num_buckets + ctx.num_buckets + 1);
+	Sys::MemSet(offsets.begin(), 0, offsets.size() * sizeof(uint32));
+	ctx.offsets = offsets.begin();
+	ctx.bucket_starts = ctx.offsets + ctx.num_buckets * ctx.num_buckets;
+	vector<uint8> bucket_ids(num);
+	ctx.bucket_ids = bucket_ids.begin();
+	executor.parallel_for(0, ctx.num_buckets, 1, internal::sample_sort_count<T, TPredicate>, &ctx);
+
+	// Bucket-major, block-minor.
+	uint32 total(0);
+	for (int bucket = 0; bucket < ctx.num_buckets; ++bucket)
+	{
+		ctx.bucket_starts[bucket] = total;
+		for (int block = 0; block < ctx.num_buckets; ++block)
+		{
+			uint32& count = ctx.offsets[block * ctx.num_buckets + bucket];
+			const uint32 offset = total;
+			total += count;
+			count = offset;
+		}
+	}
+	ctx.bucket_starts[ctx.num_buckets] = total;
+
+	executor.parallel_for(0, ctx.num_buckets, 1, internal::sample_sort_scatter<T, TPredicate>, &ctx);
+	executor.parallel_for(0, ctx.num_buckets, 1, internal::sample_sort_buckets<T, TPredicate>, &ctx);
+}
+// Version that allocates temporary buffer.
+template<typename T, class TPredicate, class TExecutor>
+void parallel_sort(T* begin, T* end, TPredicate pred, TExecutor& executor)
+{
+	if (end - begin < internal::kMinParallelSortSize || executor.get_num_threads() < 2)
+	{
+		quick_sort(begin, end, pred);
+		return;
+	}
+	vector<T> help_buffer(int(end - begin));
+	parallel_sort(begin, end, pred, executor, help_buffer.begin());
+}
+template<typename T, class TExecutor>
+void parallel_sort(T* begin, T* end, TExecutor& executor)
+{
+	parallel_sort(begin, end, less<T>(), executor);
+}
+
+// LSD radix sort (8 bits per pass) for unsigned integer keys (32 or 64-bit).
+// Every block of input has its own histogram, so both counting and scattering
+// run in parallel. Stable. Passes where all keys share the digit are skipped.
+// Buffers have to be at least num elements big, results end up in keys/values.
+template<typename TKey, class TExecutor>
+void parallel_radix_sort(TKey* keys, TKey* key_buffer, int num, TExecutor& executor)
+{
+	internal::parallel_radix_sort<TKey, int, false>(keys, (int*)0, key_buffer, (int*)0, num, executor);
+}
+// Key/value pairs, values are moved together with keys.
+template<typename TKey, typename TValue, class TExecutor>
+void parallel_radix_sort(TKey* keys, TValue* values, TKey* key_buffer, TValue* value_buffer,
+	int num, TExecutor& executor)
+{
+	internal::parallel_radix_sort<TKey, TValue, true>(keys, values, key_buffer, value_buffer, num, executor);
+}
+
+} // rde
+
+//-----------------------------------------------------------------------------
+#endif // #ifndef RDESTL_PARALLEL_SORT_H
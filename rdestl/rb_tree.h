@@ -372,7 +372,8 @@ protected:
 				}
 			}
 		}
-		m_root->color = black;
+		// Loop can stop at red node (not only root), it absorbs extra black.
+		iter->color = black;
 	}
 
 	void validate() const
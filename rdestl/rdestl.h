@@ -11,6 +11,7 @@
 #	define RDE_ASSERT		assert
 // @note; __forceinline for MSVC!
 #	define RDE_FORCEINLINE	inline
+#	define RDE_ALIGN(x)		__declspec(align(x))
 #	ifdef _DEBUG
 #		undef RDE_DEBUG
 #		define RDE_DEBUG	1
@@ -1,6 +1,9 @@
 #ifndef RDESTL_SIMPLE_STRING_STORAGE_H
 #define RDESTL_SIMPLE_STRING_STORAGE_H
 
+#include "rdestl/rdestl.h"
+#include "rdestl/string_utils.h"
+
 namespace rde
 {
 template<typename E, class TAllocator>
@@ -0,0 +1,177 @@
+#ifndef RDESTL_SSO_STRING_STORAGE_H
+#define RDESTL_SSO_STRING_STORAGE_H
+
+#include "rdestl/rdestl.h"
+#include "rdestl/string_utils.h"
+
+namespace rde
+{
+//=============================================================================
+// Small String Optimization storage.
+// Strings up to kLocalCapacity characters are kept in internal buffer, longer
+// ones are allocated. m_data always points to characters (internal buffer
+// or heap block), so c_str() doesn't need to test which one is used.
+// No sharing, copies are always deep (cheap for short strings).
+template<typename E, class TAllocator>
+class sso_string_storage
+{
+public:
+	typedef E					value_type;
+	typedef int					size_type;
+	typedef TAllocator			allocator_type;
+	typedef const value_type*	const_iterator;
+	static const size_type		kLocalCapacity = 22;
+
+	explicit sso_string_storage(const allocator_type& allocator)
+	:	m_data(m_buffer),
+		m_length(0),
+		m_capacity(kLocalCapacity),
+		m_allocator(allocator)
+	{
+		m_buffer[0] = 0;
+	}
+	sso_string_storage(const value_type* str, const allocator_type& allocator)
+	:	m_data(m_buffer),
+		m_length(0),
+		m_capacity(kLocalCapacity),
+		m_allocator(allocator)
+	{
+		assign(str, strlen(str));
+	}
+	sso_string_storage(const value_type* str, size_type len,
+		const allocator_type& allocator)
+	:	m_data(m_buffer),
+		m_length(0),
+		m_capacity(kLocalCapacity),
+		m_allocator(allocator)
+	{
+		assign(str, len);
+	}
+	sso_string_storage(const sso_string_storage& rhs, const allocator_type& allocator)
+	:	m_data(m_buffer),
+		m_length(0),
+		m_capacity(kLocalCapacity),
+		m_allocator(allocator)
+	{
+		assign(rhs.c_str(), rhs.length());
+	}
+	~sso_string_storage()
+	{
+		release_string();
+	}
+
+	// @note: doesnt copy allocator
+	sso_string_storage& operator=(const sso_string_storage& rhs)
+	{
+		if (m_data != rhs.m_data)
+		{
+			assign(rhs.c_str(), rhs.length());
+		}
+		return *this;
+	}
+
+	void assign(const value_type* str, size_type len)
+	{
+		// Do not use with str = str2.c_str()!
+		RDE_ASSERT(str != m_data);
+		if (len > m_capacity)
+		{
+			// Old contents not needed, so don't copy them.
+			release_string();
+			m_data = allocate_string(len);
+			m_capacity = len;
+		}
+		Sys::MemCpy(m_data, str, len*sizeof(value_type));
+		m_length = len;
+		m_data[len] = 0;
+	}
+
+	void append(const value_type* str, size_type len)
+	{
+		const size_type newLen = m_length + len;
+		if (newLen > m_capacity)
+		{
+			// Grow geometrically, so that repeated appends don't reallocate every time.
+			grow(newLen > m_capacity * 2 ? newLen : m_capacity * 2);
+		}
+		Sys::MemCpy(m_data + m_length, str, len*sizeof(value_type));
+		m_length = newLen;
+		m_data[newLen] = 0;
+	}
+
+	inline const value_type* c_str() const
+	{
+		return m_data;
+	}
+	inline size_type length() const
+	{
+		return m_length;
+	}
+	inline size_type capacity() const	{ return m_capacity; }
+	// True if characters are kept in internal buffer (no allocation).
+	inline bool is_local() const		{ return m_data == m_buffer; }
+
+	const allocator_type& get_allocator() const	{ return m_allocator; }
+
+	value_type* reserve(size_type capacity_hint)
+	{
+		if (capacity_hint > m_capacity)
+			grow(capacity_hint);
+		return m_data;
+	}
+	// Keeps memory, so that string can be refilled without allocations.
+	void clear()
+	{
+		resize(0);
+	}
+	void resize(size_type size)
+	{
+		reserve(size);
+		m_length = size;
+		m_data[size] = 0;
+	}
+
+protected:
+	bool invariant() const
+	{
+		RDE_ASSERT(m_data);
+		RDE_ASSERT(m_length <= m_capacity);
+		RDE_ASSERT(is_local() == (m_capacity == kLocalCapacity));
+		RDE_ASSERT(m_data[length()] == 0);
+		return true;
+	}
+	void make_unique(size_type) {}
+	RDE_FORCEINLINE E* get_data()	{ return m_data; }
+
+private:
+	value_type* allocate_string(size_type capacity)
+	{
+		RDE_ASSERT(capacity > kLocalCapacity);
+		return static_cast<value_type*>(m_allocator.allocate(sizeof(value_type)*(capacity + 1)));
+	}
+	void grow(size_type newCapacity)
+	{
+		value_type* newData = allocate_string(newCapacity);
+		Sys::MemCpy(newData, m_data, (m_length + 1)*sizeof(value_type));
+		release_string();
+		m_data = newData;
+		m_capacity = newCapacity;
+	}
+	void release_string()
+	{
+		if (!is_local())
+		{
+			m_allocator.deallocate(m_data, sizeof(value_type)*(m_capacity + 1));
+		}
+	}
+
+	E*			m_data;
+	size_type	m_length;
+	size_type	m_capacity;
+	E			m_buffer[kLocalCapacity + 1];
+	TAllocator	m_allocator;
+};
+
+} // rde
+
+#endif // RDESTL_SSO_STRING_STORAGE_H
@@ -0,0 +1,436 @@
+#include "rdestl/string_utils.h"
+
+#if RDESTL_STRING_UTILS_SSE2
+
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#	include <intrin.h>
+#	define RDESTL_TARGET_AVX2
+#else
+#	define RDESTL_TARGET_AVX2	__attribute__((target("avx2")))
+#endif
+
+// SIMD versions read past the terminator (never past the page), which
+// address sanitizer would report.
+#if defined(__SANITIZE_ADDRESS__) && defined(_MSC_VER)
+#	define RDESTL_NO_SANITIZE_ADDRESS	__declspec(no_sanitize_address)
+#elif defined(__SANITIZE_ADDRESS__)
+#	define RDESTL_NO_SANITIZE_ADDRESS	__attribute__((no_sanitize_address))
+#else
+#	define RDESTL_NO_SANITIZE_ADDRESS
+#endif
+
+namespace
+{
+typedef int (*strlen_func)(const char*);
+typedef int (*find_index_of_func)(const char*, char);
+typedef int (*strcompare_len_func)(const char*, const char*, size_t);
+typedef int (*strcompare_func)(const char*, const char*);
+typedef int (*find_substring_func)(const char*, int, const char*, int);
+
+bool cpu_has_avx2()
+{
+#ifdef _MSC_VER
+	int regs[4];
+	__cpuid(regs, 0);
+	if (regs[0] < 7)
+		return false;
+	__cpuid(regs, 1);
+	// OSXSAVE + AVX, OS has to save YMM registers.
+	const int kOsxsaveAvx = (1 << 27) | (1 << 28);
+	if ((regs[2] & kOsxsaveAvx) != kOsxsaveAvx || (_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(regs, 7, 0);
+	return (regs[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+// Unaligned loads are only done if they don't cross page boundary.
+template<size_t TBytes>
+RDE_FORCEINLINE bool can_load(const void* ptr)
+{
+	return (size_t(ptr) & 4095) <= 4096 - TBytes;
+}
+RDE_FORCEINLINE rde::uint32 zero_mask(__m128i v)
+{
+	return rde::uint32(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())));
+}
+// Same result as generic strcompare for first difference (or end) at 'index'.
+RDE_FORCEINLINE int compare_chars(char c1, char c2)
+{
+	if (c1 == c2)
+		return 0;
+	if (c1 == 0 || c2 == 0)
+		return c1 == 0 ? -1 : 1;
+	return c1 < c2 ? -1 : 1;
+}
+
+//-----------------------------------------------------------------------------
+// @pre	str 16-byte aligned
+RDESTL_NO_SANITIZE_ADDRESS int strlen_sse2(const char* str)
+{
+	const char* p = str;
+	// Both halves have to be in the same 32-byte block (so same page).
+	if (size_t(p) & 16)
+	{
+		const rde::uint32 mask = zero_mask(_mm_load_si128(reinterpret_cast<const __m128i*>(p)));
+		if (mask != 0)
+			return rde::internal::lowest_bit_index(mask);
+		p += 16;
+	}
+	for (;;)
+	{
+		const __m128i v0 = _mm_load_si128(reinterpret_cast<const __m128i*>(p));
+		const __m128i v1 = _mm_load_si128(reinterpret_cast<const __m128i*>(p + 16));
+		const __m128i zero = _mm_setzero_si128();
+		const rde::uint32 mask = rde::uint32(_mm_movemask_epi8(_mm_cmpeq_epi8(v0, zero))) |
+			(rde::uint32(_mm_movemask_epi8(_mm_cmpeq_epi8(v1, zero))) << 16);
+		if (mask != 0)
+			return int(p - str) + rde::internal::lowest_bit_index(mask);
+		p += 32;
+	}
+}
+RDESTL_NO_SANITIZE_ADDRESS RDESTL_TARGET_AVX2 int strlen_avx2(const char* str)
+{
+	const char* p = str;
+	// 32-byte alignment for the main loop.
+	if (size_t(p) & 16)
+	{
+		const rde::uint32 mask = zero_mask(_mm_load_si128(reinterpret_cast<const __m128i*>(p)));
+		if (mask != 0)
+			return rde::internal::lowest_bit_index(mask);
+		p += 16;
+	}
+	const __m256i zero = _mm256_setzero_si256();
+	for (;;)
+	{
+		const __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(p));
+		const rde::uint32 mask = rde::uint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero)));
+		if (mask != 0)
+			return int(p - str) + rde::internal::lowest_bit_index(mask);
+		p += 32;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// @pre	str 16-byte aligned
+RDESTL_NO_SANITIZE_ADDRESS int find_index_of_sse2(const char* str, char ch)
+{
+	const __m128i chars = _mm_set1_epi8(ch);
+	for (const char* p = str; ; p += 16)
+	{
+		const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(p));
+		const rde::uint32 mask = zero_mask(v) | rde::uint32(_mm_movemask_epi8(_mm_cmpeq_epi8(v, chars)));
+		if (mask != 0)
+		{
+			const int index = int(p - str) + rde::internal::lowest_bit_index(mask);
+			return str[index] == ch ? index : -1;
+		}
+	}
+}
+RDESTL_NO_SANITIZE_ADDRESS RDESTL_TARGET_AVX2 int find_index_of_avx2(const char* str, char ch)
+{
+	const char* p = str;
+	if (size_t(p) & 16)
+	{
+		const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(p));
+		const rde::uint32 mask = zero_mask(v) |
+			rde::uint32(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(ch))));
+		if (mask != 0)
+		{
+			const int index = rde::internal::lowest_bit_index(mask);
+			return str[index] == ch ? index : -1;
+		}
+		p += 16;
+	}
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i chars = _mm256_set1_epi8(ch);
+	for (;;)
+	{
+		const __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(p));
+		const rde::uint32 mask = rde::uint32(_mm256_movemask_epi8(_mm256_or_si256(
+			_mm256_cmpeq_epi8(v, zero), _mm256_cmpeq_epi8(v, chars))));
+		if (mask != 0)
+		{
+			const int index = int(p - str) + rde::internal::lowest_bit_index(mask);
+			return str[index] == ch ? index : -1;
+		}
+		p += 32;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Stops at first difference (like generic version), so doesn't read more
+// than needed from shorter string (if it's only checked for equality).
+RDESTL_NO_SANITIZE_ADDRESS int strcompare_len_sse2(const char* s1, const char* s2, size_t len)
+{
+	while (len >= 16 && can_load<16>(s1) && can_load<16>(s2))
+	{
+		const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s1));
+		const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s2));
+		const rde::uint32 mask = rde::uint32(_mm_movemask_epi8(_mm_cmpeq_epi8(v1, v2))) ^ 0xFFFF;
+		if (mask != 0)
+		{
+			const int index = rde::internal::lowest_bit_index(mask);
+			return s1[index] < s2[index] ? -1 : 1;
+		}
+		s1 += 16;
+		s2 += 16;
+		len -= 16;
+	}
+	return rde::strcompare<char>(s1, s2, len);
+}
+RDESTL_NO_SANITIZE_ADDRESS RDESTL_TARGET_AVX2 int strcompare_len_avx2(const char* s1, const char* s2, size_t len)
+{
+	while (len >= 32 && can_load<32>(s1) && can_load<32>(s2))
+	{
+		const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s1));
+		const __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s2));
+		const rde::uint32 mask = ~rde::uint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, v2)));
+		if (mask != 0)
+		{
+			const int index = rde::internal::lowest_bit_index(mask);
+			return s1[index] < s2[index] ? -1 : 1;
+		}
+		s1 += 32;
+		s2 += 32;
+		len -= 32;
+	}
+	return strcompare_len_sse2(s1, s2, len);
+}
+
+//-----------------------------------------------------------------------------
+// Compares next 16 characters (or char by char till page boundary is crossed).
+// @return	true if difference/end of string has been found (result is valid).
+RDESTL_NO_SANITIZE_ADDRESS RDE_FORCEINLINE bool strcompare_step16(const char*& s1, const char*& s2, int& result)
+{
+	if (can_load<16>(s1) && can_load<16>(s2))
+	{
+		const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s1));
+		const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s2));
+		// Different or end of string (if equal, zero in one means zero in both).
+		const rde::uint32 mask = (rde::uint32(_mm_movemask_epi8(_mm_cmpeq_epi8(v1, v2))) ^ 0xFFFF) |
+			zero_mask(v1);
+		if (mask != 0)
+		{
+			const int index = rde::internal::lowest_bit_index(mask);
+			result = compare_chars(s1[index], s2[index]);
+			return true;
+		}
+		s1 += 16;
+		s2 += 16;
+		return false;
+	}
+	for (int i = 0; i < 16; ++i, ++s1, ++s2)
+	{
+		if (*s1 != *s2 || *s1 == 0)
+		{
+			result = compare_chars(*s1, *s2);
+			return true;
+		}
+	}
+	return false;
+}
+RDESTL_NO_SANITIZE_ADDRESS int strcompare_sse2(const char* s1, const char* s2)
+{
+	int result(0);
+	while (!strcompare_step16(s1, s2, result))
+	{
+		/**/
+	}
+	return result;
+}
+RDESTL_NO_SANITIZE_ADDRESS RDESTL_TARGET_AVX2 int strcompare_avx2(const char* s1, const char* s2)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	int result(0);
+	for (;;)
+	{
+		if (can_load<32>(s1) && can_load<32>(s2))
+		{
+			const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s1));
+			const __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s2));
+			const rde::uint32 mask = ~rde::uint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, v2))) |
+				rde::uint32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, zero)));
+			if (mask != 0)
+			{
+				const int index = rde::internal::lowest_bit_index(mask);
+				return compare_chars(s1[index], s2[index]);
+			}
+			s1 += 32;
+			s2 += 32;
+		}
+		else if (strcompare_step16(s1, s2, result))
+		{
+			return result;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Candidates are positions where both first and last character match,
+// only those are compared fully. Loads stay within string (+terminator).
+// @pre	subLen >= 2, subLen <= len
+int find_substring_sse2_from(const char* s, int len, const char* sub, int subLen, int i)
+{
+	const __m128i first = _mm_set1_epi8(sub[0]);
+	const __m128i last = _mm_set1_epi8(sub[subLen - 1]);
+	for (/**/; i + subLen - 1 + 16 <= len + 1; i += 16)
+	{
+		const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+		const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + subLen - 1));
+		rde::uint32 mask = rde::uint32(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(v1, first),
+			_mm_cmpeq_epi8(v2, last))));
+		while (mask != 0)
+		{
+			const int index = i + rde::internal::lowest_bit_index(mask);
+			if (rde::strcompare(s + index + 1, sub + 1, subLen - 2) == 0)
+				return index;
+			mask &= mask - 1;
+		}
+	}
+	for (/**/; i + subLen <= len; ++i)
+	{
+		if (rde::strcompare(s + i, sub, subLen) == 0)
+			return i;
+	}
+	return -1;
+}
+int find_substring_sse2(const char* s, int len, const char* sub, int subLen)
+{
+	return find_substring_sse2_from(s, len, sub, subLen, 0);
+}
+RDESTL_TARGET_AVX2 int find_substring_avx2(const char* s, int len, const char* sub, int subLen)
+{
+	const __m256i first = _mm256_set1_epi8(sub[0]);
+	const __m256i last = _mm256_set1_epi8(sub[subLen - 1]);
+	int i(0);
+	for (/**/; i + subLen - 1 + 32 <= len + 1; i += 32)
+	{
+		const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+		const __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i + subLen - 1));
+		rde::uint32 mask = rde::uint32(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(v1, first),
+			_mm256_cmpeq_epi8(v2, last))));
+		while (mask != 0)
+		{
+			const int index = i + rde::internal::lowest_bit_index(mask);
+			if (rde::strcompare(s + index + 1, sub + 1, subLen - 2) == 0)
+				return index;
+			mask &= mask - 1;
+		}
+	}
+	return find_substring_sse2_from(s, len, sub, subLen, i);
+}
+
+//-----------------------------------------------------------------------------
+// Resolved on first call. Pointers are constant-initialized, so it's fine
+// to use them during static initialization, races only do the same work twice.
+int strlen_resolve(const char* str);
+int find_index_of_resolve(const char* str, char ch);
+int strcompare_len_resolve(const char* s1, const char* s2, size_t len);
+int strcompare_resolve(const char* s1, const char* s2);
+int find_substring_resolve(const char* s, int len, const char* sub, int subLen);
+strlen_func			s_strlen			= strlen_resolve;
+find_index_of_func	s_find_index_of		= find_index_of_resolve;
+strcompare_len_func	s_strcompare_len	= strcompare_len_resolve;
+strcompare_func		s_strcompare		= strcompare_resolve;
+find_substring_func	s_find_substring	= find_substring_resolve;
+
+void resolve_functions()
+{
+	const bool avx2 = cpu_has_avx2();
+	s_strlen = (avx2 ? strlen_avx2 : strlen_sse2);
+	s_find_index_of = (avx2 ? find_index_of_avx2 : find_index_of_sse2);
+	s_strcompare_len = (avx2 ? strcompare_len_avx2 : strcompare_len_sse2);
+	s_strcompare = (avx2 ? strcompare_avx2 : strcompare_sse2);
+	s_find_substring = (avx2 ? find_substring_avx2 : find_substring_sse2);
+}
+int strlen_resolve(const char* str)
+{
+	resolve_functions();
+	return s_strlen(str);
+}
+int find_index_of_resolve(const char* str, char ch)
+{
+	resolve_functions();
+	return s_find_index_of(str, ch);
+}
+int strcompare_len_resolve(const char* s1, const char* s2, size_t len)
+{
+	resolve_functions();
+	return s_strcompare_len(s1, s2, len);
+}
+int strcompare_resolve(const char* s1, const char* s2)
+{
+	resolve_functions();
+	return s_strcompare(s1, s2);
+}
+int find_substring_resolve(const char* s, int len, const char* sub, int subLen)
+{
+	resolve_functions();
+	return s_find_substring(s, len, sub, subLen);
+}
+} // namespace
+
+namespace rde
+{
+RDESTL_NO_SANITIZE_ADDRESS int strlen(const char* str)
+{
+	// Aligned loads never cross page boundary. Bits for bytes before
+	// the string are shifted out.
+	const int misalignment = int(size_t(str) & 15);
+	const char* p = str - misalignment;
+	const uint32 mask = zero_mask(_mm_load_si128(reinterpret_cast<const __m128i*>(p))) >> misalignment;
+	if (mask != 0)
+		return internal::lowest_bit_index(mask);
+	p += 16;
+	return int(p - str) + s_strlen(p);
+}
+
+RDESTL_NO_SANITIZE_ADDRESS int find_index_of(const char* s, char ch)
+{
+	// Generic version never matches the terminator.
+	if (ch == 0)
+		return -1;
+	const int misalignment = int(size_t(s) & 15);
+	const char* p = s - misalignment;
+	const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(p));
+	const uint32 mask = (zero_mask(v) | uint32(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(ch))))) >>
+		misalignment;
+	if (mask != 0)
+	{
+		// Either character or terminator found.
+		const int index = internal::lowest_bit_index(mask);
+		return s[index] == ch ? index : -1;
+	}
+	p += 16;
+	const int index = s_find_index_of(p, ch);
+	return index < 0 ? -1 : int(p - s) + index;
+}
+
+int strcompare(const char* s1, const char* s2, size_t len)
+{
+	return s_strcompare_len(s1, s2, len);
+}
+int strcompare(const char* s1, const char* s2)
+{
+	return s_strcompare(s1, s2);
+}
+
+int find_substring(const char* s, const char* sub)
+{
+	const int subLen = strlen(sub);
+	if (subLen < 2)
+		return subLen == 0 ? 0 : find_index_of(s, sub[0]);
+	const int len = strlen(s);
+	if (subLen > len)
+		return -1;
+	return s_find_substring(s, len, sub, subLen);
+}
+
+} // rde
+
+#endif // RDESTL_STRING_UTILS_SSE2
@@ -1,6 +1,16 @@
 #ifndef RDESTL_STRING_UTILS_H
 #define RDESTL_STRING_UTILS_H
 
+#include "rdestl/bit_utils.h"
+
+#ifndef RDESTL_STRING_UTILS_SSE2
+#	if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#		define RDESTL_STRING_UTILS_SSE2	1
+#	else
+#		define RDESTL_STRING_UTILS_SSE2	0
+#	endif
+#endif
+
 namespace rde
 {
 //-----------------------------------------------------------------------------
@@ -62,6 +72,31 @@ template<typename T> int find_index_of(const T* s, T ch)
 	return -1;
 }
 
+// Index of first occurence of 'sub' in 's', -1 if not found.
+template<typename T> int find_substring(const T* s, const T* sub)
+{
+	const int subLen = strlen(sub);
+	for (int i = 0; s[i]; ++i)
+	{
+		if (strcompare(s + i, sub, subLen) == 0)
+			return i;
+	}
+	return subLen == 0 ? 0 : -1;
+}
+
+#if RDESTL_STRING_UTILS_SSE2
+// Overloads for char strings, test 16 (SSE2) or 32 (AVX2, if CPU supports
+// it) characters at once, see string_utils.cpp.
+// They read past the terminator (never past the page), so they're kept
+// out of line, compiler would complain about reading past the end of
+// literals/arrays otherwise (-Warray-bounds).
+int strlen(const char* str);
+int strcompare(const char* s1, const char* s2, size_t len);
+int strcompare(const char* s1, const char* s2);
+int find_index_of(const char* s, char ch);
+int find_substring(const char* s, const char* sub);
+#endif // RDESTL_STRING_UTILS_SSE2
+
 } // rde
 
 #endif // RDESTL_STRING_UTILS_H
@@ -2,8 +2,8 @@
 #define RDESTL_TERNARY_SEARCH_TREE_H
 
 #include "rdestl/allocator.h"
+#include "rdestl/node_pool.h"
 #include "rdestl/pair.h"
-#include "rdestl/vector.h"
 
 namespace rde
 {
@@ -34,12 +34,9 @@ public:
 	static const int			kMaxPoolElements = 1000;
 
 	explicit ternary_search_tree(const allocator_type& allocator = allocator_type())
-	:	m_allocator(allocator),
-		m_count(0),
+	:	m_count(0),
 		m_root(0),
-		m_numNodes(0),
-		m_nodePools(allocator),
-		m_numFreePoolElements(-1)
+		m_nodePool(kNodeSize, kMaxPoolElements, allocator)
 	{
 		/**/
 	}
@@ -123,35 +120,21 @@ public:
 		(void)n;
 		n->~node();
 	}
-	size_t used_memory() const	{ return m_numNodes * kNodeSize; }
+	size_t used_memory() const	{ return m_nodePool.get_num_nodes() * kNodeSize; }
 
 	bool empty() const		{ return m_count == 0; }
 	size_type size() const	{ return m_count; }
 
 private:
+	// Nodes are never freed one by one, chunks are released with the tree.
 	node* alloc_node_mem()
 	{
-		if (m_numFreePoolElements < 0)
-			alloc_new_pool(kMaxPoolElements);
-		++m_numNodes;
-		return m_currentPool + m_numFreePoolElements--;
-	}
-	void alloc_new_pool(int pool_elements)
-	{
-		node* newPool = 
-			(node*)m_allocator.allocate(pool_elements * sizeof(node));
-		m_nodePools.push_back(newPool);
-		m_currentPool = newPool;
-		m_numFreePoolElements = kMaxPoolElements - 1;
+		return static_cast<node*>(m_nodePool.allocate());
 	}
 
-	allocator_type		m_allocator;
-	size_type			m_count;
-	node*				m_root;
-	size_type			m_numNodes;
-	rde::vector<node*>	m_nodePools;
-	node*				m_currentPool;
-	int					m_numFreePoolElements;
+	size_type				m_count;
+	node*					m_root;
+	node_pool<TAllocator>	m_nodePool;
 };
 
 }
@@ -0,0 +1,334 @@
+#include "reflection/DeepClone.h"
+#include "reflection/TypeClass.h"
+#include "reflection/TypeRegistry.h"
+#include "reflection/ValueKind.h"
+#include "rdestl/flat_hash_map.h"
+#include "rdestl/sort.h"
+#include "rdestl/vector.h"
+#include "core/System.h"
+
+namespace
+{
+// Bytes [first, first + second) are written by pointer/vector operation,
+// not copied.
+typedef rde::pair<rde::uint32, rde::uint32>	Slot;
+typedef rde::vector<Slot>					Slots;
+struct SlotLess
+{
+	bool operator()(const Slot& lhs, const Slot& rhs) const
+	{
+		return lhs.first < rhs.first;
+	}
+};
+
+void* AllocateWithNew(size_t bytes, void*)
+{
+	return operator new(bytes);
+}
+}
+
+namespace rde
+{
+struct DeepCloner::Impl
+{
+	static const uint32 NO_OFFSET = 0xFFFFFFFF;
+
+	struct Plan;
+	struct Op
+	{
+		enum Kind
+		{
+			COPY,
+			POINTER,
+			VECTOR
+		};
+		Op(Kind kind_, uint32 offset_, uint32 size_, const Plan* plan_ = 0, uint32 capacityOffset_ = NO_OFFSET)
+		:	kind(kind_),
+			offset(offset_),
+			size(size_),
+			capacityOffset(capacityOffset_),
+			plan(plan_)
+		{
+		}
+
+		Kind		kind;
+		// COPY: first byte, POINTER: pointer, VECTOR: begin pointer.
+		uint32		offset;
+		// COPY: number of bytes, VECTOR: end pointer offset.
+		uint32		size;
+		// VECTOR only, NO_OFFSET if capacity is not reflected.
+		uint32		capacityOffset;
+		// POINTER: pointed type, VECTOR: element type.
+		const Plan*	plan;
+	};
+	typedef rde::vector<Op>	Ops;
+
+	struct Plan
+	{
+		Plan(): vtableClass(0), size(0) {}
+
+		// True if type can be copied with single memcpy.
+		bool IsPlainData() const
+		{
+			return ops.size() == 1 && ops[0].kind == Op::COPY && ops[0].size == size;
+		}
+
+		// Set for objects that are allocated by cloner (as opposed to embedded
+		// ones/vector elements), if class needs vtable.
+		const TypeClass*	vtableClass;
+		uint32				size;
+		Ops					ops;
+	};
+	typedef rde::flat_hash_map<const Type*, Plan*>	Plans;
+
+	// Object allocated, but not copied yet.
+	struct PendingObject
+	{
+		void*		dst;
+		const void*	src;
+		const Plan*	plan;
+	};
+	typedef rde::vector<PendingObject>							PendingObjects;
+	// Source -> cloned object.
+	typedef rde::flat_hash_map<const void*, void*>	ClonedObjects;
+
+	Impl(const TypeRegistry& typeRegistry, FnAllocate pfnAllocate, void* userData)
+	:	m_typeRegistry(typeRegistry),
+		m_pfnAllocate(pfnAllocate ? pfnAllocate : AllocateWithNew),
+		m_userData(userData)
+	{
+	}
+	~Impl()
+	{
+		DeletePlans(m_plans);
+		DeletePlans(m_objectPlans);
+	}
+
+	void* Clone(const void* object, const TypeClass* type)
+	{
+		if (object == 0)
+			return 0;
+		RDE_ASSERT(type != 0);
+		void* clone = CloneObject(object, GetPlan(type, true));
+		while (!m_pending.empty())
+		{
+			const PendingObject pending = m_pending.back();
+			m_pending.pop_back();
+			Run(*pending.plan, static_cast<uint8*>(pending.dst), static_cast<const uint8*>(pending.src));
+		}
+		m_clonedObjects.clear();
+		return clone;
+	}
+
+	// Allocates clone, contents are copied later (no recursion, so long
+	// lists don't blow up the stack).
+	void* CloneObject(const void* src, const Plan* plan)
+	{
+		ClonedObjects::iterator it = m_clonedObjects.find(src);
+		if (it != m_clonedObjects.end())
+			return it->second;
+
+		void* dst = m_pfnAllocate(plan->size, m_userData);
+		m_clonedObjects.insert(rde::make_pair(src, dst));
+		if (plan->vtableClass)
+			plan->vtableClass->InitVTable(dst);
+		const PendingObject pending = { dst, src, plan };
+		m_pending.push_back(pending);
+		return dst;
+	}
+
+	void Run(const Plan& plan, uint8* dst, const uint8* src)
+	{
+		for (Ops::const_iterator it = plan.ops.begin(); it != plan.ops.end(); ++it)
+		{
+			switch (it->kind)
+			{
+			case Op::COPY:
+				Sys::MemCpy(dst + it->offset, src + it->offset, it->size);
+				break;
+			case Op::POINTER:
+				{
+					const void* pointed = *reinterpret_cast<void* const*>(src + it->offset);
+					*reinterpret_cast<void**>(dst + it->offset) = (pointed ? CloneObject(pointed, it->plan) : 0);
+				}
+				break;
+			case Op::VECTOR:
+				CloneVector(*it, dst, src);
+				break;
+			}
+		}
+	}
+
+	void CloneVector(const Op& op, uint8* dst, const uint8* src)
+	{
+		const uint8* srcBegin = *reinterpret_cast<uint8* const*>(src + op.offset);
+		const uint8* srcEnd = *reinterpret_cast<uint8* const*>(src + op.size);
+		const size_t numBytes = size_t(srcEnd - srcBegin);
+		uint8* dstBegin(0);
+		if (numBytes != 0)
+		{
+			const Plan& elementPlan = *op.plan;
+			RDE_ASSERT(numBytes % elementPlan.size == 0);
+			dstBegin = static_cast<uint8*>(operator new(numBytes));
+			if (elementPlan.IsPlainData())
+			{
+				Sys::MemCpy(dstBegin, srcBegin, numBytes);
+			}
+			else
+			{
+				for (size_t i = 0; i < numBytes; i += elementPlan.size)
+					Run(elementPlan, dstBegin + i, srcBegin + i);
+			}
+		}
+		*reinterpret_cast<uint8**>(dst + op.offset) = dstBegin;
+		*reinterpret_cast<uint8**>(dst + op.size) = dstBegin + numBytes;
+		if (op.capacityOffset != NO_OFFSET)
+			*reinterpret_cast<base_vector::size_type*>(dst + op.capacityOffset) = base_vector::size_type(numBytes / op.plan->size);
+	}
+
+	// Separate plans for objects allocated by cloner, if they need to have
+	// vtable initialized (vtable pointer is not copied then).
+	const Plan* GetPlan(const Type* type, bool allocatedObject)
+	{
+		const TypeClass* tc = ReflectionTypeCast<TypeClass>(type);
+		const bool initVTable = (allocatedObject && tc != 0 && tc->HasVTable());
+		Plans& plans = (initVTable ? m_objectPlans : m_plans);
+		Plans::iterator it = plans.find(type);
+		if (it != plans.end())
+			return it->second;
+
+		// Registered before compiling, pointers to the type being compiled
+		// (linked lists etc) will find it.
+		Plan* plan = new Plan();
+		plan->size = type->m_size;
+		plan->vtableClass = (initVTable ? tc : 0);
+		plans.insert(rde::make_pair(type, plan));
+
+		Slots slots;
+		if (initVTable)
+			slots.push_back(Slot(0, sizeof(void*)));
+		Ops ops;
+		Compile(ops, slots, type, 0);
+		AddCopySpans(plan->ops, slots, plan->size);
+		for (Ops::const_iterator opIt = ops.begin(); opIt != ops.end(); ++opIt)
+			plan->ops.push_back(*opIt);
+		return plan;
+	}
+
+	// Pointer/vector operations for type placed at given offset, fields are flattened.
+	void Compile(Ops& ops, Slots& slots, const Type* type, uint32 offset)
+	{
+		if (type->m_reflectionType == ReflectionType::POINTER)
+		{
+			const TypePointer* tp = static_cast<const TypePointer*>(type);
+			const Type* pointedType = m_typeRegistry.FindType(tp->m_pointedTypeId);
+			// Unknown types are not followed, pointer is copied.
+			if (pointedType == 0)
+				return;
+			ops.push_back(Op(Op::POINTER, offset, sizeof(void*), GetPlan(pointedType, true)));
+			slots.push_back(Slot(offset, sizeof(void*)));
+		}
+		else if (type->m_reflectionType == ReflectionType::ARRAY)
+		{
+			const TypeArray* ta = static_cast<const TypeArray*>(type);
+			const Type* containedType = m_typeRegistry.FindType(ta->m_containedTypeId);
+			if (containedType == 0 || GetPlan(containedType, false)->IsPlainData())
+				return;
+			for (long i = 0; i < ta->m_numElements; ++i)
+				Compile(ops, slots, containedType, offset + i * containedType->m_size);
+		}
+		else if (type->m_reflectionType == ReflectionType::CLASS)
+		{
+			const TypeClass* tc = static_cast<const TypeClass*>(type);
+			if (tc->IsVector())
+			{
+				CompileVector(ops, slots, tc, offset);
+				return;
+			}
+			const int numFields = tc->GetNumFields();
+			for (int i = 0; i < numFields; ++i)
+			{
+				const Field* field = tc->GetField(i);
+				Compile(ops, slots, field->m_type, offset + tc->CalcOffsetFrom(field->m_ownerClass) + field->m_offset);
+			}
+		}
+	}
+	void CompileVector(Ops& ops, Slots& slots, const TypeClass* tc, uint32 offset)
+	{
+		const Field* fieldBegin = tc->GetField(0);
+		const TypePointer* tp = SafeReflectionCast<TypePointer>(fieldBegin->m_type);
+		const Type* elementType = m_typeRegistry.FindType(tp->m_pointedTypeId);
+		RDE_ASSERT(elementType != 0 && elementType->m_size != 0);
+
+		const VectorLayout layout = GetVectorLayout(tc);
+		const uint32 beginOffset = offset + layout.beginOffset;
+		const uint32 endOffset = offset + layout.endOffset;
+		uint32 capacityOffset(NO_OFFSET);
+		if (layout.capacityOffset != VectorLayout::NO_OFFSET)
+		{
+			capacityOffset = offset + layout.capacityOffset;
+			slots.push_back(Slot(capacityOffset, sizeof(base_vector::size_type)));
+		}
+		ops.push_back(Op(Op::VECTOR, beginOffset, endOffset, GetPlan(elementType, false), capacityOffset));
+		slots.push_back(Slot(beginOffset, sizeof(void*)));
+		slots.push_back(Slot(endOffset, sizeof(void*)));
+	}
+
+	// Everything that's not in slots is copied, including padding and bytes
+	// reflection doesn't know about.
+	static void AddCopySpans(Ops& ops, Slots& slots, uint32 size)
+	{
+		rde::quick_sort(slots.begin(), slots.end(), SlotLess());
+		uint32 spanStart(0);
+		for (Slots::const_iterator it = slots.begin(); it != slots.end(); ++it)
+		{
+			RDE_ASSERT(it->first >= spanStart && "Overlapping fields");
+			if (it->first > spanStart)
+				ops.push_back(Op(Op::COPY, spanStart, it->first - spanStart));
+			spanStart = it->first + it->second;
+		}
+		if (size > spanStart)
+			ops.push_back(Op(Op::COPY, spanStart, size - spanStart));
+	}
+
+	static void DeletePlans(Plans& plans)
+	{
+		for (Plans::iterator it = plans.begin(); it != plans.end(); ++it)
+			delete it->second;
+		plans.clear();
+	}
+
+	const TypeRegistry&	m_typeRegistry;
+	FnAllocate			m_pfnAllocate;
+	void*				m_userData;
+	Plans				m_plans;
+	Plans				m_objectPlans;
+	PendingObjects		m_pending;
+	ClonedObjects		m_clonedObjects;
+};
+
+DeepCloner::DeepCloner(const TypeRegistry& typeRegistry, FnAllocate pfnAllocate, void* userData)
+:	m_impl(new Impl(typeRegistry, pfnAllocate, userData))
+{
+}
+DeepCloner::~DeepCloner()
+{
+}
+
+void* DeepCloner::Clone(const void* object, const TypeClass* type)
+{
+	return m_impl->Clone(object, type);
+}
+
+int DeepCloner::GetNumPlans() const
+{
+	return m_impl->m_plans.size() + m_impl->m_objectPlans.size();
+}
+
+void* DeepClone(const void* object, const TypeClass* type, const TypeRegistry& typeRegistry)
+{
+	DeepCloner cloner(typeRegistry);
+	return cloner.Clone(object, type);
+}
+
+} // rde
@@ -0,0 +1,58 @@
+#ifndef DEEP_CLONE_H
+#define DEEP_CLONE_H
+
+#include "core/ScopedPtr.h"
+#include "reflection/Type.h"
+
+namespace rde
+{
+class TypeClass;
+
+// Reflection driven deep copy of object graphs.
+// Every type is compiled (once, on first use) into flat program: memcpy of
+// plain data spans (adjacent fields merged), pointer follows and rde::vector
+// copies. Cloning just runs that, no field enumeration or type lookups.
+// Rules:
+//	- objects reachable through pointers are cloned as well, every one only
+//	  once (shared references and cycles are preserved),
+//	- pointed objects are assumed to be of pointed (static) type,
+//	- pointers to types that are not registered are copied as they are,
+//	- new objects are NOT constructed, only vtable is initialized (InitVTable),
+//	- rde::vector storage is allocated with operator new (as rde::allocator does),
+//	  new vector has capacity == size.
+class DeepCloner
+{
+public:
+	// Allocates memory for new objects (not vector storage).
+	typedef void* (*FnAllocate)(size_t bytes, void* userData);
+
+	// Default allocation is operator new.
+	explicit DeepCloner(const TypeRegistry& typeRegistry, FnAllocate pfnAllocate = 0,
+		void* userData = 0);
+	~DeepCloner();
+
+	// Returns copy of object (NULL if object is NULL).
+	void* Clone(const void* object, const TypeClass* type);
+	template<typename T>
+	T* Clone(const T* object, const TypeClass* type)
+	{
+		return static_cast<T*>(Clone(static_cast<const void*>(object), type));
+	}
+
+	// Number of types compiled so far.
+	int GetNumPlans() const;
+
+private:
+	RDE_FORBID_COPY(DeepCloner);
+
+	struct Impl;
+	ScopedPtr<Impl>	m_impl;
+};
+
+// One-shot version, compiles all needed types again for every call.
+// Use DeepCloner for cloning many objects.
+void* DeepClone(const void* object, const TypeClass* type, const TypeRegistry& typeRegistry);
+
+} // rde
+
+#endif
@@ -0,0 +1,659 @@
+#include "reflection/DeltaEncoder.h"
+#include "reflection/TypeClass.h"
+#include "reflection/TypeRegistry.h"
+#include "reflection/ValueKind.h"
+#include "rdestl/flat_hash_map.h"
+#include "rdestl/vector.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#	define RDE_DELTA_ENCODER_SSE2	1
+#	include <emmintrin.h>
+#else
+#	define RDE_DELTA_ENCODER_SSE2	0
+#endif
+
+namespace
+{
+// Bit N of diff[i] set if byte i * 16 + N differs.
+// @return true if any byte differs.
+bool ComputeDiff(const rde::uint8* a, const rde::uint8* b, rde::uint32 bytes, rde::uint16* diff)
+{
+	rde::uint32 anyDiff(0);
+	rde::uint32 i(0);
+#if RDE_DELTA_ENCODER_SSE2
+	for (; i + 16 <= bytes; i += 16)
+	{
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+		const rde::uint32 mask = ~rde::uint32(_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb))) & 0xFFFF;
+		diff[i >> 4] = rde::uint16(mask);
+		anyDiff |= mask;
+	}
+#endif
+	for (; i < bytes; i += 16)
+	{
+		rde::uint32 mask(0);
+		const rde::uint32 n = (bytes - i < 16 ? bytes - i : 16);
+		for (rde::uint32 j = 0; j < n; ++j)
+		{
+			if (a[i + j] != b[i + j])
+				mask |= 1 << j;
+		}
+		diff[i >> 4] = rde::uint16(mask);
+		anyDiff |= mask;
+	}
+	return anyDiff != 0;
+}
+// Bits of given 16-byte chunk covered by [offset, end).
+rde::uint32 ChunkRangeMask(rde::uint32 chunk, rde::uint32 offset, rde::uint32 end)
+{
+	const rde::uint32 chunkStart = chunk << 4;
+	if (end <= chunkStart || offset >= chunkStart + 16)
+		return 0;
+	const rde::uint32 lo = (offset > chunkStart ? offset - chunkStart : 0);
+	const rde::uint32 hi = (end - chunkStart < 16 ? end - chunkStart : 16);
+	return ((1 << hi) - 1) & ~((1 << lo) - 1);
+}
+bool RangeDiffers(const rde::uint16* diff, rde::uint32 offset, rde::uint32 bytes)
+{
+	const rde::uint32 end = offset + bytes;
+	for (rde::uint32 chunk = offset >> 4; chunk <= ((end - 1) >> 4); ++chunk)
+	{
+		if ((diff[chunk] & ChunkRangeMask(chunk, offset, end)) != 0)
+			return true;
+	}
+	return false;
+}
+
+rde::uint32 NumBitsNeeded(rde::uint32 x)
+{
+	rde::uint32 bits(0);
+	while (x != 0)
+	{
+		++bits;
+		x >>= 1;
+	}
+	return bits;
+}
+inline rde::uint32 MaxCode(rde::uint32 bits)
+{
+	return bits >= 32 ? 0xFFFFFFFF : (rde::uint32(1) << bits) - 1;
+}
+
+// LSB first. Caller makes sure there's enough space/data.
+class BitWriter
+{
+public:
+	explicit BitWriter(rde::uint8* data)
+	:	m_data(data),
+		m_scratch(0),
+		m_scratchBits(0)
+	{
+	}
+	// @pre value < 2^bits, bits <= 32
+	void Write(rde::uint32 value, rde::uint32 bits)
+	{
+		m_scratch |= rde::uint64(value) << m_scratchBits;
+		m_scratchBits += bits;
+		while (m_scratchBits >= 8)
+		{
+			*m_data++ = rde::uint8(m_scratch);
+			m_scratch >>= 8;
+			m_scratchBits -= 8;
+		}
+	}
+	void WriteBytes(const rde::uint8* bytes, rde::uint32 numBytes)
+	{
+		for (; numBytes >= 4; numBytes -= 4, bytes += 4)
+		{
+			rde::uint32 k;
+			memcpy(&k, bytes, sizeof(k));
+			Write(k, 32);
+		}
+		for (; numBytes != 0; --numBytes)
+			Write(*bytes++, 8);
+	}
+	void Flush()
+	{
+		if (m_scratchBits != 0)
+			Write(0, 8 - m_scratchBits);
+	}
+
+private:
+	rde::uint8*	m_data;
+	rde::uint64	m_scratch;
+	rde::uint32	m_scratchBits;
+};
+class BitReader
+{
+public:
+	explicit BitReader(const rde::uint8* data)
+	:	m_data(data),
+		m_scratch(0),
+		m_scratchBits(0)
+	{
+	}
+	// @pre bits <= 32
+	rde::uint32 Read(rde::uint32 bits)
+	{
+		while (m_scratchBits < bits)
+		{
+			m_scratch |= rde::uint64(*m_data++) << m_scratchBits;
+			m_scratchBits += 8;
+		}
+		const rde::uint32 value = rde::uint32(m_scratch & MaxCode(bits));
+		m_scratch >>= bits;
+		m_scratchBits -= bits;
+		return value;
+	}
+	void ReadBytes(rde::uint8* bytes, rde::uint32 numBytes)
+	{
+		for (; numBytes >= 4; numBytes -= 4, bytes += 4)
+		{
+			const rde::uint32 k = Read(32);
+			memcpy(bytes, &k, sizeof(k));
+		}
+		for (; numBytes != 0; --numBytes)
+			*bytes++ = rde::uint8(Read(8));
+	}
+
+private:
+	const rde::uint8*	m_data;
+	rde::uint64			m_scratch;
+	rde::uint32			m_scratchBits;
+};
+
+rde::int64 LoadInt(const rde::uint8* data, rde::uint32 size, bool isSigned)
+{
+	switch (size)
+	{
+	case 1:
+		return isSigned ? rde::int64(*reinterpret_cast<const rde::int8*>(data)) : rde::int64(*data);
+	case 2:
+		return isSigned ? rde::int64(*reinterpret_cast<const rde::int16*>(data)) :
+			rde::int64(*reinterpret_cast<const rde::uint16*>(data));
+	default:
+		RDE_ASSERT(size == 4);
+		return isSigned ? rde::int64(*reinterpret_cast<const rde::int32*>(data)) :
+			rde::int64(*reinterpret_cast<const rde::uint32*>(data));
+	}
+}
+void StoreInt(rde::uint8* data, rde::uint32 size, rde::int64 value)
+{
+	switch (size)
+	{
+	case 1:
+		*data = rde::uint8(value);
+		break;
+	case 2:
+		*reinterpret_cast<rde::uint16*>(data) = rde::uint16(value);
+		break;
+	default:
+		RDE_ASSERT(size == 4);
+		*reinterpret_cast<rde::uint32*>(data) = rde::uint32(value);
+		break;
+	}
+}
+}
+
+namespace rde
+{
+struct DeltaEncoder::Impl
+{
+	struct Op
+	{
+		enum Kind
+		{
+			RAW,
+			QUANTIZED_FLOAT,
+			QUANTIZED_DOUBLE,
+			BOUNDED_INT
+		};
+		Op(Kind kind_, uint32 offset_, uint32 size_)
+		:	kind(kind_),
+			offset(offset_),
+			size(size_),
+			bits(kind_ == RAW ? size_ * 8 : 0),
+			maxCode(0),
+			isSigned(false),
+			minValue(0.0),
+			maxValue(0.0),
+			scale(0.0),
+			invScale(0.0),
+			minInt(0),
+			maxInt(0)
+		{
+		}
+
+		Kind	kind;
+		uint32	offset;
+		// RAW: number of bytes (adjacent fields merged), others: size of value.
+		uint32	size;
+		uint32	bits;
+		uint32	maxCode;
+		bool	isSigned;
+		// QUANTIZED_*: code = (value - minValue) * scale
+		double	minValue;
+		double	maxValue;
+		double	scale;
+		double	invScale;
+		// BOUNDED_INT: code = value - minInt
+		int64	minInt;
+		int64	maxInt;
+	};
+	typedef rde::vector<Op>	Ops;
+
+	struct FieldEntry
+	{
+		uint32	firstOp;
+		uint32	numOps;
+		uint32	bits;
+		// Bytes covered by field: chunkMasks[firstMask + i] for diff chunk
+		// firstChunk + i.
+		uint32	firstChunk;
+		uint32	numChunks;
+		uint32	firstMask;
+		// True if field changed whenever its bytes did (nothing quantized).
+		bool	exact;
+	};
+	typedef rde::vector<FieldEntry>	FieldEntries;
+
+	struct Plan
+	{
+		Plan(): size(0), fieldBits(0) {}
+
+		uint32			size;
+		// Sum of bits of all fields.
+		uint32			fieldBits;
+		Ops					ops;
+		FieldEntries		fields;
+		rde::vector<uint16>	chunkMasks;
+	};
+	typedef rde::flat_hash_map<const TypeClass*, Plan*>	Plans;
+
+	Impl(const TypeRegistry& typeRegistry, int quantizationBits)
+	:	m_typeRegistry(typeRegistry),
+		m_quantizationBits(uint32(quantizationBits))
+	{
+		RDE_ASSERT(quantizationBits > 0 && quantizationBits <= 32);
+	}
+	~Impl()
+	{
+		for (Plans::iterator it = m_plans.begin(); it != m_plans.end(); ++it)
+			delete it->second;
+	}
+
+	uint32 Encode(const void* baseline, const void* current, const TypeClass* type,
+		uint8* buffer, uint32 bufferSize)
+	{
+		RDE_ASSERT(current != 0);
+		const Plan* plan = GetPlan(type);
+		const uint8* objectBase = static_cast<const uint8*>(baseline);
+		const uint8* object = static_cast<const uint8*>(current);
+		const uint32 numFields = plan->fields.size();
+
+		m_changedMask.clear();
+		m_changedMask.resize((numFields + 31) >> 5);
+		uint32 bits(1);
+		if (objectBase == 0)
+		{
+			for (uint32 i = 0; i < numFields; ++i)
+				m_changedMask[i >> 5] |= uint32(1) << (i & 31);
+			bits += numFields + plan->fieldBits;
+		}
+		else
+		{
+			m_diff.resize((plan->size + 15) >> 4);
+			if (ComputeDiff(objectBase, object, plan->size, m_diff.begin()))
+			{
+				for (uint32 i = 0; i < numFields; ++i)
+				{
+					if (FieldChanged(*plan, plan->fields[i], objectBase, object))
+					{
+						m_changedMask[i >> 5] |= uint32(1) << (i & 31);
+						bits += plan->fields[i].bits;
+					}
+				}
+				if (bits != 1)
+					bits += numFields;
+			}
+		}
+		const uint32 bytes = (bits + 7) >> 3;
+		if (bytes > bufferSize)
+			return 0;
+
+		BitWriter writer(buffer);
+		writer.Write(bits != 1 ? 1 : 0, 1);
+		if (bits != 1)
+		{
+			WriteMask(writer, numFields);
+			for (uint32 i = 0; i < numFields; ++i)
+			{
+				if (m_changedMask[i >> 5] & (uint32(1) << (i & 31)))
+					WriteField(writer, *plan, plan->fields[i], object);
+			}
+		}
+		writer.Flush();
+		return bytes;
+	}
+	bool FieldChanged(const Plan& plan, const FieldEntry& field, const uint8* objectBase,
+		const uint8* object) const
+	{
+		const uint16* diff = m_diff.begin() + field.firstChunk;
+		const uint16* masks = plan.chunkMasks.begin() + field.firstMask;
+		uint32 changedBytes(0);
+		for (uint32 i = 0; i < field.numChunks; ++i)
+			changedBytes |= diff[i] & masks[i];
+		if (changedBytes == 0)
+			return false;
+		if (field.exact)
+			return true;
+		for (uint32 i = 0; i < field.numOps; ++i)
+		{
+			const Op& op = plan.ops[field.firstOp + i];
+			if (!RangeDiffers(m_diff.begin(), op.offset, op.size))
+				continue;
+			// Changes below quantization step don't count.
+			if (op.kind == Op::RAW || Quantize(op, objectBase) != Quantize(op, object))
+				return true;
+		}
+		return false;
+	}
+	void WriteMask(BitWriter& writer, uint32 numFields) const
+	{
+		for (uint32 i = 0; i < numFields; i += 32)
+		{
+			const uint32 bits = (numFields - i < 32 ? numFields - i : 32);
+			writer.Write(m_changedMask[i >> 5], bits);
+		}
+	}
+	void WriteField(BitWriter& writer, const Plan& plan, const FieldEntry& field,
+		const uint8* object) const
+	{
+		for (uint32 i = 0; i < field.numOps; ++i)
+		{
+			const Op& op = plan.ops[field.firstOp + i];
+			if (op.kind == Op::RAW)
+				writer.WriteBytes(object + op.offset, op.size);
+			else
+				writer.Write(Quantize(op, object), op.bits);
+		}
+	}
+
+	uint32 Apply(void* object, const TypeClass* type, const uint8* data, uint32 dataSize)
+	{
+		RDE_ASSERT(object != 0);
+		if (dataSize == 0)
+			return 0;
+		const Plan* plan = GetPlan(type);
+		BitReader reader(data);
+		if (reader.Read(1) == 0)
+			return 1;
+
+		const uint32 numFields = plan->fields.size();
+		const uint32 availableBits = dataSize * 8;
+		uint32 bits = 1 + numFields;
+		if (bits > availableBits)
+			return 0;
+		m_changedMask.resize((numFields + 31) >> 5);
+		for (uint32 i = 0; i < numFields; i += 32)
+			m_changedMask[i >> 5] = reader.Read(numFields - i < 32 ? numFields - i : 32);
+		for (uint32 i = 0; i < numFields; ++i)
+		{
+			if (m_changedMask[i >> 5] & (uint32(1) << (i & 31)))
+				bits += plan->fields[i].bits;
+		}
+		if (bits > availableBits)
+			return 0;
+
+		uint8* dst = static_cast<uint8*>(object);
+		for (uint32 i = 0; i < numFields; ++i)
+		{
+			if (m_changedMask[i >> 5] & (uint32(1) << (i & 31)))
+				ReadField(reader, *plan, plan->fields[i], dst);
+		}
+		return (bits + 7) >> 3;
+	}
+	void ReadField(BitReader& reader, const Plan& plan, const FieldEntry& field, uint8* object) const
+	{
+		for (uint32 i = 0; i < field.numOps; ++i)
+		{
+			const Op& op = plan.ops[field.firstOp + i];
+			if (op.kind == Op::RAW)
+				reader.ReadBytes(object + op.offset, op.size);
+			else
+				Dequantize(op, reader.Read(op.bits), object);
+		}
+	}
+
+	static uint32 Quantize(const Op& op, const uint8* object)
+	{
+		const uint8* data = object + op.offset;
+		if (op.kind == Op::BOUNDED_INT)
+		{
+			int64 value = LoadInt(data, op.size, op.isSigned);
+			if (value < op.minInt)
+				value = op.minInt;
+			else if (value > op.maxInt)
+				value = op.maxInt;
+			return uint32(value - op.minInt);
+		}
+		const double value = (op.kind == Op::QUANTIZED_FLOAT ?
+			double(*reinterpret_cast<const float*>(data)) : *reinterpret_cast<const double*>(data));
+		// Written this way to send NaNs as minimum.
+		if (!(value > op.minValue))
+			return 0;
+		if (value >= op.maxValue)
+			return op.maxCode;
+		return uint32((value - op.minValue) * op.scale + 0.5);
+	}
+	static void Dequantize(const Op& op, uint32 code, uint8* object)
+	{
+		uint8* data = object + op.offset;
+		if (op.kind == Op::BOUNDED_INT)
+		{
+			StoreInt(data, op.size, op.minInt + int64(code));
+			return;
+		}
+		const double value = (code == op.maxCode ? op.maxValue : op.minValue + code * op.invScale);
+		if (op.kind == Op::QUANTIZED_FLOAT)
+			*reinterpret_cast<float*>(data) = float(value);
+		else
+			*reinterpret_cast<double*>(data) = value;
+	}
+
+	const Plan* GetPlan(const TypeClass* type)
+	{
+		Plans::iterator it = m_plans.find(type);
+		if (it != m_plans.end())
+			return it->second;
+
+		Plan* plan = new Plan();
+		plan->size = type->m_size;
+		m_plans.insert(rde::make_pair(type, plan));
+
+		// One entry per (serialized) field, nested classes/arrays are sent as a whole.
+		const int numFields = type->GetNumFields();
+		for (int i = 0; i < numFields; ++i)
+		{
+			const Field* field = type->GetField(i);
+			if (field->m_flags & FieldFlags::NO_SERIALIZE)
+				continue;
+			m_fieldOps.clear();
+			Compile(m_fieldOps, field->m_type, type->CalcOffsetFrom(field->m_ownerClass) + field->m_offset,
+				GetBounds(field, 0));
+			// Nothing to send (pointers only etc).
+			if (m_fieldOps.empty())
+				continue;
+			FieldEntry entry = { uint32(plan->ops.size()), uint32(m_fieldOps.size()), 0,
+				plan->size, 0, uint32(plan->chunkMasks.size()), true };
+			uint32 lastChunk(0);
+			for (Ops::const_iterator opIt = m_fieldOps.begin(); opIt != m_fieldOps.end(); ++opIt)
+			{
+				entry.bits += opIt->bits;
+				entry.exact &= (opIt->kind == Op::RAW);
+				if ((opIt->offset >> 4) < entry.firstChunk)
+					entry.firstChunk = opIt->offset >> 4;
+				if (((opIt->offset + opIt->size - 1) >> 4) > lastChunk)
+					lastChunk = (opIt->offset + opIt->size - 1) >> 4;
+				plan->ops.push_back(*opIt);
+			}
+			entry.numChunks = lastChunk - entry.firstChunk + 1;
+			for (uint32 chunk = entry.firstChunk; chunk <= lastChunk; ++chunk)
+			{
+				uint32 mask(0);
+				for (Ops::const_iterator opIt = m_fieldOps.begin(); opIt != m_fieldOps.end(); ++opIt)
+					mask |= ChunkRangeMask(chunk, opIt->offset, opIt->offset + opIt->size);
+				plan->chunkMasks.push_back(uint16(mask));
+			}
+			plan->fieldBits += entry.bits;
+			plan->fields.push_back(entry);
+		}
+		return plan;
+	}
+	static const FieldEditInfo* GetBounds(const Field* field, const FieldEditInfo* outerBounds)
+	{
+		return (field->m_flags & FieldFlags::BOUNDED) != 0 && field->m_editInfo != 0 ?
+			field->m_editInfo : outerBounds;
+	}
+
+	void Compile(Ops& ops, const Type* type, uint32 offset, const FieldEditInfo* bounds)
+	{
+		switch (type->m_reflectionType)
+		{
+		case ReflectionType::FUNDAMENTAL:
+			if (bounds == 0 || !CompileBounded(ops, type, offset, *bounds))
+				AddRaw(ops, offset, type->m_size);
+			break;
+		case ReflectionType::POINTER:
+			// Addresses are meaningless on the other side.
+			break;
+		case ReflectionType::ARRAY:
+			{
+				const TypeArray* ta = static_cast<const TypeArray*>(type);
+				const Type* containedType = m_typeRegistry.FindType(ta->m_containedTypeId);
+				if (containedType == 0)
+				{
+					AddRaw(ops, offset, type->m_size);
+					break;
+				}
+				for (long i = 0; i < ta->m_numElements; ++i)
+					Compile(ops, containedType, offset + i * containedType->m_size, bounds);
+			}
+			break;
+		case ReflectionType::CLASS:
+			{
+				const TypeClass* tc = static_cast<const TypeClass*>(type);
+				if (tc->IsVector())
+					break;
+				const int numFields = tc->GetNumFields();
+				for (int i = 0; i < numFields; ++i)
+				{
+					const Field* field = tc->GetField(i);
+					if ((field->m_flags & FieldFlags::NO_SERIALIZE) == 0)
+					{
+						Compile(ops, field->m_type,
+							offset + tc->CalcOffsetFrom(field->m_ownerClass) + field->m_offset,
+							GetBounds(field, bounds));
+					}
+				}
+			}
+			break;
+		default:
+			AddRaw(ops, offset, type->m_size);
+			break;
+		}
+	}
+	static void AddRaw(Ops& ops, uint32 offset, uint32 size)
+	{
+		if (!ops.empty())
+		{
+			Op& last = ops.back();
+			if (last.kind == Op::RAW && last.offset + last.size == offset)
+			{
+				last.size += size;
+				last.bits += size * 8;
+				return;
+			}
+		}
+		ops.push_back(Op(Op::RAW, offset, size));
+	}
+	// @return false if value has to be sent as it is.
+	bool CompileBounded(Ops& ops, const Type* type, uint32 offset, const FieldEditInfo& bounds)
+	{
+		if (type == TypeOf<float>() || type == TypeOf<double>())
+		{
+			if (!(bounds.m_limitMax > bounds.m_limitMin))
+				return false;
+			Op op(type == TypeOf<float>() ? Op::QUANTIZED_FLOAT : Op::QUANTIZED_DOUBLE, offset, type->m_size);
+			op.bits = m_quantizationBits;
+			op.maxCode = MaxCode(op.bits);
+			op.minValue = bounds.m_limitMin;
+			op.maxValue = bounds.m_limitMax;
+			op.scale = op.maxCode / (op.maxValue - op.minValue);
+			op.invScale = (op.maxValue - op.minValue) / op.maxCode;
+			ops.push_back(op);
+			return true;
+		}
+		if (type == TypeOf<bool>() || type->m_size > 4)
+			return false;
+
+		const bool isSigned = IsSignedFundamental(type);
+		const uint32 typeBits = type->m_size * 8;
+		const int64 typeMin = isSigned ? -(int64(1) << (typeBits - 1)) : 0;
+		const int64 typeMax = isSigned ? (int64(1) << (typeBits - 1)) - 1 : (int64(1) << typeBits) - 1;
+		const double lo = ceil(double(bounds.m_limitMin));
+		const double hi = floor(double(bounds.m_limitMax));
+		if (hi < lo)
+			return false;
+		Op op(Op::BOUNDED_INT, offset, type->m_size);
+		op.isSigned = isSigned;
+		op.minInt = (lo > double(typeMin) ? int64(lo) : typeMin);
+		op.maxInt = (hi < double(typeMax) ? int64(hi) : typeMax);
+		if (op.maxInt < op.minInt)
+			return false;
+		op.maxCode = uint32(op.maxInt - op.minInt);
+		op.bits = NumBitsNeeded(op.maxCode);
+		ops.push_back(op);
+		return true;
+	}
+
+	const TypeRegistry&	m_typeRegistry;
+	const uint32		m_quantizationBits;
+	Plans				m_plans;
+	Ops					m_fieldOps;
+	rde::vector<uint16>	m_diff;
+	rde::vector<uint32>	m_changedMask;
+};
+
+DeltaEncoder::DeltaEncoder(const TypeRegistry& typeRegistry, int quantizationBits)
+:	m_impl(new Impl(typeRegistry, quantizationBits))
+{
+}
+DeltaEncoder::~DeltaEncoder()
+{
+}
+
+uint32 DeltaEncoder::Encode(const void* baseline, const void* current, const TypeClass* type,
+	uint8* buffer, uint32 bufferSize)
+{
+	return m_impl->Encode(baseline, current, type, buffer, bufferSize);
+}
+uint32 DeltaEncoder::Apply(void* object, const TypeClass* type, const uint8* data, uint32 dataSize)
+{
+	return m_impl->Apply(object, type, data, dataSize);
+}
+
+uint32 DeltaEncoder::GetMaxEncodedSize(const TypeClass* type)
+{
+	const Impl::Plan* plan = m_impl->GetPlan(type);
+	return (1 + plan->fields.size() + plan->fieldBits + 7) >> 3;
+}
+int DeltaEncoder::GetNumPlans() const
+{
+	return m_impl->m_plans.size();
+}
+
+} // rde
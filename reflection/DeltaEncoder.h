@@ -0,0 +1,56 @@
+#ifndef DELTA_ENCODER_H
+#define DELTA_ENCODER_H
+
+#include "core/ScopedPtr.h"
+#include "reflection/Type.h"
+
+namespace rde
+{
+class TypeClass;
+
+// Reflection driven delta compression of objects (for network replication).
+// Encoded delta is a bitmask of changed fields followed by bit-packed values
+// of changed fields only:
+//	- BOUNDED float/double fields (also arrays/nested members) are quantized
+//	  to given number of bits within FieldEditInfo limits (clamped),
+//	- BOUNDED integer fields take as many bits as their range needs (lossless
+//	  for values within limits),
+//	- everything else is sent as it is.
+// Pointers and rde::vectors are not replicated, NO_SERIALIZE fields are skipped.
+// Every type is compiled (once, on first use) into list of operations.
+// Changes are detected with one block compare (SSE2) of whole object, fields
+// then only test their byte ranges.
+// Baseline has to be exactly what receiver has, so sender should apply deltas
+// to its copy of baseline as well (this way quantization errors don't add up
+// and quantized values that didn't change enough are not sent again).
+// Encoded data is byte aligned, so deltas of many objects can be concatenated.
+class DeltaEncoder
+{
+public:
+	explicit DeltaEncoder(const TypeRegistry& typeRegistry, int quantizationBits = 16);
+	~DeltaEncoder();
+
+	// Baseline may be NULL, all fields are encoded then.
+	// @return number of bytes written, 0 if buffer is too small.
+	uint32 Encode(const void* baseline, const void* current, const TypeClass* type,
+		uint8* buffer, uint32 bufferSize);
+	// Object has to be in baseline state.
+	// @return number of bytes read, 0 if data is truncated (object is not
+	// modified then).
+	uint32 Apply(void* object, const TypeClass* type, const uint8* data, uint32 dataSize);
+
+	// Size of delta with all fields changed.
+	uint32 GetMaxEncodedSize(const TypeClass* type);
+	// Number of types compiled so far.
+	int GetNumPlans() const;
+
+private:
+	RDE_FORBID_COPY(DeltaEncoder);
+
+	struct Impl;
+	ScopedPtr<Impl>	m_impl;
+};
+
+} // rde
+
+#endif
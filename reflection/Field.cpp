@@ -67,4 +67,31 @@ void FieldAccessor::Init(void* object, const TypeClass* objectType, const Field*
 	m_ptr = (uint8*)field->GetRawDataPtr(object, objectType);
 }
 
+FieldHandleBase::FieldHandleBase()
+:	m_offset(INVALID_OFFSET)
+{
+}
+
+void FieldHandleBase::Init(const TypeClass* objectType, const Field* field, const Type* expectedType)
+{
+	RDE_ASSERT(objectType && field && expectedType);
+	RDE_ASSERT(field->m_type != 0);	// Not post-initialized?
+	m_offset = INVALID_OFFSET;
+	// Compared by name, types don't have to come from the same registry.
+	if (field->m_type->m_name != expectedType->m_name || field->m_type->m_size != expectedType->m_size)
+		return;
+	if (objectType != field->m_ownerClass && !objectType->IsDerivedFrom(field->m_ownerClass))
+		return;
+	m_offset = field->m_offset + objectType->CalcOffsetFrom(field->m_ownerClass);
+}
+void FieldHandleBase::Init(const TypeClass* objectType, const StrId& fieldName, const Type* expectedType)
+{
+	RDE_ASSERT(objectType);
+	const Field* field = objectType->FindField(fieldName);
+	if (field)
+		Init(objectType, field, expectedType);
+	else
+		m_offset = INVALID_OFFSET;
+}
+
 } // rde
@@ -2,11 +2,11 @@
 #define FIELD_H
 
 #include "reflection/StrId.h"
+#include "reflection/Type.h"
 #include "core/BitMath.h"
 
 namespace rde
 {
-struct Type;
 class TypeClass;
 class TypeRegistry;
 
@@ -40,8 +40,8 @@ public:
 	Field(const StrId& fieldName, uint32 typeId, uint16 offset, const TypeClass* ownerClass,
 		const FieldEditInfo* editInfo = 0);
 		
-	// See also FieldAccessor helper class for more effective way, where
-	// offset is not calculated for every access.
+	// See also FieldAccessor/FieldHandle helper classes for more effective
+	// way, where offset is not calculated for every access.
 	template<typename T>
 	void Set(void* object, const TypeClass* objectType, const T& value) const
 	{
@@ -95,6 +95,104 @@ private:
 	void*		m_ptr;
 };
 
+// Non-template part of FieldHandle.
+class FieldHandleBase
+{
+public:
+	bool IsOK() const
+	{
+		return m_offset != INVALID_OFFSET;
+	}
+	// Offset of field in objects of class handle was resolved for.
+	uint32 GetOffset() const
+	{
+		return m_offset;
+	}
+
+protected:
+	enum
+	{
+		INVALID_OFFSET	= 0xFFFFFFFF
+	};
+	FieldHandleBase();
+	// Handle stays invalid if there's no such field or it's not of expected type.
+	void Init(const TypeClass* objectType, const Field* field, const Type* expectedType);
+	void Init(const TypeClass* objectType, const StrId& fieldName, const Type* expectedType);
+
+	uint32	m_offset;
+};
+
+// Typed field handle, resolved once for given (concrete) class, so access
+// is just an add, without lookups or hierarchy walks.
+// T has to be field's type (TypeOf<T>, so fundamental types by default),
+// handle is not valid (IsOK returns false) otherwise.
+// Handle is only valid for objects of class it was resolved for (it may
+// be field of base class, though).
+template<typename T>
+class FieldHandle : public FieldHandleBase
+{
+public:
+	FieldHandle() {}
+	FieldHandle(const TypeClass* objectType, const Field* field)
+	{
+		Init(objectType, field, TypeOf<T>());
+	}
+	FieldHandle(const TypeClass* objectType, const StrId& fieldName)
+	{
+		Init(objectType, fieldName, TypeOf<T>());
+	}
+
+	const T& Get(const void* object) const
+	{
+		RDE_ASSERT(IsOK());
+		return *reinterpret_cast<const T*>(static_cast<const uint8*>(object) + m_offset);
+	}
+	void Set(void* object, const T& value) const
+	{
+		RDE_ASSERT(IsOK());
+		*reinterpret_cast<T*>(static_cast<uint8*>(object) + m_offset) = value;
+	}
+
+	// Strided access, i-th object is at (uint8*)objects + i * stride.
+	// out/values have to hold count elements.
+	void Get(const void* objects, size_t stride, int count, T* out) const
+	{
+		RDE_ASSERT(IsOK());
+		const uint8* src = static_cast<const uint8*>(objects) + m_offset;
+		for (int i = 0; i < count; ++i, src += stride)
+			out[i] = *reinterpret_cast<const T*>(src);
+	}
+	void Set(void* objects, size_t stride, int count, const T* values) const
+	{
+		RDE_ASSERT(IsOK());
+		uint8* dst = static_cast<uint8*>(objects) + m_offset;
+		for (int i = 0; i < count; ++i, dst += stride)
+			*reinterpret_cast<T*>(dst) = values[i];
+	}
+	// Sets the same value for all objects.
+	void Fill(void* objects, size_t stride, int count, const T& value) const
+	{
+		RDE_ASSERT(IsOK());
+		uint8* dst = static_cast<uint8*>(objects) + m_offset;
+		for (int i = 0; i < count; ++i, dst += stride)
+			*reinterpret_cast<T*>(dst) = value;
+	}
+
+	// Objects scattered in memory (all of class handle was resolved for).
+	void Get(void* const* objects, int count, T* out) const
+	{
+		RDE_ASSERT(IsOK());
+		for (int i = 0; i < count; ++i)
+			out[i] = *reinterpret_cast<const T*>(static_cast<const uint8*>(objects[i]) + m_offset);
+	}
+	void Set(void* const* objects, int count, const T* values) const
+	{
+		RDE_ASSERT(IsOK());
+		for (int i = 0; i < count; ++i)
+			*reinterpret_cast<T*>(static_cast<uint8*>(objects[i]) + m_offset) = values[i];
+	}
+};
+
 } // rde
 
 #endif
@@ -7,8 +7,8 @@ RDE_PROCESS_FUNDAMENTAL(unsigned short, "uint16");
 RDE_PROCESS_FUNDAMENTAL(signed short, "int16");
 RDE_PROCESS_FUNDAMENTAL(unsigned long, "uint32");
 RDE_PROCESS_FUNDAMENTAL(signed long, "int32");
-RDE_PROCESS_FUNDAMENTAL(__int64, "int64");
-RDE_PROCESS_FUNDAMENTAL(unsigned __int64, "uint64");
+RDE_PROCESS_FUNDAMENTAL(int64, "int64");
+RDE_PROCESS_FUNDAMENTAL(uint64, "uint64");
 RDE_PROCESS_FUNDAMENTAL(float, "float");
 RDE_PROCESS_FUNDAMENTAL(double, "double");
 
@@ -0,0 +1,241 @@
+#include "reflection/InstancePool.h"
+#include "reflection/TypeClass.h"
+#include "rdestl/algorithm.h"
+#include "rdestl/flat_hash_map.h"
+#include "rdestl/vector.h"
+#include "core/System.h"
+
+namespace rde
+{
+struct InstancePool::Impl
+{
+	// Free objects. Runs are sorted by address and adjacent ones are always
+	// merged.
+	struct Run
+	{
+		uint8*	objects;
+		int		count;
+	};
+	struct RunLess
+	{
+		bool operator()(const Run& lhs, const Run& rhs) const
+		{
+			return lhs.objects < rhs.objects;
+		}
+	};
+	typedef rde::vector<Run>	Runs;
+	struct TypePool
+	{
+		const TypeClass*	type;
+		uint32				objectSize;
+		// Unused part of newest chunk.
+		uint8*				chunkTop;
+		uint8*				chunkEnd;
+		Runs				freeRuns;
+		int					numInstances;
+	};
+	typedef rde::flat_hash_map<const TypeClass*, TypePool*>	Pools;
+
+	explicit Impl(int objectsPerChunk)
+	:	m_lastPool(0),
+		m_objectsPerChunk(objectsPerChunk),
+		m_reservedBytes(0)
+	{
+		RDE_ASSERT(objectsPerChunk > 0);
+	}
+	~Impl()
+	{
+		Release();
+	}
+
+	void* CreateInstances(const TypeClass* type, int count)
+	{
+		RDE_ASSERT(count > 0);
+		if (count <= 0)
+			return 0;
+		TypePool& pool = GetPool(type);
+		uint8* objects = Allocate(pool, count);
+		pool.numInstances += count;
+
+		Sys::MemSet(objects, 0, size_t(count) * pool.objectSize);
+		if (type->HasVTable())
+		{
+			for (int i = 0; i < count; ++i)
+				type->InitVTable(objects + size_t(i) * pool.objectSize);
+		}
+		return objects;
+	}
+	void DestroyInstances(void* objects, const TypeClass* type, int count)
+	{
+		RDE_ASSERT(count >= 0);
+		if (objects == 0 || count <= 0)
+			return;
+		TypePool& pool = GetPool(type);
+		RDE_ASSERT(count <= pool.numInstances);
+		pool.numInstances -= count;
+		AddFreeRun(pool, static_cast<uint8*>(objects), count);
+	}
+	// Merges with both neighbours (if adjacent), so free memory never
+	// gets fragmented into single objects, no matter the destruction order.
+	void AddFreeRun(TypePool& pool, uint8* objects, int count)
+	{
+		Run run;
+		run.objects = objects;
+		run.count = count;
+		Runs& runs = pool.freeRuns;
+		Runs::iterator next = rde::lower_bound(runs.begin(), runs.end(), run, RunLess());
+		uint8* end = objects + size_t(count) * pool.objectSize;
+		// Overlapping runs = objects destroyed twice.
+		RDE_ASSERT(next == runs.end() || end <= next->objects);
+		const bool mergeNext = (next != runs.end() && end == next->objects);
+		if (next != runs.begin())
+		{
+			Run& prev = *(next - 1);
+			uint8* prevEnd = prev.objects + size_t(prev.count) * pool.objectSize;
+			RDE_ASSERT(prevEnd <= objects);
+			if (prevEnd == objects)
+			{
+				prev.count += count;
+				if (mergeNext)
+				{
+					prev.count += next->count;
+					runs.erase(next);
+				}
+				return;
+			}
+		}
+		if (mergeNext)
+		{
+			next->objects = objects;
+			next->count += count;
+			return;
+		}
+		runs.insert(next, run);
+	}
+
+	void Release()
+	{
+		for (Pools::iterator it = m_pools.begin(); it != m_pools.end(); ++it)
+			delete it->second;
+		m_pools.clear();
+		m_lastPool = 0;
+		for (Chunks::iterator it = m_chunks.begin(); it != m_chunks.end(); ++it)
+			operator delete(*it);
+		m_chunks.clear();
+		m_reservedBytes = 0;
+	}
+
+	int GetNumInstances(const TypeClass* type) const
+	{
+		Pools::const_iterator it = m_pools.find(type);
+		return it == m_pools.end() ? 0 : it->second->numInstances;
+	}
+
+	TypePool& GetPool(const TypeClass* type)
+	{
+		RDE_ASSERT(type != 0);
+		// Objects are mostly created in batches of the same type.
+		if (m_lastPool != 0 && m_lastPool->type == type)
+			return *m_lastPool;
+		Pools::iterator it = m_pools.find(type);
+		if (it == m_pools.end())
+		{
+			RDE_ASSERT(type->m_size > 0);
+			TypePool* pool = new TypePool();
+			pool->type = type;
+			pool->objectSize = type->m_size;
+			pool->chunkTop = pool->chunkEnd = 0;
+			pool->numInstances = 0;
+			it = m_pools.insert(rde::make_pair(type, pool)).first;
+		}
+		m_lastPool = it->second;
+		return *m_lastPool;
+	}
+
+	uint8* Allocate(TypePool& pool, int count)
+	{
+		const size_t bytes = size_t(count) * pool.objectSize;
+		// Highest addresses first (usually newest chunk, most likely still
+		// in cache). Objects are taken from the end, so that run start
+		// (and order of runs) doesn't change.
+		for (int i = pool.freeRuns.size() - 1; i >= 0; --i)
+		{
+			Run& run = pool.freeRuns[i];
+			if (run.count < count)
+				continue;
+			run.count -= count;
+			uint8* objects = run.objects + size_t(run.count) * pool.objectSize;
+			if (run.count == 0)
+				pool.freeRuns.erase(pool.freeRuns.begin() + i);
+			return objects;
+		}
+
+		if (size_t(pool.chunkEnd - pool.chunkTop) < bytes)
+		{
+			// Rest of old chunk is not wasted, it's free run now.
+			const int numLeft = int((pool.chunkEnd - pool.chunkTop) / pool.objectSize);
+			if (numLeft != 0)
+				AddFreeRun(pool, pool.chunkTop, numLeft);
+			const size_t chunkBytes = size_t(count > m_objectsPerChunk ? count : m_objectsPerChunk) *
+				pool.objectSize;
+			uint8* chunk = static_cast<uint8*>(operator new(chunkBytes));
+			m_chunks.push_back(chunk);
+			m_reservedBytes += chunkBytes;
+			pool.chunkTop = chunk;
+			pool.chunkEnd = chunk + chunkBytes;
+		}
+		uint8* objects = pool.chunkTop;
+		pool.chunkTop += bytes;
+		return objects;
+	}
+
+	typedef rde::vector<void*>	Chunks;
+
+	Pools		m_pools;
+	TypePool*	m_lastPool;
+	Chunks		m_chunks;
+	int			m_objectsPerChunk;
+	size_t		m_reservedBytes;
+};
+
+InstancePool::InstancePool(int objectsPerChunk)
+:	m_impl(new Impl(objectsPerChunk))
+{
+}
+InstancePool::~InstancePool()
+{
+}
+
+void* InstancePool::CreateInstances(const TypeClass* type, int count)
+{
+	return m_impl->CreateInstances(type, count);
+}
+void* InstancePool::CreateInstance(const TypeClass* type)
+{
+	return m_impl->CreateInstances(type, 1);
+}
+
+void InstancePool::DestroyInstances(void* objects, const TypeClass* type, int count)
+{
+	m_impl->DestroyInstances(objects, type, count);
+}
+void InstancePool::DestroyInstance(void* object, const TypeClass* type)
+{
+	m_impl->DestroyInstances(object, type, 1);
+}
+
+void InstancePool::Release()
+{
+	m_impl->Release();
+}
+
+int InstancePool::GetNumInstances(const TypeClass* type) const
+{
+	return m_impl->GetNumInstances(type);
+}
+size_t InstancePool::GetReservedBytes() const
+{
+	return m_impl->m_reservedBytes;
+}
+
+} // rde
@@ -0,0 +1,62 @@
+#ifndef INSTANCE_POOL_H
+#define INSTANCE_POOL_H
+
+#include "core/ScopedPtr.h"
+#include "reflection/Type.h"
+
+namespace rde
+{
+class TypeClass;
+
+// Per-type pools for objects created from data (spawning entities etc).
+// Batches are allocated as contiguous arrays (objects are type->m_size bytes
+// apart), so creating thousands of objects costs one pool lookup and (at most)
+// one heap allocation.
+// Rules are the same as for objects created by DeepCloner/loaders:
+//	- objects are NOT constructed, only zeroed and vtable is initialized
+//	  (Reflection_InitVTable placement hook),
+//	- destroyed objects are NOT destructed, memory simply goes back to pool
+//	  (to be reused by next creations of the same type). Anything objects
+//	  own (rde::vector/string members, pointers to heap) leaks, unless it's
+//	  released by the caller before DestroyInstances.
+// Memory is released when pool is destroyed (or Release is called).
+// Not thread-safe.
+class InstancePool
+{
+public:
+	// New chunks have room for at least objectsPerChunk objects.
+	explicit InstancePool(int objectsPerChunk = 256);
+	~InstancePool();
+
+	// @return first of count objects (array), NULL if count <= 0.
+	void* CreateInstances(const TypeClass* type, int count);
+	void* CreateInstance(const TypeClass* type);
+	template<typename T>
+	T* CreateInstances(const TypeClass* type, int count)
+	{
+		return static_cast<T*>(CreateInstances(type, count));
+	}
+
+	// Objects have to come from this pool and be of given type (not derived).
+	// Whole batch or only part of it can be destroyed at once.
+	// No destructors are called (see above).
+	void DestroyInstances(void* objects, const TypeClass* type, int count);
+	void DestroyInstance(void* object, const TypeClass* type);
+
+	// Frees all memory, objects still alive become invalid.
+	void Release();
+
+	int GetNumInstances(const TypeClass* type) const;
+	// Memory taken from heap, in bytes.
+	size_t GetReservedBytes() const;
+
+private:
+	RDE_FORBID_COPY(InstancePool);
+
+	struct Impl;
+	ScopedPtr<Impl>	m_impl;
+};
+
+} // rde
+
+#endif
@@ -0,0 +1,1716 @@
+#include "reflection/JsonSerializer.h"
+#include "reflection/TypeClass.h"
+#include "reflection/TypeEnum.h"
+#include "reflection/TypeRegistry.h"
+#include "reflection/ValueKind.h"
+#include "rdestl/bit_utils.h"
+#include "rdestl/flat_hash_map.h"
+#include "rdestl/vector.h"
+#include "core/BitMath.h"
+#include "core/CRC32.h"
+#include "core/System.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#	define RDE_JSON_SSE2	1
+#	include <emmintrin.h>
+#else
+#	define RDE_JSON_SSE2	0
+#endif
+
+namespace
+{
+void* AllocateWithNew(size_t bytes, void*)
+{
+	return operator new(bytes);
+}
+
+// Doesn't have to be good, only cheap, table is verified with memcmp anyway.
+// Mixes length and up to 8 first/last bytes.
+rde::uint32 KeyHash(const char* key, rde::uint32 length)
+{
+	rde::uint32 h = length * 0x9E3779B1;
+	const rde::uint32 n = length < 8 ? length : 8;
+	for (rde::uint32 i = 0; i < n; ++i)
+		h = (h ^ rde::uint8(key[i])) * 0x01000193;
+	for (rde::uint32 i = length - n; i < length; ++i)
+		h = (h ^ rde::uint8(key[i])) * 0x01000193;
+	return h ^ (h >> 15);
+}
+
+// Same hash as StrId/CRC32 of zero terminated string.
+rde::uint32 NameHash(const char* name, rde::uint32 length)
+{
+	rde::CRC32 crc;
+	crc.AddArray(reinterpret_cast<const rde::uint8*>(name), long(length));
+	crc.Add8(rde::uint8(length));
+	return crc.GetValue();
+}
+
+bool IsFinite(double v)
+{
+	return v - v == 0.0;
+}
+
+rde::int64 LoadSigned(const void* data, rde::uint32 size)
+{
+	switch (size)
+	{
+	case 1:		return *static_cast<const rde::int8*>(data);
+	case 2:		return *static_cast<const rde::int16*>(data);
+	case 4:		return *static_cast<const rde::int32*>(data);
+	default:	return *static_cast<const rde::int64*>(data);
+	}
+}
+rde::uint64 LoadUnsigned(const void* data, rde::uint32 size)
+{
+	switch (size)
+	{
+	case 1:		return *static_cast<const rde::uint8*>(data);
+	case 2:		return *static_cast<const rde::uint16*>(data);
+	case 4:		return *static_cast<const rde::uint32*>(data);
+	default:	return *static_cast<const rde::uint64*>(data);
+	}
+}
+void StoreInteger(void* data, rde::uint32 size, rde::uint64 value)
+{
+	switch (size)
+	{
+	case 1:		*static_cast<rde::uint8*>(data) = rde::uint8(value); break;
+	case 2:		*static_cast<rde::uint16*>(data) = rde::uint16(value); break;
+	case 4:		*static_cast<rde::uint32*>(data) = rde::uint32(value); break;
+	default:	*static_cast<rde::uint64*>(data) = value; break;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Scanning. All the functions stop at end, text doesn't have to be zero
+// terminated (and SSE2 loads never read past it).
+
+// Anything up to space counts as whitespace.
+inline bool IsWhitespace(char c)
+{
+	return rde::uint8(c) <= ' ';
+}
+
+RDE_FORCEINLINE const char* SkipWhitespace(const char* p, const char* end)
+{
+	// Usually there's none or just single space/new line.
+	if (p == end || !IsWhitespace(*p))
+		return p;
+	++p;
+#if RDE_JSON_SSE2
+	const __m128i firstNonWhitespace = _mm_set1_epi8('!');
+	for (; end - p >= 16; p += 16)
+	{
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		// max(v, '!') == v <=> v >= '!' (unsigned).
+		const rde::uint32 mask = rde::uint32(_mm_movemask_epi8(
+			_mm_cmpeq_epi8(_mm_max_epu8(v, firstNonWhitespace), v)));
+		if (mask != 0)
+			return p + rde::internal::lowest_bit_index(mask);
+	}
+#endif
+	while (p != end && IsWhitespace(*p))
+		++p;
+	return p;
+}
+
+// @return first quote or backslash, end if there's none.
+const char* FindStringSpecial(const char* p, const char* end)
+{
+#if RDE_JSON_SSE2
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	for (; end - p >= 16; p += 16)
+	{
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		const rde::uint32 mask = rde::uint32(_mm_movemask_epi8(
+			_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash))));
+		if (mask != 0)
+			return p + rde::internal::lowest_bit_index(mask);
+	}
+#endif
+	while (p != end && *p != '"' && *p != '\\')
+		++p;
+	return p;
+}
+
+// p points just after opening quote.
+// @return pointer past closing quote, NULL if string is not terminated.
+const char* SkipString(const char* p, const char* end)
+{
+	for (;;)
+	{
+		p = FindStringSpecial(p, end);
+		if (p == end)
+			return 0;
+		if (*p == '"')
+			return p + 1;
+		// Escaped character, whatever it is.
+		if (end - p < 2)
+			return 0;
+		p += 2;
+	}
+}
+
+inline bool IsStructural(char c)
+{
+	return c == '"' || c == ',' || (c | 0x20) == '{' || (c | 0x20) == '}';
+}
+#if RDE_JSON_SSE2
+// Bit set for every quote, comma and bracket in 16 bytes at p.
+RDE_FORCEINLINE rde::uint32 StructuralMask(const char* p)
+{
+	const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+	// '[' | 0x20 == '{', ']' | 0x20 == '}'
+	const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+	const __m128i brackets = _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')),
+		_mm_cmpeq_epi8(lower, _mm_set1_epi8('}')));
+	const __m128i separators = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+		_mm_cmpeq_epi8(v, _mm_set1_epi8(',')));
+	return rde::uint32(_mm_movemask_epi8(_mm_or_si128(brackets, separators)));
+}
+#endif
+
+// p points at opening bracket ('[' or '{'). Optionally counts top-level
+// elements (without parsing them).
+// @return pointer past matching closing bracket, NULL if text ends before.
+const char* SkipComposite(const char* p, const char* end, rde::uint32* outNumElements)
+{
+	if (outNumElements != 0)
+	{
+		const char* first = SkipWhitespace(p + 1, end);
+		*outNumElements = (first != end && (*first == ']' || *first == '}')) ? 0 : 1;
+	}
+	int depth(0);
+	while (p != end)
+	{
+		rde::uint32 mask;
+		int blockSize(1);
+#if RDE_JSON_SSE2
+		if (end - p >= 16)
+		{
+			mask = StructuralMask(p);
+			blockSize = 16;
+		}
+		else
+#endif
+		{
+			mask = IsStructural(*p) ? 1 : 0;
+		}
+		const char* next = p + blockSize;
+		while (mask != 0)
+		{
+			const char* s = p + rde::internal::lowest_bit_index(mask);
+			mask &= mask - 1;
+			const char c = *s;
+			if (c == '"')
+			{
+				// Rest of the block may be string contents, rescan after it.
+				next = SkipString(s + 1, end);
+				if (next == 0)
+					return 0;
+				break;
+			}
+			if (c == ',')
+			{
+				if (depth == 1 && outNumElements != 0)
+					++(*outNumElements);
+			}
+			else if ((c | 0x20) == '{')
+			{
+				++depth;
+			}
+			else if (--depth == 0)
+			{
+				return s + 1;
+			}
+		}
+		p = next;
+	}
+	return 0;
+}
+
+// Skips any value (doesn't validate its contents).
+// @return pointer past the value, NULL if it's invalid.
+const char* SkipValue(const char* p, const char* end)
+{
+	if (p == end)
+		return 0;
+	if (*p == '"')
+		return SkipString(p + 1, end);
+	if (*p == '[' || *p == '{')
+		return SkipComposite(p, end, 0);
+	// Number/literal.
+	const char* start = p;
+	while (p != end && *p != ',' && *p != '}' && *p != ']' && !IsWhitespace(*p))
+		++p;
+	return p != start ? p : 0;
+}
+
+inline bool MatchLiteral(const char* p, const char* end, const char* literal, size_t length)
+{
+	return size_t(end - p) >= length && memcmp(p, literal, length) == 0;
+}
+
+//-----------------------------------------------------------------------------
+// Numbers.
+
+struct JsonNumber
+{
+	bool			isInteger;
+	bool			negative;
+	// Integers only.
+	rde::uint64		magnitude;
+	double			value;
+};
+
+const double s_powersOf10[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool IsDigit(char c)
+{
+	return unsigned(c - '0') <= 9;
+}
+
+// False if mantissa * 10 + digit would overflow.
+inline bool CanAppendDigit(rde::uint64 mantissa, char digit)
+{
+	const rde::uint64 kMax = ~rde::uint64(0);
+	return mantissa < kMax / 10 || (mantissa == kMax / 10 && rde::uint64(digit - '0') <= kMax % 10);
+}
+
+// @return pointer past the number, NULL if it's not valid JSON number.
+const char* ParseNumber(const char* p, const char* end, JsonNumber& number)
+{
+	const char* start = p;
+	number.negative = (p != end && *p == '-');
+	if (number.negative)
+		++p;
+
+	// Digits are accumulated for as long as they fit in 64 bits (up to 20,
+	// so that whole uint64 range is exact).
+	rde::uint64 mantissa(0);
+	int exponent(0);
+	bool truncated(false);
+	const char* digits = p;
+	for (; p != end && IsDigit(*p); ++p)
+	{
+		if (!truncated && CanAppendDigit(mantissa, *p))
+		{
+			mantissa = mantissa * 10 + rde::uint64(*p - '0');
+		}
+		else
+		{
+			++exponent;
+			truncated = true;
+		}
+	}
+	if (p == digits)
+		return 0;
+	number.isInteger = true;
+	if (p != end && *p == '.')
+	{
+		number.isInteger = false;
+		digits = ++p;
+		for (; p != end && IsDigit(*p); ++p)
+		{
+			if (!truncated && CanAppendDigit(mantissa, *p))
+			{
+				mantissa = mantissa * 10 + rde::uint64(*p - '0');
+				--exponent;
+			}
+			else
+			{
+				truncated = true;
+			}
+		}
+		if (p == digits)
+			return 0;
+	}
+	if (p != end && (*p == 'e' || *p == 'E'))
+	{
+		number.isInteger = false;
+		++p;
+		const bool negativeExponent = (p != end && *p == '-');
+		if (p != end && (*p == '-' || *p == '+'))
+			++p;
+		digits = p;
+		int e(0);
+		for (; p != end && IsDigit(*p); ++p)
+		{
+			if (e < 100000)
+				e = e * 10 + (*p - '0');
+		}
+		if (p == digits)
+			return 0;
+		exponent += negativeExponent ? -e : e;
+	}
+	number.isInteger &= !truncated;
+	number.magnitude = mantissa;
+
+	// Exact integer times exact power of 10 -> correctly rounded result (Clinger).
+	double value;
+	if (!truncated && mantissa <= (rde::uint64(1) << 53) && exponent >= -22 && exponent <= 22)
+	{
+		value = double(mantissa);
+		value = exponent < 0 ? value / s_powersOf10[-exponent] : value * s_powersOf10[exponent];
+	}
+	else
+	{
+		// Rare (too many digits/huge exponents), let C library deal with it.
+		// Input isn't zero-terminated, so it needs a copy.
+		char buffer[64];
+		const size_t length = size_t(p - start);
+		char* copy = length < sizeof(buffer) ? buffer : new char[length + 1];
+		memcpy(copy, start, length);
+		copy[length] = 0;
+		value = strtod(number.negative ? copy + 1 : copy, 0);
+		if (copy != buffer)
+			delete[] copy;
+	}
+	number.value = number.negative ? -value : value;
+	return p;
+}
+
+//-----------------------------------------------------------------------------
+// Output.
+
+class TextBuffer
+{
+public:
+	TextBuffer(): m_data(0), m_size(0), m_capacity(0) {}
+	~TextBuffer()
+	{
+		operator delete(m_data);
+	}
+
+	void Clear()			{ m_size = 0; }
+	const char* GetData() const	{ return m_data; }
+	size_t GetSize() const	{ return m_size; }
+
+	RDE_FORCEINLINE void Put(char c)
+	{
+		if (m_size == m_capacity)
+			Grow(1);
+		m_data[m_size++] = c;
+	}
+	RDE_FORCEINLINE void Append(const char* str, size_t length)
+	{
+		if (m_size + length > m_capacity)
+			Grow(length);
+		memcpy(m_data + m_size, str, length);
+		m_size += length;
+	}
+	// Terminates text, without counting terminator to its size.
+	void Terminate()
+	{
+		Put(0);
+		--m_size;
+	}
+
+private:
+	void Grow(size_t extra)
+	{
+		size_t newCapacity = m_capacity * 2 < 4096 ? 4096 : m_capacity * 2;
+		if (newCapacity < m_size + extra)
+			newCapacity = m_size + extra;
+		char* newData = static_cast<char*>(operator new(newCapacity));
+		if (m_size != 0)
+			memcpy(newData, m_data, m_size);
+		operator delete(m_data);
+		m_data = newData;
+		m_capacity = newCapacity;
+	}
+
+	char*	m_data;
+	size_t	m_size;
+	size_t	m_capacity;
+};
+
+// @return pointer to first character, digits are written backwards from end.
+char* FormatUInt(char* end, rde::uint64 value)
+{
+	char* p = end;
+	do
+	{
+		*--p = char('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+	return p;
+}
+}
+
+namespace rde
+{
+struct JsonPlan;
+struct JsonMember
+{
+	const char*		name;
+	uint32			nameLength;
+	uint32			hash;
+	// From the start of outermost class.
+	uint32			offset;
+	const JsonPlan*	plan;
+};
+
+// Everything reader and writer need to know about given type.
+struct JsonPlan
+{
+	static const uint32 NO_OFFSET = VectorLayout::NO_OFFSET;
+
+	typedef ValueKind::Enum	Kind;
+	typedef rde::vector<JsonMember>	Members;
+
+	JsonPlan()
+	:	kind(ValueKind::UNSUPPORTED),
+		size(0),
+		type(0),
+		element(0),
+		count(0),
+		beginOffset(0),
+		endOffset(0),
+		capacityOffset(NO_OFFSET),
+		vtableClass(0),
+		keyMask(0)
+	{
+	}
+
+	// Tries member that follows previous one first (it's what we get
+	// from JsonWriter), hash table then.
+	RDE_FORCEINLINE const JsonMember* FindMember(const char* key, uint32 keyLength, uint32 expectedIndex) const
+	{
+		if (expectedIndex < uint32(members.size()))
+		{
+			const JsonMember& expected = members[expectedIndex];
+			if (expected.nameLength == keyLength && memcmp(expected.name, key, keyLength) == 0)
+				return &expected;
+		}
+		if (members.empty())
+			return 0;
+		const uint32 hash = KeyHash(key, keyLength);
+		for (uint32 slot = hash & keyMask; ; slot = (slot + 1) & keyMask)
+		{
+			const int index = keySlots[slot];
+			if (index < 0)
+				return 0;
+			const JsonMember& member = members[index];
+			if (member.hash == hash && member.nameLength == keyLength &&
+				memcmp(member.name, key, keyLength) == 0)
+			{
+				return &member;
+			}
+		}
+	}
+
+	Kind				kind;
+	uint32				size;
+	const Type*			type;
+	// ARRAY/VECTOR: element type, POINTER: pointed type.
+	const JsonPlan*		element;
+	// ARRAY/STRING: number of elements.
+	uint32				count;
+	// VECTOR only.
+	uint32				beginOffset;
+	uint32				endOffset;
+	uint32				capacityOffset;
+	// CLASS, set if objects allocated by reader (as opposed to embedded
+	// ones) need vtable.
+	const TypeClass*	vtableClass;
+	// CLASS: fields (including base classes), in order.
+	Members				members;
+	// Open addressing, member index or -1.
+	rde::vector<int>	keySlots;
+	uint32				keyMask;
+};
+
+// Shared by reader & writer.
+class JsonPlanCache
+{
+public:
+	explicit JsonPlanCache(const TypeRegistry& typeRegistry)
+	:	m_typeRegistry(typeRegistry)
+	{
+	}
+	~JsonPlanCache()
+	{
+		for (Plans::iterator it = m_plans.begin(); it != m_plans.end(); ++it)
+			delete it->second;
+	}
+
+	const JsonPlan* GetPlan(const Type* type)
+	{
+		Plans::iterator it = m_plans.find(type);
+		if (it != m_plans.end())
+			return it->second;
+
+		// Registered before compiling, so that recursive types find it.
+		JsonPlan* plan = new JsonPlan();
+		plan->type = type;
+		plan->size = type->m_size;
+		m_plans.insert(rde::make_pair(type, plan));
+		Compile(*plan, type);
+		return plan;
+	}
+	int GetNumPlans() const
+	{
+		return int(m_plans.size());
+	}
+
+	const TypeRegistry&	m_typeRegistry;
+
+private:
+	typedef rde::flat_hash_map<const Type*, JsonPlan*>	Plans;
+
+	void Compile(JsonPlan& plan, const Type* type)
+	{
+		const Type* elementType(0);
+		const ValueKind::Enum kind = GetValueKind(type, m_typeRegistry, &elementType);
+		switch (kind)
+		{
+		case ValueKind::CLASS:
+			CompileClass(plan, static_cast<const TypeClass*>(type));
+			return;
+		case ValueKind::STRING:
+		case ValueKind::ARRAY:
+			plan.count = uint32(static_cast<const TypeArray*>(type)->m_numElements);
+			break;
+		case ValueKind::VECTOR:
+			{
+				const VectorLayout layout = GetVectorLayout(static_cast<const TypeClass*>(type));
+				plan.beginOffset = layout.beginOffset;
+				plan.endOffset = layout.endOffset;
+				plan.capacityOffset = layout.capacityOffset;
+			}
+			break;
+		default:
+			break;
+		}
+		if (kind == ValueKind::ARRAY || kind == ValueKind::VECTOR || kind == ValueKind::POINTER)
+		{
+			// Pointed plan may be still in the middle of compiling (kind
+			// is set before compiling members, so it's fine).
+			plan.element = GetPlan(elementType);
+			if (plan.element->kind == ValueKind::UNSUPPORTED)
+				return;
+		}
+		plan.kind = kind;
+	}
+	void CompileClass(JsonPlan& plan, const TypeClass* tc)
+	{
+		plan.kind = ValueKind::CLASS;
+		plan.vtableClass = tc->HasVTable() ? tc : 0;
+		const int numFields = tc->GetNumFields();
+		plan.members.reserve(numFields);
+		for (int i = 0; i < numFields; ++i)
+		{
+			const Field* field = tc->GetField(i);
+			if (field->m_flags & FieldFlags::NO_SERIALIZE)
+				continue;
+			const JsonPlan* fieldPlan = GetPlan(field->m_type);
+			if (fieldPlan->kind == ValueKind::UNSUPPORTED)
+				continue;
+			JsonMember member;
+			member.name = field->m_name.GetStr();
+			member.nameLength = uint32(strlen(member.name));
+			member.hash = KeyHash(member.name, member.nameLength);
+			member.offset = tc->CalcOffsetFrom(field->m_ownerClass) + field->m_offset;
+			member.plan = fieldPlan;
+			plan.members.push_back(member);
+		}
+
+		// Load factor <= 0.5.
+		const uint32 numSlots = NextPowerOfTwo(plan.members.size() < 2 ? 4 : plan.members.size() * 2);
+		plan.keyMask = numSlots - 1;
+		plan.keySlots.resize(numSlots);
+		for (uint32 i = 0; i < numSlots; ++i)
+			plan.keySlots[i] = -1;
+		for (uint32 i = 0; i < uint32(plan.members.size()); ++i)
+		{
+			const JsonMember& member = plan.members[i];
+			// Shadowed names (same field name in base class) - first one wins.
+			if (plan.FindMember(member.name, member.nameLength, 0xFFFFFFFF) != 0)
+				continue;
+			uint32 slot = member.hash & plan.keyMask;
+			while (plan.keySlots[slot] >= 0)
+				slot = (slot + 1) & plan.keyMask;
+			plan.keySlots[slot] = int(i);
+		}
+	}
+
+	Plans	m_plans;
+};
+
+//=============================================================================
+struct JsonWriter::Impl
+{
+	// Object -> index in document.
+	typedef rde::flat_hash_map<const void*, uint32>	ObjectIds;
+	struct PendingObject
+	{
+		const void*		object;
+		const JsonPlan*	plan;
+	};
+	typedef rde::vector<PendingObject>	PendingObjects;
+
+	Impl(const TypeRegistry& typeRegistry, bool indent)
+	:	m_plans(typeRegistry),
+		m_indent(indent)
+	{
+	}
+
+	const char* Write(const void* object, const TypeClass* type, size_t* outLength)
+	{
+		m_text.Clear();
+		m_text.Put('[');
+		if (object != 0)
+		{
+			RDE_ASSERT(type != 0);
+			GetObjectId(object, m_plans.GetPlan(type));
+			// Objects are written in order of discovery, list grows as pointers
+			// are found (no recursion, so long lists don't blow up the stack).
+			for (uint32 i = 0; i < uint32(m_objects.size()); ++i)
+			{
+				if (i != 0)
+					m_text.Put(',');
+				NewLine(1);
+				WriteObject(i);
+			}
+			NewLine(0);
+		}
+		m_text.Put(']');
+		if (m_indent)
+			m_text.Put('\n');
+		m_text.Terminate();
+
+		m_objects.clear();
+		m_objectIds.clear();
+		if (outLength != 0)
+			*outLength = m_text.GetSize();
+		return m_text.GetData();
+	}
+
+	uint32 GetObjectId(const void* object, const JsonPlan* plan)
+	{
+		ObjectIds::iterator it = m_objectIds.find(object);
+		if (it != m_objectIds.end())
+			return it->second;
+		const uint32 id = uint32(m_objects.size());
+		m_objectIds.insert(rde::make_pair(object, id));
+		PendingObject pending = { object, plan };
+		m_objects.push_back(pending);
+		return id;
+	}
+
+	void WriteObject(uint32 id)
+	{
+		// Copy, list may grow.
+		const PendingObject pending = m_objects[id];
+		const JsonPlan& plan = *pending.plan;
+		m_text.Put('{');
+		NewLine(2);
+		WriteKey("$id", 3);
+		WriteUInt(id);
+		m_text.Put(',');
+		NewLine(2);
+		WriteKey("$type", 5);
+		const char* typeName = plan.type->m_name.GetStr();
+		WriteString(typeName, strlen(typeName));
+		if (plan.kind == ValueKind::CLASS)
+		{
+			WriteMembers(plan, static_cast<const uint8*>(pending.object), 2, false);
+		}
+		else
+		{
+			m_text.Put(',');
+			NewLine(2);
+			WriteKey("$value", 6);
+			WriteValue(plan, static_cast<const uint8*>(pending.object), 2);
+		}
+		NewLine(1);
+		m_text.Put('}');
+	}
+
+	// @return false if there was nothing to write.
+	bool WriteMembers(const JsonPlan& plan, const uint8* data, int depth, bool first)
+	{
+		for (JsonPlan::Members::const_iterator it = plan.members.begin(); it != plan.members.end(); ++it)
+		{
+			if (!first)
+				m_text.Put(',');
+			first = false;
+			NewLine(depth);
+			WriteKey(it->name, it->nameLength);
+			WriteValue(*it->plan, data + it->offset, depth);
+		}
+		return !plan.members.empty();
+	}
+
+	void WriteValue(const JsonPlan& plan, const uint8* data, int depth)
+	{
+		switch (plan.kind)
+		{
+		case ValueKind::BOOL:
+			if (*data != 0)
+				m_text.Append("true", 4);
+			else
+				m_text.Append("false", 5);
+			break;
+		case ValueKind::INT:
+			WriteInt(LoadSigned(data, plan.size));
+			break;
+		case ValueKind::UINT:
+			WriteUInt(LoadUnsigned(data, plan.size));
+			break;
+		case ValueKind::FLOAT:
+			WriteReal(*reinterpret_cast<const float*>(data), true);
+			break;
+		case ValueKind::DOUBLE:
+			WriteReal(*reinterpret_cast<const double*>(data), false);
+			break;
+		case ValueKind::ENUM:
+			{
+				const long value = long(LoadSigned(data, plan.size));
+				const TypeEnum::Constant* constant =
+					static_cast<const TypeEnum*>(plan.type)->FindConstantByValue(value);
+				if (constant != 0)
+				{
+					const char* name = constant->m_name.GetStr();
+					WriteString(name, strlen(name));
+				}
+				else
+				{
+					WriteInt(value);
+				}
+			}
+			break;
+		case ValueKind::STRING:
+			{
+				const char* str = reinterpret_cast<const char*>(data);
+				const void* terminator = memchr(str, 0, plan.count);
+				WriteString(str, terminator ? size_t(static_cast<const char*>(terminator) - str) : plan.count);
+			}
+			break;
+		case ValueKind::ARRAY:
+			WriteArray(*plan.element, data, plan.count, depth);
+			break;
+		case ValueKind::VECTOR:
+			{
+				const uint8* begin = *reinterpret_cast<const uint8* const*>(data + plan.beginOffset);
+				const uint8* end = *reinterpret_cast<const uint8* const*>(data + plan.endOffset);
+				WriteArray(*plan.element, begin, uint32((end - begin) / plan.element->size), depth);
+			}
+			break;
+		case ValueKind::POINTER:
+			{
+				const void* pointed = *reinterpret_cast<const void* const*>(data);
+				if (pointed == 0)
+				{
+					m_text.Append("null", 4);
+					break;
+				}
+				m_text.Put('{');
+				WriteKey("$ref", 4);
+				WriteUInt(GetObjectId(pointed, plan.element));
+				m_text.Put('}');
+			}
+			break;
+		case ValueKind::CLASS:
+			m_text.Put('{');
+			if (WriteMembers(plan, data, depth + 1, true))
+				NewLine(depth);
+			m_text.Put('}');
+			break;
+		default:
+			RDE_ASSERT(!"Unsupported types should never be written");
+			break;
+		}
+	}
+	void WriteArray(const JsonPlan& elementPlan, const uint8* data, uint32 count, int depth)
+	{
+		// Numbers etc. in one line, one object per line.
+		const bool multiline = (elementPlan.kind == ValueKind::CLASS || elementPlan.kind == ValueKind::ARRAY ||
+			elementPlan.kind == ValueKind::VECTOR);
+		m_text.Put('[');
+		for (uint32 i = 0; i < count; ++i)
+		{
+			if (i != 0)
+			{
+				m_text.Put(',');
+				if (m_indent && !multiline)
+					m_text.Put(' ');
+			}
+			if (multiline)
+				NewLine(depth + 1);
+			WriteValue(elementPlan, data + i * elementPlan.size, depth + 1);
+		}
+		if (multiline && count != 0)
+			NewLine(depth);
+		m_text.Put(']');
+	}
+
+	void NewLine(int depth)
+	{
+		if (m_indent)
+		{
+			m_text.Put('\n');
+			for (int i = 0; i < depth; ++i)
+				m_text.Put('\t');
+		}
+	}
+	void WriteKey(const char* key, size_t length)
+	{
+		// Keys are identifiers, nothing to escape.
+		m_text.Put('"');
+		m_text.Append(key, length);
+		if (m_indent)
+			m_text.Append("\": ", 3);
+		else
+			m_text.Append("\":", 2);
+	}
+	void WriteString(const char* str, size_t length)
+	{
+		m_text.Put('"');
+		const char* end = str + length;
+		while (str != end)
+		{
+			const char* run = str;
+			while (str != end && *str != '"' && *str != '\\' && uint8(*str) >= 0x20)
+				++str;
+			m_text.Append(run, size_t(str - run));
+			if (str == end)
+				break;
+			const char c = *str++;
+			char escape[8] = { '\\', c, 0 };
+			size_t escapeLength(2);
+			switch (c)
+			{
+			case '"':
+			case '\\':	break;
+			case '\n':	escape[1] = 'n'; break;
+			case '\r':	escape[1] = 'r'; break;
+			case '\t':	escape[1] = 't'; break;
+			case '\b':	escape[1] = 'b'; break;
+			case '\f':	escape[1] = 'f'; break;
+			default:
+				{
+					static const char s_hexDigits[] = "0123456789abcdef";
+					escape[1] = 'u';
+					escape[2] = '0';
+					escape[3] = '0';
+					escape[4] = s_hexDigits[(c >> 4) & 0xF];
+					escape[5] = s_hexDigits[c & 0xF];
+					escapeLength = 6;
+				}
+				break;
+			}
+			m_text.Append(escape, escapeLength);
+		}
+		m_text.Put('"');
+	}
+	void WriteUInt(uint64 value)
+	{
+		char buffer[24];
+		char* end = buffer + sizeof(buffer);
+		const char* str = FormatUInt(end, value);
+		m_text.Append(str, size_t(end - str));
+	}
+	void WriteInt(int64 value)
+	{
+		char buffer[24];
+		char* end = buffer + sizeof(buffer);
+		// Negated as unsigned, so that INT64_MIN works as well.
+		char* str = FormatUInt(end, value < 0 ? uint64(0) - uint64(value) : uint64(value));
+		if (value < 0)
+			*--str = '-';
+		m_text.Append(str, size_t(end - str));
+	}
+	// Shortest of 2 precisions that still reads back as the same value.
+	void WriteReal(double value, bool isFloat)
+	{
+		if (!IsFinite(value))
+		{
+			m_text.Append("null", 4);
+			return;
+		}
+		if (WriteShortDecimal(value, isFloat))
+			return;
+		char buffer[32];
+		Sys::StringFormat(buffer, sizeof(buffer), isFloat ? "%.7g" : "%.15g", value);
+		size_t length = strlen(buffer);
+		JsonNumber number;
+		const bool exact = ParseNumber(buffer, buffer + length, number) != 0 &&
+			(isFloat ? float(number.value) == float(value) : number.value == value);
+		if (!exact)
+		{
+			Sys::StringFormat(buffer, sizeof(buffer), isFloat ? "%.9g" : "%.17g", value);
+			length = strlen(buffer);
+		}
+		m_text.Append(buffer, length);
+	}
+	// Most values have short exact decimal representation (integers, 0.25,
+	// 0.1f...), these are written without printf. Value is accepted only if
+	// reader (n / 10^decimals) gets exactly the same number back.
+	bool WriteShortDecimal(double value, bool isFloat)
+	{
+		const bool negative = value < 0.0 || (value == 0.0 && 1.0 / value < 0.0);
+		const double magnitude = negative ? -value : value;
+		const int maxDecimals = isFloat ? 9 : 17;
+		for (int decimals = 0; decimals <= maxDecimals; ++decimals)
+		{
+			const double scaled = magnitude * s_powersOf10[decimals];
+			if (scaled >= 9007199254740992.0)	// 2^53
+				return false;
+			const uint64 n = uint64(scaled + 0.5);
+			const double decoded = double(n) / s_powersOf10[decimals];
+			if (isFloat ? float(decoded) != float(magnitude) : decoded != magnitude)
+				continue;
+
+			char buffer[32];
+			char* end = buffer + sizeof(buffer);
+			char* str = FormatUInt(end, n);
+			if (decimals != 0)
+			{
+				// Leading zeros, then move integer part left to make room for point.
+				while (end - str <= decimals)
+					*--str = '0';
+				char* point = end - decimals - 1;
+				memmove(str - 1, str, size_t(point + 1 - str));
+				--str;
+				*point = '.';
+			}
+			if (negative)
+				*--str = '-';
+			m_text.Append(str, size_t(end - str));
+			return true;
+		}
+		return false;
+	}
+
+	JsonPlanCache	m_plans;
+	const bool		m_indent;
+	TextBuffer		m_text;
+	ObjectIds		m_objectIds;
+	PendingObjects	m_objects;
+};
+
+JsonWriter::JsonWriter(const TypeRegistry& typeRegistry, bool indent)
+:	m_impl(new Impl(typeRegistry, indent))
+{
+}
+JsonWriter::~JsonWriter()
+{
+}
+
+const char* JsonWriter::Write(const void* object, const TypeClass* type, size_t* outLength)
+{
+	return m_impl->Write(object, type, outLength);
+}
+int JsonWriter::GetNumPlans() const
+{
+	return m_impl->m_plans.GetNumPlans();
+}
+
+//=============================================================================
+struct JsonReader::Impl
+{
+	// Longest type/enum constant name/key with escape sequences.
+	enum
+	{
+		MAX_NAME_LENGTH	= 256
+	};
+	struct ObjectEntry
+	{
+		void*			object;
+		const JsonPlan*	plan;
+	};
+	// References are resolved once all objects are known.
+	struct PointerFixup
+	{
+		void**			pointer;
+		uint32			id;
+		// Pointed type.
+		const JsonPlan*	plan;
+		const char*		position;
+	};
+
+	Impl(const TypeRegistry& typeRegistry, FnAllocate pfnAllocate, void* userData)
+	:	m_plans(typeRegistry),
+		m_pfnAllocate(pfnAllocate ? pfnAllocate : AllocateWithNew),
+		m_userData(userData),
+		m_begin(0),
+		m_end(0),
+		m_error(0),
+		m_errorPosition(0)
+	{
+	}
+
+	void* Read(const char* json, size_t length, const TypeClass* type)
+	{
+		RDE_ASSERT(type != 0);
+		m_begin = json;
+		m_end = json + length;
+		m_error = 0;
+		m_errorPosition = json;
+
+		void* root(0);
+		if (ParseDocument() && ResolveFixups())
+		{
+			if (m_objects.empty())
+			{
+				Fail("No objects", json);
+			}
+			else
+			{
+				const ObjectEntry& rootEntry = m_objects[0];
+				if (rootEntry.plan->kind == ValueKind::CLASS)
+				{
+					root = DynamicCast(rootEntry.object, static_cast<const TypeClass*>(rootEntry.plan->type),
+						type);
+				}
+				if (root == 0)
+					Fail("Root object is of wrong type", json);
+			}
+		}
+		if (root == 0)
+			ReleaseObjects();
+
+		m_objects.clear();
+		m_fixups.clear();
+		m_buffers.clear();
+		return root;
+	}
+
+	bool ParseDocument()
+	{
+		const char* p = SkipWhitespace(m_begin, m_end);
+		if (p == m_end || *p != '[')
+			return Fail("Expected '['", p) != 0;
+		p = SkipWhitespace(p + 1, m_end);
+		if (p != m_end && *p == ']')
+		{
+			++p;
+		}
+		else
+		{
+			for (;;)
+			{
+				p = ParseObject(p);
+				if (p == 0)
+					return false;
+				p = SkipWhitespace(p, m_end);
+				if (p != m_end && *p == ',')
+				{
+					p = SkipWhitespace(p + 1, m_end);
+					continue;
+				}
+				if (p != m_end && *p == ']')
+				{
+					++p;
+					break;
+				}
+				return Fail("Expected ',' or ']'", p) != 0;
+			}
+		}
+		p = SkipWhitespace(p, m_end);
+		if (p != m_end)
+			return Fail("Unexpected data after document", p) != 0;
+		return true;
+	}
+
+	// Top-level object.
+	const char* ParseObject(const char* p)
+	{
+		if (p == m_end || *p != '{')
+			return Fail("Expected '{'", p);
+		const uint32 id = uint32(m_objects.size());
+		const JsonPlan* plan(0);
+		const char* key;
+		uint32 keyLength;
+		p = SkipWhitespace(p + 1, m_end);
+		while (plan == 0)
+		{
+			const char* keyPosition = p;
+			p = ParseKey(p, key, keyLength);
+			if (p == 0)
+				return 0;
+			if (keyLength == 3 && memcmp(key, "$id", 3) == 0)
+			{
+				JsonNumber number;
+				const char* idPosition = p;
+				p = ParseNumber(p, m_end, number);
+				if (p == 0 || !number.isInteger || number.negative || number.magnitude != id)
+					return Fail("Invalid $id (has to be index of object)", idPosition);
+				p = SkipWhitespace(p, m_end);
+				if (p == m_end || *p != ',')
+					return Fail("Expected ','", p);
+				p = SkipWhitespace(p + 1, m_end);
+			}
+			else if (keyLength == 5 && memcmp(key, "$type", 5) == 0)
+			{
+				const char* namePosition = p;
+				uint32 nameLength;
+				p = ParseName(p, nameLength);
+				if (p == 0)
+					return 0;
+				const Type* type = m_plans.m_typeRegistry.FindType(NameHash(m_name, nameLength));
+				if (type == 0)
+					return Fail("Unknown type", namePosition);
+				plan = m_plans.GetPlan(type);
+				if (plan->kind == ValueKind::UNSUPPORTED)
+					return Fail("Type cannot be read", namePosition);
+			}
+			else
+			{
+				return Fail("Expected $type", keyPosition);
+			}
+		}
+
+		uint8* object = static_cast<uint8*>(m_pfnAllocate(plan->size, m_userData));
+		memset(object, 0, plan->size);
+		if (plan->vtableClass != 0)
+			plan->vtableClass->InitVTable(object);
+		ObjectEntry entry = { object, plan };
+		m_objects.push_back(entry);
+
+		if (plan->kind == ValueKind::CLASS)
+			return ParseMembers(p, *plan, object, false);
+
+		p = SkipWhitespace(p, m_end);
+		if (p == m_end || *p != ',')
+			return Fail("Expected ','", p);
+		p = SkipWhitespace(p + 1, m_end);
+		const char* keyPosition = p;
+		p = ParseKey(p, key, keyLength);
+		if (p == 0)
+			return 0;
+		if (keyLength != 6 || memcmp(key, "$value", 6) != 0)
+			return Fail("Expected $value", keyPosition);
+		p = ParseValue(p, *plan, object);
+		if (p == 0)
+			return 0;
+		p = SkipWhitespace(p, m_end);
+		if (p == m_end || *p != '}')
+			return Fail("Expected '}'", p);
+		return p + 1;
+	}
+
+	// first: p points just after '{', otherwise after previous value.
+	// @return pointer past closing '}'.
+	const char* ParseMembers(const char* p, const JsonPlan& plan, uint8* data, bool first)
+	{
+		p = SkipWhitespace(p, m_end);
+		if (p != m_end && *p == '}')
+			return p + 1;
+		if (!first)
+		{
+			if (p == m_end || *p != ',')
+				return Fail("Expected ',' or '}'", p);
+			p = SkipWhitespace(p + 1, m_end);
+		}
+		uint32 expectedIndex(0);
+		for (;;)
+		{
+			const char* key;
+			uint32 keyLength;
+			p = ParseKey(p, key, keyLength);
+			if (p == 0)
+				return 0;
+			const JsonMember* member = plan.FindMember(key, keyLength, expectedIndex);
+			if (member != 0)
+			{
+				p = ParseValue(p, *member->plan, data + member->offset);
+				expectedIndex = uint32(member - plan.members.begin()) + 1;
+			}
+			else
+			{
+				const char* valuePosition = p;
+				p = SkipValue(p, m_end);
+				if (p == 0)
+					return Fail("Invalid value", valuePosition);
+			}
+			if (p == 0)
+				return 0;
+			p = SkipWhitespace(p, m_end);
+			if (p != m_end && *p == ',')
+			{
+				p = SkipWhitespace(p + 1, m_end);
+				continue;
+			}
+			if (p != m_end && *p == '}')
+				return p + 1;
+			return Fail("Expected ',' or '}'", p);
+		}
+	}
+
+	// @return pointer to value (past ':' and whitespace).
+	const char* ParseKey(const char* p, const char*& key, uint32& keyLength)
+	{
+		if (p == m_end || *p != '"')
+			return Fail("Expected key", p);
+		++p;
+		const char* q = FindStringSpecial(p, m_end);
+		if (q == m_end)
+			return Fail("Unterminated string", p);
+		if (*q == '"')
+		{
+			// No escapes (always the case for names of fields).
+			key = p;
+			keyLength = uint32(q - p);
+			p = q + 1;
+		}
+		else
+		{
+			p = ParseName(p - 1, keyLength);
+			if (p == 0)
+				return 0;
+			key = m_name;
+		}
+		p = SkipWhitespace(p, m_end);
+		if (p == m_end || *p != ':')
+			return Fail("Expected ':'", p);
+		return SkipWhitespace(p + 1, m_end);
+	}
+	// Decodes string to name buffer.
+	const char* ParseName(const char* p, uint32& length)
+	{
+		size_t decodedLength;
+		p = ParseString(p, m_name, sizeof(m_name), decodedLength);
+		if (p == 0)
+			return 0;
+		if (decodedLength >= sizeof(m_name))
+			return Fail("Name too long", p);
+		length = uint32(decodedLength);
+		return p;
+	}
+
+	// p points at opening quote. Characters that don't fit are dropped,
+	// but still counted (so that caller can detect it).
+	// @return pointer past closing quote.
+	const char* ParseString(const char* p, char* out, size_t capacity, size_t& outLength)
+	{
+		if (p == m_end || *p != '"')
+			return Fail("Expected string", p);
+		++p;
+		size_t length(0);
+		for (;;)
+		{
+			const char* run = p;
+			p = FindStringSpecial(p, m_end);
+			if (p == m_end)
+				return Fail("Unterminated string", run);
+			const size_t runLength = size_t(p - run);
+			if (length < capacity)
+				memcpy(out + length, run, runLength < capacity - length ? runLength : capacity - length);
+			length += runLength;
+			if (*p == '"')
+				break;
+
+			// Escape sequence.
+			const char* escapePosition = p;
+			if (m_end - p < 2)
+				return Fail("Unterminated string", p);
+			char decoded[4];
+			size_t decodedLength(1);
+			switch (p[1])
+			{
+			case '"':	decoded[0] = '"'; break;
+			case '\\':	decoded[0] = '\\'; break;
+			case '/':	decoded[0] = '/'; break;
+			case 'b':	decoded[0] = '\b'; break;
+			case 'f':	decoded[0] = '\f'; break;
+			case 'n':	decoded[0] = '\n'; break;
+			case 'r':	decoded[0] = '\r'; break;
+			case 't':	decoded[0] = '\t'; break;
+			case 'u':
+				{
+					uint32 codePoint;
+					p = ParseCodePoint(p, codePoint);
+					if (p == 0)
+						return Fail("Invalid \\u escape", escapePosition);
+					decodedLength = EncodeUtf8(codePoint, decoded);
+				}
+				break;
+			default:
+				return Fail("Invalid escape", p);
+			}
+			if (p == escapePosition)
+				p += 2;
+			for (size_t i = 0; i < decodedLength; ++i, ++length)
+			{
+				if (length < capacity)
+					out[length] = decoded[i];
+			}
+		}
+		outLength = length;
+		return p + 1;
+	}
+	// p points at \uXXXX (surrogate pairs are combined).
+	// @return pointer past the sequence, NULL if invalid.
+	const char* ParseCodePoint(const char* p, uint32& codePoint)
+	{
+		if (!ParseHex4(p, codePoint))
+			return 0;
+		p += 6;
+		if (codePoint >= 0xD800 && codePoint < 0xDC00)
+		{
+			uint32 low;
+			if (m_end - p < 6 || p[0] != '\\' || !ParseHex4(p, low) || low < 0xDC00 || low >= 0xE000)
+				return 0;
+			codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+			p += 6;
+		}
+		return p;
+	}
+	bool ParseHex4(const char* p, uint32& value) const
+	{
+		if (m_end - p < 6 || p[1] != 'u')
+			return false;
+		value = 0;
+		for (int i = 2; i < 6; ++i)
+		{
+			const char c = p[i];
+			uint32 digit;
+			if (IsDigit(c))
+				digit = uint32(c - '0');
+			else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+				digit = uint32((c | 0x20) - 'a' + 10);
+			else
+				return false;
+			value = (value << 4) | digit;
+		}
+		return true;
+	}
+	static size_t EncodeUtf8(uint32 codePoint, char* out)
+	{
+		if (codePoint < 0x80)
+		{
+			out[0] = char(codePoint);
+			return 1;
+		}
+		if (codePoint < 0x800)
+		{
+			out[0] = char(0xC0 | (codePoint >> 6));
+			out[1] = char(0x80 | (codePoint & 0x3F));
+			return 2;
+		}
+		if (codePoint < 0x10000)
+		{
+			out[0] = char(0xE0 | (codePoint >> 12));
+			out[1] = char(0x80 | ((codePoint >> 6) & 0x3F));
+			out[2] = char(0x80 | (codePoint & 0x3F));
+			return 3;
+		}
+		out[0] = char(0xF0 | (codePoint >> 18));
+		out[1] = char(0x80 | ((codePoint >> 12) & 0x3F));
+		out[2] = char(0x80 | ((codePoint >> 6) & 0x3F));
+		out[3] = char(0x80 | (codePoint & 0x3F));
+		return 4;
+	}
+
+	const char* ParseValue(const char* p, const JsonPlan& plan, uint8* data)
+	{
+		switch (plan.kind)
+		{
+		case ValueKind::BOOL:
+			if (MatchLiteral(p, m_end, "true", 4))
+			{
+				*data = 1;
+				return p + 4;
+			}
+			if (MatchLiteral(p, m_end, "false", 5))
+			{
+				*data = 0;
+				return p + 5;
+			}
+			return Fail("Expected true or false", p);
+		case ValueKind::INT:
+		case ValueKind::UINT:
+			{
+				JsonNumber number;
+				const char* numberEnd = ParseNumber(p, m_end, number);
+				if (numberEnd == 0 || !number.isInteger)
+					return Fail("Expected integer", p);
+				if (!StoreCheckedInteger(plan, number, data))
+					return Fail("Integer out of range", p);
+				return numberEnd;
+			}
+		case ValueKind::FLOAT:
+		case ValueKind::DOUBLE:
+			{
+				JsonNumber number;
+				const char* numberEnd;
+				if (MatchLiteral(p, m_end, "null", 4))
+				{
+					number.value = NaN();
+					numberEnd = p + 4;
+				}
+				else
+				{
+					numberEnd = ParseNumber(p, m_end, number);
+					if (numberEnd == 0)
+						return Fail("Expected number", p);
+				}
+				if (plan.kind == ValueKind::FLOAT)
+					*reinterpret_cast<float*>(data) = float(number.value);
+				else
+					*reinterpret_cast<double*>(data) = number.value;
+				return numberEnd;
+			}
+		case ValueKind::ENUM:
+			{
+				if (p == m_end || *p != '"')
+				{
+					// Values without constants.
+					JsonNumber number;
+					const char* numberEnd = ParseNumber(p, m_end, number);
+					if (numberEnd == 0 || !number.isInteger)
+						return Fail("Expected enum constant", p);
+					if (!StoreCheckedInteger(plan, number, data))
+						return Fail("Integer out of range", p);
+					return numberEnd;
+				}
+				const char* namePosition = p;
+				uint32 nameLength;
+				p = ParseName(p, nameLength);
+				if (p == 0)
+					return 0;
+				const TypeEnum::Constant* constant =
+					static_cast<const TypeEnum*>(plan.type)->FindConstant(NameHash(m_name, nameLength));
+				if (constant == 0)
+					return Fail("Unknown enum constant", namePosition);
+				StoreInteger(data, plan.size, uint64(int64(constant->m_value)));
+				return p;
+			}
+		case ValueKind::STRING:
+			{
+				// Always zero terminated, too long strings are truncated.
+				size_t length;
+				p = ParseString(p, reinterpret_cast<char*>(data), plan.count - 1, length);
+				if (p != 0)
+					data[length < plan.count - 1 ? length : plan.count - 1] = 0;
+				return p;
+			}
+		case ValueKind::ARRAY:
+			return ParseArray(p, *plan.element, data, plan.count);
+		case ValueKind::VECTOR:
+			return ParseVector(p, plan, data);
+		case ValueKind::POINTER:
+			{
+				*reinterpret_cast<void**>(data) = 0;
+				if (MatchLiteral(p, m_end, "null", 4))
+					return p + 4;
+				const char* refPosition = p;
+				if (p == m_end || *p != '{')
+					return Fail("Expected $ref object or null", p);
+				const char* key;
+				uint32 keyLength;
+				p = ParseKey(SkipWhitespace(p + 1, m_end), key, keyLength);
+				if (p == 0)
+					return 0;
+				if (keyLength != 4 || memcmp(key, "$ref", 4) != 0)
+					return Fail("Expected $ref", refPosition);
+				JsonNumber number;
+				const char* idPosition = p;
+				p = ParseNumber(p, m_end, number);
+				if (p == 0 || !number.isInteger || number.negative || number.magnitude > 0xFFFFFFFF)
+					return Fail("Invalid $ref", idPosition);
+				p = SkipWhitespace(p, m_end);
+				if (p == m_end || *p != '}')
+					return Fail("Expected '}'", p);
+				PointerFixup fixup = { reinterpret_cast<void**>(data), uint32(number.magnitude),
+					plan.element, refPosition };
+				m_fixups.push_back(fixup);
+				return p + 1;
+			}
+		case ValueKind::CLASS:
+			if (p == m_end || *p != '{')
+				return Fail("Expected '{'", p);
+			return ParseMembers(p + 1, plan, data, true);
+		default:
+			RDE_ASSERT(!"Unsupported types should never be read");
+			return Fail("Unsupported type", p);
+		}
+	}
+	// Reads up to maxElements, the rest (if any) is an error.
+	const char* ParseArray(const char* p, const JsonPlan& elementPlan, uint8* data, uint32 maxElements)
+	{
+		if (p == m_end || *p != '[')
+			return Fail("Expected '['", p);
+		p = SkipWhitespace(p + 1, m_end);
+		if (p != m_end && *p == ']')
+			return p + 1;
+		for (uint32 i = 0; ; ++i)
+		{
+			if (i == maxElements)
+				return Fail("Too many array elements", p);
+			p = ParseValue(p, elementPlan, data + i * elementPlan.size);
+			if (p == 0)
+				return 0;
+			p = SkipWhitespace(p, m_end);
+			if (p != m_end && *p == ',')
+			{
+				p = SkipWhitespace(p + 1, m_end);
+				continue;
+			}
+			if (p != m_end && *p == ']')
+				return p + 1;
+			return Fail("Expected ',' or ']'", p);
+		}
+	}
+	const char* ParseVector(const char* p, const JsonPlan& plan, uint8* data)
+	{
+		if (p == m_end || *p != '[')
+			return Fail("Expected '['", p);
+		// Counting pass first, so that storage is allocated only once.
+		uint32 numElements;
+		if (SkipComposite(p, m_end, &numElements) == 0)
+			return Fail("Unterminated array", p);
+
+		const JsonPlan& elementPlan = *plan.element;
+		// 64-bit, so that it can't wrap (big elements take as little as "{}" of input).
+		const uint64 totalBytes = uint64(numElements) * elementPlan.size;
+		if (totalBytes > VectorLayout::MAX_BYTES)
+			return Fail("Array too big", p);
+		const uint32 bytes = uint32(totalBytes);
+		uint8* begin(0);
+		if (bytes != 0)
+		{
+			begin = static_cast<uint8*>(operator new(bytes));
+			m_buffers.push_back(begin);
+			memset(begin, 0, bytes);
+			if (elementPlan.vtableClass != 0)
+			{
+				for (uint32 i = 0; i < numElements; ++i)
+					elementPlan.vtableClass->InitVTable(begin + i * elementPlan.size);
+			}
+		}
+		*reinterpret_cast<uint8**>(data + plan.beginOffset) = begin;
+		*reinterpret_cast<uint8**>(data + plan.endOffset) = begin + bytes;
+		if (plan.capacityOffset != JsonPlan::NO_OFFSET)
+			*reinterpret_cast<base_vector::size_type*>(data + plan.capacityOffset) = numElements;
+		return ParseArray(p, elementPlan, begin, numElements);
+	}
+
+	// @return false if value doesn't fit.
+	static bool StoreCheckedInteger(const JsonPlan& plan, const JsonNumber& number, uint8* data)
+	{
+		const uint32 bits = plan.size * 8;
+		if (plan.kind == ValueKind::UINT)
+		{
+			if (number.negative && number.magnitude != 0)
+				return false;
+			if (bits < 64 && number.magnitude > (uint64(1) << bits) - 1)
+				return false;
+			StoreInteger(data, plan.size, number.magnitude);
+			return true;
+		}
+		// Magnitude of min value is one more than max.
+		const uint64 maxMagnitude = (uint64(1) << (bits - 1)) - (number.negative ? 0 : 1);
+		if (number.magnitude > maxMagnitude)
+			return false;
+		StoreInteger(data, plan.size, number.negative ? uint64(0) - number.magnitude : number.magnitude);
+		return true;
+	}
+	static double NaN()
+	{
+		double zero(0.0);
+		return zero / zero;
+	}
+
+	bool ResolveFixups()
+	{
+		for (PointerFixups::const_iterator it = m_fixups.begin(); it != m_fixups.end(); ++it)
+		{
+			if (it->id >= uint32(m_objects.size()))
+				return Fail("$ref to object that doesn't exist", it->position) != 0;
+			const ObjectEntry& target = m_objects[it->id];
+			uint8* object = static_cast<uint8*>(target.object);
+			if (target.plan != it->plan)
+			{
+				// Derived class can be referenced through pointer to base.
+				const TypeClass* objectType = static_cast<const TypeClass*>(target.plan->type);
+				const TypeClass* pointedType = static_cast<const TypeClass*>(it->plan->type);
+				if (target.plan->kind != ValueKind::CLASS || it->plan->kind != ValueKind::CLASS ||
+					!objectType->IsDerivedFrom(pointedType))
+				{
+					return Fail("$ref to object of wrong type", it->position) != 0;
+				}
+				object += objectType->CalcOffsetFrom(pointedType);
+			}
+			*it->pointer = object;
+		}
+		return true;
+	}
+
+	void ReleaseObjects()
+	{
+		for (Buffers::iterator it = m_buffers.begin(); it != m_buffers.end(); ++it)
+			operator delete(*it);
+		if (m_pfnAllocate == AllocateWithNew)
+		{
+			for (ObjectEntries::iterator it = m_objects.begin(); it != m_objects.end(); ++it)
+				operator delete(it->object);
+		}
+	}
+
+	// Always returns NULL (so it can be returned right away by parsing functions).
+	const char* Fail(const char* error, const char* position)
+	{
+		if (m_error == 0)
+		{
+			m_error = error;
+			m_errorPosition = position;
+		}
+		return 0;
+	}
+
+	typedef rde::vector<ObjectEntry>	ObjectEntries;
+	typedef rde::vector<PointerFixup>	PointerFixups;
+	typedef rde::vector<void*>			Buffers;
+
+	JsonPlanCache		m_plans;
+	FnAllocate			m_pfnAllocate;
+	void*				m_userData;
+	const char*			m_begin;
+	const char*			m_end;
+	const char*			m_error;
+	const char*			m_errorPosition;
+	ObjectEntries		m_objects;
+	PointerFixups		m_fixups;
+	// Vector storage, released on errors.
+	Buffers				m_buffers;
+	char				m_name[MAX_NAME_LENGTH];
+};
+
+JsonReader::JsonReader(const TypeRegistry& typeRegistry, FnAllocate pfnAllocate, void* userData)
+:	m_impl(new Impl(typeRegistry, pfnAllocate, userData))
+{
+}
+JsonReader::~JsonReader()
+{
+}
+
+void* JsonReader::Read(const char* json, size_t length, const TypeClass* type)
+{
+	return m_impl->Read(json, length, type);
+}
+const char* JsonReader::GetError() const
+{
+	return m_impl->m_error;
+}
+size_t JsonReader::GetErrorOffset() const
+{
+	return size_t(m_impl->m_errorPosition - m_impl->m_begin);
+}
+int JsonReader::GetNumPlans() const
+{
+	return m_impl->m_plans.GetNumPlans();
+}
+
+} // rde
@@ -0,0 +1,95 @@
+#ifndef JSON_SERIALIZER_H
+#define JSON_SERIALIZER_H
+
+#include "core/ScopedPtr.h"
+#include "reflection/Type.h"
+
+namespace rde
+{
+class TypeClass;
+
+// Reflection driven JSON text format. Document is an array of objects, first
+// one is the root, the rest are objects reachable through pointers:
+//	[
+//		{ "$id": 0, "$type": "Node", "name": "root", "kind": "LEAF", "next": { "$ref": 1 } },
+//		{ "$id": 1, "$type": "Node", ... },
+//		{ "$id": 2, "$type": "float", "$value": 1.5 }
+//	]
+//	- fields of base classes are written as members of object itself,
+//	- nested classes are nested JSON objects,
+//	- enums are written by name (as numbers if there's no matching constant),
+//	- char arrays are strings, other arrays and rde::vectors are JSON arrays,
+//	- pointers are { "$ref": id } or null, every object is written once
+//	  (shared references and cycles are preserved),
+//	- non-finite floats are written as null (read as NaN),
+//	- NO_SERIALIZE fields and pointers to unregistered types are skipped.
+// Pointed objects are assumed to be of pointed (static) type.
+class JsonWriter
+{
+public:
+	explicit JsonWriter(const TypeRegistry& typeRegistry, bool indent = true);
+	~JsonWriter();
+
+	// Returns zero terminated text, valid until next Write call.
+	const char* Write(const void* object, const TypeClass* type, size_t* outLength = 0);
+
+	// Number of types compiled so far.
+	int GetNumPlans() const;
+
+private:
+	RDE_FORBID_COPY(JsonWriter);
+
+	struct Impl;
+	ScopedPtr<Impl>	m_impl;
+};
+
+// Reads documents written by JsonWriter. Every type is compiled (once,
+// on first use) into list of members with precomputed key hash table, so
+// keys are matched without walking fields. Members don't have to be in any
+// particular order, missing ones are left zeroed, unknown ones are skipped.
+// "$type" has to be the first member of top-level object ("$id" may precede it).
+// Text is parsed in single pass, without any allocations except of objects
+// and vector storage (scanning is done 16 bytes at a time with SSE2).
+// Rules for new objects are the same as for DeepCloner:
+//	- objects are NOT constructed, only zeroed and vtable is initialized,
+//	- rde::vector storage is allocated with operator new, capacity == size.
+class JsonReader
+{
+public:
+	// Allocates memory for new objects (not vector storage).
+	typedef void* (*FnAllocate)(size_t bytes, void* userData);
+
+	// Default allocation is operator new. Objects are released on errors
+	// only if default allocation is used.
+	explicit JsonReader(const TypeRegistry& typeRegistry, FnAllocate pfnAllocate = 0,
+		void* userData = 0);
+	~JsonReader();
+
+	// Text doesn't have to be zero terminated.
+	// Root object has to be of given type (or derived from it).
+	// @return root object, NULL on error (see GetError).
+	void* Read(const char* json, size_t length, const TypeClass* type);
+	template<typename T>
+	T* Read(const char* json, size_t length, const TypeClass* type)
+	{
+		return static_cast<T*>(Read(json, length, type));
+	}
+
+	// Description of last error, NULL if last Read succeeded.
+	const char* GetError() const;
+	// Position in text where last error was detected.
+	size_t GetErrorOffset() const;
+
+	// Number of types compiled so far.
+	int GetNumPlans() const;
+
+private:
+	RDE_FORBID_COPY(JsonReader);
+
+	struct Impl;
+	ScopedPtr<Impl>	m_impl;
+};
+
+} // rde
+
+#endif
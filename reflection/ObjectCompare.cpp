@@ -0,0 +1,544 @@
+#include "reflection/ObjectCompare.h"
+#include "reflection/TypeClass.h"
+#include "reflection/TypeRegistry.h"
+#include "rdestl/flat_hash_map.h"
+#include "rdestl/sort.h"
+#include "rdestl/vector.h"
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#	define RDE_OBJECT_COMPARE_SSE2	1
+#	include <emmintrin.h>
+#else
+#	define RDE_OBJECT_COMPARE_SSE2	0
+#endif
+
+namespace
+{
+bool BlocksEqual(const rde::uint8* a, const rde::uint8* b, size_t bytes)
+{
+#if RDE_OBJECT_COMPARE_SSE2
+	while (bytes >= 16)
+	{
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF)
+			return false;
+		a += 16;
+		b += 16;
+		bytes -= 16;
+	}
+#endif
+	return bytes == 0 || memcmp(a, b, bytes) == 0;
+}
+
+bool FloatsEqual(float a, float b)
+{
+	return a == b || (a != a && b != b);
+}
+bool DoublesEqual(double a, double b)
+{
+	return a == b || (a != a && b != b);
+}
+
+// MurmurHash3 (x86, 32-bit) building blocks, data is fed 4 bytes at a time.
+inline rde::uint32 RotateLeft(rde::uint32 x, int r)
+{
+	return (x << r) | (x >> (32 - r));
+}
+inline rde::uint32 MixWord(rde::uint32 h, rde::uint32 k)
+{
+	k *= 0xCC9E2D51;
+	k = RotateLeft(k, 15);
+	k *= 0x1B873593;
+	h ^= k;
+	h = RotateLeft(h, 13);
+	return h * 5 + 0xE6546B64;
+}
+rde::uint32 MixBlock(rde::uint32 h, const rde::uint8* data, size_t bytes)
+{
+	while (bytes >= 4)
+	{
+		rde::uint32 k;
+		memcpy(&k, data, sizeof(k));
+		h = MixWord(h, k);
+		data += 4;
+		bytes -= 4;
+	}
+	if (bytes != 0)
+	{
+		rde::uint32 k(0);
+		memcpy(&k, data, bytes);
+		h = MixWord(h, k);
+	}
+	return h;
+}
+inline rde::uint32 MixFloat(rde::uint32 h, float f)
+{
+	// Values that compare equal have to hash the same (0/-0, NaNs).
+	rde::uint32 bits(0);
+	if (f != f)
+		bits = 0x7FC00000;
+	else if (f != 0.f)
+		memcpy(&bits, &f, sizeof(bits));
+	return MixWord(h, bits);
+}
+inline rde::uint32 MixDouble(rde::uint32 h, double d)
+{
+	rde::uint32 bits[2] = { 0, 0 };
+	if (d != d)
+		bits[1] = 0x7FF80000;
+	else if (d != 0.0)
+		memcpy(bits, &d, sizeof(bits));
+	return MixWord(MixWord(h, bits[0]), bits[1]);
+}
+inline rde::uint32 FinalizeHash(rde::uint32 h)
+{
+	h ^= h >> 16;
+	h *= 0x85EBCA6B;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35;
+	h ^= h >> 16;
+	return h;
+}
+}
+
+namespace rde
+{
+struct ObjectComparer::Impl
+{
+	struct Plan;
+	struct Op
+	{
+		// In order they're executed (cheap tests first).
+		enum Kind
+		{
+			BYTES,
+			FLOATS,
+			DOUBLES,
+			POINTER,
+			VECTOR
+		};
+		Op(Kind kind_, uint32 offset_, uint32 count_, const Plan* plan_ = 0)
+		:	kind(kind_),
+			offset(offset_),
+			count(count_),
+			plan(plan_)
+		{
+		}
+
+		// Offset of first byte after data covered by this op.
+		uint32 GetEndOffset() const
+		{
+			if (kind == FLOATS)
+				return offset + count * sizeof(float);
+			if (kind == DOUBLES)
+				return offset + count * sizeof(double);
+			return offset + count;
+		}
+
+		Kind		kind;
+		// VECTOR: offset of begin pointer.
+		uint32		offset;
+		// BYTES: bytes, FLOATS/DOUBLES: number of elements, VECTOR: offset of end pointer.
+		uint32		count;
+		// POINTER: pointed type, VECTOR: element type.
+		const Plan*	plan;
+	};
+	typedef rde::vector<Op>	Ops;
+	struct OpLess
+	{
+		bool operator()(const Op& lhs, const Op& rhs) const
+		{
+			return lhs.kind < rhs.kind || (lhs.kind == rhs.kind && lhs.offset < rhs.offset);
+		}
+	};
+
+	struct Plan
+	{
+		Plan(): size(0), followsPointers(true) {}
+
+		// True if type is one block of plain data without padding.
+		bool IsPlainData() const
+		{
+			return ops.size() == 1 && ops[0].kind == Op::BYTES && ops[0].count == size;
+		}
+
+		uint32	size;
+		// False if objects of this type never lead to other objects (no
+		// need to track visited ones then).
+		bool	followsPointers;
+		Ops		ops;
+	};
+	typedef rde::flat_hash_map<const Type*, Plan*>	Plans;
+
+	struct PendingObject
+	{
+		const void*	a;
+		const void*	b;
+		const Plan*	plan;
+	};
+	typedef rde::vector<PendingObject>									PendingObjects;
+	typedef rde::flat_hash_map<const void*, const void*>	ObjectMap;
+	// Object -> order of first visit.
+	typedef rde::flat_hash_map<const void*, uint32>		VisitedObjects;
+
+	explicit Impl(const TypeRegistry& typeRegistry)
+	:	m_typeRegistry(typeRegistry)
+	{
+	}
+	~Impl()
+	{
+		for (Plans::iterator it = m_plans.begin(); it != m_plans.end(); ++it)
+			delete it->second;
+	}
+
+	bool Equals(const void* a, const void* b, const TypeClass* type)
+	{
+		if (a == b)
+			return true;
+		if (a == 0 || b == 0)
+			return false;
+		const Plan* plan = GetPlan(type);
+		if (!plan->followsPointers)
+			return RunEquals(*plan, static_cast<const uint8*>(a), static_cast<const uint8*>(b));
+
+		m_pending.clear();
+		if (!m_aToB.empty())
+		{
+			m_aToB.clear();
+			m_bToA.clear();
+		}
+		bool equal = VisitPair(a, b, plan);
+		while (equal && !m_pending.empty())
+		{
+			const PendingObject pending = m_pending.back();
+			m_pending.pop_back();
+			equal = RunEquals(*pending.plan, static_cast<const uint8*>(pending.a),
+				static_cast<const uint8*>(pending.b));
+		}
+		return equal;
+	}
+	// Objects are matched 1:1, so graphs have to have the same shape.
+	bool VisitPair(const void* a, const void* b, const Plan* plan)
+	{
+		if (a == 0 || b == 0)
+			return a == b;
+		ObjectMap::iterator itA = m_aToB.find(a);
+		if (itA != m_aToB.end())
+			return itA->second == b;
+		if (m_bToA.find(b) != m_bToA.end())
+			return false;
+		m_aToB.insert(rde::make_pair(a, b));
+		m_bToA.insert(rde::make_pair(b, a));
+		const PendingObject pending = { a, b, plan };
+		m_pending.push_back(pending);
+		return true;
+	}
+	bool RunEquals(const Plan& plan, const uint8* a, const uint8* b)
+	{
+		for (Ops::const_iterator it = plan.ops.begin(); it != plan.ops.end(); ++it)
+		{
+			const uint32 offset = it->offset;
+			switch (it->kind)
+			{
+			case Op::BYTES:
+				if (!BlocksEqual(a + offset, b + offset, it->count))
+					return false;
+				break;
+			case Op::FLOATS:
+				{
+					const float* fa = reinterpret_cast<const float*>(a + offset);
+					const float* fb = reinterpret_cast<const float*>(b + offset);
+					for (uint32 i = 0; i < it->count; ++i)
+					{
+						if (!FloatsEqual(fa[i], fb[i]))
+							return false;
+					}
+				}
+				break;
+			case Op::DOUBLES:
+				{
+					const double* da = reinterpret_cast<const double*>(a + offset);
+					const double* db = reinterpret_cast<const double*>(b + offset);
+					for (uint32 i = 0; i < it->count; ++i)
+					{
+						if (!DoublesEqual(da[i], db[i]))
+							return false;
+					}
+				}
+				break;
+			case Op::POINTER:
+				if (!VisitPair(*reinterpret_cast<void* const*>(a + offset),
+					*reinterpret_cast<void* const*>(b + offset), it->plan))
+				{
+					return false;
+				}
+				break;
+			case Op::VECTOR:
+				{
+					const uint8* beginA = *reinterpret_cast<uint8* const*>(a + offset);
+					const uint8* beginB = *reinterpret_cast<uint8* const*>(b + offset);
+					const size_t bytes = size_t(*reinterpret_cast<uint8* const*>(a + it->count) - beginA);
+					if (bytes != size_t(*reinterpret_cast<uint8* const*>(b + it->count) - beginB))
+						return false;
+					const Plan& elementPlan = *it->plan;
+					if (elementPlan.IsPlainData())
+					{
+						if (!BlocksEqual(beginA, beginB, bytes))
+							return false;
+					}
+					else
+					{
+						for (size_t i = 0; i < bytes; i += elementPlan.size)
+						{
+							if (!RunEquals(elementPlan, beginA + i, beginB + i))
+								return false;
+						}
+					}
+				}
+				break;
+			}
+		}
+		return true;
+	}
+
+	uint32 Hash(const void* object, const TypeClass* type)
+	{
+		const Plan* plan = GetPlan(type);
+		if (object != 0 && !plan->followsPointers)
+			return FinalizeHash(RunHash(MixWord(0, 2), *plan, static_cast<const uint8*>(object)));
+
+		m_pending.clear();
+		if (!m_visited.empty())
+			m_visited.clear();
+		uint32 h = VisitObject(0, object, plan);
+		while (!m_pending.empty())
+		{
+			const PendingObject pending = m_pending.back();
+			m_pending.pop_back();
+			h = RunHash(h, *pending.plan, static_cast<const uint8*>(pending.a));
+		}
+		return FinalizeHash(h);
+	}
+	// Objects seen before only contribute order of first visit (that's
+	// what makes shared references/cycles part of the hash).
+	uint32 VisitObject(uint32 h, const void* object, const Plan* plan)
+	{
+		if (object == 0)
+			return MixWord(h, 0);
+		VisitedObjects::iterator it = m_visited.find(object);
+		if (it != m_visited.end())
+			return MixWord(MixWord(h, 1), it->second);
+		const uint32 order = m_visited.size();
+		m_visited.insert(rde::make_pair(object, order));
+		const PendingObject pending = { object, 0, plan };
+		m_pending.push_back(pending);
+		return MixWord(h, 2);
+	}
+	uint32 RunHash(uint32 h, const Plan& plan, const uint8* object)
+	{
+		for (Ops::const_iterator it = plan.ops.begin(); it != plan.ops.end(); ++it)
+		{
+			const uint32 offset = it->offset;
+			switch (it->kind)
+			{
+			case Op::BYTES:
+				h = MixBlock(h, object + offset, it->count);
+				break;
+			case Op::FLOATS:
+				{
+					const float* f = reinterpret_cast<const float*>(object + offset);
+					for (uint32 i = 0; i < it->count; ++i)
+						h = MixFloat(h, f[i]);
+				}
+				break;
+			case Op::DOUBLES:
+				{
+					const double* d = reinterpret_cast<const double*>(object + offset);
+					for (uint32 i = 0; i < it->count; ++i)
+						h = MixDouble(h, d[i]);
+				}
+				break;
+			case Op::POINTER:
+				h = VisitObject(h, *reinterpret_cast<void* const*>(object + offset), it->plan);
+				break;
+			case Op::VECTOR:
+				{
+					const uint8* begin = *reinterpret_cast<uint8* const*>(object + offset);
+					const size_t bytes = size_t(*reinterpret_cast<uint8* const*>(object + it->count) - begin);
+					h = MixWord(h, uint32(bytes));
+					const Plan& elementPlan = *it->plan;
+					if (elementPlan.IsPlainData())
+					{
+						h = MixBlock(h, begin, bytes);
+					}
+					else
+					{
+						for (size_t i = 0; i < bytes; i += elementPlan.size)
+							h = RunHash(h, elementPlan, begin + i);
+					}
+				}
+				break;
+			}
+		}
+		return h;
+	}
+
+	const Plan* GetPlan(const Type* type)
+	{
+		Plans::iterator it = m_plans.find(type);
+		if (it != m_plans.end())
+			return it->second;
+
+		// Registered before compiling, so that recursive types find it.
+		Plan* plan = new Plan();
+		plan->size = type->m_size;
+		m_plans.insert(rde::make_pair(type, plan));
+
+		Ops ops;
+		Compile(ops, type, 0);
+		// Data ops sorted by offset (fields of base classes come last),
+		// adjacent ones are merged.
+		rde::quick_sort(ops.begin(), ops.end(), OpLess());
+		for (Ops::const_iterator opIt = ops.begin(); opIt != ops.end(); ++opIt)
+		{
+			if (!plan->ops.empty())
+			{
+				Op& last = plan->ops.back();
+				const bool mergeable = (opIt->kind == Op::BYTES || opIt->kind == Op::FLOATS ||
+					opIt->kind == Op::DOUBLES);
+				if (mergeable && last.kind == opIt->kind && last.GetEndOffset() == opIt->offset)
+				{
+					last.count += opIt->count;
+					continue;
+				}
+			}
+			plan->ops.push_back(*opIt);
+		}
+		// Plans still being compiled (recursive types) count as following pointers.
+		plan->followsPointers = false;
+		for (Ops::const_iterator opIt = plan->ops.begin(); opIt != plan->ops.end(); ++opIt)
+		{
+			if (opIt->kind == Op::POINTER || (opIt->kind == Op::VECTOR && opIt->plan->followsPointers))
+				plan->followsPointers = true;
+		}
+		return plan;
+	}
+
+	void Compile(Ops& ops, const Type* type, uint32 offset)
+	{
+		switch (type->m_reflectionType)
+		{
+		case ReflectionType::FUNDAMENTAL:
+			if (type == TypeOf<float>())
+				ops.push_back(Op(Op::FLOATS, offset, 1));
+			else if (type == TypeOf<double>())
+				ops.push_back(Op(Op::DOUBLES, offset, 1));
+			else
+				ops.push_back(Op(Op::BYTES, offset, type->m_size));
+			break;
+		case ReflectionType::POINTER:
+			{
+				const TypePointer* tp = static_cast<const TypePointer*>(type);
+				const Type* pointedType = m_typeRegistry.FindType(tp->m_pointedTypeId);
+				// Unknown types are not followed, pointers have to be the same.
+				if (pointedType == 0)
+					ops.push_back(Op(Op::BYTES, offset, sizeof(void*)));
+				else
+					ops.push_back(Op(Op::POINTER, offset, sizeof(void*), GetPlan(pointedType)));
+			}
+			break;
+		case ReflectionType::ARRAY:
+			{
+				const TypeArray* ta = static_cast<const TypeArray*>(type);
+				const Type* containedType = m_typeRegistry.FindType(ta->m_containedTypeId);
+				if (containedType == 0)
+				{
+					ops.push_back(Op(Op::BYTES, offset, type->m_size));
+					break;
+				}
+				for (long i = 0; i < ta->m_numElements; ++i)
+					Compile(ops, containedType, offset + i * containedType->m_size);
+			}
+			break;
+		case ReflectionType::CLASS:
+			{
+				const TypeClass* tc = static_cast<const TypeClass*>(type);
+				if (tc->IsVector())
+				{
+					CompileVector(ops, tc, offset);
+					break;
+				}
+				const int numFields = tc->GetNumFields();
+				for (int i = 0; i < numFields; ++i)
+				{
+					const Field* field = tc->GetField(i);
+					if ((field->m_flags & FieldFlags::NO_SERIALIZE) == 0)
+					{
+						Compile(ops, field->m_type,
+							offset + tc->CalcOffsetFrom(field->m_ownerClass) + field->m_offset);
+					}
+				}
+			}
+			break;
+		default:
+			ops.push_back(Op(Op::BYTES, offset, type->m_size));
+			break;
+		}
+	}
+	void CompileVector(Ops& ops, const TypeClass* tc, uint32 offset)
+	{
+		// First two fields are begin/end pointers.
+		const Field* fieldBegin = tc->GetField(0);
+		const Field* fieldEnd = tc->GetField(1);
+		const TypePointer* tp = SafeReflectionCast<TypePointer>(fieldBegin->m_type);
+		const Type* elementType = m_typeRegistry.FindType(tp->m_pointedTypeId);
+		RDE_ASSERT(elementType != 0 && elementType->m_size != 0);
+		const uint32 beginOffset = offset + tc->CalcOffsetFrom(fieldBegin->m_ownerClass) + fieldBegin->m_offset;
+		const uint32 endOffset = offset + tc->CalcOffsetFrom(fieldEnd->m_ownerClass) + fieldEnd->m_offset;
+		ops.push_back(Op(Op::VECTOR, beginOffset, endOffset, GetPlan(elementType)));
+	}
+
+	const TypeRegistry&	m_typeRegistry;
+	Plans				m_plans;
+	PendingObjects		m_pending;
+	ObjectMap			m_aToB;
+	ObjectMap			m_bToA;
+	VisitedObjects		m_visited;
+};
+
+ObjectComparer::ObjectComparer(const TypeRegistry& typeRegistry)
+:	m_impl(new Impl(typeRegistry))
+{
+}
+ObjectComparer::~ObjectComparer()
+{
+}
+
+bool ObjectComparer::Equals(const void* a, const void* b, const TypeClass* type)
+{
+	return m_impl->Equals(a, b, type);
+}
+uint32 ObjectComparer::Hash(const void* object, const TypeClass* type)
+{
+	return m_impl->Hash(object, type);
+}
+
+int ObjectComparer::GetNumPlans() const
+{
+	return m_impl->m_plans.size();
+}
+
+bool Equals(const void* a, const void* b, const TypeClass* type, const TypeRegistry& typeRegistry)
+{
+	ObjectComparer comparer(typeRegistry);
+	return comparer.Equals(a, b, type);
+}
+uint32 Hash(const void* object, const TypeClass* type, const TypeRegistry& typeRegistry)
+{
+	ObjectComparer comparer(typeRegistry);
+	return comparer.Hash(object, type);
+}
+
+} // rde
@@ -0,0 +1,48 @@
+#ifndef OBJECT_COMPARE_H
+#define OBJECT_COMPARE_H
+
+#include "core/ScopedPtr.h"
+#include "reflection/Type.h"
+
+namespace rde
+{
+class TypeClass;
+
+// Structural equality/hashing of reflected objects (for change detection etc).
+// Every type is compiled (once, on first use) into list of operations:
+//	- contiguous plain data fields are merged into blocks, compared/hashed
+//	  at once (padding is never touched),
+//	- float/double fields are compared by value: 0.f == -0.f, NaNs are equal
+//	  to each other (so that changed NaN is not reported every time),
+//	- pointers are followed, rde::vector contents are compared.
+// Fields flagged NO_SERIALIZE are skipped.
+// Object graphs are equal if they have the same shape (shared references and
+// cycles in the same places) and equal data. Equal objects have equal hashes.
+// Pointed objects are assumed to be of pointed (static) type.
+class ObjectComparer
+{
+public:
+	explicit ObjectComparer(const TypeRegistry& typeRegistry);
+	~ObjectComparer();
+
+	bool Equals(const void* a, const void* b, const TypeClass* type);
+	uint32 Hash(const void* object, const TypeClass* type);
+
+	// Number of types compiled so far.
+	int GetNumPlans() const;
+
+private:
+	RDE_FORBID_COPY(ObjectComparer);
+
+	struct Impl;
+	ScopedPtr<Impl>	m_impl;
+};
+
+// One-shot versions, compile all needed types again for every call.
+// Use ObjectComparer for comparing/hashing many objects.
+bool Equals(const void* a, const void* b, const TypeClass* type, const TypeRegistry& typeRegistry);
+uint32 Hash(const void* object, const TypeClass* type, const TypeRegistry& typeRegistry);
+
+} // rde
+
+#endif
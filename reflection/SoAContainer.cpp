@@ -0,0 +1,176 @@
+#include "reflection/SoAContainer.h"
+#include "reflection/TypeClass.h"
+#include "core/System.h"
+
+namespace
+{
+size_t AlignColumnSize(size_t bytes)
+{
+	return (bytes + rde::SoAContainer::COLUMN_ALIGNMENT - 1) & ~size_t(rde::SoAContainer::COLUMN_ALIGNMENT - 1);
+}
+
+template<typename T>
+void CopyStrided(rde::uint8* dst, size_t dstStride, const rde::uint8* src, size_t srcStride, int count)
+{
+	for (int i = 0; i < count; ++i, dst += dstStride, src += srcStride)
+		*reinterpret_cast<T*>(dst) = *reinterpret_cast<const T*>(src);
+}
+// Most fields are 4 or 8 bytes, these don't need memcpy call per element.
+void CopyElements(rde::uint8* dst, size_t dstStride, const rde::uint8* src, size_t srcStride,
+	int count, rde::uint32 elementSize)
+{
+	switch (elementSize)
+	{
+	case 1:	CopyStrided<rde::uint8>(dst, dstStride, src, srcStride, count);	break;
+	case 2:	CopyStrided<rde::uint16>(dst, dstStride, src, srcStride, count);	break;
+	case 4:	CopyStrided<rde::uint32>(dst, dstStride, src, srcStride, count);	break;
+	case 8:	CopyStrided<rde::uint64>(dst, dstStride, src, srcStride, count);	break;
+	default:
+		for (int i = 0; i < count; ++i, dst += dstStride, src += srcStride)
+			rde::Sys::MemCpy(dst, src, elementSize);
+		break;
+	}
+}
+}
+
+namespace rde
+{
+SoAContainer::SoAContainer(const TypeClass* type)
+:	m_type(type),
+	m_block(0),
+	m_size(0),
+	m_capacity(0)
+{
+	RDE_ASSERT(type != 0);
+}
+SoAContainer::~SoAContainer()
+{
+	operator delete(m_block);
+}
+
+int SoAContainer::AddColumn(const StrId& fieldName)
+{
+	RDE_ASSERT(m_size == 0);
+	const Field* field = m_type->FindField(fieldName);
+	if (field == 0)
+		return -1;
+	RDE_ASSERT(field->m_type != 0);	// Not post-initialized?
+	Column column;
+	column.field = field;
+	column.data = 0;
+	column.offset = field->m_offset + m_type->CalcOffsetFrom(field->m_ownerClass);
+	column.size = field->m_type->m_size;
+	m_columns.push_back(column);
+	// Allocate storage for new column as well.
+	if (m_capacity != 0)
+	{
+		const int capacity = m_capacity;
+		m_capacity = 0;
+		Grow(capacity);
+	}
+	return m_columns.size() - 1;
+}
+int SoAContainer::FindColumn(const StrId& fieldName) const
+{
+	for (int i = 0; i < m_columns.size(); ++i)
+	{
+		if (m_columns[i].field->m_name == fieldName)
+			return i;
+	}
+	return -1;
+}
+
+void SoAContainer::Reserve(int capacity)
+{
+	if (capacity > m_capacity)
+		Grow(capacity);
+}
+void SoAContainer::Clear()
+{
+	m_size = 0;
+}
+
+int SoAContainer::PushBack(const void* object)
+{
+	if (m_size == m_capacity)
+		Grow(m_size + 1);
+	const uint8* src = static_cast<const uint8*>(object);
+	for (Columns::iterator it = m_columns.begin(); it != m_columns.end(); ++it)
+		Sys::MemCpy(it->data + m_size * it->size, src + it->offset, it->size);
+	return m_size++;
+}
+int SoAContainer::PushBack(const void* objects, size_t stride, int count)
+{
+	RDE_ASSERT(count >= 0);
+	if (m_size + count > m_capacity)
+		Grow(m_size + count);
+	// Column by column, so we write sequentially (and read objects several
+	// times, but they're usually much bigger than selected fields anyway).
+	const uint8* src = static_cast<const uint8*>(objects);
+	for (Columns::iterator it = m_columns.begin(); it != m_columns.end(); ++it)
+		CopyElements(it->data + m_size * it->size, it->size, src + it->offset, stride, count, it->size);
+	const int first = m_size;
+	m_size += count;
+	return first;
+}
+void SoAContainer::Erase(int index)
+{
+	RDE_ASSERT(index >= 0 && index < m_size);
+	const int numToMove = m_size - index - 1;
+	for (Columns::iterator it = m_columns.begin(); it != m_columns.end(); ++it)
+	{
+		uint8* dst = it->data + index * it->size;
+		Sys::MemMove(dst, dst + it->size, numToMove * it->size);
+	}
+	--m_size;
+}
+void SoAContainer::EraseUnordered(int index)
+{
+	RDE_ASSERT(index >= 0 && index < m_size);
+	--m_size;
+	if (index == m_size)
+		return;
+	for (Columns::iterator it = m_columns.begin(); it != m_columns.end(); ++it)
+		Sys::MemCpy(it->data + index * it->size, it->data + m_size * it->size, it->size);
+}
+
+void SoAContainer::Gather(int index, void* object) const
+{
+	RDE_ASSERT(index >= 0 && index < m_size);
+	uint8* dst = static_cast<uint8*>(object);
+	for (Columns::const_iterator it = m_columns.begin(); it != m_columns.end(); ++it)
+		Sys::MemCpy(dst + it->offset, it->data + index * it->size, it->size);
+}
+void SoAContainer::Gather(int first, int count, void* objects, size_t stride) const
+{
+	RDE_ASSERT(first >= 0 && count >= 0 && first + count <= m_size);
+	uint8* dst = static_cast<uint8*>(objects);
+	for (Columns::const_iterator it = m_columns.begin(); it != m_columns.end(); ++it)
+		CopyElements(dst + it->offset, stride, it->data + first * it->size, it->size, count, it->size);
+}
+
+void SoAContainer::Grow(int minCapacity)
+{
+	int newCapacity = (m_capacity < 16 ? 16 : m_capacity * 2);
+	if (newCapacity < minCapacity)
+		newCapacity = minCapacity;
+
+	size_t blockSize(0);
+	for (Columns::iterator it = m_columns.begin(); it != m_columns.end(); ++it)
+		blockSize += AlignColumnSize(size_t(newCapacity) * it->size);
+	// Extra space so that first column can be aligned (m_block is what we free).
+	void* newBlock = operator new(blockSize + COLUMN_ALIGNMENT);
+	uint8* columnData = reinterpret_cast<uint8*>(AlignColumnSize(reinterpret_cast<size_t>(newBlock)));
+	for (Columns::iterator it = m_columns.begin(); it != m_columns.end(); ++it)
+	{
+		if (m_size != 0)
+			Sys::MemCpy(columnData, it->data, m_size * it->size);
+		it->data = columnData;
+		columnData += AlignColumnSize(size_t(newCapacity) * it->size);
+	}
+	operator delete(m_block);
+	m_block = newBlock;
+	m_capacity = newCapacity;
+}
+
+} // rde
@@ -0,0 +1,106 @@
+#ifndef SOA_CONTAINER_H
+#define SOA_CONTAINER_H
+
+#include "reflection/Field.h"
+#include "rdestl/vector.h"
+
+namespace rde
+{
+class TypeClass;
+
+// Structure-of-arrays storage for chosen fields of reflected class.
+// Every field gets its own column (array of Field::m_type->m_size byte
+// elements), so kernels touching only few fields don't drag whole objects
+// through the cache. Columns are kept in a single block, every one of them
+// starts at COLUMN_ALIGNMENT boundary and has capacity rounded up, so SIMD
+// kernels can always process whole registers (elements past GetSize() are
+// undefined, but safe to read/write).
+// Field data is copied bitwise (fields should be plain data).
+class SoAContainer
+{
+public:
+	enum
+	{
+		COLUMN_ALIGNMENT	= 64
+	};
+
+	// Objects pushed/gathered have to be of given type (not derived).
+	explicit SoAContainer(const TypeClass* type);
+	~SoAContainer();
+
+	// Fields of base classes can be used as well. Only valid when container
+	// is empty.
+	// @return column index, -1 if there's no such field.
+	int AddColumn(const StrId& fieldName);
+	int GetNumColumns() const	{ return m_columns.size(); }
+	// -1 if there's no such column.
+	int FindColumn(const StrId& fieldName) const;
+	const Field* GetColumnField(int column) const	{ return m_columns[column].field; }
+
+	void* GetColumn(int column)
+	{
+		return m_columns[column].data;
+	}
+	const void* GetColumn(int column) const
+	{
+		return m_columns[column].data;
+	}
+	// T has to be of the same size as column elements.
+	template<typename T>
+	T* GetColumn(int column)
+	{
+		RDE_ASSERT(sizeof(T) == m_columns[column].size);
+		return static_cast<T*>(GetColumn(column));
+	}
+	template<typename T>
+	const T* GetColumn(int column) const
+	{
+		RDE_ASSERT(sizeof(T) == m_columns[column].size);
+		return static_cast<const T*>(GetColumn(column));
+	}
+
+	int GetSize() const		{ return m_size; }
+	int GetCapacity() const	{ return m_capacity; }
+	bool IsEmpty() const	{ return m_size == 0; }
+	void Reserve(int capacity);
+	void Clear();
+
+	// Copies column fields of object(s).
+	// @return index of (first) new element.
+	int PushBack(const void* object);
+	// i-th object is at (uint8*)objects + i * stride.
+	int PushBack(const void* objects, size_t stride, int count);
+	// Preserves order of remaining elements.
+	void Erase(int index);
+	// O(1), moves last element in place of erased one.
+	void EraseUnordered(int index);
+
+	// Writes column values back to object(s), other fields are not touched.
+	void Gather(int index, void* object) const;
+	void Gather(int first, int count, void* objects, size_t stride) const;
+
+private:
+	RDE_FORBID_COPY(SoAContainer);
+
+	struct Column
+	{
+		const Field*	field;
+		uint8*			data;
+		// Offset of field in objects of container class.
+		uint32			offset;
+		uint32			size;
+	};
+	typedef rde::vector<Column>	Columns;
+
+	void Grow(int minCapacity);
+
+	const TypeClass*	m_type;
+	Columns				m_columns;
+	void*				m_block;
+	int					m_size;
+	int					m_capacity;
+};
+
+} // rde
+
+#endif
@@ -0,0 +1,983 @@
+#include "reflection/TaggedBinary.h"
+#include "reflection/TypeClass.h"
+#include "reflection/TypeRegistry.h"
+#include "reflection/ValueKind.h"
+#include "rdestl/flat_hash_map.h"
+#include "rdestl/vector.h"
+#include "core/BitMath.h"
+#include <cstring>
+
+namespace
+{
+void* AllocateWithNew(size_t bytes, void*)
+{
+	return operator new(bytes);
+}
+
+namespace WireType
+{
+	enum Enum
+	{
+		VARINT,
+		FIXED32,
+		FIXED64,
+		BYTES,
+
+		NUM_BITS	= 2
+	};
+}
+
+// Longest possible varint (64-bit value).
+const int kMaxVarintSize = 10;
+
+RDE_FORCEINLINE rde::uint8* WriteVarint(rde::uint8* p, rde::uint64 value)
+{
+	while (value >= 0x80)
+	{
+		*p++ = rde::uint8(value | 0x80);
+		value >>= 7;
+	}
+	*p++ = rde::uint8(value);
+	return p;
+}
+// @return NULL if data is truncated (or varint is too long).
+RDE_FORCEINLINE const rde::uint8* ReadVarint(const rde::uint8* p, const rde::uint8* end, rde::uint64& value)
+{
+	// Most are single byte.
+	if (p != end && *p < 0x80)
+	{
+		value = *p;
+		return p + 1;
+	}
+	value = 0;
+	for (int shift = 0; shift < 64 && p != end; shift += 7)
+	{
+		const rde::uint8 b = *p++;
+		value |= rde::uint64(b & 0x7F) << shift;
+		if (b < 0x80)
+			return p;
+	}
+	return 0;
+}
+rde::uint32 VarintSize(rde::uint64 value)
+{
+	rde::uint32 size(1);
+	for (; value >= 0x80; value >>= 7)
+		++size;
+	return size;
+}
+
+// Small negative numbers -> small positive numbers.
+inline rde::uint64 ZigZag(rde::int64 value)
+{
+	return (rde::uint64(value) << 1) ^ rde::uint64(value >> 63);
+}
+inline rde::int64 UnZigZag(rde::uint64 value)
+{
+	return rde::int64(value >> 1) ^ -rde::int64(value & 1);
+}
+
+rde::int64 LoadSigned(const void* data, rde::uint32 size)
+{
+	switch (size)
+	{
+	case 1:		return *static_cast<const rde::int8*>(data);
+	case 2:		return *static_cast<const rde::int16*>(data);
+	case 4:		return *static_cast<const rde::int32*>(data);
+	default:	return *static_cast<const rde::int64*>(data);
+	}
+}
+rde::uint64 LoadUnsigned(const void* data, rde::uint32 size)
+{
+	switch (size)
+	{
+	case 1:		return *static_cast<const rde::uint8*>(data);
+	case 2:		return *static_cast<const rde::uint16*>(data);
+	case 4:		return *static_cast<const rde::uint32*>(data);
+	default:	return *static_cast<const rde::uint64*>(data);
+	}
+}
+void StoreInteger(void* data, rde::uint32 size, rde::uint64 value)
+{
+	switch (size)
+	{
+	case 1:		*static_cast<rde::uint8*>(data) = rde::uint8(value); break;
+	case 2:		*static_cast<rde::uint16*>(data) = rde::uint16(value); break;
+	case 4:		*static_cast<rde::uint32*>(data) = rde::uint32(value); break;
+	default:	*static_cast<rde::uint64*>(data) = value; break;
+	}
+}
+
+bool IsZero(const rde::uint8* data, rde::uint32 size)
+{
+	for (; size >= sizeof(rde::uint32); size -= sizeof(rde::uint32), data += sizeof(rde::uint32))
+	{
+		rde::uint32 word;
+		memcpy(&word, data, sizeof(word));
+		if (word != 0)
+			return false;
+	}
+	for (; size != 0; --size, ++data)
+	{
+		if (*data != 0)
+			return false;
+	}
+	return true;
+}
+
+class ByteBuffer
+{
+public:
+	ByteBuffer(): m_data(0), m_size(0), m_capacity(0) {}
+	~ByteBuffer()
+	{
+		operator delete(m_data);
+	}
+
+	void Clear()					{ m_size = 0; }
+	const rde::uint8* GetData() const	{ return m_data; }
+	rde::uint8* GetData()			{ return m_data; }
+	rde::uint32 GetSize() const		{ return m_size; }
+
+	// Returns place for up to 'bytes' bytes, Commit with pointer past
+	// the last one written.
+	RDE_FORCEINLINE rde::uint8* Reserve(rde::uint32 bytes)
+	{
+		if (m_size + bytes > m_capacity)
+			Grow(bytes);
+		return m_data + m_size;
+	}
+	RDE_FORCEINLINE void Commit(const rde::uint8* end)
+	{
+		m_size = rde::uint32(end - m_data);
+		RDE_ASSERT(m_size <= m_capacity);
+	}
+	// Makes room for 'bytes' bytes at given position (moves the rest).
+	void Insert(rde::uint32 position, rde::uint32 bytes)
+	{
+		Reserve(bytes);
+		memmove(m_data + position + bytes, m_data + position, m_size - position);
+		m_size += bytes;
+	}
+
+private:
+	void Grow(rde::uint32 extra)
+	{
+		rde::uint32 newCapacity = m_capacity * 2 < 4096 ? 4096 : m_capacity * 2;
+		if (newCapacity < m_size + extra)
+			newCapacity = m_size + extra;
+		rde::uint8* newData = static_cast<rde::uint8*>(operator new(newCapacity));
+		if (m_size != 0)
+			memcpy(newData, m_data, m_size);
+		operator delete(m_data);
+		m_data = newData;
+		m_capacity = newCapacity;
+	}
+
+	rde::uint8*		m_data;
+	rde::uint32		m_size;
+	rde::uint32		m_capacity;
+};
+}
+
+namespace rde
+{
+struct TaggedPlan;
+struct TaggedField
+{
+	// Name hash.
+	uint32				id;
+	// Encoded key (id + wire type).
+	uint8				key[8];
+	uint32				keyLength;
+	uint32				wireType;
+	// From the start of outermost class.
+	uint32				offset;
+	const TaggedPlan*	plan;
+};
+
+struct TaggedPlan
+{
+	static const uint32 NO_OFFSET = VectorLayout::NO_OFFSET;
+
+	typedef ValueKind::Enum	Kind;
+	typedef rde::vector<TaggedField>	Fields;
+
+	TaggedPlan()
+	:	kind(ValueKind::UNSUPPORTED),
+		wireType(WireType::VARINT),
+		size(0),
+		type(0),
+		element(0),
+		count(0),
+		beginOffset(0),
+		endOffset(0),
+		capacityOffset(NO_OFFSET),
+		vtableClass(0),
+		keyMask(0)
+	{
+	}
+
+	// Tries field that follows previous one first (fields are written
+	// in order), hash table then.
+	RDE_FORCEINLINE const TaggedField* FindField(uint32 id, uint32 expectedIndex) const
+	{
+		if (expectedIndex < uint32(fields.size()) && fields[expectedIndex].id == id)
+			return &fields[expectedIndex];
+		if (fields.empty())
+			return 0;
+		for (uint32 slot = id & keyMask; ; slot = (slot + 1) & keyMask)
+		{
+			const int index = keySlots[slot];
+			if (index < 0)
+				return 0;
+			if (fields[index].id == id)
+				return &fields[index];
+		}
+	}
+	// True if packed array elements can be copied as they are.
+	bool IsFixedSize() const
+	{
+		return kind == ValueKind::FLOAT || kind == ValueKind::DOUBLE;
+	}
+
+	Kind				kind;
+	uint32				wireType;
+	uint32				size;
+	const Type*			type;
+	// ARRAY/VECTOR: element type, POINTER: pointed type.
+	const TaggedPlan*	element;
+	// ARRAY/STRING: number of elements.
+	uint32				count;
+	// VECTOR only.
+	uint32				beginOffset;
+	uint32				endOffset;
+	uint32				capacityOffset;
+	// CLASS, set if objects allocated by reader (as opposed to embedded
+	// ones) need vtable.
+	const TypeClass*	vtableClass;
+	// CLASS: fields (including base classes), in order.
+	Fields				fields;
+	// Open addressing (by id), field index or -1.
+	rde::vector<int>	keySlots;
+	uint32				keyMask;
+};
+
+// Shared by reader & writer.
+class TaggedPlanCache
+{
+public:
+	explicit TaggedPlanCache(const TypeRegistry& typeRegistry)
+	:	m_typeRegistry(typeRegistry)
+	{
+	}
+	~TaggedPlanCache()
+	{
+		for (Plans::iterator it = m_plans.begin(); it != m_plans.end(); ++it)
+			delete it->second;
+	}
+
+	const TaggedPlan* GetPlan(const Type* type)
+	{
+		Plans::iterator it = m_plans.find(type);
+		if (it != m_plans.end())
+			return it->second;
+
+		// Registered before compiling, so that recursive types find it.
+		TaggedPlan* plan = new TaggedPlan();
+		plan->type = type;
+		plan->size = type->m_size;
+		m_plans.insert(rde::make_pair(type, plan));
+		Compile(*plan, type);
+		return plan;
+	}
+	int GetNumPlans() const
+	{
+		return int(m_plans.size());
+	}
+
+	const TypeRegistry&	m_typeRegistry;
+
+private:
+	typedef rde::flat_hash_map<const Type*, TaggedPlan*>	Plans;
+
+	void Compile(TaggedPlan& plan, const Type* type)
+	{
+		const Type* elementType(0);
+		const ValueKind::Enum kind = GetValueKind(type, m_typeRegistry, &elementType);
+		switch (kind)
+		{
+		case ValueKind::CLASS:
+			CompileClass(plan, static_cast<const TypeClass*>(type));
+			return;
+		case ValueKind::STRING:
+		case ValueKind::ARRAY:
+			plan.count = uint32(static_cast<const TypeArray*>(type)->m_numElements);
+			break;
+		case ValueKind::VECTOR:
+			{
+				const VectorLayout layout = GetVectorLayout(static_cast<const TypeClass*>(type));
+				plan.beginOffset = layout.beginOffset;
+				plan.endOffset = layout.endOffset;
+				plan.capacityOffset = layout.capacityOffset;
+			}
+			break;
+		default:
+			break;
+		}
+		if (kind == ValueKind::ARRAY || kind == ValueKind::VECTOR || kind == ValueKind::POINTER)
+		{
+			// Pointed plan may be still in the middle of compiling (kind
+			// is set before compiling fields, so it's fine).
+			plan.element = GetPlan(elementType);
+			if (plan.element->kind == ValueKind::UNSUPPORTED)
+				return;
+		}
+		plan.kind = kind;
+		plan.wireType = GetWireType(kind);
+	}
+	static uint32 GetWireType(TaggedPlan::Kind kind)
+	{
+		switch (kind)
+		{
+		case ValueKind::FLOAT:		return WireType::FIXED32;
+		case ValueKind::DOUBLE:		return WireType::FIXED64;
+		case ValueKind::STRING:
+		case ValueKind::ARRAY:
+		case ValueKind::VECTOR:
+		case ValueKind::CLASS:		return WireType::BYTES;
+		default:					return WireType::VARINT;
+		}
+	}
+
+	void CompileClass(TaggedPlan& plan, const TypeClass* tc)
+	{
+		plan.kind = ValueKind::CLASS;
+		plan.wireType = WireType::BYTES;
+		plan.vtableClass = tc->HasVTable() ? tc : 0;
+		const int numFields = tc->GetNumFields();
+		plan.fields.reserve(numFields);
+		for (int i = 0; i < numFields; ++i)
+		{
+			const Field* field = tc->GetField(i);
+			if (field->m_flags & FieldFlags::NO_SERIALIZE)
+				continue;
+			const TaggedPlan* fieldPlan = GetPlan(field->m_type);
+			if (fieldPlan->kind == ValueKind::UNSUPPORTED)
+				continue;
+			TaggedField taggedField;
+			taggedField.id = field->m_name.GetId();
+			taggedField.wireType = GetWireType(fieldPlan->kind);
+			const uint64 key = (uint64(taggedField.id) << WireType::NUM_BITS) | taggedField.wireType;
+			taggedField.keyLength = uint32(WriteVarint(taggedField.key, key) - taggedField.key);
+			taggedField.offset = tc->CalcOffsetFrom(field->m_ownerClass) + field->m_offset;
+			taggedField.plan = fieldPlan;
+			plan.fields.push_back(taggedField);
+		}
+
+		// Load factor <= 0.5.
+		const uint32 numSlots = NextPowerOfTwo(plan.fields.size() < 2 ? 4 : plan.fields.size() * 2);
+		plan.keyMask = numSlots - 1;
+		plan.keySlots.resize(numSlots);
+		for (uint32 i = 0; i < numSlots; ++i)
+			plan.keySlots[i] = -1;
+		for (uint32 i = 0; i < uint32(plan.fields.size()); ++i)
+		{
+			const uint32 id = plan.fields[i].id;
+			// Shadowed names (same field name in base class) - first one wins.
+			if (plan.FindField(id, 0xFFFFFFFF) != 0)
+				continue;
+			uint32 slot = id & plan.keyMask;
+			while (plan.keySlots[slot] >= 0)
+				slot = (slot + 1) & plan.keyMask;
+			plan.keySlots[slot] = int(i);
+		}
+	}
+
+	Plans	m_plans;
+};
+
+//=============================================================================
+struct TaggedBinaryWriter::Impl
+{
+	// Object -> index in data.
+	typedef rde::flat_hash_map<const void*, uint32>	ObjectIds;
+	struct PendingObject
+	{
+		const void*			object;
+		const TaggedPlan*	plan;
+	};
+	typedef rde::vector<PendingObject>	PendingObjects;
+
+	explicit Impl(const TypeRegistry& typeRegistry)
+	:	m_plans(typeRegistry)
+	{
+	}
+
+	const uint8* Write(const void* object, const TypeClass* type, uint32* outSize)
+	{
+		m_buffer.Clear();
+		if (object != 0)
+		{
+			RDE_ASSERT(type != 0);
+			GetObjectId(object, m_plans.GetPlan(type));
+			// Objects are written in order of discovery, list grows as pointers
+			// are found (no recursion, so long lists don't blow up the stack).
+			for (uint32 i = 0; i < uint32(m_objects.size()); ++i)
+			{
+				// Copy, list may grow.
+				const PendingObject pending = m_objects[i];
+				const TaggedPlan& plan = *pending.plan;
+				uint8* p = m_buffer.Reserve(kMaxVarintSize);
+				m_buffer.Commit(WriteVarint(p, plan.type->m_name.GetId()));
+				const uint32 lengthPosition = BeginLength();
+				if (plan.kind == ValueKind::CLASS)
+					WriteFields(plan, static_cast<const uint8*>(pending.object));
+				else
+					WriteValue(plan, static_cast<const uint8*>(pending.object));
+				EndLength(lengthPosition);
+			}
+		}
+		m_objects.clear();
+		m_objectIds.clear();
+		RDE_ASSERT(outSize != 0);
+		*outSize = m_buffer.GetSize();
+		return m_buffer.GetData();
+	}
+
+	uint32 GetObjectId(const void* object, const TaggedPlan* plan)
+	{
+		ObjectIds::iterator it = m_objectIds.find(object);
+		if (it != m_objectIds.end())
+			return it->second;
+		const uint32 id = uint32(m_objects.size());
+		m_objectIds.insert(rde::make_pair(object, id));
+		PendingObject pending = { object, plan };
+		m_objects.push_back(pending);
+		return id;
+	}
+
+	void WriteFields(const TaggedPlan& plan, const uint8* data)
+	{
+		for (TaggedPlan::Fields::const_iterator it = plan.fields.begin(); it != plan.fields.end(); ++it)
+		{
+			const uint8* fieldData = data + it->offset;
+			// Zeroed anyway when reading.
+			if (IsZero(fieldData, it->plan->size))
+				continue;
+			uint8* p = m_buffer.Reserve(sizeof(it->key));
+			memcpy(p, it->key, sizeof(it->key));
+			m_buffer.Commit(p + it->keyLength);
+			WriteValue(*it->plan, fieldData);
+		}
+	}
+
+	void WriteValue(const TaggedPlan& plan, const uint8* data)
+	{
+		switch (plan.kind)
+		{
+		case ValueKind::BOOL:
+			{
+				uint8* p = m_buffer.Reserve(1);
+				*p = (*data != 0 ? 1 : 0);
+				m_buffer.Commit(p + 1);
+			}
+			break;
+		case ValueKind::INT:
+		case ValueKind::ENUM:
+			PutVarint(ZigZag(LoadSigned(data, plan.size)));
+			break;
+		case ValueKind::UINT:
+			PutVarint(LoadUnsigned(data, plan.size));
+			break;
+		case ValueKind::FLOAT:
+		case ValueKind::DOUBLE:
+			{
+				uint8* p = m_buffer.Reserve(plan.size);
+				memcpy(p, data, plan.size);
+				m_buffer.Commit(p + plan.size);
+			}
+			break;
+		case ValueKind::POINTER:
+			{
+				const void* pointed = *reinterpret_cast<const void* const*>(data);
+				PutVarint(pointed != 0 ? uint64(GetObjectId(pointed, plan.element)) + 1 : 0);
+			}
+			break;
+		case ValueKind::STRING:
+			{
+				const void* terminator = memchr(data, 0, plan.count);
+				const uint32 length = terminator ? uint32(static_cast<const uint8*>(terminator) - data) : plan.count;
+				uint8* p = m_buffer.Reserve(kMaxVarintSize + length);
+				p = WriteVarint(p, length);
+				memcpy(p, data, length);
+				m_buffer.Commit(p + length);
+			}
+			break;
+		case ValueKind::ARRAY:
+			WriteElements(*plan.element, data, plan.count);
+			break;
+		case ValueKind::VECTOR:
+			{
+				const uint8* begin = *reinterpret_cast<const uint8* const*>(data + plan.beginOffset);
+				const uint8* end = *reinterpret_cast<const uint8* const*>(data + plan.endOffset);
+				WriteElements(*plan.element, begin, uint32((end - begin) / plan.element->size));
+			}
+			break;
+		case ValueKind::CLASS:
+			{
+				const uint32 lengthPosition = BeginLength();
+				WriteFields(plan, data);
+				EndLength(lengthPosition);
+			}
+			break;
+		default:
+			RDE_ASSERT(!"Unsupported types should never be written");
+			break;
+		}
+	}
+	void WriteElements(const TaggedPlan& elementPlan, const uint8* data, uint32 count)
+	{
+		const uint64 header = (uint64(count) << WireType::NUM_BITS) | elementPlan.wireType;
+		if (elementPlan.IsFixedSize())
+		{
+			// Packed floats, length known up front, copied at once.
+			const uint32 bytes = count * elementPlan.size;
+			uint8* p = m_buffer.Reserve(2 * kMaxVarintSize + bytes);
+			p = WriteVarint(p, VarintSize(header) + bytes);
+			p = WriteVarint(p, header);
+			memcpy(p, data, bytes);
+			m_buffer.Commit(p + bytes);
+			return;
+		}
+		const uint32 lengthPosition = BeginLength();
+		PutVarint(header);
+		for (uint32 i = 0; i < count; ++i)
+			WriteValue(elementPlan, data + i * elementPlan.size);
+		EndLength(lengthPosition);
+	}
+
+	RDE_FORCEINLINE void PutVarint(uint64 value)
+	{
+		uint8* p = m_buffer.Reserve(kMaxVarintSize);
+		m_buffer.Commit(WriteVarint(p, value));
+	}
+	// Length is not known before contents are written. Most are short,
+	// so single byte is reserved, contents are moved if it needs more.
+	uint32 BeginLength()
+	{
+		uint8* p = m_buffer.Reserve(1);
+		m_buffer.Commit(p + 1);
+		return m_buffer.GetSize() - 1;
+	}
+	void EndLength(uint32 position)
+	{
+		const uint32 length = m_buffer.GetSize() - position - 1;
+		if (length >= 0x80)
+			m_buffer.Insert(position + 1, VarintSize(length) - 1);
+		WriteVarint(m_buffer.GetData() + position, length);
+	}
+
+	TaggedPlanCache	m_plans;
+	ByteBuffer		m_buffer;
+	ObjectIds		m_objectIds;
+	PendingObjects	m_objects;
+};
+
+TaggedBinaryWriter::TaggedBinaryWriter(const TypeRegistry& typeRegistry)
+:	m_impl(new Impl(typeRegistry))
+{
+}
+TaggedBinaryWriter::~TaggedBinaryWriter()
+{
+}
+
+const uint8* TaggedBinaryWriter::Write(const void* object, const TypeClass* type, uint32* outSize)
+{
+	return m_impl->Write(object, type, outSize);
+}
+int TaggedBinaryWriter::GetNumPlans() const
+{
+	return m_impl->m_plans.GetNumPlans();
+}
+
+//=============================================================================
+struct TaggedBinaryReader::Impl
+{
+	struct ObjectEntry
+	{
+		void*				object;
+		const TaggedPlan*	plan;
+	};
+	// References are resolved once all objects are known.
+	struct PointerFixup
+	{
+		void**				pointer;
+		uint64				id;
+		// Pointed type.
+		const TaggedPlan*	plan;
+	};
+
+	Impl(const TypeRegistry& typeRegistry, FnAllocate pfnAllocate, void* userData)
+	:	m_plans(typeRegistry),
+		m_pfnAllocate(pfnAllocate ? pfnAllocate : AllocateWithNew),
+		m_userData(userData),
+		m_error(0)
+	{
+	}
+
+	void* Read(const void* data, uint32 size, const TypeClass* type)
+	{
+		RDE_ASSERT(type != 0);
+		m_error = 0;
+
+		void* root(0);
+		const uint8* begin = static_cast<const uint8*>(data);
+		if (ReadObjects(begin, begin + size) && ResolveFixups())
+		{
+			if (m_objects.empty())
+			{
+				Fail("No objects");
+			}
+			else
+			{
+				const ObjectEntry& rootEntry = m_objects[0];
+				if (rootEntry.plan->kind == ValueKind::CLASS)
+				{
+					root = DynamicCast(rootEntry.object, static_cast<const TypeClass*>(rootEntry.plan->type),
+						type);
+				}
+				if (root == 0)
+					Fail("Root object is of wrong type");
+			}
+		}
+		if (root == 0)
+			ReleaseObjects();
+
+		m_objects.clear();
+		m_fixups.clear();
+		m_buffers.clear();
+		return root;
+	}
+
+	bool ReadObjects(const uint8* p, const uint8* end)
+	{
+		while (p != end)
+		{
+			uint64 typeHash;
+			uint64 length;
+			p = ReadVarint(p, end, typeHash);
+			if (p != 0)
+				p = ReadVarint(p, end, length);
+			if (p == 0 || length > uint64(end - p))
+				return Fail("Truncated data") != 0;
+			const Type* type = (typeHash <= 0xFFFFFFFF ? m_plans.m_typeRegistry.FindType(uint32(typeHash)) : 0);
+			if (type == 0)
+				return Fail("Unknown type") != 0;
+			const TaggedPlan* plan = m_plans.GetPlan(type);
+			if (plan->kind == ValueKind::UNSUPPORTED)
+				return Fail("Type cannot be read") != 0;
+
+			uint8* object = static_cast<uint8*>(m_pfnAllocate(plan->size, m_userData));
+			memset(object, 0, plan->size);
+			if (plan->vtableClass != 0)
+				plan->vtableClass->InitVTable(object);
+			ObjectEntry entry = { object, plan };
+			m_objects.push_back(entry);
+
+			const uint8* bodyEnd = p + length;
+			const bool ok = (plan->kind == ValueKind::CLASS ? ReadFields(p, bodyEnd, *plan, object) :
+				ReadValue(p, bodyEnd, *plan, object) != 0);
+			if (!ok)
+				return false;
+			p = bodyEnd;
+		}
+		return true;
+	}
+
+	bool ReadFields(const uint8* p, const uint8* end, const TaggedPlan& plan, uint8* data)
+	{
+		uint32 expectedIndex(0);
+		while (p != end)
+		{
+			uint64 key;
+			p = ReadVarint(p, end, key);
+			if (p == 0)
+				return Fail("Truncated data") != 0;
+			const uint32 wireType = uint32(key) & ((1 << WireType::NUM_BITS) - 1);
+			const TaggedField* field = plan.FindField(uint32(key >> WireType::NUM_BITS), expectedIndex);
+			if (field != 0 && field->wireType == wireType)
+			{
+				p = ReadValue(p, end, *field->plan, data + field->offset);
+				expectedIndex = uint32(field - plan.fields.begin()) + 1;
+			}
+			else
+			{
+				// Unknown (or changed type).
+				p = SkipValue(p, end, wireType);
+			}
+			if (p == 0)
+				return false;
+		}
+		return true;
+	}
+
+	// @return pointer past the value, NULL on error.
+	const uint8* ReadValue(const uint8* p, const uint8* end, const TaggedPlan& plan, uint8* data)
+	{
+		switch (plan.kind)
+		{
+		case ValueKind::BOOL:
+			{
+				uint64 value;
+				p = ReadVarint(p, end, value);
+				if (p == 0)
+					return Fail("Truncated data");
+				*data = (value != 0 ? 1 : 0);
+				return p;
+			}
+		case ValueKind::INT:
+		case ValueKind::ENUM:
+		case ValueKind::UINT:
+			{
+				uint64 value;
+				p = ReadVarint(p, end, value);
+				if (p == 0)
+					return Fail("Truncated data");
+				StoreInteger(data, plan.size, plan.kind == ValueKind::UINT ? value : uint64(UnZigZag(value)));
+				return p;
+			}
+		case ValueKind::FLOAT:
+		case ValueKind::DOUBLE:
+			if (uint32(end - p) < plan.size)
+				return Fail("Truncated data");
+			memcpy(data, p, plan.size);
+			return p + plan.size;
+		case ValueKind::POINTER:
+			{
+				uint64 id;
+				p = ReadVarint(p, end, id);
+				if (p == 0)
+					return Fail("Truncated data");
+				*reinterpret_cast<void**>(data) = 0;
+				if (id != 0)
+				{
+					PointerFixup fixup = { reinterpret_cast<void**>(data), id - 1, plan.element };
+					m_fixups.push_back(fixup);
+				}
+				return p;
+			}
+		case ValueKind::STRING:
+			{
+				const uint8* stringEnd = ReadLength(p, end);
+				if (stringEnd == 0)
+					return 0;
+				// Always zero terminated, too long strings are truncated.
+				const uint32 length = uint32(stringEnd - p);
+				const uint32 numChars = length < plan.count - 1 ? length : plan.count - 1;
+				memcpy(data, p, numChars);
+				data[numChars] = 0;
+				return stringEnd;
+			}
+		case ValueKind::ARRAY:
+		case ValueKind::VECTOR:
+			return ReadElements(p, end, plan, data);
+		case ValueKind::CLASS:
+			{
+				const uint8* classEnd = ReadLength(p, end);
+				if (classEnd == 0 || !ReadFields(p, classEnd, plan, data))
+					return 0;
+				return classEnd;
+			}
+		default:
+			RDE_ASSERT(!"Unsupported types should never be read");
+			return Fail("Unsupported type");
+		}
+	}
+	// Array/vector.
+	const uint8* ReadElements(const uint8* p, const uint8* end, const TaggedPlan& plan, uint8* data)
+	{
+		const uint8* blockEnd = ReadLength(p, end);
+		if (blockEnd == 0)
+			return 0;
+		uint64 header;
+		p = ReadVarint(p, blockEnd, header);
+		if (p == 0)
+			return Fail("Truncated data");
+		const TaggedPlan& elementPlan = *plan.element;
+		// Element type changed, field is skipped.
+		if ((header & ((1 << WireType::NUM_BITS) - 1)) != elementPlan.wireType)
+			return blockEnd;
+		// Every element takes at least 1 byte (so corrupted count doesn't
+		// make us allocate crazy amounts).
+		const uint64 count = header >> WireType::NUM_BITS;
+		if (count > uint64(blockEnd - p))
+			return Fail("Corrupted array");
+
+		uint64 numElements = count;
+		if (plan.kind == ValueKind::VECTOR)
+		{
+			// Elements can be much bigger in memory than on the wire, so
+			// byte size needs its own check (division, so it can't wrap).
+			if (elementPlan.size != 0 && count > VectorLayout::MAX_BYTES / elementPlan.size)
+				return Fail("Array too big");
+		}
+		else if (numElements > plan.count)
+		{
+			// Extra elements are dropped.
+			numElements = plan.count;
+		}
+		const uint32 bytes = uint32(numElements * elementPlan.size);
+		if (elementPlan.IsFixedSize() && uint64(blockEnd - p) < bytes)
+			return Fail("Truncated data");
+		if (plan.kind == ValueKind::VECTOR)
+			data = AllocateVector(plan, data, uint32(numElements));
+
+		if (elementPlan.IsFixedSize())
+		{
+			if (bytes != 0)
+				memcpy(data, p, bytes);
+			return blockEnd;
+		}
+		for (uint32 i = 0; i < uint32(numElements); ++i)
+		{
+			p = ReadValue(p, blockEnd, elementPlan, data + i * elementPlan.size);
+			if (p == 0)
+				return 0;
+		}
+		return blockEnd;
+	}
+	// @return vector storage.
+	uint8* AllocateVector(const TaggedPlan& plan, uint8* data, uint32 numElements)
+	{
+		const TaggedPlan& elementPlan = *plan.element;
+		const uint32 bytes = numElements * elementPlan.size;
+		uint8* begin(0);
+		if (bytes != 0)
+		{
+			begin = static_cast<uint8*>(operator new(bytes));
+			m_buffers.push_back(begin);
+			memset(begin, 0, bytes);
+			if (elementPlan.vtableClass != 0)
+			{
+				for (uint32 i = 0; i < numElements; ++i)
+					elementPlan.vtableClass->InitVTable(begin + i * elementPlan.size);
+			}
+		}
+		*reinterpret_cast<uint8**>(data + plan.beginOffset) = begin;
+		*reinterpret_cast<uint8**>(data + plan.endOffset) = begin + bytes;
+		if (plan.capacityOffset != TaggedPlan::NO_OFFSET)
+			*reinterpret_cast<base_vector::size_type*>(data + plan.capacityOffset) = numElements;
+		return begin;
+	}
+
+	// Reads length of BYTES value, moves p to its contents.
+	// @return end of contents, NULL on error.
+	const uint8* ReadLength(const uint8*& p, const uint8* end)
+	{
+		uint64 length;
+		p = ReadVarint(p, end, length);
+		if (p == 0 || length > uint64(end - p))
+			return Fail("Truncated data");
+		return p + length;
+	}
+	const uint8* SkipValue(const uint8* p, const uint8* end, uint32 wireType)
+	{
+		switch (wireType)
+		{
+		case WireType::VARINT:
+			{
+				uint64 value;
+				p = ReadVarint(p, end, value);
+				return p != 0 ? p : Fail("Truncated data");
+			}
+		case WireType::FIXED32:
+			return end - p >= 4 ? p + 4 : Fail("Truncated data");
+		case WireType::FIXED64:
+			return end - p >= 8 ? p + 8 : Fail("Truncated data");
+		default:
+			return ReadLength(p, end);
+		}
+	}
+
+	bool ResolveFixups()
+	{
+		for (PointerFixups::const_iterator it = m_fixups.begin(); it != m_fixups.end(); ++it)
+		{
+			if (it->id >= uint64(m_objects.size()))
+				return Fail("Reference to object that doesn't exist") != 0;
+			const ObjectEntry& target = m_objects[uint32(it->id)];
+			uint8* object = static_cast<uint8*>(target.object);
+			if (target.plan != it->plan)
+			{
+				// Derived class can be referenced through pointer to base.
+				const TypeClass* objectType = static_cast<const TypeClass*>(target.plan->type);
+				const TypeClass* pointedType = static_cast<const TypeClass*>(it->plan->type);
+				if (target.plan->kind != ValueKind::CLASS || it->plan->kind != ValueKind::CLASS ||
+					!objectType->IsDerivedFrom(pointedType))
+				{
+					return Fail("Reference to object of wrong type") != 0;
+				}
+				object += objectType->CalcOffsetFrom(pointedType);
+			}
+			*it->pointer = object;
+		}
+		return true;
+	}
+
+	void ReleaseObjects()
+	{
+		for (Buffers::iterator it = m_buffers.begin(); it != m_buffers.end(); ++it)
+			operator delete(*it);
+		if (m_pfnAllocate == AllocateWithNew)
+		{
+			for (ObjectEntries::iterator it = m_objects.begin(); it != m_objects.end(); ++it)
+				operator delete(it->object);
+		}
+	}
+
+	// Always returns NULL (so it can be returned right away by reading functions).
+	const uint8* Fail(const char* error)
+	{
+		if (m_error == 0)
+			m_error = error;
+		return 0;
+	}
+
+	typedef rde::vector<ObjectEntry>	ObjectEntries;
+	typedef rde::vector<PointerFixup>	PointerFixups;
+	typedef rde::vector<void*>			Buffers;
+
+	TaggedPlanCache		m_plans;
+	FnAllocate			m_pfnAllocate;
+	void*				m_userData;
+	const char*			m_error;
+	ObjectEntries		m_objects;
+	PointerFixups		m_fixups;
+	// Vector storage, released on errors.
+	Buffers				m_buffers;
+};
+
+TaggedBinaryReader::TaggedBinaryReader(const TypeRegistry& typeRegistry, FnAllocate pfnAllocate,
+	void* userData)
+:	m_impl(new Impl(typeRegistry, pfnAllocate, userData))
+{
+}
+TaggedBinaryReader::~TaggedBinaryReader()
+{
+}
+
+void* TaggedBinaryReader::Read(const void* data, uint32 size, const TypeClass* type)
+{
+	return m_impl->Read(data, size, type);
+}
+const char* TaggedBinaryReader::GetError() const
+{
+	return m_impl->m_error;
+}
+int TaggedBinaryReader::GetNumPlans() const
+{
+	return m_impl->m_plans.GetNumPlans();
+}
+
+} // rde
@@ -0,0 +1,91 @@
+#ifndef TAGGED_BINARY_H
+#define TAGGED_BINARY_H
+
+#include "core/ScopedPtr.h"
+#include "reflection/Type.h"
+
+namespace rde
+{
+class TypeClass;
+
+// Portable binary format (unlike load-in-place images it doesn't depend on
+// pointer size, padding or field order), for long-lived data.
+// Data is a sequence of objects, first one is the root, the rest are objects
+// reachable through pointers. Every object is:
+//	varint type name hash (StrId), varint body length, body.
+// Body of class is a list of fields, every one is a key followed by value:
+//	key = varint (name hash (Field::m_name) << 2 | wire type),
+// wire types follow reflection type:
+//	- VARINT: bool, integers and enums (signed ones zigzag encoded),
+//	  pointers (object index + 1, 0 for NULL),
+//	- FIXED32/FIXED64: float/double (little endian IEEE),
+//	- BYTES: varint length, then contents. Nested classes (fields), char
+//	  arrays (characters up to terminator), other arrays and rde::vectors
+//	  (varint (count << 2 | element wire type), then packed elements).
+// Fields with all bytes zero are not written at all (reader zeroes objects).
+// Reader matches fields by name hash and skips anything it doesn't know (or
+// what changed wire type), so fields can be added, removed, reordered or
+// change between integer types (values are truncated to new size).
+// NO_SERIALIZE fields and pointers to unregistered types are skipped.
+// Pointed objects are assumed to be of pointed (static) type.
+// Every type is compiled (once, on first use) into list of fields with
+// precomputed keys (and key hash table for reader).
+class TaggedBinaryWriter
+{
+public:
+	explicit TaggedBinaryWriter(const TypeRegistry& typeRegistry);
+	~TaggedBinaryWriter();
+
+	// Returns encoded data, valid until next Write call.
+	const uint8* Write(const void* object, const TypeClass* type, uint32* outSize);
+
+	// Number of types compiled so far.
+	int GetNumPlans() const;
+
+private:
+	RDE_FORBID_COPY(TaggedBinaryWriter);
+
+	struct Impl;
+	ScopedPtr<Impl>	m_impl;
+};
+
+// Rules for new objects are the same as for DeepCloner:
+//	- objects are NOT constructed, only zeroed and vtable is initialized,
+//	- rde::vector storage is allocated with operator new, capacity == size.
+class TaggedBinaryReader
+{
+public:
+	// Allocates memory for new objects (not vector storage).
+	typedef void* (*FnAllocate)(size_t bytes, void* userData);
+
+	// Default allocation is operator new. Objects are released on errors
+	// only if default allocation is used.
+	explicit TaggedBinaryReader(const TypeRegistry& typeRegistry, FnAllocate pfnAllocate = 0,
+		void* userData = 0);
+	~TaggedBinaryReader();
+
+	// Root object has to be of given type (or derived from it).
+	// @return root object, NULL on error (see GetError).
+	void* Read(const void* data, uint32 size, const TypeClass* type);
+	template<typename T>
+	T* Read(const void* data, uint32 size, const TypeClass* type)
+	{
+		return static_cast<T*>(Read(data, size, type));
+	}
+
+	// Description of last error, NULL if last Read succeeded.
+	const char* GetError() const;
+
+	// Number of types compiled so far.
+	int GetNumPlans() const;
+
+private:
+	RDE_FORBID_COPY(TaggedBinaryReader);
+
+	struct Impl;
+	ScopedPtr<Impl>	m_impl;
+};
+
+} // rde
+
+#endif
@@ -1,5 +1,6 @@
 #include "reflection/TypeClass.h"
 #include "reflection/TypeRegistry.h"
+#include "rdestl/string_utils.h"
 
 namespace rde
 {
@@ -10,8 +11,11 @@ TypeClass::TypeClass(uint32 size, const StrId& name, FnCreateInstance pfnCreateI
 	m_base(0),
 	m_pfnCreateInstance(pfnCreateInstance),
 	m_pfnInitVTable(pfnInitVTable),
-	m_baseOffset(baseOffset)
+	m_baseOffset(baseOffset),
+	m_depth(0)
 {
+	m_ancestors[0] = this;
+	m_ancestorOffsets[0] = 0;
 }
 TypeClass::~TypeClass()
 {
@@ -29,6 +33,61 @@ void TypeClass::OnPostInit(TypeRegistry& typeReg)
 		it->OnPostInit(typeReg);
 }
 
+void TypeClass::ResolveHierarchy()
+{
+	m_depth = 0;
+	for (const TypeClass* iter = m_base; iter != 0; iter = iter->m_base)
+	{
+		++m_depth;
+		RDE_ASSERT(m_depth < MAX_HIERARCHY_DEPTH && "Hierarchy too deep (or circular)");
+	}
+	// Walk up again, filling from the bottom. Offsets accumulate the same way
+	// they did when calculated per call.
+	const TypeClass* iter = this;
+	uint32 offset(0);
+	for (int i = int(m_depth); i >= 0; --i)
+	{
+		m_ancestors[i] = iter;
+		m_ancestorOffsets[i] = offset;
+		offset += iter->m_baseOffset;
+		iter = iter->m_base;
+	}
+}
+
+const TypeClass* TypeClass::FindAncestor(uint32 nameTag) const
+{
+	for (const TypeClass* iter = this; iter != 0; iter = iter->m_base)
+	{
+		if (iter->m_name.GetId() == nameTag)
+			return iter;
+	}
+	return 0;
+}
+
+bool TypeClass::IsDerivedFromUnresolved(const TypeClass* base) const
+{
+	for (const TypeClass* iter = m_base; iter != 0; iter = iter->m_base)
+	{
+		if (iter == base)
+			return true;
+	}
+	return false;
+}
+uint32 TypeClass::CalcOffsetFromUnresolved(const TypeClass* base) const
+{
+	uint32 offset(0);
+	for (const TypeClass* iter = this; iter != base; iter = iter->m_base)
+		offset += iter->m_baseOffset;
+	return offset;
+}
+
+void TypeClass::ReserveFields(int numFields, LinearArena* arena)
+{
+	RDE_ASSERT(m_fields.empty() && "Fields have to be reserved before adding any");
+	m_fields.set_allocator(LinearArenaAllocator(arena));
+	m_fields.reserve(numFields);
+}
+
 void TypeClass::AddField(const Field& field)
 {
 	RDE_ASSERT(FindField(field.m_name) == 0 && "Field with specified name already present");
@@ -86,34 +145,6 @@ void TypeClass::EnumerateFields(FieldEnumerator enumerator, rde::uint32 typeMask
 	}
 }
 
-bool TypeClass::IsDerivedFrom(const TypeClass* base) const
-{
-	const TypeClass* iter(m_base);
-	while (iter != 0)
-	{
-		if (iter == base)
-			return true;
-		iter = iter->m_base;
-	}
-	return false;
-}
-
-uint32 TypeClass::CalcOffsetFrom(const TypeClass* base) const
-{
-	if (base == 0)
-		return 0;
-
-	RDE_ASSERT(IsDerivedFrom(base));
-	const TypeClass* iter(this);
-	uint32 totalOffset(0);
-	while (iter && iter != base)
-	{
-		totalOffset += iter->m_baseOffset;
-		iter = iter->m_base;
-	}
-	return totalOffset;
-}
-
 void* TypeClass::CreateInstance() const
 {
 	RDE_ASSERT(m_pfnCreateInstance && "Trying to instantiate abstract class.");
@@ -129,4 +160,20 @@ void* TypeClass::InitVTable(void* mem) const
 	return m_pfnInitVTable ? m_pfnInitVTable(mem) : mem;
 }
 
+bool TypeClass::IsVector() const
+{
+	// Name is "vector<...>" or "rde::vector<...>".
+	static const char* rdeVectorName = "vector<";
+	static const long rdeVectorNameLen = rde::strlen(rdeVectorName);
+
+	const char* name = m_name.GetStr();
+	// -1 -> 0, 0->1 etc. (so that -1 doesn't require further fixing).
+	int colonPos = rde::find_index_of(name, ':') + 1;
+	if (colonPos > 0)
+	{
+		++colonPos;
+	}
+	return rde::strcompare(name + colonPos, rdeVectorName, rdeVectorNameLen) == 0;
+}
+
 } // rde
@@ -3,7 +3,8 @@
 
 #include "reflection/Field.h"
 #include "reflection/Type.h"
-#include "rdestl/fixed_vector.h"
+#include "core/LinearArena.h"
+#include "rdestl/vector.h"
 
 namespace rde
 {	
@@ -18,13 +19,25 @@ public:
 	{
 		REFLECTION_TYPE	= ReflectionType::CLASS
 	};
+	// Max number of classes in inheritance chain (including this one).
+	enum
+	{
+		MAX_HIERARCHY_DEPTH	= 16
+	};
 
 	explicit TypeClass(uint32 size, const StrId& name, FnCreateInstance pfnCreateInstance = 0, 
 		FnInitVTable pfnInitVTable = 0, uint32 baseClassId = 0, uint16 baseOffset = 0);
 	virtual ~TypeClass();
 
 	virtual void OnPostInit(TypeRegistry&);
+	// Called by registry after OnPostInit for all types (needs all bases resolved).
+	// Caches whole inheritance chain, so that IsDerivedFrom/CalcOffsetFrom
+	// don't have to walk it.
+	void ResolveHierarchy();
 
+	// Preallocates storage for fields. If arena is given, fields are kept
+	// there (arena has to outlive the type).
+	void ReserveFields(int numFields, LinearArena* arena = 0);
 	void AddField(const Field& field);
 	const Field* FindField(const StrId& name, bool includingBaseClasses = true) const;
 	int GetNumFields(bool includingBaseClasses = true) const;
@@ -32,16 +45,54 @@ public:
 	void EnumerateFields(FieldEnumerator enumerator, uint32 typeMask, void* userData = 0,
 		bool includingBaseClasses = true) const;
 
-	bool IsDerivedFrom(const TypeClass* base) const;
-	// @pre: IsDerivedFrom(base)
-	uint32 CalcOffsetFrom(const TypeClass* base) const;
+	// O(1) after registry PostInit (walks base chain before hierarchy is
+	// resolved). Class is not derived from itself.
+	bool IsDerivedFrom(const TypeClass* base) const
+	{
+		if (base == 0)
+			return false;
+		if (!IsHierarchyResolved() || !base->IsHierarchyResolved())
+			return IsDerivedFromUnresolved(base);
+		return base->m_depth < m_depth && m_ancestors[base->m_depth] == base;
+	}
+	// @pre: base == this || IsDerivedFrom(base)
+	uint32 CalcOffsetFrom(const TypeClass* base) const
+	{
+		if (base == 0)
+			return 0;
+		RDE_ASSERT(base == this || IsDerivedFrom(base));
+		if (!IsHierarchyResolved() || !base->IsHierarchyResolved())
+			return CalcOffsetFromUnresolved(base);
+		return m_ancestorOffsets[base->m_depth];
+	}
+	// This class or its base with given name (hash), NULL if there's none.
+	const TypeClass* FindAncestor(uint32 nameTag) const;
+	// 0 for root classes.
+	int GetHierarchyDepth() const	{ return m_depth; }
+	// Class at given depth of inheritance chain ([0] is root, GetHierarchyDepth() is
+	// this class), NULL if chain is shorter or not resolved yet.
+	const TypeClass* GetAncestor(int depth) const
+	{
+		if (depth < 0 || uint32(depth) > m_depth || !IsHierarchyResolved())
+			return 0;
+		return m_ancestors[depth];
+	}
 
 	void* CreateInstance() const;
 	bool HasVTable() const;
 	void* InitVTable(void* mem) const;
 
+	// True for rde::vector instantiations. Their first two fields are
+	// begin/end pointers, contents need special treatment.
+	bool IsVector() const;
+
 private:
-	typedef rde::fixed_vector<Field, 32, true>	Fields;
+	typedef rde::vector<Field, LinearArenaAllocator>	Fields;
+
+	// Classes with base have non-zero depth once ResolveHierarchy is called.
+	bool IsHierarchyResolved() const	{ return m_depth != 0 || m_base == 0; }
+	bool IsDerivedFromUnresolved(const TypeClass* base) const;
+	uint32 CalcOffsetFromUnresolved(const TypeClass* base) const;
 
 	uint32				m_baseClassId;
 	const TypeClass*	m_base;
@@ -49,6 +100,11 @@ private:
 	FnInitVTable		m_pfnInitVTable;
 	uint16				m_baseOffset;
 	Fields				m_fields;
+	uint32				m_depth;
+	// [0] is root of hierarchy, [m_depth] is this class.
+	const TypeClass*	m_ancestors[MAX_HIERARCHY_DEPTH];
+	// Offset of given ancestor subobject in this class.
+	uint32				m_ancestorOffsets[MAX_HIERARCHY_DEPTH];
 };
 
 template<typename T>
@@ -57,6 +113,43 @@ T* CreateInstance(const TypeClass* type)
 	return static_cast<T*>(type->CreateInstance());
 }
 
+// Reflection-aware cast. Object's type (objectType) has to be known, so it's
+// mostly useful for upcasts of objects created/loaded by reflection system.
+// @return pointer to targetType part of object, NULL if it doesn't derive from targetType.
+inline void* DynamicCast(void* object, const TypeClass* objectType, const TypeClass* targetType)
+{
+	if (object == 0)
+		return 0;
+	if (objectType == targetType)
+		return object;
+	return objectType->IsDerivedFrom(targetType) ?
+		static_cast<uint8*>(object) + objectType->CalcOffsetFrom(targetType) : 0;
+}
+// Target class is T (has to have GetTypeName<T> specialization), found among
+// objectType and its bases.
+// T's class is looked up by name once and cached, later casts only compare it
+// with objectType's ancestor at the same depth. There can be more registries (and
+// cached class can be gone already), so it's never dereferenced on its own.
+template<typename T>
+T* DynamicCast(void* object, const TypeClass* objectType)
+{
+	static const uint32 s_targetTag = StrId(GetTypeName<T>()).GetId();
+	static const TypeClass* s_targetType = 0;
+	static int s_targetDepth = 0;
+	if (object == 0)
+		return 0;
+	const TypeClass* targetType = objectType->GetAncestor(s_targetDepth);
+	if (targetType == 0 || targetType != s_targetType || targetType->m_name.GetId() != s_targetTag)
+	{
+		targetType = objectType->FindAncestor(s_targetTag);
+		if (targetType == 0)
+			return 0;
+		s_targetType = targetType;
+		s_targetDepth = targetType->GetHierarchyDepth();
+	}
+	return static_cast<T*>(DynamicCast(object, objectType, targetType));
+}
+
 } // rde
 
 #endif
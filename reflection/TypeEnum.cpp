@@ -1,4 +1,5 @@
 #include "reflection/TypeEnum.h"
+#include "rdestl/sort.h"
 
 namespace
 {
@@ -6,15 +7,98 @@ bool CompareName(const rde::TypeEnum::Constant& e, const rde::StrId& name)
 {
 	return e.m_name == name;
 }
+bool CompareNameHash(const rde::TypeEnum::Constant& e, rde::uint32 nameHash)
+{
+	return e.m_name.GetId() == nameHash;
+}
+bool CompareValue(const rde::TypeEnum::Constant& e, long value)
+{
+	return e.m_value == value;
+}
+
+// Name hash + constant index.
+typedef rde::vector<rde::pair<rde::uint32, int> >	NameEntries;
+struct NameEntryLess
+{
+	bool operator()(const NameEntries::value_type& lhs, const NameEntries::value_type& rhs) const
+	{
+		return lhs.first < rhs.first;
+	}
+};
+
+// Value + constant index.
+typedef rde::vector<rde::pair<long, int> >	ValueEntries;
+struct ValueEntryLess
+{
+	bool operator()(const ValueEntries::value_type& lhs, const ValueEntries::value_type& rhs) const
+	{
+		return lhs.first < rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+	}
+};
 }
 
 namespace rde
 {
 TypeEnum::TypeEnum(uint32 size, const StrId& name)
-:	Type(size, ReflectionType::ENUM, name)
+:	Type(size, ReflectionType::ENUM, name),
+	m_minValue(0),
+	m_numIndexedConstants(-1)
 {
+	for (int i = 0; i < NUM_FLAG_BITS; ++i)
+		m_flagConstants[i] = -1;
 }
 
+void TypeEnum::OnPostInit(TypeRegistry&)
+{
+	// Indices live in the arena (if any), so they're only built once (or
+	// again if constants were added in the meantime).
+	if (IsIndexed())
+		return;
+
+	const int numConstants = m_constants.size();
+	// Temporary, goes to the heap, not to the arena.
+	NameEntries entries;
+	entries.reserve(numConstants);
+	for (int i = 0; i < numConstants; ++i)
+		entries.push_back(rde::make_pair(m_constants[i].m_name.GetId(), i));
+	rde::quick_sort(entries.begin(), entries.end(), NameEntryLess());
+	bool hashCollision(false);
+	for (int i = 1; i < numConstants && !hashCollision; ++i)
+		hashCollision = (entries[i].first == entries[i - 1].first);
+	// Very unlikely, but index needs unique keys. Name lookups stay linear
+	// for this enum then (they compare names, not just hashes).
+	m_nameIndex.clear();
+	if (!hashCollision && numConstants != 0)
+		m_nameIndex.build(entries.begin(), entries.end());
+
+	BuildValueIndex();
+
+	for (int i = 0; i < NUM_FLAG_BITS; ++i)
+		m_flagConstants[i] = -1;
+	for (int i = numConstants - 1; i >= 0; --i)
+	{
+		const unsigned long value = (unsigned long)m_constants[i].m_value;
+		if (value != 0 && (value & (value - 1)) == 0)
+		{
+			int bit(0);
+			while ((value >> bit) != 1)
+				++bit;
+			m_flagConstants[bit] = i;
+		}
+	}
+	m_numIndexedConstants = numConstants;
+}
+
+void TypeEnum::ReserveConstants(int numConstants, LinearArena* arena)
+{
+	RDE_ASSERT(m_constants.empty() && "Constants have to be reserved before adding any");
+	const LinearArenaAllocator allocator(arena);
+	m_constants.set_allocator(allocator);
+	m_constants.reserve(numConstants);
+	m_nameIndex.set_allocator(allocator);
+	m_valueTable.set_allocator(allocator);
+	m_valueIndex.set_allocator(allocator);
+}
 void TypeEnum::AddConstant(const Constant& constant)
 {
 	RDE_ASSERT(FindConstant(constant.m_name) == 0 && "Enumerator with given name already exists");
@@ -22,9 +106,64 @@ void TypeEnum::AddConstant(const Constant& constant)
 }
 const TypeEnum::Constant* TypeEnum::FindConstant(const StrId& name) const
 {
+	if (IsNameIndexed())
+	{
+		const Constant* c = FindConstant(name.GetId());
+		return c != 0 && c->m_name == name ? c : 0;
+	}
 	Constants::const_iterator it = rde::find_if(m_constants.begin(), m_constants.end(), name, CompareName);
 	return it == m_constants.end() ? 0 : &(*it);
 }
+const TypeEnum::Constant* TypeEnum::FindConstant(uint32 nameHash) const
+{
+	if (IsNameIndexed())
+	{
+		const int* index = m_nameIndex.find(nameHash);
+		return index ? &m_constants[*index] : 0;
+	}
+	Constants::const_iterator it = rde::find_if(m_constants.begin(), m_constants.end(), nameHash, CompareNameHash);
+	return it == m_constants.end() ? 0 : &(*it);
+}
+const TypeEnum::Constant* TypeEnum::FindConstantByValue(long value) const
+{
+	if (IsIndexed())
+	{
+		if (!m_valueTable.empty())
+		{
+			const unsigned long tableIndex = (unsigned long)value - (unsigned long)m_minValue;
+			if (tableIndex >= (unsigned long)m_valueTable.size())
+				return 0;
+			const int index = m_valueTable[tableIndex];
+			return index < 0 ? 0 : &m_constants[index];
+		}
+		const int* index = m_valueIndex.find(value);
+		return index ? &m_constants[*index] : 0;
+	}
+	Constants::const_iterator it = rde::find_if(m_constants.begin(), m_constants.end(), value, CompareValue);
+	return it == m_constants.end() ? 0 : &(*it);
+}
+long TypeEnum::EnumerateFlags(long value, ConstantEnumerator enumerator, void* userData) const
+{
+	const bool indexed = IsIndexed();
+	unsigned long bits = (unsigned long)value;
+	unsigned long unmatched(0);
+	for (int bit = 0; bits != 0; ++bit, bits >>= 1)
+	{
+		if ((bits & 1) == 0)
+			continue;
+		const unsigned long flag = 1UL << bit;
+		const Constant* c(0);
+		if (indexed)
+			c = (m_flagConstants[bit] < 0 ? 0 : &m_constants[m_flagConstants[bit]]);
+		else
+			c = FindConstantByValue(long(flag));
+		if (c != 0)
+			enumerator(*c, userData);
+		else
+			unmatched |= flag;
+	}
+	return long(unmatched);
+}
 int TypeEnum::GetNumConstants() const
 {
 	return m_constants.size();
@@ -42,4 +181,63 @@ void TypeEnum::EnumerateConstants(ConstantEnumerator enumerator, void* userData)
 	}
 }
 
+bool TypeEnum::IsIndexed() const
+{
+	// Constants added after building indices are not in there.
+	return m_numIndexedConstants == m_constants.size();
+}
+bool TypeEnum::IsNameIndexed() const
+{
+	return !m_nameIndex.empty() && IsIndexed();
+}
+
+void TypeEnum::BuildValueIndex()
+{
+	m_valueTable.clear();
+	m_valueIndex.clear();
+	const int numConstants = m_constants.size();
+	if (numConstants == 0)
+		return;
+
+	long minValue = m_constants[0].m_value;
+	long maxValue = minValue;
+	for (int i = 1; i < numConstants; ++i)
+	{
+		const long value = m_constants[i].m_value;
+		minValue = value < minValue ? value : minValue;
+		maxValue = value > maxValue ? value : maxValue;
+	}
+	// Dense table if at least half of its entries would be used.
+	const unsigned long range = (unsigned long)maxValue - (unsigned long)minValue;
+	if (range < (unsigned long)numConstants * 2)
+	{
+		m_minValue = minValue;
+		m_valueTable.resize(int(range) + 1);
+		for (int i = 0; i < m_valueTable.size(); ++i)
+			m_valueTable[i] = -1;
+		for (int i = 0; i < numConstants; ++i)
+		{
+			int& index = m_valueTable[(unsigned long)m_constants[i].m_value - (unsigned long)minValue];
+			if (index < 0)
+				index = i;
+		}
+		return;
+	}
+
+	// Sparse values. Index needs unique keys, so only first of aliases is kept.
+	ValueEntries entries;
+	entries.reserve(numConstants);
+	for (int i = 0; i < numConstants; ++i)
+		entries.push_back(rde::make_pair(m_constants[i].m_value, i));
+	rde::quick_sort(entries.begin(), entries.end(), ValueEntryLess());
+	ValueEntries::iterator last = entries.begin();
+	for (ValueEntries::iterator it = entries.begin() + 1; it != entries.end(); ++it)
+	{
+		if (it->first != last->first)
+			*(++last) = *it;
+	}
+	entries.resize(int(last - entries.begin()) + 1);
+	m_valueIndex.build(entries.begin(), entries.end());
+}
+
 }
@@ -2,7 +2,9 @@
 #define TYPE_ENUM_H
 
 #include "reflection/Type.h"
-#include "rdestl/fixed_vector.h"
+#include "core/LinearArena.h"
+#include "rdestl/eytzinger_map.h"
+#include "rdestl/vector.h"
 
 namespace rde
 {
@@ -24,19 +26,56 @@ public:
 
 	TypeEnum(uint32 size, const StrId& name);
 
+	// Builds name/value lookup indices. Lookups still work before that (or
+	// after adding more constants), but fall back to linear search.
+	virtual void OnPostInit(TypeRegistry&);
+
+	// Preallocates storage for constants, see TypeClass::ReserveFields.
+	// Lookup indices are kept in the same place.
+	void ReserveConstants(int numConstants, LinearArena* arena = 0);
 	void AddConstant(const Constant& constant);
 	// NULL if not found.
 	const Constant* FindConstant(const StrId& name) const;
+	const Constant* FindConstant(uint32 nameHash) const;
+	// If more constants have the same value, first one (in order of adding) is returned.
+	const Constant* FindConstantByValue(long value) const;
+	// For flag enums. Calls enumerator for every single bit constant that's set in value.
+	// @return bits that didn't match any constant (0 if value decomposed completely).
+	long EnumerateFlags(long value, ConstantEnumerator enumerator, void* userData = 0) const;
 
 	int GetNumConstants() const;
 	const Constant& GetConstant(int index) const;
 	void EnumerateConstants(ConstantEnumerator enumerator, void* userData = 0) const;
 
 private:
-	typedef rde::fixed_vector<Constant, 16, true> Constants;
-	Constants m_constants;
+	typedef rde::vector<Constant, LinearArenaAllocator> Constants;
+	// Value -> constant index.
+	typedef rde::vector<int, LinearArenaAllocator> ValueTable;
+	// Name hash/value -> constant index.
+	typedef rde::eytzinger_map<uint32, int, rde::less<uint32>, LinearArenaAllocator> NameIndex;
+	typedef rde::eytzinger_map<long, int, rde::less<long>, LinearArenaAllocator> ValueIndex;
+	enum
+	{
+		NUM_FLAG_BITS	= sizeof(long) * 8
+	};
+
+	bool IsIndexed() const;
+	// False if there are name hash collisions (or no constants).
+	bool IsNameIndexed() const;
+	void BuildValueIndex();
+
+	Constants	m_constants;
+	NameIndex	m_nameIndex;
+	// Values are either in dense table (if they're contiguous, or close
+	// to it), or in sparse index.
+	ValueTable	m_valueTable;
+	long		m_minValue;
+	ValueIndex	m_valueIndex;
+	// Constant index for every bit, -1 if there's no constant with just this bit set.
+	int			m_flagConstants[NUM_FLAG_BITS];
+	// -1 if indices haven't been built yet.
+	int			m_numIndexedConstants;
 };
 }
 
 #endif
-
@@ -1,50 +1,49 @@
 #include "reflection/TypeRegistry.h"
+#include "reflection/InstancePool.h"
 #include "reflection/TypeClass.h"
-#include "rdestl/fixed_vector.h"
 #include "rdestl/hash_map.h"
-#include "core/OwnedPtr.h"
+#include "rdestl/vector.h"
+#include "core/LinearArena.h"
 
 namespace rde
 {
 struct TypeRegistry::Impl
 {
 	// Key: type ID
-	typedef hash_map<uint32, Type*>							TypeMap;
-	typedef fixed_vector<OwnedPtr<FieldEditInfo>, 16, true> FieldInfos;
+	typedef hash_map<uint32, Type*>	TypeMap;
+	typedef vector<Type*>			TypeList;
 
 	Impl()
+	:	m_arena(64 * 1024, "TypeRegistry")
 	{
 		AddFundamentalTypes();
 	}
-	~Impl()
-	{
-		// @TODO: This is so *ugly*, we need to find a more elegant way of cleaning types.
-		for (TypeMap::iterator it = m_types.begin(); it != m_types.end(); ++it)
-		{
-			Type* t = it->second;
-			if (t->m_reflectionType != ReflectionType::FUNDAMENTAL)
-				delete t;
-		}
-	}
 	void AddType(Type* t)
 	{
 		RDE_ASSERT(FindType(t->m_name.GetId()) == 0 && "Type already registered");
 		m_types.insert(rde::make_pair(t->m_name.GetId(), t));
-	}
-	void AddFieldEditInfos(const OwnedPtr<FieldEditInfo>& infos)
-	{
-		RDE_ASSERT(find(m_fieldInfos.begin(), m_fieldInfos.end(), infos) == m_fieldInfos.end() &&
-			"Field infos already added");
-		m_fieldInfos.push_back(infos);
+		m_typeList.push_back(t);
 	}
 	void PostInit(TypeRegistry& typeRegistry)
 	{
-		for (TypeMap::iterator it = m_types.begin(); it != m_types.end(); ++it)
-			it->second->OnPostInit(typeRegistry);
+		for (TypeList::iterator it = m_typeList.begin(); it != m_typeList.end(); ++it)
+			(*it)->OnPostInit(typeRegistry);
+		// Second pass, bases of all classes are known now.
+		for (TypeList::iterator it = m_typeList.begin(); it != m_typeList.end(); ++it)
+		{
+			TypeClass* tc = rde::ReflectionTypeCast<TypeClass>(*it);
+			if (tc)
+				tc->ResolveHierarchy();
+		}
 	}
 	void RemoveType(const StrId& typeName)
 	{
-		m_types.erase(typeName.GetId());
+		Type* t = FindType(typeName.GetId());
+		if (t != 0)
+		{
+			m_types.erase(typeName.GetId());
+			m_typeList.erase(m_typeList.find(t));
+		}
 	}
 	Type* FindType(uint32 key) const
 	{
@@ -53,9 +52,9 @@ struct TypeRegistry::Impl
 	}
 	void EnumerateTypes(TypeRegistry::TypeEnumerator enumerator, void* userData)
 	{
-		for (TypeMap::const_iterator it = m_types.begin(); it != m_types.end(); ++it)
+		for (TypeList::const_iterator it = m_typeList.begin(); it != m_typeList.end(); ++it)
 		{
-			enumerator(it->second, userData);
+			enumerator(*it, userData);
 		}
 	}
 	void* CreateInstance(uint32 typeTag) const
@@ -63,12 +62,19 @@ struct TypeRegistry::Impl
 		TypeClass* tc = rde::ReflectionTypeCast<TypeClass>(FindType(typeTag));
 		return tc ? tc->CreateInstance() : 0;
 	}
+	void* CreateInstances(uint32 typeTag, int count, InstancePool& pool) const
+	{
+		TypeClass* tc = rde::ReflectionTypeCast<TypeClass>(FindType(typeTag));
+		return tc ? pool.CreateInstances(tc, count) : 0;
+	}
 	size_t CalcMemoryUsage() const
 	{
-		size_t memUsage(0);
-		for (TypeMap::const_iterator it = m_types.begin(); it != m_types.end(); ++it)
+		size_t memUsage(m_arena.GetReservedBytes());
+		for (TypeList::const_iterator it = m_typeList.begin(); it != m_typeList.end(); ++it)
 		{
-			Type* t = it->second;
+			Type* t = *it;
+			if (m_arena.Owns(t))
+				continue;
 			if (t->m_reflectionType == ReflectionType::CLASS)
 			{
 				memUsage += sizeof(TypeClass);
@@ -88,8 +94,10 @@ struct TypeRegistry::Impl
 #		include "reflection/FundamentalTypes.h"
 	}
 
+	// Types constructed here go away with it, others are not ours.
+	LinearArena	m_arena;
 	TypeMap		m_types;
-	FieldInfos	m_fieldInfos;
+	TypeList	m_typeList;
 };
 
 TypeRegistry::TypeRegistry()
@@ -104,11 +112,6 @@ void TypeRegistry::AddType(Type* t)
 {
 	m_impl->AddType(t);
 }
-void TypeRegistry::AddFieldEditInfos(const OwnedPtr<FieldEditInfo>& infos)
-{
-	RDE_ASSERT(infos);
-	m_impl->AddFieldEditInfos(infos);
-}
 void TypeRegistry::PostInit()
 {
 	m_impl->PostInit(*this);
@@ -133,6 +136,11 @@ void TypeRegistry::EnumerateTypes(TypeEnumerator enumerator, void* userData)
 	m_impl->EnumerateTypes(enumerator, userData);
 }
 
+LinearArena& TypeRegistry::GetArena()
+{
+	return m_impl->m_arena;
+}
+
 size_t TypeRegistry::CalcMemoryUsage() const
 {
 	return m_impl->CalcMemoryUsage();
@@ -142,5 +150,9 @@ void* TypeRegistry::Internal_CreateInstance(uint32 typeTag) const
 {
 	return m_impl->CreateInstance(typeTag);
 }
+void* TypeRegistry::Internal_CreateInstances(uint32 typeTag, int count, InstancePool& pool) const
+{
+	return m_impl->CreateInstances(typeTag, count, pool);
+}
 
 } // rde
@@ -6,9 +6,13 @@
 
 namespace rde
 {
-struct FieldEditInfo;
-template<typename T> class OwnedPtr;
+class InstancePool;
+class LinearArena;
 
+// Types loaded at run-time (with their fields, enum constants, field edit infos)
+// should be constructed in registry's arena (GetArena). Arena memory is released
+// at once when registry is destroyed, no destructors are called.
+// Types added from elsewhere are not owned by the registry.
 class TypeRegistry
 {
 public:
@@ -24,7 +28,6 @@ public:
 		AddType(TypeOf<T>());
 	}
 	void AddType(Type* t);
-	void AddFieldEditInfos(const OwnedPtr<FieldEditInfo>& infos);
 
 	// To be called after adding all types that relate to themselves.
 	// This will convert type names to pointers for quicker access.
@@ -34,19 +37,31 @@ public:
 	// NULL if not found.
 	const Type* FindType(const StrId& typeName) const;
 	const Type* FindType(uint32 typeTag) const;	// Hash
+	// In order of adding.
 	void EnumerateTypes(TypeEnumerator enumerator, void* userData = 0);
 
+	LinearArena& GetArena();
+
 	template<typename T>
 	T* CreateInstance(const StrId& typeName) const
 	{
 		return static_cast<T*>(Internal_CreateInstance(typeName.GetId()));
 	}
+	// Batch version, one lookup for all objects, memory comes from pool
+	// (objects are not constructed, see InstancePool).
+	// NULL if there's no such class.
+	template<typename T>
+	T* CreateInstances(const StrId& typeName, int count, InstancePool& pool) const
+	{
+		return static_cast<T*>(Internal_CreateInstances(typeName.GetId(), count, pool));
+	}
 
 	// Estimation, in bytes.
 	size_t CalcMemoryUsage() const;
 
 private:
 	void* Internal_CreateInstance(uint32 typeTag) const;
+	void* Internal_CreateInstances(uint32 typeTag, int count, InstancePool& pool) const;
 
 	struct Impl;
 	ScopedPtr<Impl>	m_impl;
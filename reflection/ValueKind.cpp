@@ -0,0 +1,82 @@
+#include "reflection/ValueKind.h"
+#include "reflection/TypeClass.h"
+#include "reflection/TypeRegistry.h"
+
+namespace rde
+{
+ValueKind::Enum GetValueKind(const Type* type, const TypeRegistry& typeRegistry, const Type** outElementType)
+{
+	const Type* elementType(0);
+	ValueKind::Enum kind(ValueKind::UNSUPPORTED);
+	switch (type->m_reflectionType)
+	{
+	case ReflectionType::FUNDAMENTAL:
+		if (type == TypeOf<bool>())
+			kind = ValueKind::BOOL;
+		else if (type == TypeOf<float>())
+			kind = ValueKind::FLOAT;
+		else if (type == TypeOf<double>())
+			kind = ValueKind::DOUBLE;
+		else
+			kind = IsSignedFundamental(type) ? ValueKind::INT : ValueKind::UINT;
+		break;
+	case ReflectionType::ENUM:
+		kind = ValueKind::ENUM;
+		break;
+	case ReflectionType::ARRAY:
+		{
+			const TypeArray* ta = static_cast<const TypeArray*>(type);
+			elementType = typeRegistry.FindType(ta->m_containedTypeId);
+			if (elementType != 0 && ta->m_numElements > 0)
+				kind = (elementType == TypeOf<char>() ? ValueKind::STRING : ValueKind::ARRAY);
+		}
+		break;
+	case ReflectionType::POINTER:
+		elementType = typeRegistry.FindType(static_cast<const TypePointer*>(type)->m_pointedTypeId);
+		if (elementType != 0)
+			kind = ValueKind::POINTER;
+		break;
+	case ReflectionType::CLASS:
+		{
+			const TypeClass* tc = static_cast<const TypeClass*>(type);
+			if (tc->IsVector())
+			{
+				const TypePointer* tp = SafeReflectionCast<TypePointer>(tc->GetField(0)->m_type);
+				elementType = typeRegistry.FindType(tp->m_pointedTypeId);
+				if (elementType != 0)
+					kind = ValueKind::VECTOR;
+			}
+			else
+				kind = ValueKind::CLASS;
+		}
+		break;
+	default:
+		break;
+	}
+	if (outElementType != 0)
+		*outElementType = (kind != ValueKind::UNSUPPORTED ? elementType : 0);
+	return kind;
+}
+
+bool IsSignedFundamental(const Type* type)
+{
+	return type == TypeOf<char>() || type == TypeOf<signed char>() || type == TypeOf<signed short>() ||
+		type == TypeOf<signed long>() || type == TypeOf<int64>();
+}
+
+VectorLayout GetVectorLayout(const TypeClass* vectorType)
+{
+	RDE_ASSERT(vectorType->IsVector());
+	const Field* beginField = vectorType->GetField(0);
+	const Field* endField = vectorType->GetField(1);
+	VectorLayout layout;
+	layout.beginOffset = vectorType->CalcOffsetFrom(beginField->m_ownerClass) + beginField->m_offset;
+	layout.endOffset = vectorType->CalcOffsetFrom(endField->m_ownerClass) + endField->m_offset;
+	layout.capacityOffset = VectorLayout::NO_OFFSET;
+	const Field* capacityField = vectorType->FindField("m_capacity");
+	if (capacityField != 0)
+		layout.capacityOffset = vectorType->CalcOffsetFrom(capacityField->m_ownerClass) + capacityField->m_offset;
+	return layout;
+}
+
+} // rde
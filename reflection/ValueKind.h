@@ -0,0 +1,56 @@
+#ifndef VALUE_KIND_H
+#define VALUE_KIND_H
+
+#include "reflection/Type.h"
+
+namespace rde
+{
+class TypeClass;
+
+// How values of given type are handled by reflection driven serializers.
+namespace ValueKind
+{
+enum Enum
+{
+	BOOL,
+	INT,
+	UINT,
+	FLOAT,
+	DOUBLE,
+	ENUM,
+	STRING,		// char array
+	ARRAY,
+	VECTOR,
+	POINTER,
+	CLASS,
+	UNSUPPORTED
+};
+}
+
+// Where rde::vector keeps its data.
+struct VectorLayout
+{
+	static const uint32 NO_OFFSET = 0xFFFFFFFF;
+	// Readers treat bigger vectors as corrupted input (capacity is an int).
+	static const uint32 MAX_BYTES = 0x7FFFFFFF;
+
+	uint32	beginOffset;
+	uint32	endOffset;
+	// NO_OFFSET if capacity is not reflected.
+	uint32	capacityOffset;
+};
+
+// ARRAY/VECTOR: outElementType (optional) is element type, POINTER: pointed type.
+// Arrays, vectors and pointers of types that are not registered are UNSUPPORTED.
+ValueKind::Enum GetValueKind(const Type* type, const TypeRegistry& typeRegistry,
+	const Type** outElementType = 0);
+// char, signed char/short/long and int64.
+bool IsSignedFundamental(const Type* type);
+// First two fields of vector are begin/end (see CollectPointers_Vector in
+// load-in-place code), offsets are from the start of vector.
+// @pre vectorType->IsVector()
+VectorLayout GetVectorLayout(const TypeClass* vectorType);
+
+} // rde
+
+#endif
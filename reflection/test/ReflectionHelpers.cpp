@@ -1,10 +1,13 @@
 #include "reflection/TypeClass.h"
 #include "reflection/TypeEnum.h"
 #include "reflection/TypeRegistry.h"
+#include "io/AsyncIo.h"
 #include "io/FileStream.h"
 #include "io/StreamReader.h"
+#include "rdestl/fixed_vector.h"
 #include "rdestl/stack.h"
-#include "core/OwnedPtr.h"
+#include "core/LinearArena.h"
+#include "core/ScopedPtr.h"
 
 namespace
 {
@@ -33,9 +36,11 @@ struct FieldData
 };
 #pragma pack(pop)
 
-void LoadFields(rde::StreamReader& sr, rde::TypeClass& tc, rde::FieldEditInfo* fieldInfos)
+void LoadFields(rde::StreamReader& sr, rde::TypeClass& tc, rde::FieldEditInfo* fieldInfos,
+				rde::LinearArena& arena)
 {
 	const int numFields = sr.ReadInt32();
+	tc.ReserveFields(numFields, &arena);
 	char fieldNameBuffer[128];
 	static const rde::uint16 INVALID_INDEX = 0xFFFF;
 	for (int i = 0; i < numFields; ++i)
@@ -55,11 +60,13 @@ void LoadReflectionInfo(rde::Stream& stream, rde::TypeRegistry& typeRegistry)
 	rde::StreamReader sr(&stream);
 	const int numTypes = sr.ReadInt32();
 	const int numFieldInfos = sr.ReadInt32();
+	// Everything's allocated from registry's arena, in load order.
+	rde::LinearArena& arena = typeRegistry.GetArena();
 
 	rde::FieldEditInfo* fieldInfos(0);
 	if (numFieldInfos != 0)
 	{
-		fieldInfos = new rde::FieldEditInfo[numFieldInfos];
+		fieldInfos = arena.AllocateArray<rde::FieldEditInfo>(numFieldInfos);
 		char helpBuffer[64];
 		for (int i = 0; i < numFieldInfos; ++i)
 		{
@@ -92,16 +99,17 @@ void LoadReflectionInfo(rde::Stream& stream, rde::TypeRegistry& typeRegistry)
 				initVTableFuncAddress += s_moduleBase;
 			rde::TypeClass::FnInitVTable pfnInitVTable = (rde::TypeClass::FnInitVTable)initVTableFuncAddress;
 
-			rde::TypeClass* tc = new rde::TypeClass(typeSize, nameBuffer, pfnCreateInstance, pfnInitVTable, 
-				baseClassId, baseClassOffset);
-			LoadFields(sr, *tc, fieldInfos);
+			rde::TypeClass* tc = new (arena.Allocate(sizeof(rde::TypeClass))) rde::TypeClass(typeSize,
+				nameBuffer, pfnCreateInstance, pfnInitVTable, baseClassId, baseClassOffset);
+			LoadFields(sr, *tc, fieldInfos, arena);
 			newType = tc;
 		}
 		else if (reflectionType == rde::ReflectionType::ENUM)
 		{
 			const int numEnumElements = sr.ReadInt32();
 			char enumeratorNameBuffer[128];
-			rde::TypeEnum* te = new rde::TypeEnum(typeSize, nameBuffer);
+			rde::TypeEnum* te = new (arena.Allocate(sizeof(rde::TypeEnum))) rde::TypeEnum(typeSize, nameBuffer);
+			te->ReserveConstants(numEnumElements, &arena);
 			for (int i = 0; i < numEnumElements; ++i)
 			{
 				sr.ReadASCIIZ(enumeratorNameBuffer, sizeof(enumeratorNameBuffer));
@@ -114,13 +122,15 @@ void LoadReflectionInfo(rde::Stream& stream, rde::TypeRegistry& typeRegistry)
 		else if (reflectionType == rde::ReflectionType::POINTER)
 		{
 			const rde::uint32 pointedTypeId = sr.ReadInt32();
-			newType = new rde::TypePointer(typeSize, nameBuffer, pointedTypeId);
+			newType = new (arena.Allocate(sizeof(rde::TypePointer))) rde::TypePointer(typeSize,
+				nameBuffer, pointedTypeId);
 		}
 		else if (reflectionType == rde::ReflectionType::ARRAY)
 		{
 			const rde::uint32 containedTypeId = sr.ReadInt32();
 			const int numElements = sr.ReadInt32();
-			newType = new rde::TypeArray(typeSize, nameBuffer, containedTypeId, numElements);
+			newType = new (arena.Allocate(sizeof(rde::TypeArray))) rde::TypeArray(typeSize,
+				nameBuffer, containedTypeId, numElements);
 		}
 		else
 		{
@@ -129,10 +139,6 @@ void LoadReflectionInfo(rde::Stream& stream, rde::TypeRegistry& typeRegistry)
 		if (newType)
 			typeRegistry.AddType(newType);
 	}
-	if (fieldInfos)
-	{
-		typeRegistry.AddFieldEditInfos(fieldInfos);
-	}
 }
 
 //-----------------------------------------------------------------------------------------------------
@@ -168,6 +174,13 @@ struct RawFieldInfo
 typedef rde::fixed_vector<PointerFixupEntry, 16, true> PointerFixups;
 typedef rde::fixed_vector<RawFieldInfo, 16, true> RawFields;
 typedef rde::vector<const rde::Field*> Fields;
+typedef rde::fixed_vector<rde::iosys::WriteSpan, 32, true> WriteSpans;
+
+void AddWriteSpan(WriteSpans& spans, const void* data, long bytes)
+{
+	rde::iosys::WriteSpan span = { data, bytes };
+	spans.push_back(span);
+}
 
 struct CollectContext
 {
@@ -375,17 +388,7 @@ void CollectClass(void* rawPointer, CollectContext* context, const rde::TypeClas
 	};
 	context->m_objectStack.push(newEntry);
 	// Special case A: rde::vector.
-	static const char* rdeVectorName = "vector<";
-	static const long rdeVectorNameLen = rde::strlen(rdeVectorName);
-
-	const char* tcName = tc->m_name.GetStr();
-	// -1 -> 0, 0->1 etc. (so that -1 doesn't require further fixing).
-	int colonPos = rde::find_index_of(tcName, ':') + 1;
-	if (colonPos > 0)
-	{
-		++colonPos;
-	}
-	if (rde::strcompare(tcName + colonPos, rdeVectorName, rdeVectorNameLen) == 0)
+	if (tc->IsVector())
 	{
 		CollectPointers_Vector(context, tc);
 	}
@@ -428,6 +431,52 @@ void CollectMembers(const rde::Field* field, void* userData)
 	}
 }
 
+void FixupObject(void* objectMem, const rde::TypeClass* type, const PointerFixups& pointerFixups,
+				 const rde::TypeRegistry& typeRegistry)
+{
+	type->InitVTable(objectMem);
+
+	rde::uint8* objectMem8 = static_cast<rde::uint8*>(objectMem);
+	for (PointerFixups::const_iterator it = pointerFixups.begin(); it != pointerFixups.end(); ++it)
+	{
+		rde::uint8* pptr = objectMem8 + it->m_pointerOffset;
+		void* patchedMem = objectMem8 + it->m_pointerValueOffset;
+		*reinterpret_cast<void**>(pptr) = patchedMem;
+
+		if (it->m_typeTag != 0)
+		{
+			const rde::TypeClass* fieldType = 
+				static_cast<const rde::TypeClass*>(typeRegistry.FindType(it->m_typeTag));
+			// We already initialized vtable for 'main' object.
+			if (patchedMem != objectMem)
+				fieldType->InitVTable(patchedMem);
+		}
+	}
+}
+
+// State of single object loaded with LoadObjectsAsync.
+struct AsyncObjectLoad
+{
+	AsyncObjectLoad()
+	:	m_file(rde::iosys::INVALID_FILE_HANDLE),
+		m_type(0),
+		m_objectMem(0),
+		m_headerRequest(-1),
+		m_firstDataRequest(0),
+		m_numDataRequests(0)
+	{
+	}
+
+	rde::iosys::FileHandle	m_file;
+	ObjectHeader			m_header;
+	const rde::TypeClass*	m_type;
+	PointerFixups			m_fixups;
+	void*					m_objectMem;
+	int						m_headerRequest;
+	int						m_firstDataRequest;
+	int						m_numDataRequests;
+};
+
 } // namespace
 
 void InitModuleBase(size_t moduleBase)
@@ -465,25 +514,92 @@ void* LoadObjectImpl(rde::Stream& stream, rde::TypeRegistry& typeRegistry, rde::
 	}
 	void* objectMem = operator new(objectHeader.size);
 	stream.Read(objectMem, objectHeader.size);
-	type->InitVTable(objectMem);
+	FixupObject(objectMem, type, pointerFixups, typeRegistry);
+	return objectMem;
+}
 
-	rde::uint8* objectMem8 = static_cast<rde::uint8*>(objectMem);
-	for (PointerFixups::const_iterator it = pointerFixups.begin(); it != pointerFixups.end(); ++it)
+int LoadObjectsAsync(const char* const* fileNames, int numObjects, void** outObjects,
+					 rde::TypeRegistry& typeRegistry, rde::uint32 version, rde::AsyncIo& asyncIo)
+{
+	rde::ScopedPtr<AsyncObjectLoad, rde::ArrayDeleter> loads(new AsyncObjectLoad[numObjects]);
+	rde::ScopedPtr<rde::AsyncIoRequest, rde::ArrayDeleter> headerRequests(new rde::AsyncIoRequest[numObjects]);
+	// Max 2 requests per object (fixups + object data).
+	rde::ScopedPtr<rde::AsyncIoRequest, rde::ArrayDeleter> dataRequests(new rde::AsyncIoRequest[numObjects * 2]);
+
+	// Stage 1: headers of all objects in one batch.
+	int numHeaderRequests(0);
+	for (int i = 0; i < numObjects; ++i)
 	{
-		rde::uint8* pptr = objectMem8 + it->m_pointerOffset;
-		void* patchedMem = objectMem8 + it->m_pointerValueOffset;
-		*reinterpret_cast<void**>(pptr) = patchedMem;
+		outObjects[i] = 0;
+		AsyncObjectLoad& load = loads.Get()[i];
+		load.m_file = rde::iosys::OpenFile(fileNames[i], rde::iosys::AccessMode::READ);
+		if (load.m_file == rde::iosys::INVALID_FILE_HANDLE)
+			continue;
+		load.m_headerRequest = numHeaderRequests;
+		headerRequests.Get()[numHeaderRequests++].SetRead(load.m_file, 0, 
+			&load.m_header, sizeof(load.m_header));
+	}
+	asyncIo.Submit(headerRequests.Get(), numHeaderRequests);
 
-		if (it->m_typeTag != 0)
+	// Stage 2: as headers arrive, queue reads of fixup tables & object data straight
+	// into their final destination. All of them are submitted at once, so reads of
+	// many objects overlap.
+	int numDataRequests(0);
+	for (int i = 0; i < numObjects; ++i)
+	{
+		AsyncObjectLoad& load = loads.Get()[i];
+		if (load.m_headerRequest < 0)
+			continue;
+		rde::AsyncIoRequest& headerRequest = headerRequests.Get()[load.m_headerRequest];
+		asyncIo.Wait(headerRequest);
+		if (!headerRequest.Succeeded() || (version != 0 && version != load.m_header.version))
+			continue;
+		load.m_type = rde::ReflectionTypeCast<rde::TypeClass>(typeRegistry.FindType(load.m_header.typeTag));
+		if (load.m_type == 0)
+			continue;
+
+		load.m_firstDataRequest = numDataRequests;
+		long offset = sizeof(ObjectHeader);
+		if (load.m_header.numPointerFixups > 0)
 		{
-			const rde::TypeClass* fieldType = 
-				static_cast<const rde::TypeClass*>(typeRegistry.FindType(it->m_typeTag));
-			// We already initialized vtable for 'main' object.
-			if (patchedMem != objectMem)
-				fieldType->InitVTable(patchedMem);
+			load.m_fixups.resize(load.m_header.numPointerFixups);
+			const long fixupBytes = load.m_header.numPointerFixups * sizeof(PointerFixupEntry);
+			dataRequests.Get()[numDataRequests++].SetRead(load.m_file, offset, load.m_fixups.begin(), fixupBytes);
+			offset += fixupBytes;
 		}
+		load.m_objectMem = operator new(load.m_header.size);
+		dataRequests.Get()[numDataRequests++].SetRead(load.m_file, offset, load.m_objectMem,
+			load.m_header.size);
+		load.m_numDataRequests = numDataRequests - load.m_firstDataRequest;
 	}
-	return objectMem;
+	asyncIo.Submit(dataRequests.Get(), numDataRequests);
+
+	// Stage 3: patch objects in order, while remaining reads are still in flight.
+	int numLoaded(0);
+	for (int i = 0; i < numObjects; ++i)
+	{
+		AsyncObjectLoad& load = loads.Get()[i];
+		bool ok = (load.m_objectMem != 0);
+		for (int r = 0; r < load.m_numDataRequests; ++r)
+		{
+			rde::AsyncIoRequest& request = dataRequests.Get()[load.m_firstDataRequest + r];
+			asyncIo.Wait(request);
+			ok &= request.Succeeded();
+		}
+		if (ok)
+		{
+			FixupObject(load.m_objectMem, load.m_type, load.m_fixups, typeRegistry);
+			outObjects[i] = load.m_objectMem;
+			++numLoaded;
+		}
+		else if (load.m_objectMem != 0)
+		{
+			operator delete(load.m_objectMem);
+		}
+		if (load.m_file != rde::iosys::INVALID_FILE_HANDLE)
+			rde::iosys::CloseFile(load.m_file);
+	}
+	return numLoaded;
 }
 
 // Rough layout:
@@ -528,27 +644,34 @@ void SaveObjectImpl(const void* obj, const rde::StrId& typeName, rde::Stream& st
 	// Fix size, couldn't do it earlier, because we used this as object offset, so it had to be zero.
 	collectContext.m_dataSize += type->m_size;
 
-	// Write object header.
+	// Everything (header, fixups, raw object memory) is submitted with
+	// a single vectored write, instead of one write per block.
+	WriteSpans spans;
+	spans.reserve(collectContext.m_fields.size() + 2);
+
+	// Object header.
 	objectHeader.size = collectContext.m_dataSize;
 	RDE_ASSERT(collectContext.m_fixups.size() < 65536);
 	objectHeader.numPointerFixups = (rde::uint16)collectContext.m_fixups.size() - 1;
-	stream.Write(&objectHeader, sizeof(ObjectHeader));
+	AddWriteSpan(spans, &objectHeader, sizeof(ObjectHeader));
 
-	// Write fixups
+	// Fixups
 	// Skip initial fixup, it's always 0, 0
 	if (objectHeader.numPointerFixups > 0)
-		stream.Write(collectContext.m_fixups.begin() + 1, objectHeader.numPointerFixups * sizeof(PointerFixupEntry));
+		AddWriteSpan(spans, collectContext.m_fixups.begin() + 1, objectHeader.numPointerFixups * sizeof(PointerFixupEntry));
 
 	// Raw object memory (main obj + ptr fields).
 #if DBG_VERBOSITY_LEVEL > 0
-	const int objectMemStart = stream.GetPosition();
+	long objectMemOffset(0);
 #endif
 	for (RawFields::iterator it = collectContext.m_fields.begin(); it != collectContext.m_fields.end(); ++it)
 	{
 #if DBG_VERBOSITY_LEVEL > 0
 		DBGPRINTF2("%*s%d: %s [%d byte(s)]\n", it->m_nestLevel, "", 
-			stream.GetPosition() - objectMemStart, it->m_name.GetStr(), it->m_size);
+			objectMemOffset, it->m_name.GetStr(), it->m_size);
+		objectMemOffset += (long)it->m_size;
 #endif
-		stream.Write(*it->m_mem, (long)it->m_size);
+		AddWriteSpan(spans, *it->m_mem, (long)it->m_size);
 	}
+	stream.WriteV(spans.begin(), (int)spans.size());
 }
@@ -5,6 +5,7 @@
 
 namespace rde
 {
+class AsyncIo;
 class StrId;
 class Stream;
 class TypeRegistry;
@@ -15,6 +16,11 @@ bool LoadReflectionInfo(const char* fileName, rde::TypeRegistry& typeRegistry);
 void SaveObjectImpl(const void* obj, const rde::StrId& typeName, rde::Stream& stream, 
 					rde::TypeRegistry& typeRegistry, rde::uint32 version);
 void* LoadObjectImpl(rde::Stream& stream, rde::TypeRegistry& typeRegistry, rde::uint32 version);
+// Loads one object per file, reads of all files overlap.
+// outObjects[i] set to NULL if i-th object couldn't be loaded.
+// Returns number of objects loaded.
+int LoadObjectsAsync(const char* const* fileNames, int numObjects, void** outObjects,
+					 rde::TypeRegistry& typeRegistry, rde::uint32 version, rde::AsyncIo& asyncIo);
 
 template<typename T>
 void SaveObject(const T& obj, rde::Stream& stream, rde::TypeRegistry& typeRegistry, rde::uint32 version)
@@ -1,12 +1,50 @@
+#include <cmath>
 #include <cstdio>
 #include <cstddef>
+#include <cstring>
+#include <emmintrin.h>
 #include "ReflectionHelpers.h"
+#include "reflection/DeepClone.h"
+#include "reflection/DeltaEncoder.h"
+#include "reflection/InstancePool.h"
+#include "reflection/JsonSerializer.h"
+#include "reflection/ObjectCompare.h"
+#include "reflection/SoAContainer.h"
+#include "reflection/TaggedBinary.h"
 #include "reflection/TypeClass.h"
 #include "reflection/TypeEnum.h"
 #include "reflection/TypeRegistry.h"
+#include "io/AsyncIo.h"
+#include "io/CompressedStream.h"
 #include "io/FileStream.h"
+#include "io/MemoryStream.h"
 #include "io/StreamReader.h"
+#include "rdestl/basic_string.h"
+#include "rdestl/eytzinger_map.h"
+#include "rdestl/flat_hash_map.h"
+#include "rdestl/hash_map.h"
+#include "rdestl/list.h"
+#include "rdestl/node_pool.h"
+#include "rdestl/parallel_sort.h"
+#include "rdestl/radix_sorter.h"
+#include "rdestl/rb_tree.h"
+#include "rdestl/simple_string_storage.h"
+#include "rdestl/sorted_vector.h"
+#include "rdestl/sso_string_storage.h"
 #include "rdestl/stack.h"
+#include "rdestl/string_utils.h"
+#include "rdestl/ternary_search_tree.h"
+#include "rdestl/vector.h"
+#include "core/AllocationProfiler.h"
+#include "core/BitMath.h"
+#include "core/CRC32.h"
+#include "core/JobSystem.h"
+#include "core/LinearArena.h"
+#include "core/MemManager.h"
+#include "core/MPMCQueue.h"
+#include "core/SizeClassAllocator.h"
+#include "core/SPSCRingBuffer.h"
+#include "core/Thread.h"
 #include "core/Timer.h"
 #include "core/win32/Windows.h"
 
@@ -246,6 +284,2884 @@ void TestCircular(rde::TypeRegistry& typeRegistry)
 	}
 }
 
+void TestMemoryStream(rde::TypeRegistry& typeRegistry)
+{
+	CircularPtrTest a;
+	CircularPtrTest b;
+	a.val = 10;
+	b.val = 20;
+	a.ptr = &b;
+	b.ptr = &a;
+
+	// Small initial capacity on purpose, so that it has to grow.
+	rde::MemoryStream ostream(16);
+	SaveObject(a, ostream, typeRegistry, 1);
+	RDE_ASSERT(ostream.GetSize() > 0);
+	RDE_ASSERT(ostream.GetPosition() == ostream.GetSize());
+
+	// Load straight from stream's buffer, no copies.
+	rde::SpanStream istream(ostream.GetData(), ostream.GetSize());
+	CircularPtrTest* pa = LoadObject<CircularPtrTest>(istream, typeRegistry, 1);
+	RDE_ASSERT(istream.GetPosition() == istream.GetSize());
+	RDE_ASSERT(pa->val == 10);
+	RDE_ASSERT(pa->ptr->val == 20);
+	RDE_ASSERT(pa->ptr->ptr == pa);
+	operator delete(pa);
+
+	// Reading the same buffer once again via MemoryStream itself.
+	ostream.Seek(rde::iosys::SeekMode::BEGIN, 0);
+	pa = LoadObject<CircularPtrTest>(ostream, typeRegistry, 1);
+	RDE_ASSERT(pa->ptr->ptr == pa);
+	operator delete(pa);
+}
+
+void TestCompressedStream(rde::TypeRegistry& typeRegistry)
+{
+	SuperBar sb;
+	sb.i = 7;
+	sb.p = &sb.color.b;
+	sb.psb = &sb;
+	for (int i = 0; i < 1000; ++i)
+		sb.v.push_back(i & 15);
+
+	// Tiny blocks, so that object spans many of them.
+	rde::MemoryStream memStream;
+	{
+		rde::CompressedStream ostream;
+		ostream.Open(&memStream, rde::iosys::AccessMode::WRITE, 256);
+		SaveObject(sb, ostream, typeRegistry, 1);
+		ostream.Close();
+		RDE_ASSERT(ostream.GetCompressedSize() == memStream.GetSize());
+		RDE_ASSERT(ostream.GetCompressedSize() < ostream.GetSize());
+	}
+
+	rde::SpanStream spanStream(memStream.GetData(), memStream.GetSize());
+	rde::CompressedStream istream;
+	istream.Open(&spanStream, rde::iosys::AccessMode::READ);
+	istream.SetNumDecompressionThreads(2);
+	SuperBar* psb = LoadObject<SuperBar>(istream, typeRegistry, 1);
+	RDE_ASSERT(istream.GetPosition() == istream.GetSize());
+	RDE_ASSERT(psb->i == sb.i);
+	RDE_ASSERT(*psb->p == psb->color.b);
+	RDE_ASSERT(psb->psb == psb);
+	RDE_ASSERT(psb->v.size() == 1000);
+	RDE_ASSERT(psb->v[999] == (999 & 15));
+	operator delete(psb);
+
+	// Random access.
+	istream.Seek(rde::iosys::SeekMode::BEGIN, 0);
+	rde::uint32 typeTag(0);
+	istream.Read(&typeTag, sizeof(typeTag));
+	RDE_ASSERT(typeTag == rde::StrId(rde::GetTypeName<SuperBar>()).GetId());
+}
+
+// Counts write calls that reach the stream.
+class CountingStream : public rde::MemoryStream
+{
+public:
+	CountingStream(): m_numWriteCalls(0) {}
+
+	virtual void Write(const void* data, long bytes)
+	{
+		++m_numWriteCalls;
+		rde::MemoryStream::Write(data, bytes);
+	}
+	virtual void WriteV(const rde::iosys::WriteSpan* spans, int numSpans)
+	{
+		++m_numWriteCalls;
+		rde::MemoryStream::WriteV(spans, numSpans);
+	}
+
+	int	m_numWriteCalls;
+};
+
+// Graph of many small objects, used to be saved with one write per object.
+void BenchmarkSaveGraph(rde::TypeRegistry& typeRegistry)
+{
+	const int kNumObjects = 2000;
+	rde::vector<CircularPtrTest> objects(kNumObjects);
+	for (int i = 0; i < kNumObjects; ++i)
+	{
+		objects[i].val = i;
+		objects[i].ptr = &objects[(i + 1) % kNumObjects];
+	}
+
+	CountingStream countingStream;
+	SaveObject(objects[0], countingStream, typeRegistry, 1);
+	RDE_ASSERT(countingStream.m_numWriteCalls == 1);
+
+	rde::FileStream ofstream;
+	if (ofstream.Open("graph.lip", rde::iosys::AccessMode::WRITE))
+	{
+		rde::uint64 tstart = __rdtsc();
+		SaveObject(objects[0], ofstream, typeRegistry, 1);
+		rde::uint64 saveTime = __rdtsc() - tstart;
+		printf("Graph of %d objects (%d bytes) saved in %d ticks, %d write call(s)\n", kNumObjects,
+			countingStream.GetSize(), (int)saveTime, countingStream.m_numWriteCalls);
+		ofstream.Close();
+	}
+
+	rde::SpanStream istream(countingStream.GetData(), countingStream.GetSize());
+	CircularPtrTest* first = LoadObject<CircularPtrTest>(istream, typeRegistry, 1);
+	CircularPtrTest* p = first;
+	for (int i = 0; i < kNumObjects; ++i, p = p->ptr)
+		RDE_ASSERT(p->val == i);
+	RDE_ASSERT(p == first);
+	operator delete(first);
+}
+
+// Throughput vs ratio for various block sizes.
+void BenchmarkCompression(const char* fileName)
+{
+	rde::FileStream fstream;
+	if (!fstream.Open(fileName, rde::iosys::AccessMode::READ))
+		return;
+	rde::vector<rde::uint8> data(fstream.GetSize());
+	fstream.Read(data.begin(), data.size());
+	fstream.Close();
+
+	const long blockSizes[] = { 4 * 1024, 16 * 1024, 64 * 1024 };
+	for (size_t i = 0; i < RDE_ARRAY_COUNT(blockSizes); ++i)
+	{
+		rde::MemoryStream memStream(data.size());
+		rde::CompressedStream ostream;
+		rde::uint64 tstart = __rdtsc();
+		ostream.Open(&memStream, rde::iosys::AccessMode::WRITE, blockSizes[i]);
+		ostream.Write(data.begin(), data.size());
+		ostream.Close();
+		const rde::uint64 compressTime = __rdtsc() - tstart;
+
+		rde::vector<rde::uint8> decompressed(data.size());
+		rde::SpanStream spanStream(memStream.GetData(), memStream.GetSize());
+		rde::CompressedStream istream;
+		tstart = __rdtsc();
+		istream.Open(&spanStream, rde::iosys::AccessMode::READ);
+		istream.Read(decompressed.begin(), decompressed.size());
+		const rde::uint64 decompressTime = __rdtsc() - tstart;
+		RDE_ASSERT(memcmp(decompressed.begin(), data.begin(), data.size()) == 0);
+
+		printf("%s, block %d: %d -> %d bytes, compressed in %d ticks, decompressed in %d ticks\n",
+			fileName, blockSizes[i], ostream.GetSize(), ostream.GetCompressedSize(),
+			(int)compressTime, (int)decompressTime);
+	}
+}
+
+// Relies on files saved by TestLoadInPlace & TestCircular.
+void TestLoadAsync(rde::TypeRegistry& typeRegistry)
+{
+	const char* fileNames[] = { "test.lip", "circtest.lip", "missing.lip" };
+	void* objects[3];
+
+	rde::AsyncIo asyncIo;
+	rde::uint64 tstart = __rdtsc();
+	const int numLoaded = LoadObjectsAsync(fileNames, 3, objects, typeRegistry, 1, asyncIo);
+	rde::uint64 loadTime = __rdtsc() - tstart;
+	printf("%d objects loaded asynchronously in %d ticks\n", numLoaded, loadTime);
+
+	RDE_ASSERT(numLoaded == 2);
+	RDE_ASSERT(objects[2] == 0);
+
+	SuperBar* psb = static_cast<SuperBar*>(objects[0]);
+	RDE_ASSERT(psb->i == 5);
+	RDE_ASSERT(*psb->p == psb->color.r);
+	RDE_ASSERT(psb->v.size() == 2);
+	RDE_ASSERT(psb->psb->psb == psb);
+#if !TEST_PERL
+	RDE_ASSERT(psb->VirtualTest() == 5);
+#endif
+
+	CircularPtrTest* pa = static_cast<CircularPtrTest*>(objects[1]);
+	RDE_ASSERT(pa->val == 10);
+	RDE_ASSERT(pa->ptr->val == 20);
+	RDE_ASSERT(pa->ptr->ptr->ptr == pa);
+
+	operator delete(objects[0]);
+	operator delete(objects[1]);
+}
+
+namespace
+{
+struct ChecksumJobData
+{
+	const rde::uint8*	data;
+	long				blockSize;
+	rde::uint32*		checksums;
+};
+void ChecksumBlocks(int begin, int end, void* userData)
+{
+	const ChecksumJobData* jobData = static_cast<const ChecksumJobData*>(userData);
+	for (int i = begin; i < end; ++i)
+	{
+		rde::CRC32 crc;
+		crc.AddArray(jobData->data + i * jobData->blockSize, jobData->blockSize);
+		jobData->checksums[i] = crc.GetValue();
+	}
+}
+
+volatile long s_stageCounter(0);
+long s_stages[2];
+void StageA(void*)	{ s_stages[0] = ++s_stageCounter; }
+void StageB(void*)	{ s_stages[1] = ++s_stageCounter; }
+}
+
+// Checksums 16MB buffer in 4K blocks with 1, 2, 4, ... threads.
+void BenchmarkJobSystem()
+{
+	const int kNumBlocks = 4096;
+	const long kBlockSize = 4096;
+	rde::vector<rde::uint8> data(kNumBlocks * kBlockSize);
+	for (int i = 0; i < data.size(); ++i)
+		data[i] = rde::uint8(i * 13 + (i >> 12));
+	rde::vector<rde::uint32> checksums(kNumBlocks);
+	rde::vector<rde::uint32> reference(kNumBlocks);
+	ChecksumJobData jobData = { data.begin(), kBlockSize, reference.begin() };
+	ChecksumBlocks(0, kNumBlocks, &jobData);
+
+	jobData.checksums = checksums.begin();
+	rde::uint64 singleThreadTime(0);
+	for (int numThreads = 1; numThreads <= rde::JobSystem::kMaxWorkerThreads + 1; numThreads *= 2)
+	{
+		rde::JobSystem jobSystem(numThreads - 1);
+
+		// Dependency has to be respected.
+		rde::JobSystem::Counter stageA, stageB;
+		s_stageCounter = 0;
+		jobSystem.Run(StageA, 0, &stageA);
+		jobSystem.Run(StageB, 0, &stageB, &stageA);
+		jobSystem.Wait(stageB);
+		RDE_ASSERT(s_stages[0] == 1 && s_stages[1] == 2);
+
+		memset(checksums.begin(), 0, checksums.size() * sizeof(rde::uint32));
+		const rde::uint64 tstart = __rdtsc();
+		jobSystem.ParallelFor(0, kNumBlocks, 16, ChecksumBlocks, &jobData);
+		const rde::uint64 parallelTime = __rdtsc() - tstart;
+		RDE_ASSERT(memcmp(checksums.begin(), reference.begin(), kNumBlocks * sizeof(rde::uint32)) == 0);
+		if (numThreads == 1)
+			singleThreadTime = parallelTime;
+		printf("%d thread(s): checksummed %d blocks in %d ticks (%.2fx)\n", numThreads, kNumBlocks,
+			(int)parallelTime, double(singleThreadTime) / double(parallelTime));
+		if (numThreads >= 2 * int(rde::NumBits(rde::Thread::GetProcessAffinityMask())))
+			break;
+	}
+}
+
+namespace
+{
+// Bigger key, comparisons aren't free.
+struct BenchKey32
+{
+	BenchKey32() {}
+	explicit BenchKey32(rde::uint32 x)
+	{
+		for (int i = 0; i < 8; ++i)
+			v[i] = x + i;
+	}
+	bool operator==(const BenchKey32& rhs) const
+	{
+		return memcmp(v, rhs.v, sizeof(v)) == 0;
+	}
+	rde::uint32	v[8];
+};
+struct BenchKey32Hash
+{
+	rde::hash_value_t operator()(const BenchKey32& key) const
+	{
+		return rde::hash<rde::uint32>()(key.v[0]);
+	}
+};
+struct BenchUint32Key
+{
+	explicit BenchUint32Key(rde::uint32 x): v(x) {}
+	operator rde::uint32() const	{ return v; }
+	rde::uint32	v;
+};
+
+template<class TMap, typename TKey>
+void BenchmarkHashMap(const char* name, int numKeys)
+{
+	TMap m;
+	rde::uint64 tstart = __rdtsc();
+	for (int i = 0; i < numKeys; ++i)
+		m.insert(typename TMap::value_type(TKey(i * 7), i));
+	const rde::uint64 insertTime = __rdtsc() - tstart;
+
+	int numFound(0);
+	tstart = __rdtsc();
+	for (int i = 0; i < numKeys; ++i)
+		numFound += (m.find(TKey(i * 7)) != m.end());
+	const rde::uint64 findHitTime = __rdtsc() - tstart;
+	RDE_ASSERT(numFound == numKeys);
+
+	tstart = __rdtsc();
+	for (int i = 0; i < numKeys; ++i)
+		numFound += (m.find(TKey(i * 7 + 3)) != m.end());
+	const rde::uint64 findMissTime = __rdtsc() - tstart;
+	RDE_ASSERT(numFound == numKeys);
+
+	rde::uint64 sum(0);
+	tstart = __rdtsc();
+	for (typename TMap::const_iterator it = m.begin(); it != m.end(); ++it)
+		sum += it->second;
+	const rde::uint64 iterateTime = __rdtsc() - tstart;
+	RDE_ASSERT(sum == rde::uint64(numKeys) * (numKeys - 1) / 2);
+
+	const double loadFactor = double(m.size()) / m.bucket_count();
+	tstart = __rdtsc();
+	for (int i = 0; i < numKeys; ++i)
+		m.erase(TKey(i * 7));
+	const rde::uint64 eraseTime = __rdtsc() - tstart;
+	RDE_ASSERT(m.empty());
+
+	printf("%-22s %6d keys, load %.2f: insert %4d, hit %4d, miss %4d, erase %4d, iterate %4d ticks/key\n",
+		name, numKeys, loadFactor, int(insertTime / numKeys), int(findHitTime / numKeys),
+		int(findMissTime / numKeys), int(eraseTime / numKeys), int(iterateTime / numKeys));
+}
+}
+
+// hash_map vs flat_hash_map. Key counts chosen so that both maps
+// end up at different load factors.
+void BenchmarkHashMaps()
+{
+	const int keyCounts[] = { 1000, 10000, 40000, 100000 };
+	for (size_t i = 0; i < RDE_ARRAY_COUNT(keyCounts); ++i)
+	{
+		BenchmarkHashMap<rde::hash_map<rde::uint32, int>, BenchUint32Key>("hash_map<uint32>", keyCounts[i]);
+		BenchmarkHashMap<rde::flat_hash_map<rde::uint32, int>, BenchUint32Key>("flat_hash_map<uint32>", keyCounts[i]);
+		BenchmarkHashMap<rde::hash_map<BenchKey32, int, BenchKey32Hash>, BenchKey32>("hash_map<key32>", keyCounts[i]);
+		BenchmarkHashMap<rde::flat_hash_map<BenchKey32, int, BenchKey32Hash>, BenchKey32>("flat_hash_map<key32>", keyCounts[i]);
+	}
+}
+
+namespace
+{
+typedef void* (*AllocFunc)(size_t bytes);
+typedef void (*FreeFunc)(void* ptr);
+
+// Keeps window of live blocks of random sizes, like loader creating
+// type descriptions & fields.
+struct AllocBenchmarkThread
+{
+	void Run()
+	{
+		const int kWindowSize = 512;
+		void* blocks[kWindowSize] = { 0 };
+		rde::uint32 seed = rde::uint32(size_t(this));
+		const rde::uint64 tstart = __rdtsc();
+		for (int i = 0; i < numAllocs; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			const int slot = (seed >> 8) % kWindowSize;
+			freeFunc(blocks[slot]);
+			blocks[slot] = allocFunc(16 + ((seed >> 16) % 240));
+			static_cast<rde::uint8*>(blocks[slot])[0] = rde::uint8(i);
+		}
+		for (int i = 0; i < kWindowSize; ++i)
+			freeFunc(blocks[i]);
+		ticks = __rdtsc() - tstart;
+		rde::SizeClassAllocator::FlushThreadCache();
+	}
+
+	AllocFunc	allocFunc;
+	FreeFunc	freeFunc;
+	int			numAllocs;
+	rde::uint64	ticks;
+};
+
+void* SystemAlloc(size_t bytes)	{ return ::malloc(bytes); }
+void SystemFree(void* ptr)		{ ::free(ptr); }
+void SizeClassFree(void* ptr)
+{
+	if (ptr != 0)
+		rde::SizeClassAllocator::Free(ptr);
+}
+
+rde::uint64 RunAllocBenchmark(int numThreads, AllocFunc allocFunc, FreeFunc freeFunc)
+{
+	const int kMaxThreads = 8;
+	AllocBenchmarkThread benchmarks[kMaxThreads];
+	rde::Thread threads[kMaxThreads];
+	for (int i = 0; i < numThreads; ++i)
+	{
+		benchmarks[i].allocFunc = allocFunc;
+		benchmarks[i].freeFunc = freeFunc;
+		benchmarks[i].numAllocs = 1000000 / numThreads;
+		threads[i].Start(rde::Thread::Delegate::from_method<AllocBenchmarkThread,
+			&AllocBenchmarkThread::Run>(&benchmarks[i]), 64 * 1024);
+	}
+	rde::uint64 maxTicks(0);
+	for (int i = 0; i < numThreads; ++i)
+	{
+		threads[i].Stop();
+		if (benchmarks[i].ticks > maxTicks)
+			maxTicks = benchmarks[i].ticks;
+	}
+	return maxTicks;
+}
+}
+
+// 1M small allocations split between 1, 2, 4, 8 threads.
+void BenchmarkAllocator()
+{
+	for (int numThreads = 1; numThreads <= 8; numThreads *= 2)
+	{
+		const rde::uint64 systemTime = RunAllocBenchmark(numThreads, SystemAlloc, SystemFree);
+		const rde::uint64 sizeClassTime = RunAllocBenchmark(numThreads, rde::SizeClassAllocator::Alloc, SizeClassFree);
+		printf("%d thread(s): malloc %d ticks, SizeClassAllocator %d ticks\n", numThreads,
+			(int)systemTime, (int)sizeClassTime);
+	}
+}
+
+namespace
+{
+void WriteToStream(const void* data, size_t bytes, void* userData)
+{
+	static_cast<rde::Stream*>(userData)->Write(data, long(bytes));
+}
+
+rde::uint64 RunProfiledAllocs(int numAllocs)
+{
+	void* blocks[64] = { 0 };
+	const rde::uint64 tstart = __rdtsc();
+	for (int i = 0; i < numAllocs; ++i)
+	{
+		rde::MemManager::Free(blocks[i & 63]);
+		blocks[i & 63] = rde::MemManager::Alloc(16 + (i & 255), 0);
+	}
+	for (int i = 0; i < 64; ++i)
+		rde::MemManager::Free(blocks[i]);
+	return __rdtsc() - tstart;
+}
+}
+
+// Tags from scopes and explicit tags, live bytes estimate & alloc overhead.
+void TestAllocationProfiler()
+{
+	const rde::uint64 baseTime = RunProfiledAllocs(1000000);
+	rde::AllocationProfiler::Start(64 * 1024);
+	const rde::uint64 profiledTime = RunProfiledAllocs(1000000);
+
+	const int kNumBigBlocks = 16;
+	const size_t kBigBlockSize = 256 * 1024;
+	void* bigBlocks[kNumBigBlocks];
+	for (int i = 0; i < kNumBigBlocks; ++i)
+		bigBlocks[i] = rde::MemManager::Alloc(kBigBlockSize, "Big");
+	const int kNumScopedBlocks = 10000;
+	void* scopedBlocks[kNumScopedBlocks];
+	{
+		rde::AllocationProfiler::TagScope scope("Scoped");
+		for (int i = 0; i < kNumScopedBlocks; ++i)
+			scopedBlocks[i] = rde::MemManager::Alloc(100, 0);
+	}
+	rde::MemManager::EndFrame();
+
+	int bigTag(-1), scopedTag(-1);
+	for (int i = 0; i < rde::AllocationProfiler::GetNumTags(); ++i)
+	{
+		const rde::AllocationProfiler::TagStats& stats = rde::AllocationProfiler::GetTagStats(i);
+		if (strcmp(stats.name, "Big") == 0)
+			bigTag = i;
+		else if (strcmp(stats.name, "Scoped") == 0)
+			scopedTag = i;
+	}
+	RDE_ASSERT(bigTag > 0 && scopedTag > 0);
+	const rde::AllocationProfiler::TagStats& bigStats = rde::AllocationProfiler::GetTagStats(bigTag);
+	RDE_ASSERT(bigStats.numAllocsPerFrame == kNumBigBlocks);
+	// Blocks bigger than sampling interval are always sampled.
+	RDE_ASSERT(bigStats.liveBytes == kNumBigBlocks * kBigBlockSize);
+	const rde::AllocationProfiler::TagStats& scopedStats = rde::AllocationProfiler::GetTagStats(scopedTag);
+	RDE_ASSERT(scopedStats.numAllocs == kNumScopedBlocks);
+	printf("Scoped: %d live bytes, estimated %d\n", kNumScopedBlocks * 100, (int)scopedStats.liveBytes);
+
+	rde::FileStream ofstream;
+	if (ofstream.Open("allocs.csv", rde::iosys::AccessMode::WRITE))
+	{
+		rde::AllocationProfiler::WriteReportCSV(WriteToStream, &ofstream);
+		ofstream.Close();
+	}
+
+	for (int i = 0; i < kNumBigBlocks; ++i)
+		rde::MemManager::Free(bigBlocks[i]);
+	for (int i = 0; i < kNumScopedBlocks; ++i)
+		rde::MemManager::Free(scopedBlocks[i]);
+	rde::MemManager::EndFrame();
+	RDE_ASSERT(rde::AllocationProfiler::GetTagStats(bigTag).liveBytes == 0);
+	RDE_ASSERT(rde::AllocationProfiler::GetTagStats(bigTag).peakLiveBytes == kNumBigBlocks * kBigBlockSize);
+	RDE_ASSERT(rde::AllocationProfiler::GetTagStats(scopedTag).liveBytes == 0);
+	rde::AllocationProfiler::Stop();
+
+	printf("1M allocs: %d ticks, with profiler %d ticks\n", (int)baseTime, (int)profiledTime);
+}
+
+namespace
+{
+struct IdentityKey
+{
+	rde::uint32 operator()(rde::uint32 x) const	{ return x; }
+};
+}
+
+// Serial quick_sort/radix_sorter vs parallel versions, 10^4..10^8 random 32-bit keys.
+void BenchmarkSort()
+{
+	rde::JobSystem jobSystem;
+	rde::JobSystemExecutor executor(jobSystem);
+#if RDE_64
+	const int kMaxNumKeys = 100000000;
+#else
+	const int kMaxNumKeys = 10000000;
+#endif
+	rde::vector<rde::uint32> keys;
+	rde::vector<rde::uint32> sorted;
+	rde::vector<rde::uint32> buffer;
+	rde::radix_sorter<rde::uint32> radixSorter;
+	for (int numKeys = 10000; numKeys <= kMaxNumKeys; numKeys *= 10)
+	{
+		keys.resize(numKeys);
+		sorted.resize(numKeys);
+		buffer.resize(numKeys);
+		rde::uint32 seed(numKeys);
+		for (int i = 0; i < numKeys; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			keys[i] = seed ^ (seed >> 16);
+		}
+
+		sorted = keys;
+		rde::uint64 tstart = __rdtsc();
+		rde::quick_sort(sorted.begin(), sorted.end());
+		const rde::uint64 quickSortTime = __rdtsc() - tstart;
+
+		sorted = keys;
+		tstart = __rdtsc();
+		rde::parallel_sort(sorted.begin(), sorted.end(), rde::less<rde::uint32>(), executor, buffer.begin());
+		const rde::uint64 parallelSortTime = __rdtsc() - tstart;
+		RDE_ASSERT(rde::is_sorted(sorted.begin(), sorted.end(), rde::less<rde::uint32>()));
+
+		sorted = keys;
+		tstart = __rdtsc();
+		radixSorter.sort<rde::radix_sorter<rde::uint32>::data_unsigned>(sorted.begin(), numKeys, IdentityKey());
+		const rde::uint64 radixSortTime = __rdtsc() - tstart;
+
+		sorted = keys;
+		tstart = __rdtsc();
+		rde::parallel_radix_sort(sorted.begin(), buffer.begin(), numKeys, executor);
+		const rde::uint64 parallelRadixSortTime = __rdtsc() - tstart;
+		RDE_ASSERT(rde::is_sorted(sorted.begin(), sorted.end(), rde::less<rde::uint32>()));
+
+		printf("%d keys: quick_sort %d, parallel_sort %d (%.2fx), radix_sorter %d, parallel_radix_sort %d (%.2fx) kticks\n",
+			numKeys, int(quickSortTime / 1000), int(parallelSortTime / 1000), double(quickSortTime) / double(parallelSortTime),
+			int(radixSortTime / 1000), int(parallelRadixSortTime / 1000), double(radixSortTime) / double(parallelRadixSortTime));
+	}
+}
+
+// SIMD char versions vs generic templates, short (identifier-like) and long strings.
+void BenchmarkStringUtils()
+{
+	static const char* s_names[] =
+	{
+		"m_position", "m_orientation", "m_boundingBox", "m_numChildren", "rde::TypeClass",
+		"rde::vector<rde::Field,rde::LinearArenaAllocator>", "m_fieldEditInfo", "Bar"
+	};
+	const int kNumNames = sizeof(s_names) / sizeof(s_names[0]);
+	const int kNumIterations = 100000;
+
+	int checksum(0);
+	rde::uint64 tstart = __rdtsc();
+	for (int i = 0; i < kNumIterations; ++i)
+	{
+		for (int j = 0; j < kNumNames; ++j)
+			checksum += rde::strlen<char>(s_names[j]) + rde::strcompare<char>(s_names[j], s_names[(j + 1) % kNumNames]);
+	}
+	const rde::uint64 genericShortTime = __rdtsc() - tstart;
+	tstart = __rdtsc();
+	for (int i = 0; i < kNumIterations; ++i)
+	{
+		for (int j = 0; j < kNumNames; ++j)
+			checksum -= rde::strlen(s_names[j]) + rde::strcompare(s_names[j], s_names[(j + 1) % kNumNames]);
+	}
+	const rde::uint64 simdShortTime = __rdtsc() - tstart;
+	RDE_ASSERT(checksum == 0);
+
+	const int kLongSize = 64 * 1024;
+	rde::vector<char> text(kLongSize + 1);
+	for (int i = 0; i < kLongSize; ++i)
+		text[i] = char('a' + (i * 7) % 23);
+	static const char s_pattern[] = "needle";
+	memcpy(&text[kLongSize - sizeof(s_pattern)], s_pattern, sizeof(s_pattern) - 1);
+	text[kLongSize] = 0;
+	const int kNumLongIterations = 100;
+
+	tstart = __rdtsc();
+	for (int i = 0; i < kNumLongIterations; ++i)
+	{
+		checksum += rde::strlen<char>(text.begin()) + rde::find_index_of<char>(text.begin(), 'z') +
+			rde::find_substring<char>(text.begin(), s_pattern);
+	}
+	const rde::uint64 genericLongTime = __rdtsc() - tstart;
+	tstart = __rdtsc();
+	for (int i = 0; i < kNumLongIterations; ++i)
+	{
+		checksum -= rde::strlen(text.begin()) + rde::find_index_of(text.begin(), 'z') +
+			rde::find_substring(text.begin(), s_pattern);
+	}
+	const rde::uint64 simdLongTime = __rdtsc() - tstart;
+	RDE_ASSERT(checksum == 0);
+	RDE_ASSERT(rde::find_substring(text.begin(), s_pattern) == kLongSize - int(sizeof(s_pattern)));
+
+	printf("Short strings: generic %d, SIMD %d kticks (%.2fx). 64KB text: generic %d, SIMD %d kticks (%.2fx)\n",
+		int(genericShortTime / 1000), int(simdShortTime / 1000), double(genericShortTime) / double(simdShortTime),
+		int(genericLongTime / 1000), int(simdLongTime / 1000), double(genericLongTime) / double(simdLongTime));
+}
+
+namespace
+{
+typedef rde::basic_string<char, rde::allocator, rde::cow_string_storage<char, rde::allocator> >		CowString;
+typedef rde::basic_string<char, rde::allocator, rde::simple_string_storage<char, rde::allocator> >	SimpleString;
+typedef rde::basic_string<char, rde::allocator, rde::sso_string_storage<char, rde::allocator> >		SsoString;
+
+// Type & field names, as seen by reflection tooling. Mostly short.
+const char* s_stringBenchmarkNames[] =
+{
+	"int32", "float", "m_position", "m_orientation", "m_numChildren", "Bar", "rde::Type",
+	"m_fieldEditInfo", "rde::vector<rde::Field,rde::LinearArenaAllocator>",
+	"Minimum value of the field, used by editor"
+};
+const int kNumStringBenchmarkNames = sizeof(s_stringBenchmarkNames) / sizeof(s_stringBenchmarkNames[0]);
+
+struct StringBenchmarkTimes
+{
+	rde::uint64	construct;
+	rde::uint64	copy;
+	rde::uint64	append;
+	rde::uint64	compare;
+};
+
+template<class TString>
+StringBenchmarkTimes RunStringBenchmark(int numIterations, int& checksum)
+{
+	StringBenchmarkTimes times;
+	rde::uint64 tstart = __rdtsc();
+	for (int i = 0; i < numIterations; ++i)
+	{
+		for (int j = 0; j < kNumStringBenchmarkNames; ++j)
+		{
+			TString s(s_stringBenchmarkNames[j]);
+			checksum += s.length();
+		}
+	}
+	times.construct = __rdtsc() - tstart;
+
+	TString names[kNumStringBenchmarkNames];
+	for (int j = 0; j < kNumStringBenchmarkNames; ++j)
+		names[j] = s_stringBenchmarkNames[j];
+
+	tstart = __rdtsc();
+	for (int i = 0; i < numIterations; ++i)
+	{
+		for (int j = 0; j < kNumStringBenchmarkNames; ++j)
+		{
+			TString s(names[j]);
+			checksum += s.length();
+		}
+	}
+	times.copy = __rdtsc() - tstart;
+
+	tstart = __rdtsc();
+	for (int i = 0; i < numIterations; ++i)
+	{
+		for (int j = 0; j < kNumStringBenchmarkNames; ++j)
+		{
+			TString s(names[j]);
+			s.append("::");
+			s += names[(j + 1) % kNumStringBenchmarkNames];
+			checksum += s.length();
+		}
+	}
+	times.append = __rdtsc() - tstart;
+
+	tstart = __rdtsc();
+	for (int i = 0; i < numIterations; ++i)
+	{
+		for (int j = 0; j < kNumStringBenchmarkNames; ++j)
+		{
+			checksum += names[j].compare(names[(i + j) % kNumStringBenchmarkNames]);
+			checksum += (names[j] == names[j] ? 1 : 0);
+		}
+	}
+	times.compare = __rdtsc() - tstart;
+	return times;
+}
+}
+
+// Construct/copy/append/compare of short strings with all string storages.
+void BenchmarkStringStorage()
+{
+	const int kNumIterations = 100000;
+	int cowChecksum(0), simpleChecksum(0), ssoChecksum(0);
+	const StringBenchmarkTimes cow = RunStringBenchmark<CowString>(kNumIterations, cowChecksum);
+	const StringBenchmarkTimes simple = RunStringBenchmark<SimpleString>(kNumIterations, simpleChecksum);
+	const StringBenchmarkTimes sso = RunStringBenchmark<SsoString>(kNumIterations, ssoChecksum);
+	RDE_ASSERT(cowChecksum == ssoChecksum && simpleChecksum == ssoChecksum);
+
+	SsoString s("m_position");
+	RDE_ASSERT(s.length() == 10 && rde::strcompare(s.c_str(), "m_position") == 0);
+	s.append("_and_m_orientation");
+	RDE_ASSERT(s.length() == 28 && s.compare("m_position_and_m_orientation") == 0);
+
+	printf("Strings (cow/simple/sso kticks): construct %d/%d/%d, copy %d/%d/%d, append %d/%d/%d, compare %d/%d/%d\n",
+		int(cow.construct / 1000), int(simple.construct / 1000), int(sso.construct / 1000),
+		int(cow.copy / 1000), int(simple.copy / 1000), int(sso.copy / 1000),
+		int(cow.append / 1000), int(simple.append / 1000), int(sso.append / 1000),
+		int(cow.compare / 1000), int(simple.compare / 1000), int(sso.compare / 1000));
+}
+
+namespace
+{
+// Unique keys for 0 <= index < 2^32 (multiplication by odd number is a bijection).
+rde::uint32 LookupBenchmarkKey(int index)
+{
+	return rde::uint32(index) * 2654435761u;
+}
+// Values are 1, so sum of found values == number of hits.
+typedef rde::sorted_vector<rde::uint32, rde::uint32>	LookupSortedVector;
+typedef rde::hash_map<rde::uint32, rde::uint32>			LookupHashMap;
+typedef rde::eytzinger_map<rde::uint32, rde::uint32>	LookupEytzingerMap;
+rde::uint32 LookupFound(const LookupSortedVector& m, rde::uint32 key)
+{
+	LookupSortedVector::const_iterator it = m.find(key);
+	return it == m.end() ? 0 : it->second;
+}
+rde::uint32 LookupFound(const LookupHashMap& m, rde::uint32 key)
+{
+	LookupHashMap::const_iterator it = m.find(key);
+	return it == m.end() ? 0 : it->second;
+}
+rde::uint32 LookupFound(const LookupEytzingerMap& m, rde::uint32 key)
+{
+	const rde::uint32* value = m.find(key);
+	return value ? *value : 0;
+}
+template<class TMap>
+rde::uint64 RunLookupBenchmark(const TMap& m, int numKeys, int numLookups)
+{
+	rde::uint32 seed(numKeys);
+	rde::uint64 sum(0);
+	const rde::uint64 tstart = __rdtsc();
+	for (int i = 0; i < numLookups; ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+		const int index = int((seed >> 8) % rde::uint32(numKeys));
+		sum += LookupFound(m, LookupBenchmarkKey(index));
+	}
+	const rde::uint64 ticks = __rdtsc() - tstart;
+	RDE_ASSERT(sum == rde::uint64(numLookups));
+	return ticks;
+}
+}
+
+// Lookups (all hits, random order) in frozen tables, 16..1M entries.
+void BenchmarkLookupTables()
+{
+	const int kNumLookups = 1000000;
+	for (int numKeys = 16; numKeys <= 1024 * 1024; numKeys *= 16)
+	{
+		rde::vector<rde::pair<rde::uint32, rde::uint32> > entries;
+		entries.reserve(numKeys);
+		for (int i = 0; i < numKeys; ++i)
+			entries.push_back(rde::pair<rde::uint32, rde::uint32>(LookupBenchmarkKey(i), 1));
+
+		rde::uint64 tstart = __rdtsc();
+		const LookupEytzingerMap eytzingerMap(entries.begin(), entries.end());
+		const rde::uint64 buildTime = __rdtsc() - tstart;
+		const LookupSortedVector sortedVector(entries.begin(), entries.end());
+		LookupHashMap hashMap;
+		for (int i = 0; i < numKeys; ++i)
+			hashMap.insert(entries[i]);
+
+		const rde::uint64 sortedVectorTime = RunLookupBenchmark(sortedVector, numKeys, kNumLookups);
+		const rde::uint64 hashMapTime = RunLookupBenchmark(hashMap, numKeys, kNumLookups);
+		const rde::uint64 eytzingerTime = RunLookupBenchmark(eytzingerMap, numKeys, kNumLookups);
+		printf("%7d keys: sorted_vector %3d, hash_map %3d, eytzinger_map %3d ticks/lookup (build %d kticks)\n",
+			numKeys, int(sortedVectorTime / kNumLookups), int(hashMapTime / kNumLookups),
+			int(eytzingerTime / kNumLookups), int(buildTime / 1000));
+	}
+}
+
+namespace
+{
+// Counts heap traffic of node containers.
+struct HeapCounters
+{
+	int		numAllocs;
+	size_t	liveBytes;
+	size_t	peakBytes;
+};
+HeapCounters s_heapCounters;
+
+class CountingAllocator
+{
+public:
+	explicit CountingAllocator(const char* name = "COUNTING"):	m_name(name) {}
+
+	void* allocate(size_t bytes, int /*flags*/ = 0)
+	{
+		++s_heapCounters.numAllocs;
+		s_heapCounters.liveBytes += bytes;
+		if (s_heapCounters.liveBytes > s_heapCounters.peakBytes)
+			s_heapCounters.peakBytes = s_heapCounters.liveBytes;
+		return ::malloc(bytes);
+	}
+	void deallocate(void* ptr, size_t bytes)
+	{
+		s_heapCounters.liveBytes -= bytes;
+		::free(ptr);
+	}
+	const char* get_name() const	{ return m_name; }
+
+private:
+	const char*	m_name;
+};
+
+struct NodeBenchmarkTimes
+{
+	rde::uint64	insert;
+	rde::uint64	iterate;
+	rde::uint64	erase;
+	HeapCounters	heap;
+};
+
+template<class TAllocator>
+NodeBenchmarkTimes RunListBenchmark(int numElements)
+{
+	NodeBenchmarkTimes times;
+	s_heapCounters.numAllocs = 0;
+	s_heapCounters.peakBytes = s_heapCounters.liveBytes;
+	{
+		rde::list<int, TAllocator> l;
+		rde::uint64 tstart = __rdtsc();
+		for (int i = 0; i < numElements; ++i)
+			l.push_back(i);
+		times.insert = __rdtsc() - tstart;
+
+		rde::uint64 sum(0);
+		tstart = __rdtsc();
+		for (typename rde::list<int, TAllocator>::const_iterator it = l.begin(); it != l.end(); ++it)
+			sum += *it;
+		times.iterate = __rdtsc() - tstart;
+		RDE_ASSERT(sum == rde::uint64(numElements) * (numElements - 1) / 2);
+
+		// Every other element first, so that free list is not in allocation order.
+		tstart = __rdtsc();
+		for (typename rde::list<int, TAllocator>::iterator it = l.begin(); it != l.end(); ++it)
+			it = l.erase(it);
+		while (!l.empty())
+			l.pop_front();
+		times.erase = __rdtsc() - tstart;
+	}
+	times.heap = s_heapCounters;
+	return times;
+}
+
+rde::uint64 s_treeSum(0);
+void SumTreeNode(rde::rb_tree<int, CountingAllocator>::node* n, int, int)
+{
+	s_treeSum += n->key;
+}
+void SumTreeNode(rde::rb_tree<int, rde::node_allocator<CountingAllocator> >::node* n, int, int)
+{
+	s_treeSum += n->key;
+}
+
+template<class TAllocator>
+NodeBenchmarkTimes RunTreeBenchmark(int numElements)
+{
+	NodeBenchmarkTimes times;
+	s_heapCounters.numAllocs = 0;
+	s_heapCounters.peakBytes = s_heapCounters.liveBytes;
+	{
+		rde::rb_tree<int, TAllocator> tree;
+		rde::uint64 tstart = __rdtsc();
+		for (int i = 0; i < numElements; ++i)
+			tree.insert(int((rde::uint32(i) * 2654435761u) >> 1));
+		times.insert = __rdtsc() - tstart;
+		RDE_ASSERT(tree.size() == numElements);
+
+		s_treeSum = 0;
+		tstart = __rdtsc();
+		tree.traverse(SumTreeNode);
+		times.iterate = __rdtsc() - tstart;
+		RDE_ASSERT(s_treeSum != 0);
+
+		tstart = __rdtsc();
+		for (int i = 0; i < numElements; ++i)
+			tree.erase(int((rde::uint32(i) * 2654435761u) >> 1));
+		times.erase = __rdtsc() - tstart;
+		RDE_ASSERT(tree.empty());
+	}
+	times.heap = s_heapCounters;
+	return times;
+}
+
+void PrintNodeBenchmark(const char* name, const NodeBenchmarkTimes& times, int numElements)
+{
+	printf("%-30s insert %4d, iterate %4d, erase %4d ticks/elem, %6d heap allocs, peak %d KB\n",
+		name, int(times.insert / numElements), int(times.iterate / numElements), int(times.erase / numElements),
+		times.heap.numAllocs, int(times.heap.peakBytes / 1024));
+	RDE_ASSERT(times.heap.liveBytes == 0);
+}
+}
+
+// Node containers with one heap allocation per node vs node_allocator.
+void BenchmarkNodeContainers()
+{
+	// rb_tree validates itself after every change in debug, keep it small.
+	const int kNumElements = 20000;
+	PrintNodeBenchmark("list", RunListBenchmark<CountingAllocator>(kNumElements), kNumElements);
+	PrintNodeBenchmark("list, node_allocator",
+		RunListBenchmark<rde::node_allocator<CountingAllocator> >(kNumElements), kNumElements);
+	PrintNodeBenchmark("rb_tree", RunTreeBenchmark<CountingAllocator>(kNumElements), kNumElements);
+	PrintNodeBenchmark("rb_tree, node_allocator",
+		RunTreeBenchmark<rde::node_allocator<CountingAllocator> >(kNumElements), kNumElements);
+
+	// Ternary search tree gives its node chunks back when destroyed.
+	{
+		rde::ternary_search_tree<int, CountingAllocator> tst;
+		tst.insert_p("m_position", 1);
+		tst.insert_p("m_orientation", 2);
+		RDE_ASSERT(tst.find("m_position") != tst.end() && tst.find("m_positio") == tst.end());
+		RDE_ASSERT(s_heapCounters.liveBytes != 0);
+	}
+	RDE_ASSERT(s_heapCounters.liveBytes == 0);
+
+	// Memory stream buffer comes from given allocator as well.
+	{
+		rde::BasicMemoryStream<CountingAllocator> stream;
+		const int numAllocs = s_heapCounters.numAllocs;
+		for (int i = 0; i < 1000; ++i)
+			stream.Write(&i, sizeof(i));
+		RDE_ASSERT(s_heapCounters.numAllocs > numAllocs);
+		RDE_ASSERT(s_heapCounters.liveBytes == size_t(stream.GetCapacity()));
+	}
+	RDE_ASSERT(s_heapCounters.liveBytes == 0);
+}
+
+namespace
+{
+typedef rde::MPMCQueue<rde::uint64, 1024>		BenchmarkMPMCQueue;
+typedef rde::SPSCRingBuffer<rde::uint64, 1024>	BenchmarkSPSCRingBuffer;
+
+// Items are (producer index << 32) | sequence number.
+struct QueueProducer
+{
+	void Run()
+	{
+		for (int i = 0; i < numItems; ++i)
+		{
+			const rde::uint64 item = (rde::uint64(index) << 32) | rde::uint32(i);
+			while (!queue->Push(item))
+				rde::Thread::YieldCurrentThread();
+		}
+	}
+
+	BenchmarkMPMCQueue*	queue;
+	int					index;
+	int					numItems;
+};
+struct QueueConsumer
+{
+	static const int kMaxProducers = 8;
+
+	void Run()
+	{
+		rde::uint32 nextSequence[kMaxProducers] = { 0 };
+		for (int i = 0; i < numItems; ++i)
+		{
+			rde::uint64 item;
+			while (!queue->Pop(item))
+				rde::Thread::YieldCurrentThread();
+			// FIFO per producer (other consumers may take items in between).
+			const int producer = int(item >> 32);
+			const rde::uint32 sequence = rde::uint32(item);
+			RDE_ASSERT(producer < kMaxProducers && sequence >= nextSequence[producer]);
+			nextSequence[producer] = sequence + 1;
+			sum += sequence;
+		}
+	}
+
+	BenchmarkMPMCQueue*	queue;
+	int					numItems;
+	rde::uint64			sum;
+};
+
+rde::uint64 RunMPMCBenchmark(BenchmarkMPMCQueue& queue, int numProducers, int numConsumers, int numItems)
+{
+	const int kMaxThreads = QueueConsumer::kMaxProducers;
+	QueueProducer producers[kMaxThreads];
+	QueueConsumer consumers[kMaxThreads];
+	rde::Thread producerThreads[kMaxThreads];
+	rde::Thread consumerThreads[kMaxThreads];
+	const rde::uint64 tstart = __rdtsc();
+	for (int i = 0; i < numConsumers; ++i)
+	{
+		consumers[i].queue = &queue;
+		consumers[i].numItems = numItems / numConsumers;
+		consumers[i].sum = 0;
+		consumerThreads[i].Start(rde::Thread::Delegate::from_method<QueueConsumer,
+			&QueueConsumer::Run>(&consumers[i]), 64 * 1024);
+	}
+	for (int i = 0; i < numProducers; ++i)
+	{
+		producers[i].queue = &queue;
+		producers[i].index = i;
+		producers[i].numItems = numItems / numProducers;
+		producerThreads[i].Start(rde::Thread::Delegate::from_method<QueueProducer,
+			&QueueProducer::Run>(&producers[i]), 64 * 1024);
+	}
+	rde::uint64 sum(0);
+	for (int i = 0; i < numProducers; ++i)
+		producerThreads[i].Stop();
+	for (int i = 0; i < numConsumers; ++i)
+	{
+		consumerThreads[i].Stop();
+		sum += consumers[i].sum;
+	}
+	const rde::uint64 ticks = __rdtsc() - tstart;
+	const rde::uint64 itemsPerProducer = numItems / numProducers;
+	RDE_ASSERT(sum == numProducers * itemsPerProducer * (itemsPerProducer - 1) / 2);
+	RDE_ASSERT(queue.IsEmpty());
+	return ticks;
+}
+
+// Pops items in order, sends them back if there's 'out' buffer.
+struct PingPongThread
+{
+	void Run()
+	{
+		for (int i = 0; i < numRoundTrips; ++i)
+		{
+			rde::uint64 item;
+			while (!in->Pop(item))
+				rde::Thread::YieldCurrentThread();
+			RDE_ASSERT(item == rde::uint64(i));
+			while (out != 0 && !out->Push(item))
+				rde::Thread::YieldCurrentThread();
+		}
+	}
+
+	BenchmarkSPSCRingBuffer*	in;
+	BenchmarkSPSCRingBuffer*	out;
+	int							numRoundTrips;
+};
+}
+
+// MPMC throughput with 1..4 producers/consumers, SPSC round trip latency.
+void BenchmarkConcurrentQueues()
+{
+	// Divisible by 1, 2 and 4.
+	const int kNumItems = 1 << 20;
+	BenchmarkMPMCQueue* queue = new BenchmarkMPMCQueue();
+	for (int numProducers = 1; numProducers <= 4; numProducers *= 2)
+	{
+		for (int numConsumers = 1; numConsumers <= 4; numConsumers *= 2)
+		{
+			const rde::uint64 ticks = RunMPMCBenchmark(*queue, numProducers, numConsumers, kNumItems);
+			printf("MPMCQueue %d producers, %d consumers: %d ticks/item\n", numProducers, numConsumers,
+				int(ticks / kNumItems));
+		}
+	}
+	delete queue;
+
+	BenchmarkSPSCRingBuffer* ping = new BenchmarkSPSCRingBuffer();
+	BenchmarkSPSCRingBuffer* pong = new BenchmarkSPSCRingBuffer();
+	const int kNumRoundTrips = 100000;
+	PingPongThread echo = { ping, pong, kNumRoundTrips };
+	rde::Thread echoThread;
+	echoThread.Start(rde::Thread::Delegate::from_method<PingPongThread, &PingPongThread::Run>(&echo), 64 * 1024);
+	rde::uint64 tstart = __rdtsc();
+	for (int i = 0; i < kNumRoundTrips; ++i)
+	{
+		while (!ping->Push(rde::uint64(i)))
+			rde::Thread::YieldCurrentThread();
+		rde::uint64 item;
+		while (!pong->Pop(item))
+			rde::Thread::YieldCurrentThread();
+		RDE_ASSERT(item == rde::uint64(i));
+	}
+	const rde::uint64 roundTripTicks = (__rdtsc() - tstart) / kNumRoundTrips;
+	echoThread.Stop();
+
+	// Throughput, this thread produces.
+	PingPongThread consumer = { ping, 0, kNumItems };
+	rde::Thread consumerThread;
+	consumerThread.Start(rde::Thread::Delegate::from_method<PingPongThread, &PingPongThread::Run>(&consumer), 64 * 1024);
+	tstart = __rdtsc();
+	for (int i = 0; i < kNumItems; ++i)
+	{
+		while (!ping->Push(rde::uint64(i)))
+			rde::Thread::YieldCurrentThread();
+	}
+	consumerThread.Stop();
+	const rde::uint64 spscTicks = __rdtsc() - tstart;
+	RDE_ASSERT(ping->IsEmpty());
+	delete ping;
+	delete pong;
+
+	printf("SPSCRingBuffer: round trip %d ticks, push+pop %d ticks/item\n", int(roundTripTicks),
+		int(spscTicks / kNumItems));
+}
+
+namespace
+{
+// Mirrors old TypeClass base walk, for comparison.
+struct ChainClass
+{
+	const ChainClass*	base;
+	rde::uint16			baseOffset;
+};
+bool ChainIsDerivedFrom(const ChainClass* c, const ChainClass* base)
+{
+	for (const ChainClass* iter = c->base; iter != 0; iter = iter->base)
+	{
+		if (iter == base)
+			return true;
+	}
+	return false;
+}
+rde::uint32 ChainCalcOffsetFrom(const ChainClass* c, const ChainClass* base)
+{
+	rde::uint32 totalOffset(0);
+	for (const ChainClass* iter = c; iter != base; iter = iter->base)
+		totalOffset += iter->baseOffset;
+	return totalOffset;
+}
+}
+
+// Subtype test + base offset on every pair of classes in deepest allowed hierarchy.
+void BenchmarkClassHierarchy()
+{
+	const int kNumClasses = rde::TypeClass::MAX_HIERARCHY_DEPTH;
+	const rde::uint16 kBaseOffset = 8;
+	rde::TypeRegistry registry;
+	rde::LinearArena& arena = registry.GetArena();
+	const rde::TypeClass* classes[kNumClasses];
+	ChainClass chain[kNumClasses];
+	char name[32];
+	rde::uint32 baseId(0);
+	for (int i = 0; i < kNumClasses; ++i)
+	{
+		sprintf_s(name, "HierarchyLevel%d", i);
+		rde::TypeClass* tc = new (arena.Allocate(sizeof(rde::TypeClass))) rde::TypeClass(
+			64, name, 0, 0, baseId, i == 0 ? 0 : kBaseOffset);
+		registry.AddType(tc);
+		classes[i] = tc;
+		chain[i].base = (i == 0 ? 0 : &chain[i - 1]);
+		chain[i].baseOffset = (i == 0 ? 0 : kBaseOffset);
+		baseId = tc->m_name.GetId();
+	}
+	registry.PostInit();
+
+	char object[64];
+	for (int i = 0; i < kNumClasses; ++i)
+	{
+		RDE_ASSERT(classes[i]->GetHierarchyDepth() == i);
+		for (int j = 0; j < kNumClasses; ++j)
+		{
+			const bool derived = classes[i]->IsDerivedFrom(classes[j]);
+			RDE_ASSERT(derived == (j < i));
+			RDE_ASSERT(derived == ChainIsDerivedFrom(&chain[i], &chain[j]));
+			void* base = rde::DynamicCast(object, classes[i], classes[j]);
+			if (j <= i)
+			{
+				RDE_ASSERT(classes[i]->CalcOffsetFrom(classes[j]) == rde::uint32(kBaseOffset * (i - j)));
+				RDE_ASSERT(base == object + kBaseOffset * (i - j));
+			}
+			else
+				RDE_ASSERT(base == 0);
+		}
+	}
+
+	const int kNumIterations = 10000;
+	rde::uint32 sumChain(0);
+	rde::uint64 tstart = __rdtsc();
+	for (int n = 0; n < kNumIterations; ++n)
+	{
+		for (int i = 0; i < kNumClasses; ++i)
+		{
+			for (int j = 0; j < kNumClasses; ++j)
+			{
+				if (ChainIsDerivedFrom(&chain[i], &chain[j]))
+					sumChain += ChainCalcOffsetFrom(&chain[i], &chain[j]);
+			}
+		}
+	}
+	const rde::uint64 chainTicks = __rdtsc() - tstart;
+
+	rde::uint32 sum(0);
+	tstart = __rdtsc();
+	for (int n = 0; n < kNumIterations; ++n)
+	{
+		for (int i = 0; i < kNumClasses; ++i)
+		{
+			for (int j = 0; j < kNumClasses; ++j)
+			{
+				if (classes[i]->IsDerivedFrom(classes[j]))
+					sum += classes[i]->CalcOffsetFrom(classes[j]);
+			}
+		}
+	}
+	const rde::uint64 ticks = __rdtsc() - tstart;
+	RDE_ASSERT(sum == sumChain);
+
+	const int numQueries = kNumIterations * kNumClasses * kNumClasses;
+	printf("Hierarchy depth %d: base walk %d ticks/query, ancestor table %d ticks/query\n",
+		kNumClasses, int(chainTicks / numQueries), int(ticks / numQueries));
+}
+
+namespace
+{
+rde::TypeEnum* CreateBenchmarkEnum(rde::LinearArena& arena, const char* name, int numConstants, long valueStep,
+	bool index, rde::TypeRegistry& registry)
+{
+	rde::TypeEnum* te = new (arena.Allocate(sizeof(rde::TypeEnum))) rde::TypeEnum(4, name);
+	te->ReserveConstants(numConstants, &arena);
+	char constantName[32];
+	for (int i = 0; i < numConstants; ++i)
+	{
+		sprintf_s(constantName, "CONSTANT_%d", i);
+		te->AddConstant(rde::TypeEnum::Constant(constantName, long(i) * valueStep));
+	}
+	if (index)
+		te->OnPostInit(registry);
+	return te;
+}
+
+// Both lookups for every constant, enum without index does linear search.
+rde::uint64 RunEnumLookupBenchmark(const rde::TypeEnum* te, int numIterations, long valueStep)
+{
+	const int numConstants = te->GetNumConstants();
+	rde::uint32* nameHashes = new rde::uint32[numConstants];
+	for (int i = 0; i < numConstants; ++i)
+		nameHashes[i] = te->GetConstant(i).m_name.GetId();
+	long sum(0);
+	const rde::uint64 tstart = __rdtsc();
+	for (int n = 0; n < numIterations; ++n)
+	{
+		for (int i = 0; i < numConstants; ++i)
+		{
+			sum += te->FindConstant(nameHashes[i])->m_value;
+			sum += te->FindConstantByValue(long(i) * valueStep)->m_value;
+		}
+	}
+	const rde::uint64 ticks = __rdtsc() - tstart;
+	RDE_ASSERT(sum == long(numIterations) * long(numConstants - 1) * long(numConstants) * valueStep);
+	delete[] nameHashes;
+	return ticks / (numIterations * numConstants * 2);
+}
+
+void CollectFlag(const rde::TypeEnum::Constant& c, void* userData)
+{
+	*static_cast<long*>(userData) |= c.m_value;
+}
+}
+
+void BenchmarkEnumLookup()
+{
+	rde::TypeRegistry registry;
+	rde::LinearArena& arena = registry.GetArena();
+
+	// Values 0..n-1 (dense table) and spread out (sparse index).
+	const long kSparseStep = 977;
+	for (int numConstants = 16; numConstants <= 4096; numConstants *= 16)
+	{
+		const rde::TypeEnum* linearDense = CreateBenchmarkEnum(arena, "LinearDense", numConstants, 1, false, registry);
+		const rde::TypeEnum* dense = CreateBenchmarkEnum(arena, "Dense", numConstants, 1, true, registry);
+		const rde::TypeEnum* linearSparse = CreateBenchmarkEnum(arena, "LinearSparse", numConstants, kSparseStep, false, registry);
+		const rde::TypeEnum* sparse = CreateBenchmarkEnum(arena, "Sparse", numConstants, kSparseStep, true, registry);
+		const int numIterations = 65536 / numConstants;
+		const rde::uint64 linearDenseTicks = RunEnumLookupBenchmark(linearDense, numIterations, 1);
+		const rde::uint64 denseTicks = RunEnumLookupBenchmark(dense, numIterations, 1);
+		const rde::uint64 linearSparseTicks = RunEnumLookupBenchmark(linearSparse, numIterations, kSparseStep);
+		const rde::uint64 sparseTicks = RunEnumLookupBenchmark(sparse, numIterations, kSparseStep);
+		printf("Enum lookup, %d constants: dense %d/%d ticks, sparse %d/%d ticks (linear/indexed)\n",
+			numConstants, int(linearDenseTicks), int(denseTicks), int(linearSparseTicks), int(sparseTicks));
+	}
+
+	// Misses, aliases (first one wins), flags.
+	rde::TypeEnum* te = new (arena.Allocate(sizeof(rde::TypeEnum))) rde::TypeEnum(4, "Flags");
+	te->ReserveConstants(6, &arena);
+	te->AddConstant(rde::TypeEnum::Constant("NONE", 0));
+	te->AddConstant(rde::TypeEnum::Constant("FIRST", 1));
+	te->AddConstant(rde::TypeEnum::Constant("SECOND", 2));
+	te->AddConstant(rde::TypeEnum::Constant("FOURTH", 8));
+	te->AddConstant(rde::TypeEnum::Constant("BOTH", 3));
+	te->AddConstant(rde::TypeEnum::Constant("DEFAULT", 2));
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		if (pass == 1)
+			te->OnPostInit(registry);
+		RDE_ASSERT(te->FindConstant("DEFAULT")->m_value == 2);
+		RDE_ASSERT(te->FindConstant("THIRD") == 0);
+		RDE_ASSERT(te->FindConstant(rde::StrId("THIRD").GetId()) == 0);
+		RDE_ASSERT(te->FindConstantByValue(2)->m_name == rde::StrId("SECOND"));
+		RDE_ASSERT(te->FindConstantByValue(3)->m_name == rde::StrId("BOTH"));
+		RDE_ASSERT(te->FindConstantByValue(4) == 0);
+		RDE_ASSERT(te->FindConstantByValue(-1) == 0);
+		long flags(0);
+		RDE_ASSERT(te->EnumerateFlags(1 | 2 | 4 | 8, CollectFlag, &flags) == 4);
+		RDE_ASSERT(flags == (1 | 2 | 8));
+	}
+}
+
+namespace
+{
+int s_numFailedChecks(0);
+
+// Unlike RDE_ASSERT, evaluated in release builds too, failures are reported
+// and make the test return non-zero.
+#define TEST_CHECK(expr)	Check((expr), #expr, __FILE__, __LINE__)
+bool Check(bool ok, const char* expr, const char* file, int line)
+{
+	if (!ok)
+	{
+		++s_numFailedChecks;
+		printf("%s(%d): check failed: %s\n", file, line, expr);
+	}
+	return ok;
+}
+
+// Types below are described by hand, so that tests don't depend on
+// reflection info file.
+struct TestField
+{
+	const char*					name;
+	const char*					typeName;
+	size_t						offset;
+	rde::uint16					flags;
+	const rde::FieldEditInfo*	editInfo;
+};
+#define TEST_FIELD(type, field, typeName)	{ #field, typeName, offsetof(type, field), 0, 0 }
+#define TEST_FIELD_EX(type, field, typeName, flags, editInfo)	{ #field, typeName, offsetof(type, field), flags, editInfo }
+
+rde::TypeClass* AddTestClass(rde::TypeRegistry& registry, size_t size, const char* name,
+	const TestField* fields, int numFields, const char* baseName = 0,
+	rde::TypeClass::FnCreateInstance createInstance = 0, rde::TypeClass::FnInitVTable initVTable = 0)
+{
+	rde::LinearArena& arena = registry.GetArena();
+	// Single inheritance, no vtables in tested classes, so base is at offset 0.
+	rde::TypeClass* tc = new (arena.Allocate(sizeof(rde::TypeClass))) rde::TypeClass(rde::uint32(size),
+		name, createInstance, initVTable, baseName != 0 ? rde::StrId(baseName).GetId() : 0, 0);
+	if (numFields != 0)
+		tc->ReserveFields(numFields, &arena);
+	for (int i = 0; i < numFields; ++i)
+	{
+		rde::Field field(fields[i].name, rde::StrId(fields[i].typeName).GetId(), rde::uint16(fields[i].offset),
+			tc, fields[i].editInfo);
+		field.m_flags = fields[i].flags;
+		tc->AddField(field);
+	}
+	registry.AddType(tc);
+	return tc;
+}
+template<int N>
+rde::TypeClass* AddTestClass(rde::TypeRegistry& registry, size_t size, const char* name,
+	const TestField (&fields)[N], const char* baseName = 0)
+{
+	return AddTestClass(registry, size, name, fields, N, baseName);
+}
+void AddTestArray(rde::TypeRegistry& registry, const char* name, const char* elementTypeName,
+	size_t elementSize, long numElements)
+{
+	rde::LinearArena& arena = registry.GetArena();
+	registry.AddType(new (arena.Allocate(sizeof(rde::TypeArray))) rde::TypeArray(
+		rde::uint32(elementSize * numElements), name, rde::StrId(elementTypeName).GetId(), numElements));
+}
+void AddTestPointer(rde::TypeRegistry& registry, const char* name, const char* pointedTypeName)
+{
+	rde::LinearArena& arena = registry.GetArena();
+	registry.AddType(new (arena.Allocate(sizeof(rde::TypePointer))) rde::TypePointer(sizeof(void*),
+		name, rde::StrId(pointedTypeName).GetId()));
+}
+
+typedef rde::vector<float>	CloneSamples;
+struct CloneNode
+{
+	float			weights[4];
+	double			value;
+	CloneNode*		next;
+	CloneNode*		shared;
+	CloneSamples	samples;
+};
+// Same layout as rde::vector storage (as reflector would describe it).
+struct CloneSamplesLayout
+{
+	float*			m_begin;
+	float*			m_end;
+	int				m_capacity;
+	rde::allocator	m_allocator;
+};
+
+const rde::TypeClass* RegisterCloneNodeTypes(rde::TypeRegistry& registry)
+{
+	RDE_COMPILE_CHECK(sizeof(CloneSamplesLayout) == sizeof(CloneSamples));
+	AddTestPointer(registry, "float*", "float");
+	AddTestArray(registry, "float[4]", "float", sizeof(float), 4);
+	AddTestPointer(registry, "CloneNode*", "CloneNode");
+
+	const TestField samplesFields[] =
+	{
+		TEST_FIELD(CloneSamplesLayout, m_begin, "float*"),
+		TEST_FIELD(CloneSamplesLayout, m_end, "float*"),
+		TEST_FIELD(CloneSamplesLayout, m_capacity, "int32")
+	};
+	AddTestClass(registry, sizeof(CloneSamples), "rde::vector<float>", samplesFields);
+
+	const TestField nodeFields[] =
+	{
+		TEST_FIELD(CloneNode, weights, "float[4]"),
+		TEST_FIELD(CloneNode, value, "double"),
+		TEST_FIELD(CloneNode, next, "CloneNode*"),
+		TEST_FIELD(CloneNode, shared, "CloneNode*"),
+		TEST_FIELD(CloneNode, samples, "rde::vector<float>")
+	};
+	const rde::TypeClass* nodeType = AddTestClass(registry, sizeof(CloneNode), "CloneNode", nodeFields);
+	registry.PostInit();
+	return nodeType;
+}
+
+// Reference implementation, walks fields of every object.
+struct FieldCloneContext
+{
+	typedef rde::flat_hash_map<const void*, void*>	ClonedObjects;
+
+	const void*					src;
+	void*						dst;
+	const rde::TypeClass*		type;
+	const rde::TypeRegistry*	registry;
+	ClonedObjects*				clonedObjects;
+};
+void* CloneFieldByField(const void* src, const rde::TypeClass* type, const rde::TypeRegistry& registry,
+	FieldCloneContext::ClonedObjects& clonedObjects);
+void CloneField(const rde::Field* field, void* userData)
+{
+	const FieldCloneContext* context = static_cast<const FieldCloneContext*>(userData);
+	const void* src = field->GetRawDataPtr(const_cast<void*>(context->src), context->type);
+	void* dst = field->GetRawDataPtr(context->dst, context->type);
+	const rde::Type* fieldType = field->m_type;
+	if (fieldType->m_reflectionType == rde::ReflectionType::POINTER)
+	{
+		const void* pointed = *static_cast<void* const*>(src);
+		const rde::TypePointer* tp = static_cast<const rde::TypePointer*>(fieldType);
+		const rde::TypeClass* pointedClass = rde::ReflectionTypeCast<rde::TypeClass>(
+			context->registry->FindType(tp->m_pointedTypeId));
+		*static_cast<void**>(dst) = CloneFieldByField(pointed, pointedClass, *context->registry,
+			*context->clonedObjects);
+	}
+	else if (fieldType->m_name == rde::StrId("rde::vector<float>"))
+	{
+		new (dst) CloneSamples(*static_cast<const CloneSamples*>(src));
+	}
+	else if (fieldType->m_reflectionType == rde::ReflectionType::CLASS)
+	{
+		FieldCloneContext fieldContext = *context;
+		fieldContext.src = src;
+		fieldContext.dst = dst;
+		fieldContext.type = static_cast<const rde::TypeClass*>(fieldType);
+		fieldContext.type->EnumerateFields(CloneField, rde::ReflectionType::ALL, &fieldContext);
+	}
+	else
+	{
+		rde::Sys::MemCpy(dst, src, fieldType->m_size);
+	}
+}
+void* CloneFieldByField(const void* src, const rde::TypeClass* type, const rde::TypeRegistry& registry,
+	FieldCloneContext::ClonedObjects& clonedObjects)
+{
+	if (src == 0)
+		return 0;
+	FieldCloneContext::ClonedObjects::iterator it = clonedObjects.find(src);
+	if (it != clonedObjects.end())
+		return it->second;
+	void* dst = operator new(type->m_size);
+	clonedObjects.insert(rde::make_pair(src, dst));
+	FieldCloneContext context = { src, dst, type, &registry, &clonedObjects };
+	type->EnumerateFields(CloneField, rde::ReflectionType::ALL, &context);
+	return dst;
+}
+
+void CheckClonedNodes(const CloneNode* src, const CloneNode* clone, int numNodes)
+{
+	for (int i = 0; i < numNodes; ++i)
+	{
+		TEST_CHECK(clone != src);
+		TEST_CHECK(clone->value == src->value && clone->weights[3] == src->weights[3]);
+		TEST_CHECK(clone->samples.size() == src->samples.size());
+		TEST_CHECK(clone->samples.begin() != src->samples.begin());
+		for (int j = 0; j < clone->samples.size(); ++j)
+			TEST_CHECK(clone->samples[j] == src->samples[j]);
+		TEST_CHECK(clone->shared->value == src->shared->value);
+		src = src->next;
+		clone = clone->next;
+	}
+	TEST_CHECK(src == 0 && clone == 0);
+}
+void DeleteClonedNodes(CloneNode* node)
+{
+	while (node)
+	{
+		CloneNode* next = node->next;
+		node->samples.~CloneSamples();
+		operator delete(node);
+		node = next;
+	}
+}
+}
+
+// Object graph of SuperBar with cycle and pointer to field (from reflection info file).
+void TestDeepClone(rde::TypeRegistry& typeRegistry)
+{
+	SuperBar sb;
+	sb.i = 5;
+	sb.s = -100;
+	sb.color.r = 0.7f;
+	sb.p = &sb.color.r;
+	SuperBar sb2;
+	sb2.p = &sb.color.r;
+	sb.psb = &sb2;
+	sb2.psb = &sb;
+	sb.v.push_back(1);
+	sb.v.push_back(2);
+
+	const rde::TypeClass* type = rde::ReflectionTypeCast<rde::TypeClass>(typeRegistry.FindType("SuperBar"));
+	rde::DeepCloner cloner(typeRegistry);
+	SuperBar* psb = cloner.Clone(&sb, type);
+	TEST_CHECK(psb->i == 5 && psb->s == -100);
+	TEST_CHECK(psb->color.r == sb.color.r);
+#if !TEST_PERL
+	TEST_CHECK(psb->VirtualTest() == 5);
+#endif
+	// Shared pointee is cloned once, cycle leads back to clone.
+	TEST_CHECK(psb->p != sb.p && *psb->p == sb.color.r && psb->psb->p == psb->p);
+	TEST_CHECK(psb->psb != &sb2 && psb->psb->psb == psb);
+	TEST_CHECK(psb->v.size() == 2 && psb->v[0] == 1 && psb->v[1] == 2);
+	TEST_CHECK(psb->v.begin() != sb.v.begin());
+}
+
+void BenchmarkDeepClone()
+{
+	rde::TypeRegistry registry;
+	const rde::TypeClass* nodeType = RegisterCloneNodeTypes(registry);
+
+	// List, every node also points to some earlier node.
+	const int kNumNodes = 1000;
+	CloneNode* nodes = new CloneNode[kNumNodes];
+	for (int i = 0; i < kNumNodes; ++i)
+	{
+		CloneNode& node = nodes[i];
+		for (int j = 0; j < 4; ++j)
+			node.weights[j] = float(i + j);
+		node.value = i * 0.5;
+		node.next = (i + 1 < kNumNodes ? &nodes[i + 1] : 0);
+		node.shared = &nodes[(i * 7) / 8];
+		for (int j = 0; j < 1 + (i & 15); ++j)
+			node.samples.push_back(float(j));
+	}
+
+	rde::DeepCloner cloner(registry);
+	FieldCloneContext::ClonedObjects clonedObjects;
+	const int kNumIterations = 20;
+	rde::uint64 clonerTicks(0);
+	rde::uint64 fieldTicks(0);
+	for (int n = 0; n < kNumIterations; ++n)
+	{
+		rde::uint64 tstart = __rdtsc();
+		CloneNode* clone = cloner.Clone(&nodes[0], nodeType);
+		clonerTicks += __rdtsc() - tstart;
+		TEST_CHECK(clone->samples.capacity() == clone->samples.size());
+		CheckClonedNodes(&nodes[0], clone, kNumNodes);
+		DeleteClonedNodes(clone);
+
+		tstart = __rdtsc();
+		clone = static_cast<CloneNode*>(CloneFieldByField(&nodes[0], nodeType, registry, clonedObjects));
+		clonedObjects.clear();
+		fieldTicks += __rdtsc() - tstart;
+		CheckClonedNodes(&nodes[0], clone, kNumNodes);
+		DeleteClonedNodes(clone);
+	}
+	delete[] nodes;
+	printf("DeepClone of %d nodes: compiled plan %d ticks/node, EnumerateFields %d ticks/node (%d plans)\n",
+		kNumNodes, int(clonerTicks / (kNumIterations * kNumNodes)), int(fieldTicks / (kNumIterations * kNumNodes)),
+		cloner.GetNumPlans());
+}
+
+namespace
+{
+struct CompareRecord
+{
+	rde::uint16		id;
+	rde::uint16		flags;
+	float			position[3];
+	double			time;
+	rde::uint8		state[8];
+	rde::uint16		dirtyCounter;	// NO_SERIALIZE
+	CloneSamples	samples;
+};
+
+const rde::TypeClass* RegisterCompareRecordTypes(rde::TypeRegistry& registry)
+{
+	AddTestArray(registry, "float[3]", "float", sizeof(float), 3);
+	AddTestArray(registry, "uint8[8]", "uint8", 1, 8);
+
+	const TestField recordFields[] =
+	{
+		TEST_FIELD(CompareRecord, id, "uint16"),
+		TEST_FIELD(CompareRecord, flags, "uint16"),
+		TEST_FIELD(CompareRecord, position, "float[3]"),
+		TEST_FIELD(CompareRecord, time, "double"),
+		TEST_FIELD(CompareRecord, state, "uint8[8]"),
+		TEST_FIELD_EX(CompareRecord, dirtyCounter, "uint16", rde::FieldFlags::NO_SERIALIZE, 0),
+		TEST_FIELD(CompareRecord, samples, "rde::vector<float>")
+	};
+	const rde::TypeClass* recordType = AddTestClass(registry, sizeof(CompareRecord), "CompareRecord", recordFields);
+	// Also registers float*, vector and CloneNode types (and calls PostInit).
+	RegisterCloneNodeTypes(registry);
+	return recordType;
+}
+
+// Reference implementation, recurses through fields of every object (no pointers
+// in CompareRecord, so they're not handled).
+struct FieldCompareContext
+{
+	const void*				a;
+	const void*				b;
+	const rde::TypeClass*	type;
+	bool					equal;
+};
+bool CompareFieldData(const rde::Type* fieldType, const void* a, const void* b)
+{
+	if (fieldType == rde::TypeOf<float>())
+		return *static_cast<const float*>(a) == *static_cast<const float*>(b);
+	if (fieldType == rde::TypeOf<double>())
+		return *static_cast<const double*>(a) == *static_cast<const double*>(b);
+	return memcmp(a, b, fieldType->m_size) == 0;
+}
+void CompareField(const rde::Field* field, void* userData)
+{
+	FieldCompareContext* context = static_cast<FieldCompareContext*>(userData);
+	if (!context->equal || (field->m_flags & rde::FieldFlags::NO_SERIALIZE) != 0)
+		return;
+	const void* a = field->GetRawDataPtr(const_cast<void*>(context->a), context->type);
+	const void* b = field->GetRawDataPtr(const_cast<void*>(context->b), context->type);
+	const rde::Type* fieldType = field->m_type;
+	if (fieldType->m_reflectionType == rde::ReflectionType::ARRAY)
+	{
+		const rde::TypeArray* ta = static_cast<const rde::TypeArray*>(fieldType);
+		const rde::uint32 elementSize = fieldType->m_size / ta->m_numElements;
+		const rde::Type* elementType = (elementSize == sizeof(float) && field->m_name == rde::StrId("position") ?
+			rde::TypeOf<float>() : rde::TypeOf<unsigned char>());
+		for (long i = 0; i < ta->m_numElements && context->equal; ++i)
+		{
+			context->equal = CompareFieldData(elementType, static_cast<const rde::uint8*>(a) + i * elementSize,
+				static_cast<const rde::uint8*>(b) + i * elementSize);
+		}
+	}
+	else if (fieldType->m_reflectionType == rde::ReflectionType::CLASS)
+	{
+		const CloneSamples& va = *static_cast<const CloneSamples*>(a);
+		const CloneSamples& vb = *static_cast<const CloneSamples*>(b);
+		context->equal = (va.size() == vb.size());
+		for (int i = 0; i < va.size() && context->equal; ++i)
+			context->equal = (va[i] == vb[i]);
+	}
+	else
+	{
+		context->equal = CompareFieldData(fieldType, a, b);
+	}
+}
+bool EqualsFieldByField(const void* a, const void* b, const rde::TypeClass* type)
+{
+	FieldCompareContext context = { a, b, type, true };
+	type->EnumerateFields(CompareField, rde::ReflectionType::ALL, &context);
+	return context.equal;
+}
+}
+
+void BenchmarkObjectCompare()
+{
+	rde::TypeRegistry registry;
+	const rde::TypeClass* recordType = RegisterCompareRecordTypes(registry);
+	rde::ObjectComparer comparer(registry);
+
+	const int kNumRecords = 4096;
+	CompareRecord* records = new CompareRecord[kNumRecords];
+	CompareRecord* copies = new CompareRecord[kNumRecords];
+	for (int i = 0; i < kNumRecords; ++i)
+	{
+		CompareRecord& r = records[i];
+		r.id = rde::uint16(i);
+		r.flags = rde::uint16(i * 3);
+		r.position[0] = float(i);
+		r.position[1] = -0.f;
+		r.position[2] = 1.f / 3.f;
+		r.time = i * 0.25;
+		for (int j = 0; j < 8; ++j)
+			r.state[j] = rde::uint8(i + j);
+		r.dirtyCounter = 0;
+		for (int j = 0; j < 4 + (i & 7); ++j)
+			r.samples.push_back(float(j));
+		copies[i] = r;
+		copies[i].position[1] = 0.f;
+		copies[i].dirtyCounter = rde::uint16(i);
+	}
+	// Every 16th record differs at the end.
+	for (int i = 0; i < kNumRecords; i += 16)
+		copies[i].samples.back() += 1.f;
+
+	int numEqual(0);
+	rde::uint64 tstart = __rdtsc();
+	for (int i = 0; i < kNumRecords; ++i)
+		numEqual += comparer.Equals(&records[i], &copies[i], recordType) ? 1 : 0;
+	const rde::uint64 comparerTicks = __rdtsc() - tstart;
+	TEST_CHECK(numEqual == kNumRecords - kNumRecords / 16);
+
+	numEqual = 0;
+	tstart = __rdtsc();
+	for (int i = 0; i < kNumRecords; ++i)
+		numEqual += EqualsFieldByField(&records[i], &copies[i], recordType) ? 1 : 0;
+	const rde::uint64 fieldTicks = __rdtsc() - tstart;
+	TEST_CHECK(numEqual == kNumRecords - kNumRecords / 16);
+
+	rde::uint32 hashes(0);
+	tstart = __rdtsc();
+	for (int i = 0; i < kNumRecords; ++i)
+		hashes ^= comparer.Hash(&records[i], recordType);
+	const rde::uint64 hashTicks = __rdtsc() - tstart;
+	for (int i = 1; i < kNumRecords; i += 16)
+	{
+		// Equal objects, equal hashes (-0 vs 0, NO_SERIALIZE field differs).
+		TEST_CHECK(comparer.Hash(&records[i], recordType) == comparer.Hash(&copies[i], recordType));
+		TEST_CHECK(comparer.Hash(&records[i], recordType) != comparer.Hash(&records[i + 1], recordType));
+	}
+
+	printf("Equals: compiled plan %d ticks/object, EnumerateFields %d ticks/object, Hash %d ticks/object (%x)\n",
+		int(comparerTicks / kNumRecords), int(fieldTicks / kNumRecords), int(hashTicks / kNumRecords), hashes);
+
+	// Graphs: clone has the same shape, change deep inside is detected.
+	const rde::TypeClass* nodeType = rde::ReflectionTypeCast<rde::TypeClass>(registry.FindType("CloneNode"));
+	const int kNumNodes = 64;
+	CloneNode* nodes = new CloneNode[kNumNodes];
+	for (int i = 0; i < kNumNodes; ++i)
+	{
+		nodes[i].weights[0] = nodes[i].weights[1] = nodes[i].weights[2] = nodes[i].weights[3] = float(i);
+		nodes[i].value = i;
+		nodes[i].next = &nodes[(i + 1) % kNumNodes];
+		nodes[i].shared = &nodes[i / 2];
+	}
+	rde::DeepCloner cloner(registry);
+	CloneNode* clone = cloner.Clone(&nodes[0], nodeType);
+	TEST_CHECK(comparer.Equals(&nodes[0], clone, nodeType));
+	TEST_CHECK(comparer.Hash(&nodes[0], nodeType) == comparer.Hash(clone, nodeType));
+	CloneNode* deepClone = clone;
+	for (int i = 0; i < kNumNodes / 2; ++i)
+		deepClone = deepClone->next;
+	deepClone->samples.push_back(1.f);
+	TEST_CHECK(!comparer.Equals(&nodes[0], clone, nodeType));
+	TEST_CHECK(comparer.Hash(&nodes[0], nodeType) != comparer.Hash(clone, nodeType));
+	deepClone->samples.pop_back();
+	// Same data, different sharing.
+	deepClone->shared = deepClone;
+	TEST_CHECK(!comparer.Equals(&nodes[0], clone, nodeType));
+	delete[] nodes;
+	delete[] records;
+	delete[] copies;
+}
+
+namespace
+{
+struct ReplicatedEntity
+{
+	float				position[3];
+	float				velocity[3];
+	rde::int16			health;
+	rde::uint8			team;
+	rde::uint8			state;
+	rde::uint16			ammo;
+	double				spawnTime;
+	ReplicatedEntity*	target;
+	rde::uint16			localFrame;
+};
+
+const rde::TypeClass* RegisterReplicatedEntityTypes(rde::TypeRegistry& registry)
+{
+	rde::LinearArena& arena = registry.GetArena();
+	AddTestArray(registry, "float[3]", "float", sizeof(float), 3);
+	AddTestPointer(registry, "ReplicatedEntity*", "ReplicatedEntity");
+
+	rde::FieldEditInfo* limits = arena.AllocateArray<rde::FieldEditInfo>(4);
+	limits[0].m_limitMin = -2048.f;
+	limits[0].m_limitMax = 2048.f;
+	limits[1].m_limitMin = -64.f;
+	limits[1].m_limitMax = 64.f;
+	limits[2].m_limitMin = 0.f;
+	limits[2].m_limitMax = 1000.f;
+	limits[3].m_limitMin = 0.f;
+	limits[3].m_limitMax = 3.f;
+
+	const TestField entityFields[] =
+	{
+		TEST_FIELD_EX(ReplicatedEntity, position, "float[3]", rde::FieldFlags::BOUNDED, &limits[0]),
+		TEST_FIELD_EX(ReplicatedEntity, velocity, "float[3]", rde::FieldFlags::BOUNDED, &limits[1]),
+		TEST_FIELD_EX(ReplicatedEntity, health, "int16", rde::FieldFlags::BOUNDED, &limits[2]),
+		TEST_FIELD_EX(ReplicatedEntity, team, "uint8", rde::FieldFlags::BOUNDED, &limits[3]),
+		TEST_FIELD(ReplicatedEntity, state, "uint8"),
+		TEST_FIELD(ReplicatedEntity, ammo, "uint16"),
+		TEST_FIELD(ReplicatedEntity, spawnTime, "double"),
+		TEST_FIELD(ReplicatedEntity, target, "ReplicatedEntity*"),
+		TEST_FIELD_EX(ReplicatedEntity, localFrame, "uint16", rde::FieldFlags::NO_SERIALIZE, 0)
+	};
+	const rde::TypeClass* entityType = AddTestClass(registry, sizeof(ReplicatedEntity), "ReplicatedEntity",
+		entityFields);
+	registry.PostInit();
+	return entityType;
+}
+
+bool ReplicatedStateEqual(const ReplicatedEntity& a, const ReplicatedEntity& b)
+{
+	return memcmp(a.position, b.position, sizeof(a.position)) == 0 &&
+		memcmp(a.velocity, b.velocity, sizeof(a.velocity)) == 0 &&
+		a.health == b.health && a.team == b.team && a.state == b.state && a.ammo == b.ammo &&
+		a.spawnTime == b.spawnTime;
+}
+}
+
+// Server side keeps per-client baseline (what client has), encodes deltas of
+// all entities into one packet, client and baseline apply them.
+void BenchmarkDeltaEncoding()
+{
+	rde::TypeRegistry registry;
+	const rde::TypeClass* entityType = RegisterReplicatedEntityTypes(registry);
+	rde::DeltaEncoder encoder(registry);
+
+	const int kNumEntities = 4096;
+	ReplicatedEntity* entities = new ReplicatedEntity[kNumEntities];
+	ReplicatedEntity* baselines = new ReplicatedEntity[kNumEntities];
+	ReplicatedEntity* clients = new ReplicatedEntity[kNumEntities];
+	memset(entities, 0, kNumEntities * sizeof(ReplicatedEntity));
+	for (int i = 0; i < kNumEntities; ++i)
+	{
+		ReplicatedEntity& e = entities[i];
+		e.position[0] = float(i % 64) * 16.f - 512.f;
+		e.position[1] = 0.f;
+		e.position[2] = float(i / 64) * 16.f - 512.f;
+		e.velocity[0] = float(i % 7) - 3.f;
+		e.velocity[2] = float(i % 5) - 2.f;
+		e.health = 1000;
+		e.team = rde::uint8(i & 3);
+		e.ammo = 100;
+		e.spawnTime = i * 0.01;
+		e.target = &entities[(i + 1) % kNumEntities];
+	}
+
+	const rde::uint32 maxEntityBytes = encoder.GetMaxEncodedSize(entityType);
+	const rde::uint32 packetCapacity = kNumEntities * maxEntityBytes;
+	rde::uint8* packet = new rde::uint8[packetCapacity];
+
+	// Full update first (no baseline),
+	rde::uint32 packetSize(0);
+	for (int i = 0; i < kNumEntities; ++i)
+	{
+		const rde::uint32 bytes = encoder.Encode(0, &entities[i], entityType, packet + packetSize,
+			packetCapacity - packetSize);
+		TEST_CHECK(bytes != 0);
+		packetSize += bytes;
+	}
+	memset(baselines, 0, kNumEntities * sizeof(ReplicatedEntity));
+	memset(clients, 0, kNumEntities * sizeof(ReplicatedEntity));
+	rde::uint32 readPos(0);
+	for (int i = 0; i < kNumEntities; ++i)
+	{
+		const rde::uint32 bytes = encoder.Apply(&clients[i], entityType, packet + readPos, packetSize - readPos);
+		TEST_CHECK(bytes != 0);
+		encoder.Apply(&baselines[i], entityType, packet + readPos, packetSize - readPos);
+		readPos += bytes;
+	}
+	TEST_CHECK(readPos == packetSize);
+	const rde::uint32 fullUpdateSize = packetSize;
+	// Only replicated fields, position within quantization step.
+	TEST_CHECK(clients[5].health == 1000 && clients[5].team == 1 && clients[5].target == 0);
+	TEST_CHECK(fabsf(clients[5].position[0] - entities[5].position[0]) < 4096.f / 65535.f);
+
+	// Nothing changed: 1 byte per entity.
+	rde::uint8 smallBuffer[4];
+	TEST_CHECK(encoder.Encode(&baselines[0], &clients[0], entityType, smallBuffer, 1) == 1);
+	// Doesn't fit/truncated.
+	entities[0].ammo = 99;
+	TEST_CHECK(encoder.Encode(&baselines[0], &entities[0], entityType, smallBuffer, 1) == 0);
+	TEST_CHECK(encoder.Encode(&baselines[0], &entities[0], entityType, smallBuffer, 4) == 3);
+	TEST_CHECK(encoder.Apply(&clients[0], entityType, smallBuffer, 2) == 0 && clients[0].ammo == 100);
+	entities[0].ammo = 100;
+
+	const int kNumTicks = 32;
+	rde::uint64 encodeTicks(0);
+	rde::uint64 applyTicks(0);
+	rde::uint64 totalBytes(0);
+	for (int tick = 0; tick < kNumTicks; ++tick)
+	{
+		// Every 4th entity moves, every 16th is hit, every 64th changes state.
+		for (int i = tick & 3; i < kNumEntities; i += 4)
+		{
+			ReplicatedEntity& e = entities[i];
+			for (int j = 0; j < 3; ++j)
+				e.position[j] += e.velocity[j] * 0.1f;
+			if ((i & 15) == (tick & 15))
+				e.health = rde::int16(e.health > 10 ? e.health - 10 : 1000);
+			if ((i & 63) == (tick & 63))
+				e.state = rde::uint8(e.state + 1);
+			++e.localFrame;
+		}
+
+		packetSize = 0;
+		rde::uint64 tstart = __rdtsc();
+		for (int i = 0; i < kNumEntities; ++i)
+		{
+			packetSize += encoder.Encode(&baselines[i], &entities[i], entityType, packet + packetSize,
+				packetCapacity - packetSize);
+		}
+		encodeTicks += __rdtsc() - tstart;
+		totalBytes += packetSize;
+
+		readPos = 0;
+		tstart = __rdtsc();
+		for (int i = 0; i < kNumEntities; ++i)
+			readPos += encoder.Apply(&clients[i], entityType, packet + readPos, packetSize - readPos);
+		applyTicks += __rdtsc() - tstart;
+		TEST_CHECK(readPos == packetSize);
+
+		readPos = 0;
+		for (int i = 0; i < kNumEntities; ++i)
+			readPos += encoder.Apply(&baselines[i], entityType, packet + readPos, packetSize - readPos);
+	}
+	for (int i = 0; i < kNumEntities; ++i)
+	{
+		TEST_CHECK(ReplicatedStateEqual(clients[i], baselines[i]));
+		TEST_CHECK(clients[i].health == entities[i].health && clients[i].state == entities[i].state);
+		TEST_CHECK(fabsf(clients[i].position[2] - entities[i].position[2]) < 4096.f / 65535.f);
+	}
+
+	const int numUpdates = kNumEntities * kNumTicks;
+	printf("Delta encoding: %.2f bytes/update (full update %.2f, object %d), encode %d ticks/object, apply %d ticks/object\n",
+		double(totalBytes) / numUpdates, double(fullUpdateSize) / kNumEntities, int(sizeof(ReplicatedEntity)),
+		int(encodeTicks / numUpdates), int(applyTicks / numUpdates));
+
+	delete[] packet;
+	delete[] entities;
+	delete[] baselines;
+	delete[] clients;
+}
+
+namespace
+{
+struct JsonNode
+{
+	enum Kind
+	{
+		GROUP,
+		MESH,
+		LIGHT,
+		CAMERA
+	};
+	Kind			kind;
+	char			name[16];
+	float			position[3];
+	double			weight;
+	bool			active;
+	rde::int16		priority;
+	JsonNode*		parent;
+	JsonNode*		next;
+	CloneSamples	samples;
+};
+
+const rde::TypeClass* RegisterJsonNodeTypes(rde::TypeRegistry& registry)
+{
+	rde::LinearArena& arena = registry.GetArena();
+	rde::TypeEnum* kindType = new (arena.Allocate(sizeof(rde::TypeEnum))) rde::TypeEnum(
+		sizeof(JsonNode::Kind), "JsonNode::Kind");
+	kindType->ReserveConstants(4, &arena);
+	kindType->AddConstant(rde::TypeEnum::Constant("GROUP", JsonNode::GROUP));
+	kindType->AddConstant(rde::TypeEnum::Constant("MESH", JsonNode::MESH));
+	kindType->AddConstant(rde::TypeEnum::Constant("LIGHT", JsonNode::LIGHT));
+	kindType->AddConstant(rde::TypeEnum::Constant("CAMERA", JsonNode::CAMERA));
+	registry.AddType(kindType);
+	AddTestArray(registry, "char[16]", "char", 1, 16);
+	AddTestArray(registry, "float[3]", "float", sizeof(float), 3);
+	AddTestPointer(registry, "JsonNode*", "JsonNode");
+
+	const TestField nodeFields[] =
+	{
+		TEST_FIELD(JsonNode, kind, "JsonNode::Kind"),
+		TEST_FIELD(JsonNode, name, "char[16]"),
+		TEST_FIELD(JsonNode, position, "float[3]"),
+		TEST_FIELD(JsonNode, weight, "double"),
+		TEST_FIELD(JsonNode, active, "bool"),
+		TEST_FIELD(JsonNode, priority, "int16"),
+		TEST_FIELD(JsonNode, parent, "JsonNode*"),
+		TEST_FIELD(JsonNode, next, "JsonNode*"),
+		TEST_FIELD(JsonNode, samples, "rde::vector<float>")
+	};
+	const rde::TypeClass* nodeType = AddTestClass(registry, sizeof(JsonNode), "JsonNode", nodeFields);
+
+	// Vector type + PostInit.
+	RegisterCloneNodeTypes(registry);
+	return nodeType;
+}
+
+// List, every node also points to its parent (tree). Some values that
+// are tricky to write as text.
+JsonNode* CreateJsonNodes(int numNodes)
+{
+	JsonNode* nodes = new JsonNode[numNodes];
+	for (int i = 0; i < numNodes; ++i)
+	{
+		JsonNode& node = nodes[i];
+		node.kind = JsonNode::Kind(i & 3);
+		memset(node.name, 0, sizeof(node.name));
+		rde::Sys::StringFormat(node.name, sizeof(node.name), "node_%d", i);
+		node.position[0] = i * 0.25f;
+		node.position[1] = -float(i);
+		node.position[2] = i / 3.f;
+		node.weight = i * 0.1;
+		node.active = (i % 3) == 0;
+		node.priority = rde::int16(i * 37 - 5000);
+		node.parent = (i != 0 ? &nodes[(i - 1) / 2] : 0);
+		node.next = (i + 1 < numNodes ? &nodes[i + 1] : 0);
+		for (int j = 0; j < 1 + (i & 7); ++j)
+			node.samples.push_back(float(i) + j * 0.5f);
+	}
+	strcpy(nodes[7].name, "tab\t\"quoted\"");
+	nodes[9].kind = JsonNode::Kind(7);
+	nodes[11].weight = 1e300;
+	nodes[12].position[1] = 1e-30f;
+	return nodes;
+}
+
+void DeleteJsonNodes(JsonNode* node)
+{
+	while (node)
+	{
+		JsonNode* next = node->next;
+		node->samples.~CloneSamples();
+		operator delete(node);
+		node = next;
+	}
+}
+
+double ToMegabytesPerSecond(rde::uint64 bytes, const rde::Timer& timer)
+{
+	const int ms = timer.GetTimeInMs();
+	return double(bytes) / (1024.0 * 1024.0) * 1000.0 / (ms > 0 ? ms : 1);
+}
+
+// Reference numbers for other formats.
+struct LoadInPlaceSpeed
+{
+	long	imageSize;
+	double	saveSpeed;
+	double	loadSpeed;
+};
+LoadInPlaceSpeed MeasureLoadInPlace(JsonNode* root, rde::TypeRegistry& registry, int numIterations)
+{
+	rde::MemoryStream imageStream;
+	rde::Timer timer;
+	timer.Start();
+	for (int n = 0; n < numIterations; ++n)
+	{
+		imageStream.Clear();
+		SaveObjectImpl(root, "JsonNode", imageStream, registry, 1);
+	}
+	timer.Stop();
+	LoadInPlaceSpeed result;
+	result.imageSize = imageStream.GetSize();
+	result.saveSpeed = ToMegabytesPerSecond(rde::uint64(result.imageSize) * numIterations, timer);
+
+	timer.Start();
+	for (int n = 0; n < numIterations; ++n)
+	{
+		rde::SpanStream istream(imageStream.GetData(), result.imageSize);
+		JsonNode* image = static_cast<JsonNode*>(LoadObjectImpl(istream, registry, 1));
+		TEST_CHECK(image->next->parent == image);
+		operator delete(image);
+	}
+	timer.Stop();
+	result.loadSpeed = ToMegabytesPerSecond(rde::uint64(result.imageSize) * numIterations, timer);
+	return result;
+}
+}
+
+namespace
+{
+struct JsonBlob
+{
+	char	data[64 * 1024];
+};
+typedef rde::vector<JsonBlob>	JsonBlobs;
+struct JsonBlobsLayout
+{
+	JsonBlob*		m_begin;
+	JsonBlob*		m_end;
+	int				m_capacity;
+	rde::allocator	m_allocator;
+};
+struct JsonLimits
+{
+	rde::uint64	big;
+	rde::int64	small;
+	double		value;
+	JsonBlobs	blobs;
+};
+// Same as JsonLimits, but with 1-byte blobs (vector layout doesn't depend on element).
+struct TinyBlob
+{
+	rde::uint8	unused;
+};
+struct TinyLimits
+{
+	rde::uint64				big;
+	rde::int64				small;
+	double					value;
+	rde::vector<TinyBlob>	blobs;
+};
+
+// blobSize - size of JsonBlob (so that tiny blobs can be written and read as big ones).
+const rde::TypeClass* RegisterJsonLimitsTypes(rde::TypeRegistry& registry, size_t blobSize = sizeof(JsonBlob))
+{
+	RDE_COMPILE_CHECK(sizeof(JsonBlobsLayout) == sizeof(JsonBlobs));
+	RDE_COMPILE_CHECK(sizeof(TinyLimits) == sizeof(JsonLimits));
+	AddTestClass(registry, blobSize, "JsonBlob", 0, 0);
+	AddTestPointer(registry, "JsonBlob*", "JsonBlob");
+	const TestField blobsFields[] =
+	{
+		TEST_FIELD(JsonBlobsLayout, m_begin, "JsonBlob*"),
+		TEST_FIELD(JsonBlobsLayout, m_end, "JsonBlob*"),
+		TEST_FIELD(JsonBlobsLayout, m_capacity, "int32")
+	};
+	AddTestClass(registry, sizeof(JsonBlobs), "rde::vector<JsonBlob>", blobsFields);
+	const TestField limitsFields[] =
+	{
+		TEST_FIELD(JsonLimits, big, "uint64"),
+		TEST_FIELD(JsonLimits, small, "int64"),
+		TEST_FIELD(JsonLimits, value, "double"),
+		TEST_FIELD(JsonLimits, blobs, "rde::vector<JsonBlob>")
+	};
+	const rde::TypeClass* limitsType = AddTestClass(registry, sizeof(JsonLimits), "JsonLimits", limitsFields);
+	registry.PostInit();
+	return limitsType;
+}
+
+void AppendText(rde::vector<char>& text, const char* str)
+{
+	const int length = int(strlen(str));
+	const int offset = text.size();
+	text.resize(offset + length);
+	memcpy(text.begin() + offset, str, length);
+}
+JsonLimits* ReadJsonLimits(rde::JsonReader& reader, const char* members, const rde::TypeClass* limitsType)
+{
+	rde::vector<char> json;
+	AppendText(json, "[{\"$type\": \"JsonLimits\", ");
+	AppendText(json, members);
+	AppendText(json, "}]");
+	return reader.Read<JsonLimits>(json.begin(), json.size(), limitsType);
+}
+void DeleteJsonLimits(JsonLimits* limits)
+{
+	if (limits != 0)
+	{
+		limits->blobs.~JsonBlobs();
+		operator delete(limits);
+	}
+}
+}
+
+// Full range of 64-bit integers, numbers that don't fit in fixed buffer,
+// arrays too big to allocate.
+void TestJsonLimits()
+{
+	rde::TypeRegistry registry;
+	const rde::TypeClass* limitsType = RegisterJsonLimitsTypes(registry);
+	rde::JsonReader reader(registry);
+
+	JsonLimits* limits = ReadJsonLimits(reader,
+		"\"big\": 18446744073709551615, \"small\": -9223372036854775808, \"blobs\": [{}, {}]", limitsType);
+	if (TEST_CHECK(limits != 0 && reader.GetError() == 0))
+	{
+		TEST_CHECK(limits->big == ~rde::uint64(0) && limits->small == rde::int64(rde::uint64(1) << 63));
+		TEST_CHECK(limits->blobs.size() == 2);
+	}
+	DeleteJsonLimits(limits);
+	limits = ReadJsonLimits(reader, "\"big\": 10000000000000000000, \"small\": 9223372036854775807", limitsType);
+	TEST_CHECK(limits != 0 && limits->big == 10000000000000000000ULL && limits->small == 0x7FFFFFFFFFFFFFFFLL);
+	DeleteJsonLimits(limits);
+
+	// Round trip of extremes.
+	JsonLimits extremes;
+	extremes.big = ~rde::uint64(0);
+	extremes.small = rde::int64(rde::uint64(1) << 63);
+	extremes.value = 1.7976931348623157e308;
+	rde::JsonWriter writer(registry, false);
+	size_t length;
+	const char* json = writer.Write(&extremes, limitsType, &length);
+	limits = reader.Read<JsonLimits>(json, length, limitsType);
+	TEST_CHECK(limits != 0 && limits->big == extremes.big && limits->small == extremes.small &&
+		limits->value == extremes.value);
+	DeleteJsonLimits(limits);
+
+	// Longer than any fixed buffer, still valid numbers.
+	rde::vector<char> members;
+	AppendText(members, "\"value\": 1.");
+	for (int i = 0; i < 100; ++i)
+		members.push_back('0');
+	AppendText(members, "1e2");
+	members.push_back(0);
+	limits = ReadJsonLimits(reader, members.begin(), limitsType);
+	TEST_CHECK(limits != 0 && limits->value == 100.0);
+	DeleteJsonLimits(limits);
+	members.clear();
+	AppendText(members, "\"value\": -1");
+	for (int i = 0; i < 100; ++i)
+		members.push_back('0');
+	members.push_back(0);
+	limits = ReadJsonLimits(reader, members.begin(), limitsType);
+	TEST_CHECK(limits != 0 && limits->value == -1e100);
+	DeleteJsonLimits(limits);
+
+	const char* const invalid[] =
+	{
+		"\"big\": 18446744073709551616",
+		"\"big\": 184467440737095516150",
+		"\"big\": -1",
+		"\"small\": -9223372036854775809",
+		"\"small\": 9223372036854775808",
+	};
+	for (size_t i = 0; i < RDE_ARRAY_COUNT(invalid); ++i)
+	{
+		limits = ReadJsonLimits(reader, invalid[i], limitsType);
+		TEST_CHECK(limits == 0 && reader.GetError() != 0);
+		DeleteJsonLimits(limits);
+	}
+
+	// 64K elements of 64KB, byte size would wrap to 0 in 32 bits.
+	rde::vector<char> hugeArray;
+	AppendText(hugeArray, "\"blobs\": [{}");
+	for (int i = 1; i < 64 * 1024; ++i)
+		AppendText(hugeArray, ", {}");
+	AppendText(hugeArray, "]");
+	hugeArray.push_back(0);
+	limits = ReadJsonLimits(reader, hugeArray.begin(), limitsType);
+	TEST_CHECK(limits == 0 && reader.GetError() != 0);
+	DeleteJsonLimits(limits);
+}
+
+// Same graph as text and as load-in-place image.
+void BenchmarkJson()
+{
+	rde::TypeRegistry registry;
+	const rde::TypeClass* nodeType = RegisterJsonNodeTypes(registry);
+
+	const int kNumNodes = 1000;
+	JsonNode* nodes = CreateJsonNodes(kNumNodes);
+
+	rde::JsonWriter writer(registry, false);
+	rde::JsonReader reader(registry);
+	rde::ObjectComparer comparer(registry);
+
+	// Round trip, both compact and indented.
+	for (int indent = 0; indent < 2; ++indent)
+	{
+		rde::JsonWriter textWriter(registry, indent != 0);
+		size_t length;
+		const char* json = textWriter.Write(&nodes[0], nodeType, &length);
+		TEST_CHECK(strlen(json) == length);
+		JsonNode* loaded = reader.Read<JsonNode>(json, length, nodeType);
+		TEST_CHECK(loaded != 0 && reader.GetError() == 0);
+		TEST_CHECK(comparer.Equals(&nodes[0], loaded, nodeType));
+		TEST_CHECK(loaded->next->parent == loaded);
+		TEST_CHECK(loaded->next->next->next->next->next->next->next->kind == JsonNode::CAMERA);
+		TEST_CHECK(loaded->samples.capacity() == loaded->samples.size());
+		DeleteJsonNodes(loaded);
+	}
+
+	// Hand written document: members in any order, unknown members, enum
+	// as a number, escapes, whitespace.
+	const char handWritten[] =
+		"[ { \"$type\": \"JsonNode\", \"priority\": -7, \"unknown\": { \"a\": [1, \"]\", {}] },"
+		"  \"name\": \"a\\u00e9\\n\", \"kind\": 2, \"samples\": [ 1.5, -2e1, 3 ],\n"
+		"  \"next\": { \"$ref\": 1 }, \"active\": true },\n"
+		"  { \"$id\": 1, \"$type\": \"JsonNode\", \"kind\": \"MESH\", \"parent\": {\"$ref\":0},"
+		"  \"position\": [1, 2, 3e-2] } ]";
+	JsonNode* loaded = reader.Read<JsonNode>(handWritten, sizeof(handWritten) - 1, nodeType);
+	TEST_CHECK(loaded != 0);
+	TEST_CHECK(loaded->priority == -7 && loaded->kind == JsonNode::LIGHT && loaded->active);
+	TEST_CHECK(strcmp(loaded->name, "a\xC3\xA9\n") == 0);
+	TEST_CHECK(loaded->samples.size() == 3 && loaded->samples[1] == -20.f);
+	TEST_CHECK(loaded->next->kind == JsonNode::MESH && loaded->next->parent == loaded);
+	TEST_CHECK(loaded->next->position[2] == 3e-2f && loaded->next->samples.empty());
+	DeleteJsonNodes(loaded);
+
+	// Errors: truncated, wrong types, out of range, dangling reference.
+	size_t length;
+	const char* json = writer.Write(&nodes[0], nodeType, &length);
+	TEST_CHECK(reader.Read(json, length / 2, nodeType) == 0 && reader.GetError() != 0);
+	const char* const invalid[] =
+	{
+		"",
+		"[]",
+		"[{\"$type\": \"Unknown\"}]",
+		"[{\"$type\": \"JsonNode\", \"kind\": \"NONE\"}]",
+		"[{\"$type\": \"JsonNode\", \"priority\": 40000}]",
+		"[{\"$type\": \"JsonNode\", \"position\": [1, 2, 3, 4]}]",
+		"[{\"$type\": \"JsonNode\", \"next\": {\"$ref\": 1}}]",
+		"[{\"$type\": \"JsonNode\", \"samples\": [1, 2}]",
+		"[{\"$type\": \"JsonNode\"}] x",
+		"[{\"$type\": \"float\", \"$value\": 1}]",
+	};
+	for (size_t i = 0; i < RDE_ARRAY_COUNT(invalid); ++i)
+	{
+		TEST_CHECK(reader.Read(invalid[i], strlen(invalid[i]), nodeType) == 0);
+		TEST_CHECK(reader.GetError() != 0 && reader.GetErrorOffset() <= strlen(invalid[i]));
+	}
+
+	const int kNumIterations = 50;
+	rde::Timer timer;
+	timer.Start();
+	for (int n = 0; n < kNumIterations; ++n)
+		json = writer.Write(&nodes[0], nodeType, &length);
+	timer.Stop();
+	const double writeSpeed = ToMegabytesPerSecond(rde::uint64(length) * kNumIterations, timer);
+
+	timer.Start();
+	for (int n = 0; n < kNumIterations; ++n)
+		DeleteJsonNodes(reader.Read<JsonNode>(json, length, nodeType));
+	timer.Stop();
+	const double readSpeed = ToMegabytesPerSecond(rde::uint64(length) * kNumIterations, timer);
+
+	const LoadInPlaceSpeed loadInPlace = MeasureLoadInPlace(&nodes[0], registry, kNumIterations);
+
+	printf("JSON, %d nodes (%d bytes): write %.1f MB/s, read %.1f MB/s (%d plans); "
+		"load-in-place (%d bytes): save %.1f MB/s, load %.1f MB/s\n",
+		kNumNodes, int(length), writeSpeed, readSpeed, reader.GetNumPlans(), int(loadInPlace.imageSize),
+		loadInPlace.saveSpeed, loadInPlace.loadSpeed);
+	delete[] nodes;
+}
+
+namespace
+{
+// Newer version of JsonNode: fields removed, reordered, added and widened.
+struct EvolvedJsonNode
+{
+	double				weight;
+	rde::int64			priority;
+	float				scale;
+	JsonNode::Kind		kind;
+	EvolvedJsonNode*	next;
+};
+
+const rde::TypeClass* RegisterEvolvedJsonNodeTypes(rde::TypeRegistry& registry)
+{
+	rde::LinearArena& arena = registry.GetArena();
+	rde::TypeEnum* kindType = new (arena.Allocate(sizeof(rde::TypeEnum))) rde::TypeEnum(
+		sizeof(JsonNode::Kind), "JsonNode::Kind");
+	registry.AddType(kindType);
+	AddTestPointer(registry, "JsonNode*", "JsonNode");
+
+	const TestField nodeFields[] =
+	{
+		TEST_FIELD(EvolvedJsonNode, weight, "double"),
+		TEST_FIELD(EvolvedJsonNode, priority, "int64"),
+		TEST_FIELD(EvolvedJsonNode, scale, "float"),
+		TEST_FIELD(EvolvedJsonNode, kind, "JsonNode::Kind"),
+		TEST_FIELD(EvolvedJsonNode, next, "JsonNode*")
+	};
+	// Same name, so it's matched with what older version wrote.
+	const rde::TypeClass* nodeType = AddTestClass(registry, sizeof(EvolvedJsonNode), "JsonNode", nodeFields);
+	registry.PostInit();
+	return nodeType;
+}
+}
+
+// Same graph as JSON benchmark, tagged binary vs load-in-place image.
+void BenchmarkTaggedBinary()
+{
+	rde::TypeRegistry registry;
+	const rde::TypeClass* nodeType = RegisterJsonNodeTypes(registry);
+
+	const int kNumNodes = 1000;
+	JsonNode* nodes = CreateJsonNodes(kNumNodes);
+
+	rde::TaggedBinaryWriter writer(registry);
+	rde::TaggedBinaryReader reader(registry);
+	rde::ObjectComparer comparer(registry);
+
+	rde::uint32 size;
+	const rde::uint8* data = writer.Write(&nodes[0], nodeType, &size);
+	JsonNode* loaded = reader.Read<JsonNode>(data, size, nodeType);
+	TEST_CHECK(loaded != 0 && reader.GetError() == 0);
+	TEST_CHECK(comparer.Equals(&nodes[0], loaded, nodeType));
+	TEST_CHECK(loaded->next->parent == loaded);
+	TEST_CHECK(loaded->samples.capacity() == loaded->samples.size());
+	DeleteJsonNodes(loaded);
+
+	// Every truncated version has to be rejected.
+	for (rde::uint32 cut = 0; cut < size; cut += 97)
+		TEST_CHECK(reader.Read(data, cut, nodeType) == 0 && reader.GetError() != 0);
+
+	// Data written with old version, read with new one.
+	{
+		rde::TypeRegistry evolvedRegistry;
+		const rde::TypeClass* evolvedType = RegisterEvolvedJsonNodeTypes(evolvedRegistry);
+		rde::TaggedBinaryReader evolvedReader(evolvedRegistry);
+		EvolvedJsonNode* evolved = evolvedReader.Read<EvolvedJsonNode>(data, size, evolvedType);
+		TEST_CHECK(evolved != 0 && evolvedReader.GetError() == 0);
+		int numEvolved = 0;
+		while (evolved)
+		{
+			const JsonNode& node = nodes[numEvolved++];
+			TEST_CHECK(evolved->priority == node.priority && evolved->weight == node.weight);
+			TEST_CHECK(evolved->kind == node.kind && evolved->scale == 0.f);
+			EvolvedJsonNode* next = evolved->next;
+			operator delete(evolved);
+			evolved = next;
+		}
+		TEST_CHECK(numEvolved == kNumNodes);
+	}
+
+	// Blobs take 1 byte on the wire, but 64KB in memory, 64K of them
+	// would wrap to 0 bytes in 32 bits.
+	{
+		rde::TypeRegistry tinyRegistry;
+		const rde::TypeClass* tinyType = RegisterJsonLimitsTypes(tinyRegistry, sizeof(TinyBlob));
+		rde::TaggedBinaryWriter tinyWriter(tinyRegistry);
+		rde::TypeRegistry limitsRegistry;
+		const rde::TypeClass* limitsType = RegisterJsonLimitsTypes(limitsRegistry);
+		rde::TaggedBinaryReader limitsReader(limitsRegistry);
+
+		TinyLimits tiny;
+		tiny.big = 1;
+		tiny.small = -1;
+		tiny.value = 0.0;
+		tiny.blobs.resize(2);
+		rde::uint32 tinySize;
+		const rde::uint8* tinyData = tinyWriter.Write(&tiny, tinyType, &tinySize);
+		JsonLimits* limits = limitsReader.Read<JsonLimits>(tinyData, tinySize, limitsType);
+		TEST_CHECK(limits != 0 && limits->blobs.size() == 2 && limits->small == -1);
+		DeleteJsonLimits(limits);
+
+		tiny.blobs.resize(64 * 1024);
+		tinyData = tinyWriter.Write(&tiny, tinyType, &tinySize);
+		TEST_CHECK(limitsReader.Read(tinyData, tinySize, limitsType) == 0 && limitsReader.GetError() != 0);
+	}
+
+	const int kNumIterations = 50;
+	rde::Timer timer;
+	timer.Start();
+	for (int n = 0; n < kNumIterations; ++n)
+		data = writer.Write(&nodes[0], nodeType, &size);
+	timer.Stop();
+	const double writeSpeed = ToMegabytesPerSecond(rde::uint64(size) * kNumIterations, timer);
+
+	timer.Start();
+	for (int n = 0; n < kNumIterations; ++n)
+		DeleteJsonNodes(reader.Read<JsonNode>(data, size, nodeType));
+	timer.Stop();
+	const double readSpeed = ToMegabytesPerSecond(rde::uint64(size) * kNumIterations, timer);
+
+	const LoadInPlaceSpeed loadInPlace = MeasureLoadInPlace(&nodes[0], registry, kNumIterations);
+
+	printf("Tagged binary, %d nodes (%d bytes): write %.1f MB/s, read %.1f MB/s (%d plans); "
+		"load-in-place (%d bytes): save %.1f MB/s, load %.1f MB/s\n",
+		kNumNodes, int(size), writeSpeed, readSpeed, reader.GetNumPlans(), int(loadInPlace.imageSize),
+		loadInPlace.saveSpeed, loadInPlace.loadSpeed);
+	delete[] nodes;
+}
+
+namespace
+{
+struct HandleBase
+{
+	float		weight;
+	rde::int16	priority;
+};
+struct HandleObject : public HandleBase
+{
+	double		value;
+	bool		active;
+	float		scale;
+};
+
+const rde::TypeClass* RegisterHandleTypes(rde::TypeRegistry& registry)
+{
+	const TestField baseFields[] =
+	{
+		TEST_FIELD(HandleBase, weight, "float"),
+		TEST_FIELD(HandleBase, priority, "int16")
+	};
+	AddTestClass(registry, sizeof(HandleBase), "HandleBase", baseFields);
+
+	const TestField objectFields[] =
+	{
+		TEST_FIELD(HandleObject, value, "double"),
+		TEST_FIELD(HandleObject, active, "bool"),
+		TEST_FIELD(HandleObject, scale, "float")
+	};
+	const rde::TypeClass* objectType = AddTestClass(registry, sizeof(HandleObject), "HandleObject", objectFields,
+		"HandleBase");
+	registry.PostInit();
+	return objectType;
+}
+}
+
+// Updating single field of many objects: by name, via Field, via handles.
+void BenchmarkFieldHandles()
+{
+	rde::TypeRegistry registry;
+	const rde::TypeClass* objectType = RegisterHandleTypes(registry);
+
+	TEST_CHECK(!rde::FieldHandle<float>().IsOK());
+	TEST_CHECK(!rde::FieldHandle<double>(objectType, "weight").IsOK());
+	TEST_CHECK(!rde::FieldHandle<float>(objectType, "unknown").IsOK());
+	const rde::FieldHandle<float> weight(objectType, "weight");
+	const rde::FieldHandle<rde::int16> priority(objectType, "priority");
+	const rde::FieldHandle<double> value(objectType, objectType->FindField("value"));
+	const rde::FieldHandle<bool> active(objectType, "active");
+	TEST_CHECK(weight.IsOK() && priority.IsOK() && value.IsOK() && active.IsOK());
+
+	HandleObject object;
+	weight.Set(&object, 1.5f);
+	value.Set(&object, 2.5);
+	TEST_CHECK(object.weight == 1.5f && value.Get(&object) == 2.5);
+
+	const int kNumObjects = 10000;
+	HandleObject* objects = new HandleObject[kNumObjects];
+	void** objectPointers = new void*[kNumObjects];
+	float* weights = new float[kNumObjects];
+	float* loaded = new float[kNumObjects];
+	for (int i = 0; i < kNumObjects; ++i)
+	{
+		objectPointers[i] = &objects[kNumObjects - 1 - i];
+		weights[i] = float(i) * 0.5f;
+	}
+
+	rde::uint64 tstart = __rdtsc();
+	for (int i = 0; i < kNumObjects; ++i)
+		rde::FieldAccessor(&objects[i], objectType, "weight").Set(weights[i]);
+	const rde::uint64 accessorTicks = __rdtsc() - tstart;
+
+	const rde::Field* weightField = objectType->FindField("weight");
+	tstart = __rdtsc();
+	for (int i = 0; i < kNumObjects; ++i)
+		weightField->Set(&objects[i], objectType, weights[i]);
+	const rde::uint64 fieldTicks = __rdtsc() - tstart;
+
+	tstart = __rdtsc();
+	weight.Set(objects, sizeof(HandleObject), kNumObjects, weights);
+	const rde::uint64 stridedTicks = __rdtsc() - tstart;
+	weight.Get(objects, sizeof(HandleObject), kNumObjects, loaded);
+	TEST_CHECK(memcmp(weights, loaded, kNumObjects * sizeof(float)) == 0);
+
+	tstart = __rdtsc();
+	weight.Set(objectPointers, kNumObjects, weights);
+	const rde::uint64 scatteredTicks = __rdtsc() - tstart;
+	weight.Get(objectPointers, kNumObjects, loaded);
+	TEST_CHECK(memcmp(weights, loaded, kNumObjects * sizeof(float)) == 0);
+	TEST_CHECK(objects[0].weight == weights[kNumObjects - 1]);
+
+	priority.Fill(objects, sizeof(HandleObject), kNumObjects, -3);
+	active.Fill(objects, sizeof(HandleObject), kNumObjects, true);
+	TEST_CHECK(objects[kNumObjects - 1].priority == -3 && objects[kNumObjects / 2].active);
+
+	printf("Field update, %d objects: by name %d, Field::Set %d, strided handle %d, scattered handle %d ticks/object\n",
+		kNumObjects, int(accessorTicks / kNumObjects), int(fieldTicks / kNumObjects),
+		int(stridedTicks / kNumObjects), int(scatteredTicks / kNumObjects));
+
+	delete[] loaded;
+	delete[] weights;
+	delete[] objectPointers;
+	delete[] objects;
+}
+
+namespace
+{
+// Typical "fat" simulation object, kernels only touch few fields.
+struct SimParticle
+{
+	float		position[3];
+	float		x;
+	float		vx;
+	float		mass;
+	double		age;
+	rde::uint32	flags;
+	char		name[36];
+};
+
+const rde::TypeClass* RegisterSimParticleTypes(rde::TypeRegistry& registry)
+{
+	AddTestArray(registry, "float[3]", "float", sizeof(float), 3);
+	AddTestArray(registry, "char[36]", "char", 1, 36);
+	const TestField particleFields[] =
+	{
+		TEST_FIELD(SimParticle, position, "float[3]"),
+		TEST_FIELD(SimParticle, x, "float"),
+		TEST_FIELD(SimParticle, vx, "float"),
+		TEST_FIELD(SimParticle, mass, "float"),
+		TEST_FIELD(SimParticle, age, "double"),
+		TEST_FIELD(SimParticle, flags, "uint32"),
+		TEST_FIELD(SimParticle, name, "char[36]")
+	};
+	const rde::TypeClass* particleType = AddTestClass(registry, sizeof(SimParticle), "SimParticle", particleFields);
+	registry.PostInit();
+	return particleType;
+}
+
+// x += vx * dt, returns sum of masses.
+float UpdateParticlesAoS(SimParticle* particles, int numParticles, float dt)
+{
+	float massSum(0.f);
+	for (int i = 0; i < numParticles; ++i)
+	{
+		particles[i].x += particles[i].vx * dt;
+		massSum += particles[i].mass;
+	}
+	return massSum;
+}
+// Columns are aligned and padded, so we always process 4 elements.
+float UpdateParticlesSoA(float* x, const float* vx, const float* mass, int numParticles, float dt)
+{
+	const __m128 vdt = _mm_set1_ps(dt);
+	__m128 vsum = _mm_setzero_ps();
+	int i = 0;
+	for (; i + 4 <= numParticles; i += 4)
+	{
+		_mm_store_ps(x + i, _mm_add_ps(_mm_load_ps(x + i), _mm_mul_ps(_mm_load_ps(vx + i), vdt)));
+		vsum = _mm_add_ps(vsum, _mm_load_ps(mass + i));
+	}
+	RDE_ALIGN(16) float sums[4];
+	_mm_store_ps(sums, vsum);
+	float massSum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+	for (; i < numParticles; ++i)
+	{
+		x[i] += vx[i] * dt;
+		massSum += mass[i];
+	}
+	return massSum;
+}
+}
+
+void BenchmarkSoAContainer()
+{
+	rde::TypeRegistry registry;
+	const rde::TypeClass* particleType = RegisterSimParticleTypes(registry);
+
+	// Base class fields.
+	{
+		rde::TypeRegistry handleRegistry;
+		rde::SoAContainer handles(RegisterHandleTypes(handleRegistry));
+		TEST_CHECK(handles.AddColumn("weight") == 0 && handles.AddColumn("unknown") == -1);
+		HandleObject object;
+		object.weight = 3.f;
+		handles.PushBack(&object);
+		object.weight = 0.f;
+		handles.Gather(0, &object);
+		TEST_CHECK(object.weight == 3.f);
+	}
+
+	rde::SoAContainer soa(particleType);
+	const int xColumn = soa.AddColumn("x");
+	const int vxColumn = soa.AddColumn("vx");
+	const int massColumn = soa.AddColumn("mass");
+	const int positionColumn = soa.AddColumn("position");
+	TEST_CHECK(soa.FindColumn("mass") == massColumn && soa.FindColumn("age") == -1);
+	TEST_CHECK(soa.GetColumnField(positionColumn)->m_type->m_size == 3 * sizeof(float));
+
+	const int kNumParticles = 200000;
+	SimParticle* particles = new SimParticle[kNumParticles];
+	memset(particles, 0, kNumParticles * sizeof(SimParticle));
+	for (int i = 0; i < kNumParticles; ++i)
+	{
+		particles[i].position[1] = float(i);
+		particles[i].x = float(i & 1023);
+		particles[i].vx = float(i & 7) - 3.5f;
+		particles[i].mass = 1.f + float(i & 3);
+	}
+	// Single pushes (growing) and bulk push.
+	for (int i = 0; i < 1000; ++i)
+		soa.PushBack(&particles[i]);
+	TEST_CHECK(soa.PushBack(&particles[1000], sizeof(SimParticle), kNumParticles - 1000) == 1000);
+	TEST_CHECK(soa.GetSize() == kNumParticles);
+	for (int c = 0; c < soa.GetNumColumns(); ++c)
+		TEST_CHECK((reinterpret_cast<size_t>(soa.GetColumn(c)) & (rde::SoAContainer::COLUMN_ALIGNMENT - 1)) == 0);
+	TEST_CHECK(soa.GetColumn<float>(massColumn)[kNumParticles - 1] == particles[kNumParticles - 1].mass);
+
+	const float kDt = 1.f / 64;
+	const int kNumIterations = 20;
+	float aosSum(0.f);
+	rde::Timer timer;
+	timer.Start();
+	for (int n = 0; n < kNumIterations; ++n)
+		aosSum += UpdateParticlesAoS(particles, kNumParticles, kDt);
+	timer.Stop();
+	const int aosTime = timer.GetTimeInMs();
+
+	float* x = soa.GetColumn<float>(xColumn);
+	const float* vx = soa.GetColumn<float>(vxColumn);
+	const float* mass = soa.GetColumn<float>(massColumn);
+	float soaSum(0.f);
+	timer.Start();
+	for (int n = 0; n < kNumIterations; ++n)
+		soaSum += UpdateParticlesSoA(x, vx, mass, kNumParticles, kDt);
+	timer.Stop();
+	const int soaTime = timer.GetTimeInMs();
+	// Exact (values are small integers and dt is power of 2).
+	TEST_CHECK(aosSum == soaSum);
+
+	// Results back to objects.
+	SimParticle* gathered = new SimParticle[kNumParticles];
+	memcpy(gathered, particles, kNumParticles * sizeof(SimParticle));
+	for (int i = 0; i < kNumParticles; ++i)
+		gathered[i].x = 0.f;
+	soa.Gather(0, kNumParticles, gathered, sizeof(SimParticle));
+	TEST_CHECK(memcmp(gathered, particles, kNumParticles * sizeof(SimParticle)) == 0);
+
+	// Erase keeps order, unordered one moves last element.
+	soa.Erase(1);
+	soa.Gather(1, &gathered[0]);
+	TEST_CHECK(gathered[0].x == particles[2].x && gathered[0].position[1] == 2.f);
+	soa.EraseUnordered(1);
+	soa.Gather(1, &gathered[0]);
+	TEST_CHECK(gathered[0].position[1] == float(kNumParticles - 1));
+	TEST_CHECK(soa.GetSize() == kNumParticles - 2);
+
+	printf("SoA, %d particles x %d updates: AoS %d ms, SoA %d ms\n", kNumParticles, kNumIterations,
+		aosTime, soaTime);
+
+	delete[] gathered;
+	delete[] particles;
+}
+
+namespace
+{
+struct SpawnEntity
+{
+	SpawnEntity(): health(100.f), id(0) {}
+	explicit SpawnEntity(EInitVTable) {}
+	virtual ~SpawnEntity() {}
+
+	virtual int GetKind() const
+	{
+		return 3;
+	}
+
+	static void* Reflection_CreateInstance()
+	{
+		return new SpawnEntity();
+	}
+	static void* Reflection_InitVTable(void* mem)
+	{
+		return new (mem) SpawnEntity(INIT_VTABLE);
+	}
+
+	float		position[3];
+	float		health;
+	rde::uint32	id;
+};
+
+// Fields don't matter here, only creation functions.
+const rde::TypeClass* RegisterSpawnEntityType(rde::TypeRegistry& registry)
+{
+	const rde::TypeClass* entityType = AddTestClass(registry, sizeof(SpawnEntity), "SpawnEntity", 0, 0, 0,
+		&SpawnEntity::Reflection_CreateInstance, &SpawnEntity::Reflection_InitVTable);
+	registry.PostInit();
+	return entityType;
+}
+}
+
+// Spawning entities from data: one by one vs batches from pool.
+void BenchmarkInstancePool()
+{
+	rde::TypeRegistry registry;
+	const rde::TypeClass* entityType = RegisterSpawnEntityType(registry);
+	rde::InstancePool pool;
+
+	TEST_CHECK(registry.CreateInstances<SpawnEntity>("Unknown", 10, pool) == 0);
+	SpawnEntity* batch = registry.CreateInstances<SpawnEntity>("SpawnEntity", 100, pool);
+	TEST_CHECK(batch != 0 && pool.GetNumInstances(entityType) == 100);
+	for (int i = 0; i < 100; ++i)
+		TEST_CHECK(batch[i].GetKind() == 3 && batch[i].health == 0.f);
+	// Partial destroy, freed objects are reused (singles and smaller batches).
+	pool.DestroyInstances(batch + 50, entityType, 50);
+	SpawnEntity* single = static_cast<SpawnEntity*>(pool.CreateInstance(entityType));
+	TEST_CHECK(single >= batch + 50 && single < batch + 100 && single->GetKind() == 3);
+	pool.DestroyInstance(single, entityType);
+	TEST_CHECK(pool.CreateInstances<SpawnEntity>(entityType, 50) == batch + 50);
+	pool.DestroyInstances(batch, entityType, 100);
+	TEST_CHECK(pool.GetNumInstances(entityType) == 0);
+
+	const int kNumEntities = 10000;
+	const int kNumRounds = 20;
+	SpawnEntity** entities = new SpawnEntity*[kNumEntities];
+	rde::uint64 tstart = __rdtsc();
+	for (int round = 0; round < kNumRounds; ++round)
+	{
+		for (int i = 0; i < kNumEntities; ++i)
+			entities[i] = registry.CreateInstance<SpawnEntity>("SpawnEntity");
+		for (int i = 0; i < kNumEntities; ++i)
+			delete entities[i];
+	}
+	const rde::uint64 singleTicks = __rdtsc() - tstart;
+	delete[] entities;
+
+	// Spawn waves of different sizes, memory is reused.
+	size_t reservedBytes(0);
+	tstart = __rdtsc();
+	for (int round = 0; round < kNumRounds; ++round)
+	{
+		SpawnEntity* wave = registry.CreateInstances<SpawnEntity>("SpawnEntity", kNumEntities, pool);
+		TEST_CHECK(wave[kNumEntities - 1].GetKind() == 3);
+		pool.DestroyInstances(wave, entityType, kNumEntities);
+		if (round == 0)
+			reservedBytes = pool.GetReservedBytes();
+	}
+	const rde::uint64 pooledTicks = __rdtsc() - tstart;
+	TEST_CHECK(pool.GetReservedBytes() == reservedBytes);
+
+	printf("Spawn %d entities: CreateInstance/delete %d, pooled batch %d ticks/entity (%d KB reserved)\n",
+		kNumEntities, int(singleTicks / (rde::uint64(kNumRounds) * kNumEntities)),
+		int(pooledTicks / (rde::uint64(kNumRounds) * kNumEntities)), int(reservedBytes / 1024));
+}
+
+namespace
+{
+struct TypeLayoutCheck
+{
+	rde::LinearArena*	arena;
+	int					numLoadedTypes;
+};
+void CheckTypeLayout(const rde::Type* t, void* userData)
+{
+	TypeLayoutCheck* check = static_cast<TypeLayoutCheck*>(userData);
+	if (t->m_reflectionType == rde::ReflectionType::FUNDAMENTAL)
+		return;
+	// Loaded types live in registry arena.
+	RDE_ASSERT(check->arena->Owns(t));
+	++check->numLoadedTypes;
+}
+}
+
+void TestTypeRegistryArena(rde::TypeRegistry& typeRegistry)
+{
+	TypeLayoutCheck check = { &typeRegistry.GetArena(), 0 };
+	typeRegistry.EnumerateTypes(CheckTypeLayout, &check);
+	printf("%d types loaded, %d bytes of arena memory\n", check.numLoadedTypes,
+		(int)typeRegistry.GetArena().GetReservedBytes());
+}
+
 int __cdecl main(int, char const *[])
 {
 	EnumerateModules();
@@ -271,8 +3187,11 @@ int __cdecl main(int, char const *[])
 	}
 #endif
 
+	TestTypeRegistryArena(typeRegistry);
+
 	Bar bar;
 	const rde::TypeClass* barType = rde::ReflectionTypeCast<rde::TypeClass>(typeRegistry.FindType("Bar"));
+	RDE_ASSERT(rde::DynamicCast<SuperBar>(&bar, barType) == static_cast<SuperBar*>(&bar));
 
 	rde::FieldAccessor accessor_f(&bar, barType, "f");
 	accessor_f.Set(5.f);
@@ -308,6 +3227,39 @@ int __cdecl main(int, char const *[])
 #endif
 
 	TestCircular(typeRegistry);
+	TestDeepClone(typeRegistry);
+	TestLoadAsync(typeRegistry);
+	TestMemoryStream(typeRegistry);
+	TestCompressedStream(typeRegistry);
+	BenchmarkSaveGraph(typeRegistry);
+	BenchmarkCompression("perltest.ref");
+	BenchmarkCompression("test.lip");
+	BenchmarkJobSystem();
+	BenchmarkHashMaps();
+	BenchmarkAllocator();
+	TestAllocationProfiler();
+	BenchmarkSort();
+	BenchmarkStringUtils();
+	BenchmarkStringStorage();
+	BenchmarkLookupTables();
+	BenchmarkNodeContainers();
+	BenchmarkConcurrentQueues();
+	BenchmarkClassHierarchy();
+	BenchmarkEnumLookup();
+	BenchmarkDeepClone();
+	BenchmarkObjectCompare();
+	BenchmarkDeltaEncoding();
+	TestJsonLimits();
+	BenchmarkJson();
+	BenchmarkTaggedBinary();
+	BenchmarkFieldHandles();
+	BenchmarkSoAContainer();
+	BenchmarkInstancePool();
 
+	if (s_numFailedChecks != 0)
+	{
+		printf("%d checks failed\n", s_numFailedChecks);
+		return 1;
+	}
 	return 0;
 }